@@ -0,0 +1,55 @@
+#pragma once
+
+#include "util/perf.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Tiny benchmark registry. Each bench/*.cpp registers its benchmarks with a
+// file-scope `BenchmarkRegistration`, and `bench <name> [args...]` runs one.
+struct Benchmark
+{
+    std::string name;
+    std::string usage;
+    std::function<int(const std::vector<std::string>& args)> run;
+};
+
+inline std::vector<Benchmark>& benchmarkRegistry()
+{
+    static std::vector<Benchmark> registry;
+    return registry;
+}
+
+struct BenchmarkRegistration
+{
+    BenchmarkRegistration(std::string name, std::string usage,
+                          std::function<int(const std::vector<std::string>&)> run)
+    {
+        benchmarkRegistry().push_back(
+          {std::move(name), std::move(usage), std::move(run)});
+    }
+};
+
+// Runs `fn` `iterations` times and returns the median wall time in ms.
+template <typename Fn>
+double medianMilliseconds(int iterations, Fn&& fn)
+{
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    for (int i = 0; i < iterations; ++i) {
+        Stopwatch timer;
+        fn();
+        samples.push_back(timer.elapsedMilliseconds());
+    }
+    std::ranges::sort(samples);
+    return samples[samples.size() / 2];
+}
+
+// Keeps the optimiser from discarding a computed value.
+template <typename T>
+void doNotOptimise(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
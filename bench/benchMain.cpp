@@ -0,0 +1,36 @@
+#include "bench.hpp"
+
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+    const auto& registry = benchmarkRegistry();
+
+    if (argc < 2) {
+        std::cout << "usage: bench <name> [args...]\n\nbenchmarks:\n";
+        for (const auto& bench : registry) {
+            std::cout << "  " << bench.name << " " << bench.usage << '\n';
+        }
+        return 1;
+    }
+
+    std::string name = argv[1];
+    std::vector<std::string> args(argv + 2, argv + argc);
+
+    for (const auto& bench : registry) {
+        if (bench.name == name) {
+            try {
+                return bench.run(args);
+            } catch (const std::exception& e) {
+                std::cerr << name << " failed: " << e.what() << '\n';
+                return 1;
+            }
+        }
+    }
+
+    std::cout << "unknown benchmark '" << name << "'\n";
+    return 1;
+}
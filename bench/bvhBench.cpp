@@ -0,0 +1,169 @@
+#include "bench.hpp"
+
+#include "frontend/bvh.hpp"
+#include "frontend/camera.hpp"
+#include "frontend/frustum.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr int rayCount = 10000;
+
+// `count` boxes of up to 2 units spread over a cube that keeps their density
+// the same whatever the count, as objects in a growing world would be.
+std::vector<Aabb> randomBoxes(size_t count, std::mt19937& random)
+{
+    float half = 10.0F * std::cbrt(static_cast<float>(count));
+    std::uniform_real_distribution<float> position{-half, half};
+    std::uniform_real_distribution<float> size{0.05F, 1.0F};
+    std::vector<Aabb> boxes(count);
+    for (Aabb& box : boxes) {
+        glm::vec3 center{position(random), position(random), position(random)};
+        glm::vec3 extent{size(random), size(random), size(random)};
+        box = {.min = center - extent, .max = center + extent};
+    }
+    return boxes;
+}
+
+Aabb moved(const Aabb& box, glm::vec3 offset)
+{
+    return {.min = box.min + offset, .max = box.max + offset};
+}
+
+void runBvhBench(size_t count)
+{
+    std::mt19937 random{11};
+    std::vector<Aabb> boxes = randomBoxes(count, random);
+    float half = 10.0F * std::cbrt(static_cast<float>(count));
+
+    //
+    // Build
+    //
+    Bvh bvh;
+    double buildMs = medianMilliseconds(3, [&] { bvh = Bvh{boxes}; });
+    BvhStats built = bvh.getStats();
+    std::cout << std::format(
+      "{:8} primitives: build {:8.2f} ms, {} nodes, {} leaves, depth {}, SAH "
+      "cost {:.1f}, {:.1f} MiB\n",
+      count, buildMs, built.nodes, built.leaves, built.depth, built.sahCost,
+      static_cast<double>(bvh.getMemoryUsage()) / (1024.0 * 1024.0));
+
+    //
+    // Refit after 1% and after all of them moved a little, then after they
+    // have all drifted far enough for a rebuild
+    //
+    std::uniform_real_distribution<float> jitter{-0.5F, 0.5F};
+    auto moveSome = [&](size_t every, float distance) {
+        for (size_t i = 0; i < count; i += every) {
+            glm::vec3 offset{jitter(random), jitter(random), jitter(random)};
+            boxes[i] = moved(boxes[i], offset * distance);
+            bvh.setBox(static_cast<uint32_t>(i), boxes[i]);
+        }
+    };
+    bool rebuilt = false;
+    double refitFewMs = medianMilliseconds(5, [&] {
+        moveSome(100, 1.0F);
+        rebuilt |= bvh.update();
+    });
+    double refitAllMs = medianMilliseconds(5, [&] {
+        moveSome(1, 1.0F);
+        rebuilt |= bvh.update();
+    });
+    size_t driftSteps = 0;
+    while (!bvh.update() && driftSteps < 100) {
+        moveSome(1, half * 0.05F);
+        ++driftSteps;
+    }
+    std::cout << std::format(
+      "          refit 1% {:8.3f} ms, all {:8.3f} ms{}; rebuilt after {} "
+      "large drifts, SAH cost {:.1f} -> {:.1f}\n",
+      refitFewMs, refitAllMs, rebuilt ? " (rebuilt)" : "", driftSteps,
+      built.sahCost, bvh.getStats().sahCost);
+
+    //
+    // Frustum culling from the middle, against testing every box
+    //
+    Camera camera{.position = {0.0F, 0.0F, 0.0F},
+                  .target = {0.0F, 0.0F, -1.0F}};
+    camera.farPlane = half;
+    Frustum frustum{camera};
+    std::vector<uint32_t> visible;
+    double cullMs = medianMilliseconds(11, [&] {
+        visible.clear();
+        bvh.cull(frustum, visible);
+    });
+    size_t linearVisible = 0;
+    double linearMs = medianMilliseconds(11, [&] {
+        linearVisible = std::ranges::count_if(boxes, [&](const Aabb& box) {
+            return frustum.intersectsBox(box);
+        });
+    });
+
+    //
+    // Rays from the middle in every direction, nearest box
+    //
+    std::normal_distribution<float> normal;
+    std::vector<Ray> rays(rayCount);
+    for (Ray& ray : rays) {
+        ray.direction = glm::normalize(
+          glm::vec3{normal(random), normal(random), normal(random)});
+    }
+    size_t hits = 0;
+    double rayMs = medianMilliseconds(5, [&] {
+        hits = 0;
+        for (const Ray& ray : rays) {
+            hits += bvh.raycastBoxes(ray) ? 1 : 0;
+        }
+    });
+    // a few against every box, to check the nearest hits agree
+    size_t wrongHits = 0;
+    for (size_t r = 0; r < 20; ++r) {
+        const Ray& ray = rays[r];
+        glm::vec3 inverseDirection = 1.0F / ray.direction;
+        std::optional<float> nearest;
+        for (const Aabb& box : boxes) {
+            if (auto distance = intersectRayBox(
+                  ray, inverseDirection, box,
+                  nearest.value_or(std::numeric_limits<float>::max())))
+            {
+                nearest = distance;
+            }
+        }
+        std::optional<BvhHit> hit = bvh.raycastBoxes(ray);
+        if (nearest.has_value() != hit.has_value() ||
+            (nearest && *nearest != hit->distance))
+        {
+            ++wrongHits;
+        }
+    }
+
+    std::cout << std::format(
+      "          cull {:8.3f} ms ({} visible), every box {:8.3f} ms ({} "
+      "visible); {} rays {:8.3f} ms ({:.2f} M rays/s, {} hit, {} of 20 "
+      "differ from every box)\n",
+      cullMs, visible.size(), linearMs, linearVisible, rayCount, rayMs,
+      rayCount / rayMs / 1000.0, hits, wrongHits);
+}
+
+// Builds, refits and queries trees over 10k to 1M random boxes.
+int runBvhBenchmarks(const std::vector<std::string>& /*args*/)
+{
+    for (size_t count : {10000, 100000, 1000000}) {
+        runBvhBench(count);
+    }
+    return 0;
+}
+
+BenchmarkRegistration bvhBench{"bvh", "", runBvhBenchmarks};
+} // namespace
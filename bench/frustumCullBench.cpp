@@ -0,0 +1,79 @@
+#include "bench.hpp"
+
+#include "frontend/camera.hpp"
+#include "frontend/frustum.hpp"
+
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr size_t boundCount = 100000;
+
+// `count` boxes of 0.1 to 4 units, each with the sphere around it, spread
+// over a cube of 200 units around the origin.
+CullBounds randomBounds(size_t count)
+{
+    std::mt19937 random{7};
+    std::uniform_real_distribution<float> position{-100.0F, 100.0F};
+    std::uniform_real_distribution<float> size{0.05F, 2.0F};
+    CullBounds bounds;
+    bounds.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        glm::vec3 center{position(random), position(random), position(random)};
+        glm::vec3 extent{size(random), size(random), size(random)};
+        bounds.add({.min = center - extent, .max = center + extent},
+                   glm::length(extent));
+    }
+    return bounds;
+}
+
+// Culls 100k bounds against a camera in the middle of them, one at a time
+// and in batches, and checks both agree.
+int runFrustumCullBench(const std::vector<std::string>& /*args*/)
+{
+    CullBounds bounds = randomBounds(boundCount);
+    Camera camera{.position = {0.0F, 0.0F, 0.0F},
+                  .target = {0.0F, 0.0F, -1.0F}};
+    camera.farPlane = 150.0F;
+    Frustum frustum{camera};
+
+    std::vector<uint8_t> scalarVisible;
+    std::vector<uint8_t> batchVisible;
+    size_t scalarCount = 0;
+    size_t batchCount = 0;
+    double scalarMs = medianMilliseconds(21, [&] {
+        scalarCount = bounds.cullScalar(frustum, scalarVisible);
+        doNotOptimise(scalarVisible.data());
+    });
+    double batchMs = medianMilliseconds(21, [&] {
+        batchCount = bounds.cull(frustum, batchVisible);
+        doNotOptimise(batchVisible.data());
+    });
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < boundCount; ++i) {
+        mismatches += scalarVisible[i] != batchVisible[i] ? 1 : 0;
+    }
+
+    auto report = [](const char* what, double ms, size_t visible) {
+        std::cout << std::format("  {:8} {:8.3f} ms ({:5.2f} ns/bound), {} of "
+                                 "{} visible\n",
+                                 what, ms, ms * 1e6 / boundCount, visible,
+                                 boundCount);
+    };
+    std::cout << std::format("{} bounds, batches compiled for {}\n",
+                             boundCount, frustumSimdPath());
+    report("scalar", scalarMs, scalarCount);
+    report("batched", batchMs, batchCount);
+    std::cout << std::format("  speedup {:.2f}x, {} mismatches\n",
+                             scalarMs / batchMs, mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
+
+BenchmarkRegistration frustumCullBench{"frustumCull", "", runFrustumCullBench};
+} // namespace
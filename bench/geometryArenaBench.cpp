@@ -0,0 +1,161 @@
+#include "bench.hpp"
+
+#include "frontend/GLFWContext.h"
+#include "frontend/camera.hpp"
+#include "frontend/geometryArena.hpp"
+#include "frontend/glState.hpp"
+#include "frontend/loadedObj.hpp"
+#include "frontend/renderQueue.hpp"
+#include "frontend/shader.hpp"
+#include "frontend/window.hpp"
+#include "util/error.hpp"
+#include "util/rangeAllocator.hpp"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+constexpr int frameWidth = 1280;
+constexpr int frameHeight = 720;
+constexpr int copies = 100;
+
+// Allocates and frees ranges of 100 to 10k units at random, as meshes coming
+// and going would, and reports the time per operation and how much of the
+// space ends up in holes.
+void runAllocatorChurn()
+{
+    constexpr size_t capacity = size_t{1} << 24;
+    constexpr int operations = 200000;
+
+    std::vector<std::pair<size_t, size_t>> live;
+    size_t failed = 0;
+    RangeAllocator allocator{capacity};
+    double ms = medianMilliseconds(5, [&] {
+        allocator = RangeAllocator{capacity};
+        live.clear();
+        failed = 0;
+        std::mt19937 random{42};
+        std::uniform_int_distribution<size_t> size{100, 10000};
+        for (int i = 0; i < operations; ++i) {
+            if (!live.empty() && random() % 2 == 0) {
+                size_t victim = random() % live.size();
+                allocator.free(live[victim].first, live[victim].second);
+                live[victim] = live.back();
+                live.pop_back();
+                continue;
+            }
+            size_t count = size(random);
+            if (auto offset = allocator.allocate(count)) {
+                live.emplace_back(*offset, count);
+            } else {
+                ++failed;
+            }
+        }
+    });
+    std::cout << std::format(
+      "RangeAllocator: {} operations in {:.3f} ms ({:.1f} ns each), {} live, "
+      "{} failed, {:.1f}% of the used span in {} holes\n",
+      operations, ms, ms * 1e6 / operations, live.size(), failed,
+      100.0 * static_cast<double>(allocator.getFreeInHoles()) /
+        static_cast<double>(allocator.getUsed() + allocator.getFreeInHoles()),
+      allocator.getFreeRanges().size());
+}
+
+// Queues `copies` copies of a model, loaded with its own buffers per shape
+// and into shared arenas, and reports the frame times and the draw calls and
+// binds each needs.
+void runArenaDraws(const std::filesystem::path& path)
+{
+    GLFWContext glfwContext;
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    Window window{"geometry arenas", frameWidth, frameHeight};
+    std::cout << std::format("GL: {}, multi-draw indirect {}\n",
+                             reinterpret_cast<const char*>(
+                               glGetString(GL_RENDERER)),
+                             multiDrawIndirectSupported() ? "yes" : "no");
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+
+    const std::filesystem::path shaders{"shaders/simpleDiffuseTexturedPhong"};
+    Shader shader{shaders / "vertQuantized.glsl", shaders / "frag.glsl"};
+    Camera camera{.position = {0.0F, 10.0F, 14.0F},
+                  .target = {0.0F, 0.0F, 0.0F}};
+    camera.aspectRatio =
+      static_cast<float>(frameWidth) / static_cast<float>(frameHeight);
+    ObjDrawSettings settings{.meshletCulling = false,
+                             .viewportHeight = frameHeight};
+
+    GeometryArenas arenas;
+    for (bool shared : {false, true}) {
+        ObjLoadOptions options;
+        options.vertexFormat = VertexFormat::Quantized;
+        options.arenas = shared ? &arenas : nullptr;
+        LoadedObject object{path, options};
+        {
+            auto bound = shader.bind();
+            object.setInitUniforms(bound);
+        }
+
+        RenderQueue queue;
+        RenderQueueStats queued;
+        GLStateStats state;
+        double ms = medianMilliseconds(5, [&] {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            GLState::current().invalidate();
+            (void)GLState::current().takeStats();
+            queue.begin(camera);
+            for (int i = 0; i < copies; ++i) {
+                object.pose.scale = glm::vec3{0.01F};
+                object.pose.position =
+                  glm::vec3{static_cast<float>(i % 10 - 5) * 2.0F, 0.0F,
+                            static_cast<float>(i / 10 - 5) * 2.0F};
+                (void)object.submit(queue, shader, camera, settings);
+            }
+            queued = queue.execute();
+            glFinish();
+            state = GLState::current().takeStats();
+        });
+
+        std::cout << std::format(
+          "{:16} {:8.2f} ms: {} packets, {} draw calls ({} multi-draws of {} "
+          "commands), {} VAO binds, {} GL binds issued, {} skipped\n",
+          shared ? "shared arenas" : "buffer per shape", ms, queued.packets,
+          queued.drawCalls, queued.multiDraws, queued.indirectCommands,
+          queued.meshBinds, state.issued, state.skipped);
+        if (shared) {
+            GeometryArenaStats stats = arenas.getStats();
+            std::cout << std::format(
+              "Arenas: {} holding {} allocations, {:.1f} of {:.1f} MiB used, "
+              "{} growths, {} compactions\n",
+              stats.arenas, stats.allocations,
+              static_cast<double>(stats.usedBytes) / (1024.0 * 1024.0),
+              static_cast<double>(stats.capacityBytes) / (1024.0 * 1024.0),
+              stats.growths, stats.compactions);
+        }
+    }
+}
+
+int runGeometryArenaBench(const std::vector<std::string>& args)
+{
+    runAllocatorChurn();
+    try {
+        runArenaDraws(args.empty() ? "assets/models/shaderBall/shaderBall.obj"
+                                   : args[0]);
+    } catch (const IrrecoverableError& e) {
+        std::cout << "Skipped the draws: " << e.msg << "\n";
+    }
+    return 0;
+}
+
+BenchmarkRegistration geometryArenaBench{"geometryArena", "[model.obj]",
+                                         runGeometryArenaBench};
+} // namespace
@@ -0,0 +1,129 @@
+#include "bench.hpp"
+
+#include "frontend/GLFWContext.h"
+#include "frontend/camera.hpp"
+#include "frontend/instancing.hpp"
+#include "frontend/loadedObj.hpp"
+#include "frontend/renderQueue.hpp"
+#include "frontend/shader.hpp"
+#include "frontend/window.hpp"
+#include "util/error.hpp"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr int frameWidth = 1280;
+constexpr int frameHeight = 720;
+
+// `count` copies of `pose` on a square grid in the XZ plane, each turned a
+// little differently.
+void placeGrid(InstanceSet& instances, int count, const WorldPose& pose,
+               float spacing)
+{
+    int side = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count))));
+    float half = static_cast<float>(side - 1) * spacing * 0.5F;
+    instances.poses.resize(count);
+    for (int i = 0; i < count; ++i) {
+        WorldPose& instance = instances.poses[i];
+        instance = pose;
+        instance.position =
+          glm::vec3{static_cast<float>(i % side) * spacing - half, 0.0F,
+                    static_cast<float>(i / side) * spacing - half};
+        instance.rotateAxis(static_cast<float>(i) * 0.1F, {0.0F, 1.0F, 0.0F});
+    }
+}
+
+// Draws 100 to 10k copies of a model, once each through the RenderQueue and
+// as instances, in a hidden window, and reports the frame times.
+int runInstancingBench(const std::vector<std::string>& args)
+{
+    std::filesystem::path path =
+      args.empty() ? "assets/models/shaderBall/shaderBall.obj" : args[0];
+    try {
+        GLFWContext glfwContext;
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        Window window{"instancing", frameWidth, frameHeight};
+        std::cout << std::format("GL: {}\n", reinterpret_cast<const char*>(
+                                               glGetString(GL_RENDERER)));
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+
+        ObjLoadOptions options;
+        options.vertexFormat = VertexFormat::Quantized;
+        LoadedObject object{path, options};
+        object.pose.scale = glm::vec3{0.01F};
+        const std::filesystem::path shaders{"shaders/simpleDiffuseTexturedPhong"};
+        Shader shader{shaders / "vertQuantized.glsl", shaders / "frag.glsl"};
+        Shader instancedShader{shaders / "vertQuantizedInstanced.glsl",
+                               shaders / "frag.glsl"};
+        for (Shader* s : {&shader, &instancedShader}) {
+            auto bound = s->bind();
+            object.setInitUniforms(bound);
+        }
+
+        RenderQueue queue;
+        InstanceSet instances;
+        ObjDrawSettings settings{.meshletCulling = false,
+                                 .viewportHeight = frameHeight};
+
+        for (int count : {100, 1000, 10000}) {
+            constexpr float spacing = 2.0F;
+            placeGrid(instances, count, object.pose, spacing);
+            float extent = std::sqrt(static_cast<float>(count)) * spacing;
+            Camera camera{.position = {0.0F, extent * 0.5F, extent * 0.7F},
+                          .target = {0.0F, 0.0F, 0.0F}};
+            camera.aspectRatio =
+              static_cast<float>(frameWidth) / static_cast<float>(frameHeight);
+            camera.farPlane = extent * 2.0F;
+
+            // one draw per shape and copy
+            RenderQueueStats queued;
+            double queueMs = medianMilliseconds(5, [&] {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                queue.begin(camera);
+                for (const WorldPose& pose : instances.poses) {
+                    object.pose = pose;
+                    (void)object.submit(queue, shader, camera, settings);
+                }
+                queued = queue.execute();
+                glFinish();
+            });
+
+            ObjDrawStats drawn;
+            double instancedMs = medianMilliseconds(5, [&] {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                queue.begin(camera);
+                (void)queue.execute();
+                auto bound = instancedShader.bind();
+                drawn = object.drawInstanced(bound, instances, camera, settings);
+                glFinish();
+            });
+
+            size_t lodDraws = 0;
+            for (size_t lod = 0; lod < maxShapeLods; ++lod) {
+                lodDraws += drawn.shapesPerLod[lod];
+            }
+            std::cout << std::format(
+              "{:6} copies: queued {:8.2f} ms ({} draw calls), instanced "
+              "{:8.2f} ms ({} culled, {} shape instances, {} triangles)\n",
+              count, queueMs, queued.drawCalls, instancedMs,
+              drawn.instancesCulled, lodDraws, drawn.trianglesDrawn);
+        }
+    } catch (const IrrecoverableError& e) {
+        std::cout << "Skipped: " << e.msg << "\n";
+    }
+    return 0;
+}
+
+BenchmarkRegistration instancingBench{"instancing", "[model.obj]",
+                                      runInstancingBench};
+} // namespace
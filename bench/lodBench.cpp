@@ -0,0 +1,116 @@
+#include "bench.hpp"
+
+#include "frontend/meshOptimize.hpp"
+#include "frontend/meshSimplify.hpp"
+#include "frontend/objParser.hpp"
+#include "frontend/vertexDedup.hpp"
+
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <numbers>
+
+namespace
+{
+// A bumpy closed sphere of radius ~1, the kind of dense surface scans give.
+ImportedShape bumpySphere(int rings, int segments)
+{
+    ImportedShape shape;
+    for (int r = 0; r <= rings; ++r) {
+        float theta = std::numbers::pi_v<float> * static_cast<float>(r) /
+                      static_cast<float>(rings);
+        for (int s = 0; s < segments; ++s) {
+            float phi = 2.0F * std::numbers::pi_v<float> *
+                        static_cast<float>(s) / static_cast<float>(segments);
+            glm::vec3 n{std::sin(theta) * std::cos(phi), std::cos(theta),
+                        std::sin(theta) * std::sin(phi)};
+            LoadedObjVertex v;
+            v.position = n * (1.0F + (0.02F * std::sin(12.0F * phi) *
+                                      std::sin(9.0F * theta)));
+            v.normal = n;
+            shape.vertices.push_back(v);
+        }
+    }
+
+    // Wraps around in phi, so the only borders are the degenerate poles
+    auto row = static_cast<uint32_t>(segments);
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < segments; ++s) {
+            uint32_t a = (static_cast<uint32_t>(r) * row) +
+                         static_cast<uint32_t>(s);
+            uint32_t b = (static_cast<uint32_t>(r) * row) +
+                         static_cast<uint32_t>((s + 1) % segments);
+            shape.indices.insert(shape.indices.end(),
+                                 {a, b, a + row, b, b + row, a + row});
+        }
+    }
+    return shape;
+}
+
+std::vector<ImportedShape> shapesOf(const std::filesystem::path& path)
+{
+    std::optional<ParsedObj> chunked = parseObjChunked(path);
+    ParsedObj parsed = chunked ? std::move(*chunked) : parseObjWithTinyObj(path);
+
+    std::vector<ImportedShape> shapes(parsed.shapes.size());
+    for (size_t s = 0; s < parsed.shapes.size(); ++s) {
+        std::vector<LoadedObjVertex> corners;
+        for (const auto& index : parsed.shapes[s].mesh.indices) {
+            corners.emplace_back(index, parsed.attrib);
+        }
+        dedupVertices(corners, shapes[s]);
+        optimizeShape(shapes[s]);
+    }
+    return shapes;
+}
+
+int runLodBench(const std::vector<std::string>& args)
+{
+    std::vector<ImportedShape> shapes;
+    if (args.empty()) {
+        shapes.push_back(bumpySphere(400, 800));
+        optimizeShape(shapes.back());
+    } else {
+        shapes = shapesOf(args[0]);
+    }
+
+    Stopwatch timer;
+    for (auto& shape : shapes) {
+        buildLodChain(shape);
+    }
+    double ms = timer.elapsedMilliseconds();
+
+    // Sum up each level over all shapes; shapes with fewer levels count
+    // with their coarsest one
+    std::array<size_t, maxShapeLods> triangles{};
+    std::array<float, maxShapeLods> error{};
+    std::array<VertexCacheStats, maxShapeLods> cache{};
+    for (const auto& shape : shapes) {
+        for (size_t lod = 0; lod < maxShapeLods && !shape.lods.empty(); ++lod) {
+            const ShapeLod& level =
+              shape.lods[std::min(lod, shape.lods.size() - 1)];
+            triangles[lod] += level.indexCount / 3;
+            error[lod] = std::max(error[lod], level.error);
+            cache[lod] += analyzeVertexCache(
+              std::span<const uint32_t>{shape.indices}.subspan(
+                level.firstIndex, level.indexCount),
+              shape.vertices.size());
+        }
+    }
+
+    std::cout << std::format("Built levels of detail of {} shapes in {:.1f} "
+                             "ms\n",
+                             shapes.size(), ms);
+    for (size_t lod = 0; lod < maxShapeLods; ++lod) {
+        std::cout << std::format("  LOD {}: {:9} triangles ({:5.1f}%), max "
+                                 "error {:.3e}, ACMR {:.3f}\n",
+                                 lod, triangles[lod],
+                                 100.0 * static_cast<double>(triangles[lod]) /
+                                   static_cast<double>(triangles[0]),
+                                 error[lod], cache[lod].acmr());
+    }
+    return 0;
+}
+
+BenchmarkRegistration lodBench{"lod", "[model.obj]", runLodBench};
+} // namespace
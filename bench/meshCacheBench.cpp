@@ -0,0 +1,66 @@
+#include "bench.hpp"
+
+#include "frontend/meshCache.hpp"
+#include "frontend/objImport.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <iostream>
+
+namespace
+{
+// Reads every cached byte once so the warm timing includes page faults,
+// which is what the GPU upload would pay.
+uint64_t touchCache(const MeshCache& cache)
+{
+    uint64_t sum = 0;
+    for (const auto& shape : cache.getShapes()) {
+        for (const auto& v : shape.vertices) {
+            sum += static_cast<uint64_t>(v.position.x);
+        }
+        for (uint16_t i : shape.indices) {
+            sum += i;
+        }
+    }
+    return sum;
+}
+
+int runMeshCacheBench(const std::vector<std::string>& args)
+{
+    std::filesystem::path objPath =
+      args.empty() ? "assets/models/shaderBall/shaderBall.obj" : args[0];
+    int iterations = args.size() > 1 ? std::stoi(args[1]) : 5;
+
+    std::filesystem::remove(MeshCache::pathFor(objPath));
+
+    double coldMs = medianMilliseconds(iterations, [&] {
+        ImportedObject imported = importObjFile(objPath);
+        doNotOptimise(imported.shapes.size());
+    });
+
+    double writeMs = medianMilliseconds(1, [&] {
+        MeshCache::build(objPath, importObjFile(objPath)).save(objPath);
+    });
+
+    double warmMs = medianMilliseconds(iterations, [&] {
+        auto cache = MeshCache::open(objPath);
+        if (!cache) {
+            throw std::runtime_error{"mesh cache missed after writing it"};
+        }
+        doNotOptimise(touchCache(*cache));
+    });
+
+    std::cout << std::format("{}\n"
+                             "  cold (parse .obj + dedup): {:10.3f} ms\n"
+                             "  write cache (incl. parse): {:10.3f} ms\n"
+                             "  warm (map cache + touch):  {:10.3f} ms\n"
+                             "  speedup:                   {:10.1f}x\n",
+                             objPath.string(), coldMs, writeMs, warmMs,
+                             coldMs / warmMs);
+    return 0;
+}
+
+BenchmarkRegistration meshCacheBench{"meshCache", "[model.obj] [iterations]",
+                                     runMeshCacheBench};
+} // namespace
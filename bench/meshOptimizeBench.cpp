@@ -0,0 +1,115 @@
+#include "bench.hpp"
+
+#include "frontend/meshOptimize.hpp"
+#include "frontend/objParser.hpp"
+#include "frontend/vertexDedup.hpp"
+
+#include <algorithm>
+#include <format>
+#include <iostream>
+#include <random>
+
+namespace
+{
+// A `gridSize`² bumpy grid with its triangles shuffled, the worst case for
+// the post-transform cache.
+ImportedShape shuffledGrid(int gridSize)
+{
+    ImportedShape shape;
+    int row = gridSize + 1;
+    for (int y = 0; y <= gridSize; ++y) {
+        for (int x = 0; x <= gridSize; ++x) {
+            LoadedObjVertex v;
+            float u = static_cast<float>(x) / static_cast<float>(gridSize);
+            float w = static_cast<float>(y) / static_cast<float>(gridSize);
+            v.position = {u, w, 0.1F * u * (1.0F - u) * w};
+            v.normal = {0.0F, 0.0F, 1.0F};
+            v.texCoord = {u, w};
+            shape.vertices.push_back(v);
+        }
+    }
+
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (int y = 0; y < gridSize; ++y) {
+        for (int x = 0; x < gridSize; ++x) {
+            auto a = static_cast<uint32_t>((y * row) + x);
+            auto r = static_cast<uint32_t>(row);
+            triangles.push_back({a, a + 1, a + r + 1});
+            triangles.push_back({a, a + r + 1, a + r});
+        }
+    }
+    std::ranges::shuffle(triangles, std::mt19937{42});
+    for (const auto& t : triangles) {
+        shape.indices.insert(shape.indices.end(), t.begin(), t.end());
+    }
+    return shape;
+}
+
+std::vector<ImportedShape> shapesOf(const std::filesystem::path& path)
+{
+    std::optional<ParsedObj> chunked = parseObjChunked(path);
+    ParsedObj parsed = chunked ? std::move(*chunked) : parseObjWithTinyObj(path);
+
+    std::vector<ImportedShape> shapes(parsed.shapes.size());
+    for (size_t s = 0; s < parsed.shapes.size(); ++s) {
+        std::vector<LoadedObjVertex> corners;
+        for (const auto& index : parsed.shapes[s].mesh.indices) {
+            corners.emplace_back(index, parsed.attrib);
+        }
+        dedupVertices(corners, shapes[s]);
+    }
+    return shapes;
+}
+
+VertexCacheStats statsOf(const std::vector<ImportedShape>& shapes)
+{
+    VertexCacheStats stats;
+    for (const auto& shape : shapes) {
+        stats += analyzeVertexCache(shape.indices, shape.vertices.size());
+    }
+    return stats;
+}
+
+int runMeshOptimizeBench(const std::vector<std::string>& args)
+{
+    std::vector<ImportedShape> original =
+      args.empty() ? std::vector<ImportedShape>{shuffledGrid(500)}
+                   : shapesOf(args[0]);
+
+    auto report = [](const char* stage, const VertexCacheStats& stats,
+                     double ms) {
+        std::cout << std::format("  {:<20} ACMR {:6.3f}  ATVR {:6.3f}  "
+                                 "{:10.3f} ms\n",
+                                 stage, stats.acmr(), stats.atvr(), ms);
+    };
+
+    VertexCacheStats before = statsOf(original);
+    std::cout << std::format("{} shapes, {} triangles, {} vertices\n",
+                             original.size(), before.triangles,
+                             before.vertices);
+    report("file order", before, 0.0);
+
+    std::vector<ImportedShape> shapes = original;
+    Stopwatch timer;
+    for (auto& shape : shapes) {
+        optimizeVertexCache(shape.indices, shape.vertices.size());
+    }
+    report("vertex cache", statsOf(shapes), timer.elapsedMilliseconds());
+
+    timer.restart();
+    for (auto& shape : shapes) {
+        optimizeOverdraw(shape.indices, shape.vertices);
+    }
+    report("+ overdraw", statsOf(shapes), timer.elapsedMilliseconds());
+
+    timer.restart();
+    for (auto& shape : shapes) {
+        optimizeVertexFetch(shape);
+    }
+    report("+ vertex fetch", statsOf(shapes), timer.elapsedMilliseconds());
+    return 0;
+}
+
+BenchmarkRegistration meshOptimizeBench{"meshOptimize", "[model.obj]",
+                                        runMeshOptimizeBench};
+} // namespace
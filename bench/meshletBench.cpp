@@ -0,0 +1,144 @@
+#include "bench.hpp"
+
+#include "frontend/meshOptimize.hpp"
+#include "frontend/meshlets.hpp"
+#include "frontend/objImport.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <numbers>
+
+namespace
+{
+// A closed UV sphere of radius 1, front faces outwards.
+ImportedShape sphere(int rings, int segments)
+{
+    ImportedShape shape;
+    for (int r = 0; r <= rings; ++r) {
+        float theta = std::numbers::pi_v<float> * static_cast<float>(r) /
+                      static_cast<float>(rings);
+        for (int s = 0; s <= segments; ++s) {
+            float phi = 2.0F * std::numbers::pi_v<float> *
+                        static_cast<float>(s) / static_cast<float>(segments);
+            LoadedObjVertex v;
+            v.normal = {std::sin(theta) * std::cos(phi), std::cos(theta),
+                        std::sin(theta) * std::sin(phi)};
+            v.position = v.normal;
+            shape.vertices.push_back(v);
+        }
+    }
+
+    auto row = static_cast<uint32_t>(segments + 1);
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < segments; ++s) {
+            uint32_t a = (static_cast<uint32_t>(r) * row) +
+                         static_cast<uint32_t>(s);
+            shape.indices.insert(shape.indices.end(),
+                                 {a, a + 1, a + row, a + 1, a + row + 1,
+                                  a + row});
+        }
+    }
+    return shape;
+}
+
+std::vector<ImportedShape> shapesOf(const std::filesystem::path& path)
+{
+    ImportedObject imported = importObjFile(path);
+    // full detail only
+    for (auto& shape : imported.shapes) {
+        if (!shape.lods.empty()) {
+            shape.indices.resize(shape.lods[0].indexCount);
+        }
+    }
+    return std::move(imported.shapes);
+}
+
+int runMeshletBench(const std::vector<std::string>& args)
+{
+    std::vector<ImportedShape> shapes;
+    if (args.empty()) {
+        shapes.push_back(sphere(500, 1000));
+        optimizeShape(shapes.back());
+    } else {
+        shapes = shapesOf(args[0]);
+    }
+
+    double ms = medianMilliseconds(5, [&] {
+        for (auto& shape : shapes) {
+            shape.meshlets = buildMeshlets(shape.indices, shape.vertices);
+        }
+    });
+
+    size_t meshletCount = 0;
+    size_t triangleCount = 0;
+    size_t openCones = 0;
+    glm::vec3 minPosition{std::numeric_limits<float>::max()};
+    glm::vec3 maxPosition{std::numeric_limits<float>::lowest()};
+    for (const auto& shape : shapes) {
+        meshletCount += shape.meshlets.size();
+        triangleCount += shape.indices.size() / 3;
+        openCones += std::ranges::count_if(shape.meshlets, [](const auto& m) {
+            return m.coneCutoff >= 1.0F;
+        });
+        for (const auto& v : shape.vertices) {
+            minPosition = glm::min(minPosition, glm::vec3{v.position});
+            maxPosition = glm::max(maxPosition, glm::vec3{v.position});
+        }
+    }
+    std::cout << std::format(
+      "{} triangles -> {} meshlets ({:.1f} triangles each, {:.1f}% with no "
+      "usable normal cone) in {:.3f} ms\n",
+      triangleCount, meshletCount,
+      static_cast<double>(triangleCount) / static_cast<double>(meshletCount),
+      100.0 * static_cast<double>(openCones) /
+        static_cast<double>(meshletCount),
+      ms);
+
+    //
+    // Cull from a ring of cameras looking at the model, from further away
+    // and then close enough that parts leave the view
+    //
+    glm::vec3 centre = (minPosition + maxPosition) * 0.5F;
+    float size = glm::length(maxPosition - minPosition);
+    glm::mat4 projection =
+      glm::perspective(glm::radians(60.0F), 16.0F / 9.0F, 0.01F * size,
+                       10.0F * size);
+    for (float distance : {2.0F, 0.35F}) {
+        MeshletCullStats stats;
+        Stopwatch timer;
+        constexpr int views = 16;
+        for (int i = 0; i < views; ++i) {
+            float angle = 2.0F * std::numbers::pi_v<float> *
+                          static_cast<float>(i) / static_cast<float>(views);
+            glm::vec3 eye = centre + (size * distance *
+                                      glm::vec3{std::cos(angle), 0.3F,
+                                                std::sin(angle)});
+            glm::mat4 view = glm::lookAt(eye, centre, {0.0F, 1.0F, 0.0F});
+            MeshletCuller culler{projection * view, glm::mat4{1.0F}, eye};
+            for (const auto& shape : shapes) {
+                for (const auto& meshlet : shape.meshlets) {
+                    doNotOptimise(culler.isVisible(meshlet, stats));
+                }
+            }
+        }
+        std::cout << std::format(
+          "  camera at {:.2f}x size: {:5.1f}% meshlets culled (frustum {}, "
+          "backface {}), {:5.1f}% triangles, {:.3f} ms per view\n",
+          distance,
+          100.0 * static_cast<double>(stats.meshletsCulled()) /
+            static_cast<double>(stats.meshlets),
+          stats.frustumCulled / views, stats.backfaceCulled / views,
+          100.0 * static_cast<double>(stats.trianglesCulled) /
+            static_cast<double>(stats.triangles),
+          timer.elapsedMilliseconds() / views);
+    }
+    return 0;
+}
+
+BenchmarkRegistration meshletBench{"meshlets", "[model.obj]", runMeshletBench};
+} // namespace
@@ -0,0 +1,107 @@
+#include "bench.hpp"
+
+#include "frontend/GLFWContext.h"
+#include "frontend/mipmaps.hpp"
+#include "frontend/texture.hpp"
+#include "frontend/window.hpp"
+#include "util/error.hpp"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <thread>
+
+namespace
+{
+// glGenerateMipmap on `image` in a hidden window, or nothing if there is no
+// GL context to be had (headless, no driver).
+std::optional<double> glGenerateMipmapMilliseconds(const RgbaImage& image)
+{
+    try {
+        GLFWContext glfwContext;
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        Window window{"mipmaps", 64, 64};
+
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB_ALPHA, image.width, image.height,
+                     0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+        glFinish();
+
+        // glFinish, or it only times queueing the work
+        double ms = medianMilliseconds(5, [&] {
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glFinish();
+        });
+        glDeleteTextures(1, &texture);
+        std::cout << std::format("  GL: {} ({})\n",
+                                 reinterpret_cast<const char*>(
+                                   glGetString(GL_RENDERER)),
+                                 reinterpret_cast<const char*>(
+                                   glGetString(GL_VERSION)));
+        return ms;
+    } catch (const IrrecoverableError& e) {
+        std::cout << "  glGenerateMipmap skipped: " << e.msg << "\n";
+        return std::nullopt;
+    }
+}
+
+// Builds the mip chain of the images with both filters across 1, 2, 4, ...
+// threads, and compares against the driver's glGenerateMipmap. Run with
+// LIBGL_ALWAYS_SOFTWARE=1 to measure Mesa's llvmpipe.
+int runMipmapBench(const std::vector<std::string>& args)
+{
+    std::vector<std::filesystem::path> paths{args.begin(), args.end()};
+    if (paths.empty()) {
+        for (const char* name : {"IndentA.tga", "checkerA.tga"}) {
+            paths.emplace_back(
+              std::filesystem::path{"assets/models/shaderBall"} / name);
+        }
+    }
+
+    std::cout << "Filters built for " << mipSimdPath() << "\n";
+    size_t maxThreads = std::max(1U, std::thread::hardware_concurrency());
+    for (const auto& path : paths) {
+        DecodedTexture decoded = DecodedTexture::fromFile(path);
+        RgbaImage image =
+          toRgbaImage(decoded.data(), decoded.width, decoded.height,
+                      decoded.channels, decoded.bgr);
+        double megaTexels =
+          static_cast<double>(image.width) * image.height / 1e6;
+        std::cout << std::format("{} ({}x{})\n", path.string(), image.width,
+                                 image.height);
+
+        for (MipFilter filter : {MipFilter::Box, MipFilter::Kaiser}) {
+            for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+                ThreadPool pool{threads - 1};
+                size_t levels = 0;
+                double ms = medianMilliseconds(5, [&] {
+                    auto mips = buildMipChain(image, true, filter, pool);
+                    levels = mips.size();
+                    doNotOptimise(mips);
+                });
+                std::cout << std::format(
+                  "  CPU {:6}, {:2} threads: {:8.2f} ms ({} levels, "
+                  "{:.1f} MTexel/s)\n",
+                  mipFilterName(filter), threads, ms, levels,
+                  megaTexels / ms * 1000.0);
+            }
+        }
+
+        if (auto ms = glGenerateMipmapMilliseconds(image)) {
+            std::cout << std::format("  glGenerateMipmap:    {:8.2f} ms\n",
+                                     *ms);
+        }
+    }
+    return 0;
+}
+
+BenchmarkRegistration mipmapBench{"mipmaps", "[image...]", runMipmapBench};
+} // namespace
@@ -0,0 +1,84 @@
+#include "bench.hpp"
+
+#include "frontend/objImport.hpp"
+
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+// Writes `shapeCount` separate grid patches of `gridSize`² quads each, the
+// shape of a typical scene export with many small parts.
+std::filesystem::path writeManyShapesObj(int shapeCount, int gridSize)
+{
+    std::filesystem::path path =
+      std::filesystem::temp_directory_path() /
+      std::format("objImportBench_{}x{}.obj", shapeCount, gridSize);
+    if (std::filesystem::exists(path)) {
+        return path;
+    }
+
+    std::ofstream out{path};
+    int row = gridSize + 1;
+    int firstVertex = 1;
+    for (int s = 0; s < shapeCount; ++s) {
+        out << "o part" << s << "\n";
+        for (int y = 0; y <= gridSize; ++y) {
+            for (int x = 0; x <= gridSize; ++x) {
+                float fx = static_cast<float>(x) / static_cast<float>(gridSize);
+                float fy = static_cast<float>(y) / static_cast<float>(gridSize);
+                out << std::format("v {:.6f} {:.6f} {:.6f}\nvt {:.6f} {:.6f}\n",
+                                   fx + static_cast<float>(s), fy, fx * fy, fx,
+                                   fy);
+            }
+        }
+        out << "vn 0 0 1\n";
+        for (int y = 0; y < gridSize; ++y) {
+            for (int x = 0; x < gridSize; ++x) {
+                int a = firstVertex + (y * row) + x;
+                out << std::format("f {0}/{0}/-1 {1}/{1}/-1 {2}/{2}/-1 "
+                                   "{3}/{3}/-1\n",
+                                   a, a + 1, a + row + 1, a + row);
+            }
+        }
+        firstVertex += row * row;
+    }
+    return path;
+}
+
+int runObjImportBench(const std::vector<std::string>& args)
+{
+    std::filesystem::path objPath = args.empty()
+                                      ? writeManyShapesObj(400, 30)
+                                      : std::filesystem::path{args[0]};
+    int iterations = args.size() > 1 ? std::stoi(args[1]) : 3;
+
+    std::cout << objPath.string() << "\n";
+
+    double singleMs = 0.0;
+    size_t maxThreads = std::max(1U, std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        ThreadPool pool{threads - 1};
+        size_t shapes = 0;
+        double ms = medianMilliseconds(iterations, [&] {
+            ImportedObject imported = importObjFile(objPath, pool);
+            shapes = imported.shapes.size();
+            doNotOptimise(shapes);
+        });
+        if (threads == 1) {
+            singleMs = ms;
+            std::cout << std::format("  {} shapes\n", shapes);
+        }
+        std::cout << std::format("  {:3} thr: {:10.3f} ms {:6.2f}x\n", threads,
+                                 ms, singleMs / ms);
+    }
+    return 0;
+}
+
+BenchmarkRegistration objImportBench{"objImport", "[model.obj] [iterations]",
+                                     runObjImportBench};
+} // namespace
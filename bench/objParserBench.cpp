@@ -0,0 +1,190 @@
+#include "bench.hpp"
+
+#include "frontend/objParser.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+// Bumped whenever writeSyntheticObj() writes something else, as the file is
+// kept between runs.
+constexpr int syntheticVersion = 2;
+
+// Writes a `gridSize`² quad grid split into a few groups and objects, with
+// normals, texture coordinates, smoothing groups, relative indices and
+// trailing blanks, so every code path of the parser gets exercised.
+std::filesystem::path writeSyntheticObj(int gridSize)
+{
+    std::filesystem::path path =
+      std::filesystem::temp_directory_path() /
+      std::format("objParserBench_{}_v{}.obj", gridSize, syntheticVersion);
+    if (std::filesystem::exists(path)) {
+        return path;
+    }
+
+    std::ofstream out{path};
+    out << "# synthetic grid\n";
+    for (int y = 0; y <= gridSize; ++y) {
+        for (int x = 0; x <= gridSize; ++x) {
+            float fx = static_cast<float>(x) / static_cast<float>(gridSize);
+            float fy = static_cast<float>(y) / static_cast<float>(gridSize);
+            out << std::format("v {:.6f} {:.6f} {:.6e}\n", fx * 10.0F,
+                               fy * 10.0F, fx * fy * 0.001F);
+            out << std::format("vt {:.6f} {:.6f}\n", fx, fy);
+        }
+    }
+    out << "vn 0 0 1\nvn 0.0 -0.5 0.866025\n";
+
+    int row = gridSize + 1;
+    int groupRows = (gridSize / 4) + 1;
+    for (int y = 0; y < gridSize; ++y) {
+        // Alternately a group and an object whose name keeps its trailing
+        // blank; the object is split halfway along its first row by a `g `
+        // line, which starts an unnamed shape
+        bool object = (y / groupRows) % 2 != 0;
+        if (y % groupRows == 0) {
+            if (object) {
+                out << "o object" << y << " \n";
+            } else {
+                out << "g part" << y << " extra \t\n";
+            }
+            out << "s " << (y % 3 == 0 ? "off" : "1") << " \n";
+        }
+        for (int x = 0; x < gridSize; ++x) {
+            if (object && y % groupRows == 0 && x == gridSize / 2) {
+                out << "g \n";
+            }
+            int a = (y * row) + x + 1;
+            int b = a + 1;
+            int c = a + row + 1;
+            int d = a + row;
+            if ((x + y) % 2 == 0) {
+                out << std::format("f {0}/{0}/1 {1}/{1}/1 {2}/{2}/2 {3}/{3}/2\n",
+                                   a, b, c, d);
+            } else {
+                out << std::format("f {}//-1 {}//-2 {}//-1\n", a, b, c);
+            }
+        }
+    }
+    return path;
+}
+
+template <typename T>
+bool sameBits(const std::vector<T>& a, const std::vector<T>& b)
+{
+    return a.size() == b.size() &&
+           std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+bool sameIndices(const std::vector<tinyobj::index_t>& a,
+                 const std::vector<tinyobj::index_t>& b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].vertex_index != b[i].vertex_index ||
+            a[i].normal_index != b[i].normal_index ||
+            a[i].texcoord_index != b[i].texcoord_index)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns a description of the first difference, or an empty string.
+std::string compare(const ParsedObj& expected, const ParsedObj& actual)
+{
+    if (!sameBits(expected.attrib.vertices, actual.attrib.vertices)) {
+        return "positions differ";
+    }
+    if (!sameBits(expected.attrib.normals, actual.attrib.normals)) {
+        return "normals differ";
+    }
+    if (!sameBits(expected.attrib.texcoords, actual.attrib.texcoords)) {
+        return "texcoords differ";
+    }
+    if (!sameBits(expected.attrib.colors, actual.attrib.colors)) {
+        return "colors differ";
+    }
+    if (expected.shapes.size() != actual.shapes.size()) {
+        return std::format("shape count {} vs {}", expected.shapes.size(),
+                           actual.shapes.size());
+    }
+    for (size_t s = 0; s < expected.shapes.size(); ++s) {
+        const auto& e = expected.shapes[s];
+        const auto& a = actual.shapes[s];
+        if (e.name != a.name || !sameIndices(e.mesh.indices, a.mesh.indices) ||
+            e.mesh.num_face_vertices != a.mesh.num_face_vertices ||
+            e.mesh.material_ids != a.mesh.material_ids ||
+            e.mesh.smoothing_group_ids != a.mesh.smoothing_group_ids)
+        {
+            return std::format("shape {} ('{}') differs", s, e.name);
+        }
+    }
+    if (expected.materials.size() != actual.materials.size()) {
+        return "material count differs";
+    }
+    for (size_t m = 0; m < expected.materials.size(); ++m) {
+        if (expected.materials[m].name != actual.materials[m].name) {
+            return std::format("material {} differs", m);
+        }
+    }
+    return {};
+}
+
+int runObjParserBench(const std::vector<std::string>& args)
+{
+    std::filesystem::path objPath =
+      args.empty() ? writeSyntheticObj(800) : std::filesystem::path{args[0]};
+    int iterations = args.size() > 1 ? std::stoi(args[1]) : 3;
+    double megabytes =
+      static_cast<double>(std::filesystem::file_size(objPath)) / 1.0e6;
+
+    ParsedObj reference = parseObjWithTinyObj(objPath);
+    double tinyObjMs = medianMilliseconds(iterations, [&] {
+        doNotOptimise(parseObjWithTinyObj(objPath).shapes.size());
+    });
+
+    std::cout << std::format("{} ({:.1f} MB)\n"
+                             "  tinyobj:            {:10.3f} ms {:8.1f} MB/s\n",
+                             objPath.string(), megabytes, tinyObjMs,
+                             megabytes / (tinyObjMs / 1000.0));
+
+    size_t maxThreads = std::max(1U, std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        // the calling thread counts as one
+        ThreadPool pool{threads - 1};
+
+        std::optional<ParsedObj> chunked = parseObjChunked(objPath, pool);
+        if (!chunked) {
+            std::cout << "  chunked parser does not handle this file\n";
+            return 0;
+        }
+        std::string mismatch = compare(reference, *chunked);
+        if (!mismatch.empty()) {
+            throw std::runtime_error{"chunked parser output differs from "
+                                     "tinyobj: " +
+                                     mismatch};
+        }
+
+        double ms = medianMilliseconds(iterations, [&] {
+            doNotOptimise(parseObjChunked(objPath, pool)->shapes.size());
+        });
+        std::cout << std::format(
+          "  chunked {:3} thr:    {:10.3f} ms {:8.1f} MB/s {:6.1f}x\n", threads,
+          ms, megabytes / (ms / 1000.0), tinyObjMs / ms);
+    }
+    return 0;
+}
+
+BenchmarkRegistration objParserBench{"objParser", "[model.obj] [iterations]",
+                                     runObjParserBench};
+} // namespace
@@ -0,0 +1,229 @@
+#include "bench.hpp"
+
+#include "frontend/bvh.hpp"
+#include "frontend/camera.hpp"
+#include "frontend/frustum.hpp"
+#include "frontend/occlusion.hpp"
+#include "util/threadPool.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+constexpr size_t testBoxCount = 10000;
+
+// Appends the 12 triangles of `box`, counter-clockwise seen from outside.
+void addBox(OccluderMesh& mesh, const Aabb& box)
+{
+    auto base = static_cast<uint32_t>(mesh.positions.size());
+    for (uint32_t corner = 0; corner < 8; ++corner) {
+        mesh.positions.emplace_back((corner & 1U) != 0 ? box.max.x : box.min.x,
+                                    (corner & 2U) != 0 ? box.max.y : box.min.y,
+                                    (corner & 4U) != 0 ? box.max.z : box.min.z);
+    }
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+        uint32_t u = 1U << ((axis + 1) % 3);
+        uint32_t v = 1U << ((axis + 2) % 3);
+        for (uint32_t side = 0; side < 2; ++side) {
+            uint32_t face = side != 0 ? 1U << axis : 0U;
+            uint32_t quad[4] = {face, face | u, face | u | v, face | v};
+            if (side == 0) {
+                std::swap(quad[1], quad[3]);
+            }
+            for (uint32_t index : {quad[0], quad[1], quad[2], quad[0], quad[2],
+                                   quad[3]})
+            {
+                mesh.indices.push_back(base + index);
+            }
+        }
+    }
+}
+
+// `count` walls, 3 units high and 2 to 8 long, facing along x or z, in
+// front of a camera at the origin looking down -z.
+OccluderMesh randomWalls(size_t count, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> across{-40.0F, 40.0F};
+    std::uniform_real_distribution<float> along{-80.0F, -2.0F};
+    std::uniform_real_distribution<float> length{1.0F, 4.0F};
+    OccluderMesh walls;
+    for (size_t i = 0; i < count; ++i) {
+        glm::vec3 center{across(random), 0.0F, along(random)};
+        glm::vec3 extent{length(random), 1.5F, 0.1F};
+        if (i % 2 != 0) {
+            std::swap(extent.x, extent.z);
+        }
+        addBox(walls, {.min = center - extent, .max = center + extent});
+    }
+    return walls;
+}
+
+std::vector<Aabb> randomBoxes(size_t count, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> across{-40.0F, 40.0F};
+    std::uniform_real_distribution<float> height{-1.2F, 1.2F};
+    std::uniform_real_distribution<float> along{-100.0F, -2.0F};
+    std::uniform_real_distribution<float> size{0.05F, 0.3F};
+    std::vector<Aabb> boxes(count);
+    for (Aabb& box : boxes) {
+        glm::vec3 center{across(random), height(random), along(random)};
+        glm::vec3 extent{size(random), size(random), size(random)};
+        box = {.min = center - extent, .max = center + extent};
+    }
+    return boxes;
+}
+
+// Whether any of 25 points on each face of `box` inside the view can be
+// seen from the camera past `walls`.
+bool anyPointSeen(const Aabb& box, const Camera& camera,
+                  const glm::mat4& clipFromWorld, const RaycastMesh& walls)
+{
+    constexpr int steps = 4;
+    for (int axis = 0; axis < 3; ++axis) {
+        for (int side = 0; side < 2; ++side) {
+            for (int i = 0; i <= steps; ++i) {
+                for (int j = 0; j <= steps; ++j) {
+                    glm::vec3 t{0.0F};
+                    t[axis] = static_cast<float>(side);
+                    t[(axis + 1) % 3] = static_cast<float>(i) / steps;
+                    t[(axis + 2) % 3] = static_cast<float>(j) / steps;
+                    glm::vec3 point = box.min + ((box.max - box.min) * t);
+                    glm::vec4 clip = clipFromWorld * glm::vec4{point, 1.0F};
+                    if (clip.x < -clip.w || clip.x > clip.w ||
+                        clip.y < -clip.w || clip.y > clip.w ||
+                        clip.z < -clip.w || clip.z > clip.w)
+                    {
+                        continue;
+                    }
+                    // 1 is the point itself
+                    Ray ray{.origin = camera.position,
+                            .direction = point - camera.position};
+                    if (!walls.raycast(ray, 0.9999F)) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void runOcclusionBench(size_t wallCount, int width, int height)
+{
+    std::mt19937 random{5};
+    OccluderMesh walls = randomWalls(wallCount, random);
+    std::vector<Aabb> boxes = randomBoxes(testBoxCount, random);
+
+    Camera camera{.position = {0.0F, 0.0F, 0.0F},
+                  .target = {0.0F, 0.0F, -1.0F}};
+    camera.aspectRatio =
+      static_cast<float>(width) / static_cast<float>(height);
+    glm::mat4 clipFromWorld =
+      camera.computeProjectionMatrix() * camera.computeViewMatrix();
+
+    OcclusionBuffer buffer{width, height};
+    auto rasterise = [&](ThreadPool& pool, bool scalar) {
+        return medianMilliseconds(11, [&] {
+            buffer.begin(clipFromWorld);
+            buffer.addOccluder(walls, glm::mat4{1.0F});
+            if (scalar) {
+                buffer.rasteriseScalar(pool);
+            } else {
+                buffer.rasterise(pool);
+            }
+        });
+    };
+
+    //
+    // Rasterising, a pixel at a time and vectorised, on one thread and all
+    //
+    ThreadPool singleThread{0};
+    double scalarMs = rasterise(ThreadPool::global(), true);
+    std::vector<float> scalarDepths;
+    for (int y = 0; y < buffer.getHeight(); ++y) {
+        for (int x = 0; x < buffer.getWidth(); ++x) {
+            scalarDepths.push_back(buffer.getDepth(x, y));
+        }
+    }
+    double singleMs = rasterise(singleThread, false);
+    double pooledMs = rasterise(ThreadPool::global(), false);
+    size_t differing = 0;
+    size_t covered = 0;
+    for (int y = 0; y < buffer.getHeight(); ++y) {
+        for (int x = 0; x < buffer.getWidth(); ++x) {
+            float depth = buffer.getDepth(x, y);
+            size_t pixel = (static_cast<size_t>(y) * buffer.getWidth()) + x;
+            differing += depth != scalarDepths[pixel] ? 1 : 0;
+            covered += depth > 0.0F ? 1 : 0;
+        }
+    }
+    const OcclusionStats& stats = buffer.getStats();
+
+    //
+    // Testing boxes, and checking the hidden ones really are
+    //
+    Frustum frustum{clipFromWorld};
+    size_t inFrustum = 0;
+    size_t hidden = 0;
+    double testMs = medianMilliseconds(11, [&] {
+        inFrustum = 0;
+        hidden = 0;
+        for (const Aabb& box : boxes) {
+            if (frustum.intersectsBox(box)) {
+                ++inFrustum;
+                hidden += buffer.isVisible(box) ? 0 : 1;
+            }
+        }
+    });
+    RaycastMesh wallMesh{walls.positions, walls.indices};
+    size_t wronglyHidden = 0;
+    for (const Aabb& box : boxes) {
+        if (frustum.intersectsBox(box) && !buffer.isVisible(box) &&
+            anyPointSeen(box, camera, clipFromWorld, wallMesh))
+        {
+            ++wronglyHidden;
+        }
+    }
+
+    std::cout << std::format(
+      "{:6} walls ({} triangles, {} rasterised), {}x{}, {:.0f}% covered\n",
+      wallCount, stats.triangles, stats.trianglesRasterised,
+      buffer.getWidth(), buffer.getHeight(),
+      100.0 * static_cast<double>(covered) /
+        static_cast<double>(scalarDepths.size()));
+    std::cout << std::format(
+      "  rasterise: scalar {:7.3f} ms, {} 1 thread {:7.3f} ms, {} threads "
+      "{:7.3f} ms; {} pixels differ\n",
+      scalarMs, occlusionSimdPath(), singleMs, ThreadPool::global().size() + 1,
+      pooledMs, differing);
+    std::cout << std::format(
+      "  test: {} boxes in the frustum, {} hidden, in {:.3f} ms ({:.1f} "
+      "ns/box); {} hidden yet reached by a ray\n",
+      inFrustum, hidden, testMs,
+      testMs * 1e6 / static_cast<double>(std::max<size_t>(inFrustum, 1)),
+      wronglyHidden);
+}
+
+// Rasterises random walls into buffers of two sizes, and tests 10k boxes
+// behind them.
+int runOcclusionBenchmarks(const std::vector<std::string>& /*args*/)
+{
+    for (auto [width, height] : {std::pair{256, 128}, std::pair{512, 256}}) {
+        for (size_t walls : {100, 1000, 10000}) {
+            runOcclusionBench(walls, width, height);
+        }
+    }
+    return 0;
+}
+
+BenchmarkRegistration occlusionBench{"occlusion", "", runOcclusionBenchmarks};
+} // namespace
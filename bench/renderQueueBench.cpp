@@ -0,0 +1,127 @@
+#include "bench.hpp"
+
+#include "frontend/renderQueue.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <random>
+#include <string>
+#include <tuple>
+
+namespace
+{
+struct Scene
+{
+    std::vector<DrawPacket> packets;
+    std::vector<glm::vec3> centers;
+};
+
+// `count` draws spread over a handful of programs, tens of textures and many
+// meshes, in random order. The pointers are made up: nothing is executed.
+Scene randomScene(size_t count)
+{
+    std::mt19937 rng{42};
+    std::uniform_int_distribution<uintptr_t> shader{1, 4};
+    std::uniform_int_distribution<uint32_t> texture{1, 48};
+    std::uniform_int_distribution<uintptr_t> mesh{1, 4096};
+    std::uniform_real_distribution<float> position{-50.0F, 50.0F};
+
+    Scene scene;
+    for (size_t i = 0; i < count; ++i) {
+        DrawPacket packet;
+        packet.shader = reinterpret_cast<Shader*>(shader(rng) * 0x1000);
+        packet.mesh = reinterpret_cast<const Mesh*>(mesh(rng) * 0x40);
+        packet.material.texture = texture(rng);
+        packet.indexCount = 3;
+        scene.packets.push_back(packet);
+        scene.centers.emplace_back(position(rng), position(rng),
+                                   position(rng));
+    }
+    return scene;
+}
+
+// Program, texture and mesh changes when drawing `packet(i)` in order.
+template <typename PacketAt>
+std::tuple<size_t, size_t, size_t> stateChanges(size_t count, PacketAt packet)
+{
+    size_t programs = 0;
+    size_t textures = 0;
+    size_t meshes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const DrawPacket& p = packet(i);
+        const DrawPacket* last = i > 0 ? &packet(i - 1) : nullptr;
+        programs += last == nullptr || last->shader != p.shader ? 1 : 0;
+        textures += last == nullptr ||
+                        last->material.texture != p.material.texture
+                      ? 1
+                      : 0;
+        meshes += last == nullptr || last->mesh != p.mesh ? 1 : 0;
+    }
+    return {programs, textures, meshes};
+}
+
+// Submits and sorts scenes of 1k to 100k draws, against std::sort on the
+// same fields, and counts the state changes left in the sorted order.
+int runRenderQueueBench(const std::vector<std::string>& /*args*/)
+{
+    Camera camera;
+    camera.position = glm::vec3{0.0F, 0.0F, 80.0F};
+    camera.farPlane = 200.0F;
+
+    RenderQueue queue;
+    for (size_t count : {1000, 10000, 100000}) {
+        Scene scene = randomScene(count);
+
+        double queueMs = medianMilliseconds(9, [&] {
+            queue.begin(camera);
+            for (size_t i = 0; i < count; ++i) {
+                queue.submit(scene.packets[i], scene.centers[i]);
+            }
+            queue.sort();
+            doNotOptimise(queue.sortedPacket(0));
+        });
+
+        std::vector<size_t> order(count);
+        double stdSortMs = medianMilliseconds(9, [&] {
+            glm::vec3 forward = camera.computeForward();
+            std::vector<float> depths(count);
+            for (size_t i = 0; i < count; ++i) {
+                order[i] = i;
+                depths[i] = glm::dot(scene.centers[i] - camera.position,
+                                     forward);
+            }
+            std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                const DrawPacket& pa = scene.packets[a];
+                const DrawPacket& pb = scene.packets[b];
+                return std::tie(pa.shader, pa.material.texture, depths[a],
+                                pa.mesh) < std::tie(pb.shader,
+                                                    pb.material.texture,
+                                                    depths[b], pb.mesh);
+            });
+            doNotOptimise(order);
+        });
+
+        auto [unsortedPrograms, unsortedTextures, unsortedMeshes] =
+          stateChanges(count, [&](size_t i) -> const DrawPacket& {
+              return scene.packets[i];
+          });
+        auto [programs, textures, meshes] =
+          stateChanges(count, [&](size_t i) -> const DrawPacket& {
+              return queue.sortedPacket(i);
+          });
+
+        std::cout << std::format(
+          "{:6} draws: submit + radix sort {:7.3f} ms, std::sort {:7.3f} ms\n"
+          "              program/texture/mesh changes {}/{}/{} unsorted, "
+          "{}/{}/{} sorted\n",
+          count, queueMs, stdSortMs, unsortedPrograms, unsortedTextures,
+          unsortedMeshes, programs, textures, meshes);
+    }
+    return 0;
+}
+
+BenchmarkRegistration renderQueueBench{"renderQueue", "",
+                                       runRenderQueueBench};
+} // namespace
@@ -0,0 +1,60 @@
+#include "bench.hpp"
+
+#include "frontend/blockCompression.hpp"
+#include "frontend/texture.hpp"
+
+#include <filesystem>
+#include <format>
+#include <iostream>
+
+namespace
+{
+// Compresses the images to every block format and reports how much smaller
+// and how far from the original they get. Runs without a GPU.
+int runTextureCompressBench(const std::vector<std::string>& args)
+{
+    std::vector<std::filesystem::path> paths{args.begin(), args.end()};
+    if (paths.empty()) {
+        for (const char* name : {"IndentA.tga", "checkerA.tga"}) {
+            paths.emplace_back(
+              std::filesystem::path{"assets/models/shaderBall"} / name);
+        }
+    }
+
+    for (const auto& path : paths) {
+        DecodedTexture decoded = DecodedTexture::fromFile(path);
+        RgbaImage image =
+          toRgbaImage(decoded.data(), decoded.width, decoded.height,
+                      decoded.channels, decoded.bgr);
+        size_t rawBytes = static_cast<size_t>(decoded.width) *
+                          static_cast<size_t>(decoded.height) *
+                          static_cast<size_t>(decoded.channels);
+        std::cout << std::format("{} ({}x{}, {} channels, {} KiB)\n",
+                                 path.string(), decoded.width, decoded.height,
+                                 decoded.channels, rawBytes / 1024);
+
+        for (BlockFormat format : {BlockFormat::BC1, BlockFormat::BC3,
+                                   BlockFormat::BC5, BlockFormat::BC7})
+        {
+            std::vector<std::byte> blocks;
+            double ms = medianMilliseconds(3, [&] {
+                blocks = compressImage(image, format);
+            });
+            RgbaImage roundTrip =
+              decompressImage(blocks, image.width, image.height, format);
+            std::cout << std::format(
+              "  {}: {:6} KiB ({:4.1f}:1), PSNR {:5.2f} dB, {:8.2f} ms "
+              "({:.1f} MTexel/s)\n",
+              blockFormatName(format), blocks.size() / 1024,
+              static_cast<double>(rawBytes) /
+                static_cast<double>(blocks.size()),
+              blockPsnr(image, roundTrip, format), ms,
+              static_cast<double>(image.pixels.size() / 4) / (ms * 1000.0));
+        }
+    }
+    return 0;
+}
+
+BenchmarkRegistration textureCompressBench{"textureCompress", "[image...]",
+                                           runTextureCompressBench};
+} // namespace
@@ -0,0 +1,53 @@
+#include "bench.hpp"
+
+#include "frontend/texture.hpp"
+#include "util/threadPool.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+// Decodes the images the way the material loader does, once per thread count.
+int runTextureDecodeBench(const std::vector<std::string>& args)
+{
+    std::vector<std::filesystem::path> paths{args.begin(), args.end()};
+    if (paths.empty()) {
+        for (const char* name : {"IndentA.tga", "checkerA.tga", "white.tga"}) {
+            paths.emplace_back(
+              std::filesystem::path{"assets/models/shaderBall"} / name);
+        }
+    }
+
+    double singleMs = 0.0;
+    size_t maxThreads = std::max(1U, std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        ThreadPool pool{threads - 1};
+        std::vector<DecodedTexture> decoded(paths.size());
+        double ms = medianMilliseconds(3, [&] {
+            pool.parallelFor(paths.size(), [&](size_t i) {
+                decoded[i] = DecodedTexture::fromFile(paths[i]);
+            });
+        });
+        if (threads == 1) {
+            singleMs = ms;
+            for (const auto& texture : decoded) {
+                std::cout << std::format("  {} ({}x{}, {} channels): {:.3f} "
+                                         "ms\n",
+                                         texture.filePath, texture.width,
+                                         texture.height, texture.channels,
+                                         texture.decodeMilliseconds);
+            }
+        }
+        std::cout << std::format("  {:3} thr: {:10.3f} ms {:6.2f}x\n", threads,
+                                 ms, singleMs / ms);
+    }
+    return 0;
+}
+
+BenchmarkRegistration textureDecodeBench{"textureDecode", "[image...]",
+                                         runTextureDecodeBench};
+} // namespace
@@ -0,0 +1,116 @@
+#include "bench.hpp"
+
+#include "frontend/GLFWContext.h"
+#include "frontend/shader.hpp"
+#include "frontend/window.hpp"
+#include "util/error.hpp"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+// Names longer than the small string buffer, as most of the renderer's are,
+// so a string-keyed set from a literal allocates
+const char* vertexSource = R"(#version 410 core
+layout(location = 0) in vec3 aPos;
+uniform mat4 modelViewProjection;
+uniform int theTextureTopRowFirst;
+void main()
+{
+    vec4 p = modelViewProjection * vec4(aPos, 1.0);
+    gl_Position = theTextureTopRowFirst != 0 ? p : -p;
+}
+)";
+
+const char* fragmentSource = R"(#version 410 core
+out vec4 colour;
+void main()
+{
+    colour = vec4(1.0);
+}
+)";
+
+constexpr int setsPerRun = 100000;
+
+// Sets a mat4 and an int uniform `setsPerRun` times each, by name and through
+// handles, with values that change every time and with the same values over
+// and over (which the handles' shadow copy skips).
+int runUniformBench(const std::vector<std::string>& /*args*/)
+{
+    try {
+        GLFWContext glfwContext;
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        Window window{"uniforms", 64, 64};
+        std::cout << std::format("GL: {}\n", reinterpret_cast<const char*>(
+                                               glGetString(GL_RENDERER)));
+
+        Shader shader{std::string{vertexSource}, std::string{fragmentSource}};
+        auto matrixHandle =
+          shader.getUniformHandle<glm::mat4>("modelViewProjection");
+        auto intHandle = shader.getUniformHandle<int>("theTextureTopRowFirst");
+        auto bound = shader.bind();
+
+        std::vector<glm::mat4> matrices(setsPerRun);
+        for (int i = 0; i < setsPerRun; ++i) {
+            matrices[i] = glm::translate(glm::mat4{1.0F},
+                                         glm::vec3{static_cast<float>(i)});
+        }
+
+        auto report = [](const char* what, double ms) {
+            std::cout << std::format("  {:34} {:8.3f} ms ({:6.1f} ns/set)\n",
+                                     what, ms, ms * 1e6 / (2 * setsPerRun));
+        };
+
+        report("by name, changing", medianMilliseconds(5, [&] {
+                   for (int i = 0; i < setsPerRun; ++i) {
+                       bound.setUniform("modelViewProjection", matrices[i]);
+                       bound.setUniformInt("theTextureTopRowFirst", i & 1);
+                   }
+                   glFinish();
+               }));
+        report("handles, changing", medianMilliseconds(5, [&] {
+                   for (int i = 0; i < setsPerRun; ++i) {
+                       bound.set(matrixHandle, matrices[i]);
+                       bound.set(intHandle, i & 1);
+                   }
+                   glFinish();
+               }));
+        report("by name, unchanged", medianMilliseconds(5, [&] {
+                   for (int i = 0; i < setsPerRun; ++i) {
+                       bound.setUniform("modelViewProjection", matrices[0]);
+                       bound.setUniformInt("theTextureTopRowFirst", 1);
+                   }
+                   glFinish();
+               }));
+        report("handles, unchanged", medianMilliseconds(5, [&] {
+                   for (int i = 0; i < setsPerRun; ++i) {
+                       bound.set(matrixHandle, matrices[0]);
+                       bound.set(intHandle, 1);
+                   }
+                   glFinish();
+               }));
+
+        // what the shadow copy saves on top of the handles
+        GLint location =
+          shader.getUniforms().find("modelViewProjection")->second.location;
+        report("raw glUniform, unchanged", medianMilliseconds(5, [&] {
+                   for (int i = 0; i < 2 * setsPerRun; ++i) {
+                       glUniformMatrix4fv(location, 1, GL_FALSE,
+                                          glm::value_ptr(matrices[0]));
+                   }
+                   glFinish();
+               }));
+    } catch (const IrrecoverableError& e) {
+        std::cout << "Skipped: " << e.msg << "\n";
+    }
+    return 0;
+}
+
+BenchmarkRegistration uniformBench{"uniforms", "", runUniformBench};
+} // namespace
@@ -0,0 +1,160 @@
+#include "bench.hpp"
+
+#include "frontend/objImport.hpp"
+#include "frontend/objParser.hpp"
+#include "frontend/vertexDedup.hpp"
+
+#include <format>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+// The hasher and loop `importObjFile` used before the dedicated dedup code,
+// kept as the baseline.
+struct VertexHasher
+{
+    static size_t hashVec(const glm::vec2& v)
+    {
+        return std::hash<float>()(v.x) ^ (std::hash<float>()(v.y) << 1);
+    }
+    static size_t hashVec(const glm::vec3& v)
+    {
+        return ((std::hash<float>()(v.x) ^ (std::hash<float>()(v.y) << 1)) >>
+                1) ^
+               (std::hash<float>()(v.z) << 1);
+    }
+
+    std::size_t operator()(const LoadedObjVertex& v) const
+    {
+        size_t h1 = hashVec(v.position);
+        size_t h2 = hashVec(v.normal);
+        size_t h3 = hashVec(v.texCoord);
+        return ((h1 ^ (h2 << 1)) >> 1) ^ (h3 << 1);
+    }
+};
+
+void dedupWithUnorderedMap(const std::vector<LoadedObjVertex>& corners,
+                           ImportedShape& shape)
+{
+    auto& vertices = shape.vertices;
+    auto& indices = shape.indices;
+    std::unordered_map<LoadedObjVertex, uint32_t, VertexHasher> uniqueVertices;
+
+    for (const auto& vertex : corners) {
+        if (!uniqueVertices.contains(vertex)) {
+            uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(vertex);
+        }
+        indices.push_back(uniqueVertices[vertex]);
+    }
+}
+
+// Triangulated `gridSize`² grid where every interior vertex is shared by six
+// corners, like a typical closed mesh. The second triangle of each cell has
+// -0 in its normals, which still has to merge with +0.
+std::vector<LoadedObjVertex> syntheticCorners(int gridSize)
+{
+    auto vertexAt = [gridSize](int x, int y, float zero = 0.0F) {
+        LoadedObjVertex v;
+        float u = static_cast<float>(x) / static_cast<float>(gridSize);
+        float w = static_cast<float>(y) / static_cast<float>(gridSize);
+        v.position = {u * 10.0F, w * 10.0F, u * w};
+        v.normal = {zero, zero, 1.0F};
+        v.texCoord = {u, w};
+        return v;
+    };
+
+    std::vector<LoadedObjVertex> corners;
+    corners.reserve(static_cast<size_t>(gridSize) * gridSize * 6);
+    for (int y = 0; y < gridSize; ++y) {
+        for (int x = 0; x < gridSize; ++x) {
+            corners.push_back(vertexAt(x, y));
+            corners.push_back(vertexAt(x + 1, y));
+            corners.push_back(vertexAt(x + 1, y + 1));
+            corners.push_back(vertexAt(x, y, -0.0F));
+            corners.push_back(vertexAt(x + 1, y + 1, -0.0F));
+            corners.push_back(vertexAt(x, y + 1, -0.0F));
+        }
+    }
+    return corners;
+}
+
+// All corners of every shape of an .obj, back to back.
+std::vector<LoadedObjVertex> cornersOf(const std::filesystem::path& path)
+{
+    std::optional<ParsedObj> chunked = parseObjChunked(path);
+    ParsedObj parsed = chunked ? std::move(*chunked) : parseObjWithTinyObj(path);
+
+    std::vector<LoadedObjVertex> corners;
+    for (const auto& shape : parsed.shapes) {
+        for (const auto& index : shape.mesh.indices) {
+            corners.emplace_back(index, parsed.attrib);
+        }
+    }
+    return corners;
+}
+
+void expectSame(const ImportedShape& expected, const ImportedShape& actual,
+                const char* variant)
+{
+    if (expected.indices != actual.indices ||
+        expected.vertices.size() != actual.vertices.size() ||
+        !std::equal(expected.vertices.begin(), expected.vertices.end(),
+                    actual.vertices.begin()))
+    {
+        throw std::runtime_error{std::string{variant} +
+                                 " output differs from std::unordered_map"};
+    }
+}
+
+int runVertexDedupBench(const std::vector<std::string>& args)
+{
+    std::vector<LoadedObjVertex> corners =
+      args.empty() ? syntheticCorners(1000) : cornersOf(args[0]);
+    int iterations = args.size() > 1 ? std::stoi(args[1]) : 5;
+    double megaCorners = static_cast<double>(corners.size()) / 1.0e6;
+
+    ImportedShape reference;
+    double mapMs = medianMilliseconds(iterations, [&] {
+        reference = {};
+        dedupWithUnorderedMap(corners, reference);
+    });
+
+    ImportedShape flat;
+    double flatMs = medianMilliseconds(iterations, [&] {
+        dedupVerticesFlatHash(corners, flat);
+    });
+    expectSame(reference, flat, "flat hash");
+
+    auto report = [&](const std::string& label, double ms) {
+        std::cout << std::format("  {:<22} {:10.3f} ms {:8.1f} Mcorners/s "
+                                 "{:6.1f}x\n",
+                                 label, ms, megaCorners / (ms / 1000.0),
+                                 mapMs / ms);
+    };
+
+    std::cout << std::format("{:.2f}M corners -> {} unique vertices\n",
+                             megaCorners, reference.vertices.size());
+    report("std::unordered_map", mapMs);
+    report("flat hash", flatMs);
+
+    size_t maxThreads = std::max(1U, std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        ThreadPool pool{threads - 1};
+        ImportedShape sorted;
+        double ms = medianMilliseconds(iterations, [&] {
+            dedupVerticesRadixSort(corners, sorted, pool);
+        });
+        expectSame(reference, sorted, "radix sort");
+        report(std::format("radix sort ({} thr)", threads), ms);
+    }
+    return 0;
+}
+
+BenchmarkRegistration vertexDedupBench{"vertexDedup",
+                                       "[model.obj] [iterations]",
+                                       runVertexDedupBench};
+} // namespace
@@ -0,0 +1,110 @@
+#include "bench.hpp"
+
+#include "frontend/objParser.hpp"
+#include "frontend/vertexDedup.hpp"
+#include "frontend/vertexQuantize.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <numbers>
+
+namespace
+{
+// A UV sphere about the size of our models, with tiling UVs.
+std::vector<LoadedObjVertex> sphereVertices(int rings, int segments)
+{
+    std::vector<LoadedObjVertex> vertices;
+    for (int r = 0; r <= rings; ++r) {
+        float theta = std::numbers::pi_v<float> * static_cast<float>(r) /
+                      static_cast<float>(rings);
+        for (int s = 0; s <= segments; ++s) {
+            float phi = 2.0F * std::numbers::pi_v<float> *
+                        static_cast<float>(s) / static_cast<float>(segments);
+            glm::vec3 n{std::sin(theta) * std::cos(phi), std::cos(theta),
+                        std::sin(theta) * std::sin(phi)};
+            LoadedObjVertex v;
+            v.position = n * 150.0F;
+            v.normal = n;
+            v.texCoord = {4.0F * static_cast<float>(s) /
+                            static_cast<float>(segments),
+                          2.0F * static_cast<float>(r) /
+                            static_cast<float>(rings)};
+            vertices.push_back(v);
+        }
+    }
+    return vertices;
+}
+
+std::vector<LoadedObjVertex> verticesOf(const std::filesystem::path& path)
+{
+    std::optional<ParsedObj> chunked = parseObjChunked(path);
+    ParsedObj parsed = chunked ? std::move(*chunked) : parseObjWithTinyObj(path);
+
+    std::vector<LoadedObjVertex> corners;
+    for (const auto& shape : parsed.shapes) {
+        for (const auto& index : shape.mesh.indices) {
+            corners.emplace_back(index, parsed.attrib);
+        }
+    }
+    ImportedShape unique;
+    dedupVertices(corners, unique);
+    return unique.vertices;
+}
+
+float angleDegrees(glm::vec3 a, glm::vec3 b)
+{
+    float cosine = glm::dot(glm::normalize(a), glm::normalize(b));
+    return glm::degrees(std::acos(std::clamp(cosine, -1.0F, 1.0F)));
+}
+
+int runVertexQuantizeBench(const std::vector<std::string>& args)
+{
+    std::vector<LoadedObjVertex> vertices =
+      args.empty() ? sphereVertices(1000, 1000) : verticesOf(args[0]);
+
+    QuantizedShape quantized;
+    double ms = medianMilliseconds(5, [&] {
+        quantized = quantizeVertices(vertices);
+    });
+    QuantizationError error = measureQuantizationError(vertices, quantized);
+
+    std::cout << std::format(
+      "{} vertices: {} KiB -> {} KiB, packed in {:.3f} ms\n"
+      "  position (unorm16 in bounds): {:.3e} ({:.3e} of diagonal)\n"
+      "  normal (octahedral unorm16):  {:.4f} deg\n"
+      "  uv (unorm16 in bounds):       {:.3e}\n",
+      vertices.size(), vertices.size() * sizeof(LoadedObjVertex) / 1024,
+      quantized.vertices.size() * sizeof(QuantizedObjVertex) / 1024, ms,
+      error.position, error.positionRelative, error.normalDegrees,
+      error.texCoord);
+
+    // Alternatives the vertex layout supports, for comparison
+    float normal2101010 = 0.0F;
+    float normalHalf = 0.0F;
+    float uvHalf = 0.0F;
+    for (const auto& v : vertices) {
+        glm::vec3 n = v.normal;
+        if (glm::length(n) > 0.0F) {
+            n = glm::normalize(n);
+            normal2101010 = std::max(
+              normal2101010, angleDegrees(n, fromSnorm2101010(toSnorm2101010(n))));
+            glm::vec3 half{fromHalf(toHalf(n.x)), fromHalf(toHalf(n.y)),
+                           fromHalf(toHalf(n.z))};
+            normalHalf = std::max(normalHalf, angleDegrees(n, half));
+        }
+        glm::vec2 uv = v.texCoord;
+        uvHalf = std::max({uvHalf, std::abs(fromHalf(toHalf(uv.x)) - uv.x),
+                           std::abs(fromHalf(toHalf(uv.y)) - uv.y)});
+    }
+    std::cout << std::format("  normal (2_10_10_10):          {:.4f} deg\n"
+                             "  normal (3x half):             {:.4f} deg\n"
+                             "  uv (half):                    {:.3e}\n",
+                             normal2101010, normalHalf, uvHalf);
+    return 0;
+}
+
+BenchmarkRegistration vertexQuantizeBench{"vertexQuantize", "[model.obj]",
+                                          runVertexQuantizeBench};
+} // namespace
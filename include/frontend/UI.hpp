@@ -1,6 +1,10 @@
 #pragma once
 
 #include "frontend/camera.hpp"
+#include "frontend/frustum.hpp"
+#include "frontend/glState.hpp"
+#include "frontend/loadedObj.hpp"
+#include "frontend/occlusion.hpp"
 #include "frontend/window.hpp"
 
 #include <glm/glm.hpp>
@@ -11,6 +15,8 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
+#include <cstdint>
+
 class ImGUIContext
 {
   public:
@@ -53,6 +59,31 @@ struct UIState
     //
     ImVec4 clearColour = ImVec4(0.2F, 0.3F, 0.3F, 1.0F);
 
+    AsyncObjectLoad::Status modelLoadStatus = AsyncObjectLoad::Status::Loading;
+    size_t modelShapesUploaded = 0;
+    size_t modelShapeCount = 0;
+
+    ObjDrawSettings drawSettings;
+    // of the last frame
+    ObjDrawStats drawStats;
+    RenderQueueStats renderStats;
+    GLStateStats glStateStats;
+    GeometryArenaStats geometryArenaStats;
+    // objects in the scene's Bvh, and those in the frustum
+    size_t sceneObjects = 0;
+    size_t sceneObjectsVisible = 0;
+    // of the last frame's occlusion buffer, and the texture showing it (0
+    // while it is not shown)
+    OcclusionStats occlusionStats;
+    bool showOcclusionBuffer = false;
+    uint32_t occlusionTexture = 0;
+    ImVec2 occlusionTextureSize{0.0F, 0.0F};
+
+    TextureStreamingSettings textureStreamingSettings;
+    SceneLighting lighting;
+    // of the last frame
+    TextureStreamingStats textureStreamingStats;
+
     float timeValue = 0.0F;
     bool showControls = true;
 
@@ -69,6 +100,10 @@ struct UIState
     float manualRotationY = 0.0F;
     float manualRotationZ = 0.0F;
 
+    // copies of the object in a grid, drawn instanced; 0 draws it once
+    // through the render queue
+    int instanceCount = 0;
+
     //
     // Camera
     //
@@ -107,11 +142,111 @@ inline void drawImGuiAndUpdateState(UIState& state)
         ImGui::Separator();
         if (ImGui::CollapsingHeader("Renderer")) {
             ImGui::ColorEdit3("Clear Color", &state.clearColour.x);
+
+            if (state.modelLoadStatus == AsyncObjectLoad::Status::Loading) {
+                ImGui::Text("Loading model: %zu / %zu shapes",
+                            state.modelShapesUploaded, state.modelShapeCount);
+            } else if (state.modelLoadStatus ==
+                       AsyncObjectLoad::Status::Failed) {
+                ImGui::Text("Model failed to load");
+            }
+
+            ImGui::Text("Objects visible: %zu / %zu", state.sceneObjectsVisible,
+                        state.sceneObjects);
+            ImGui::Checkbox("Shape Culling", &state.drawSettings.shapeCulling);
+            if (state.drawSettings.shapeCulling && state.instanceCount == 0) {
+                ImGui::Text("Shapes visible: %zu, culled: %zu (%s)",
+                            state.drawStats.shapesVisible,
+                            state.drawStats.shapesCulled, frustumSimdPath());
+            }
+            ImGui::Checkbox("Occlusion Culling",
+                            &state.drawSettings.occlusionCulling);
+            if (state.drawSettings.occlusionCulling &&
+                state.instanceCount == 0) {
+                const OcclusionStats& occlusion = state.occlusionStats;
+                ImGui::Text("Shapes occluded: %zu (%s)",
+                            state.drawStats.shapesOccluded,
+                            occlusionSimdPath());
+                ImGui::Text("Occluders: %zu, %zu / %zu triangles in %.3f ms",
+                            occlusion.occluders, occlusion.trianglesRasterised,
+                            occlusion.triangles,
+                            occlusion.rasteriseMilliseconds);
+                ImGui::Checkbox("Show Occlusion Buffer",
+                                &state.showOcclusionBuffer);
+                if (state.showOcclusionBuffer && state.occlusionTexture != 0) {
+                    // ImTextureID is a pointer or an integer, depending on
+                    // the ImGui version
+                    ImGui::Image(
+                      (ImTextureID)(intptr_t)state.occlusionTexture,
+                      state.occlusionTextureSize);
+                }
+            }
+            ImGui::Checkbox("Meshlet Culling",
+                            &state.drawSettings.meshletCulling);
+            if (state.drawSettings.meshletCulling) {
+                const MeshletCullStats& stats = state.drawStats.culling;
+                ImGui::Text("Meshlets culled: %zu / %zu (frustum %zu, "
+                            "backface %zu)",
+                            stats.meshletsCulled(), stats.meshlets,
+                            stats.frustumCulled, stats.backfaceCulled);
+                ImGui::Text("Triangles culled: %zu / %zu",
+                            stats.trianglesCulled, stats.triangles);
+            }
+
+            ImGui::SliderFloat("LOD Pixel Error",
+                               &state.drawSettings.lodPixelError, 0.0F, 16.0F);
+            ImGui::Text("Triangles drawn: %zu", state.drawStats.trianglesDrawn);
+            const RenderQueueStats& render = state.renderStats;
+            ImGui::Text("Draw calls: %zu, texture binds: %zu",
+                        render.drawCalls, render.textureBinds);
+            ImGui::Text("Program binds: %zu, mesh binds: %zu",
+                        render.programBinds, render.meshBinds);
+            ImGui::Text("Multi-draws: %zu (%zu commands)", render.multiDraws,
+                        render.indirectCommands);
+            const GeometryArenaStats& arenas = state.geometryArenaStats;
+            ImGui::Text("Geometry arenas: %zu, %zu meshes, %.1f / %.1f MiB",
+                        arenas.arenas, arenas.allocations,
+                        static_cast<double>(arenas.usedBytes) / 1048576.0,
+                        static_cast<double>(arenas.capacityBytes) / 1048576.0);
+            ImGui::Text("Sorted %zu packets in %.3f ms", render.packets,
+                        render.sortMilliseconds);
+            ImGui::Text("GL binds issued: %zu, skipped: %zu",
+                        state.glStateStats.issued, state.glStateStats.skipped);
+            for (size_t lod = 0; lod < maxShapeLods; ++lod) {
+                if (state.drawStats.shapesPerLod[lod] > 0) {
+                    ImGui::Text("LOD %zu: %zu shapes", lod,
+                                state.drawStats.shapesPerLod[lod]);
+                }
+            }
+            if (state.instanceCount > 0) {
+                ImGui::Text("Instances culled: %zu / %d",
+                            state.drawStats.instancesCulled,
+                            state.instanceCount);
+            }
+
+            TextureStreamingSettings& streaming =
+              state.textureStreamingSettings;
+            const TextureStreamingStats& streamed = state.textureStreamingStats;
+            int budgetMiB = static_cast<int>(streaming.budgetBytes >> 20);
+            if (ImGui::SliderInt("Texture Budget (MiB)", &budgetMiB, 1, 512)) {
+                streaming.budgetBytes = static_cast<size_t>(budgetMiB) << 20;
+            }
+            ImGui::SliderFloat("Texture LOD Bias", &streaming.lodBias, -2.0F,
+                               4.0F);
+            constexpr double mebibyte = 1024.0 * 1024.0;
+            ImGui::Text("Textures resident: %.1f MiB, requested: %.1f MiB "
+                        "(%zu streamed)",
+                        static_cast<double>(streamed.residentBytes) / mebibyte,
+                        static_cast<double>(streamed.requestedBytes) / mebibyte,
+                        streamed.streamedTextures);
+            ImGui::Text("Mips streamed in: %zu, evicted: %zu",
+                        streamed.levelsUploaded, streamed.levelsEvicted);
         }
 
 
         ImGui::Separator();
         if (ImGui::CollapsingHeader("Main Object")) {
+            ImGui::SliderInt("Instances", &state.instanceCount, 0, 10000);
 
             // Rotation controls
             ImGui::Text("Rotation");
@@ -142,6 +277,30 @@ inline void drawImGuiAndUpdateState(UIState& state)
         }
 
 
+        ImGui::Separator();
+        if (ImGui::CollapsingHeader("Lighting")) {
+            SceneLighting& lighting = state.lighting;
+            ImGui::SliderInt("Lights", &lighting.lightCount, 0,
+                             maxDirectionalLights);
+            for (int i = 0; i < lighting.lightCount; ++i) {
+                DirectionalLight& light = lighting.lights[i];
+                ImGui::PushID(i);
+                ImGui::Text("Light %d", i);
+                ImGui::SliderFloat3("Direction", &light.direction.x, -1.0F,
+                                    1.0F);
+                ImGui::ColorEdit3("Colour", &light.colour.x);
+                ImGui::SliderFloat("Intensity", &light.intensity, 0.0F, 4.0F);
+                ImGui::PopID();
+            }
+            ImGui::ColorEdit3("Ambient Colour", &lighting.ambientColour.x);
+            ImGui::SliderFloat("Ambient Strength", &lighting.ambientStrength,
+                               0.0F, 1.0F);
+            ImGui::SliderFloat("Specular Strength",
+                               &lighting.specularStrength, 0.0F, 2.0F);
+            ImGui::SliderFloat("Shininess", &lighting.shininess, 1.0F, 256.0F);
+        }
+
+
         ImGui::Separator();
         if (ImGui::CollapsingHeader("Camera")) {
 
@@ -151,6 +310,7 @@ inline void drawImGuiAndUpdateState(UIState& state)
             ImGui::DragFloat("Near Plane", state.nearPlane, 0.1F);
             ImGui::DragFloat("Far Plane", state.farPlane, 0.1F);
             ImGui::SliderFloat("FOV", state.fov, 1.0F, 120.0F);
+            ImGui::Text("Right click: orbit the surface under the cursor");
 
             if (ImGui::Button("Reset Camera")) {
                 *state.cameraPosition = state.initCameraPosition;
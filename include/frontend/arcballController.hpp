@@ -40,6 +40,13 @@ struct ArcballController
           glm::clamp(elevation + deltaElevation, minElevation, maxElevation);
     }
 
+    // Orbits `point` from now on (e.g. the surface under the cursor), from
+    // where the camera is.
+    void pivotOn(const glm::vec3& point)
+    {
+        setFromPositionAndTarget(getPosition(), point);
+    }
+
     void setFromPositionAndTarget(const glm::vec3& position,
                                   const glm::vec3& targetPos)
     {
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "util/threadPool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+// CPU encoders (and decoders, to measure them) for the GPU block compressed
+// texture formats. Every format stores 4x4 texel blocks in a fixed number of
+// bytes, so textures stay compressed in VRAM and when sampled.
+//
+// Nothing here touches GL, so textures can be compressed, and the results
+// checked, on machines without a GPU.
+
+// The values are stored in texture cache files, do not renumber.
+enum class BlockFormat : uint32_t
+{
+    BC1 = 1, // RGB, 4 bits per texel
+    BC3 = 3, // RGBA: BC1 colour and a separate alpha block, 8 bits per texel
+    BC5 = 5, // RG in two independent channels, 8 bits per texel
+    BC7 = 7, // RGBA, 8 bits per texel, much better quality than BC1/BC3
+};
+
+// What textures should be compressed to when they are loaded.
+enum class TextureCompression
+{
+    None,
+    // BC1 for RGB, BC3 for RGBA and BC5 for one or two channel images; all
+    // of them widely supported (BC7 needs GL 4.2)
+    Auto,
+    BC1,
+    BC3,
+    BC5,
+    BC7,
+};
+
+[[nodiscard]] const char* blockFormatName(BlockFormat format);
+
+// Bytes per 4x4 block.
+[[nodiscard]] size_t blockBytes(BlockFormat format);
+
+// Bytes of a `width` x `height` image, partial blocks at the edges included.
+[[nodiscard]] size_t compressedSize(int width, int height, BlockFormat format);
+
+// Nothing for `TextureCompression::None`.
+[[nodiscard]] std::optional<BlockFormat>
+blockFormatFor(TextureCompression compression, int channels);
+
+// 8-bit RGBA pixels, rows in the order they are uploaded in.
+struct RgbaImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// Expands 1 to 4 channel pixels (BGR(A) if `bgr`) to RGBA. Missing colour
+// channels are 0 and missing alpha is 255, as GL samples them.
+[[nodiscard]] RgbaImage toRgbaImage(const unsigned char* pixels, int width,
+                                    int height, int channels, bool bgr);
+
+// Compresses `image`, rows of blocks spread over `pool`.
+[[nodiscard]] std::vector<std::byte>
+compressImage(const RgbaImage& image, BlockFormat format,
+              ThreadPool& pool = ThreadPool::global());
+
+// Decodes blocks `compressImage` wrote (BC7 only in the mode it uses).
+[[nodiscard]] RgbaImage decompressImage(std::span<const std::byte> blocks,
+                                        int width, int height,
+                                        BlockFormat format);
+
+// Peak signal to noise ratio of `decoded` against `original`, in dB, over
+// the channels `format` stores. Infinite for identical images.
+[[nodiscard]] double blockPsnr(const RgbaImage& original,
+                               const RgbaImage& decoded, BlockFormat format);
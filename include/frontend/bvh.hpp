@@ -0,0 +1,249 @@
+#pragma once
+
+#include "frontend/frustum.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <vector>
+
+// Bounding volume hierarchies: a binary tree of boxes over primitives that
+// are themselves only known by their boxes, for culling them against a
+// frustum and casting rays at them in logarithmic rather than linear time.
+//
+// Trees are built top down, each node split where the surface area heuristic
+// (SAH) estimates the cheapest traversal, from the primitives' centroids
+// binned along each axis. Primitives that move are refit: the boxes above
+// them grow or shrink, the structure stays. As refits make the tree worse
+// than a fresh build would be, Bvh::update() rebuilds it once its SAH cost
+// has grown past a limit.
+
+// A half line from `origin`. `direction` need not be normalised; distances
+// along the ray are in multiples of it, so they stay the same when the ray
+// is moved into another space with an affine transform.
+struct Ray
+{
+    glm::vec3 origin{0.0F};
+    glm::vec3 direction{0.0F, 0.0F, -1.0F};
+};
+
+// Distance at which `ray` enters `box` (0 if it starts inside), if it does
+// before `maxDistance`. `inverseDirection` is 1 / ray.direction.
+[[nodiscard]] std::optional<float>
+intersectRayBox(const Ray& ray, glm::vec3 inverseDirection, const Aabb& box,
+                float maxDistance);
+
+// Distance at which `ray` hits the triangle, either side, if it does before
+// `maxDistance`.
+[[nodiscard]] std::optional<float>
+intersectRayTriangle(const Ray& ray, glm::vec3 a, glm::vec3 b, glm::vec3 c,
+                     float maxDistance);
+
+// Nearest primitive a ray hit, and where along the ray.
+struct BvhHit
+{
+    uint32_t primitive = 0;
+    float distance = 0.0F;
+};
+
+// The shape of a tree, and what has been done to it.
+struct BvhStats
+{
+    size_t primitives = 0;
+    size_t nodes = 0;
+    size_t leaves = 0;
+    size_t depth = 0;
+    // expected cost of a query, in box tests, relative to testing the root
+    float sahCost = 0.0F;
+    // since the tree was created
+    size_t builds = 0;
+    size_t refits = 0;
+};
+
+class Bvh
+{
+  public:
+    // leaves are made smaller when the SAH says so
+    static constexpr uint32_t maxLeafPrimitives = 8;
+
+    // Rebuilds once the SAH cost is this many times what it was after the
+    // last build.
+    float rebuildCostRatio = 1.5F;
+
+    Bvh() = default;
+    // Over primitives 0 to boxes.size() - 1.
+    explicit Bvh(std::span<const Aabb> boxes);
+
+    // A new primitive; ids of removed ones are reused. Queries see it after
+    // update().
+    uint32_t add(const Aabb& box);
+    // Queries stop returning it after update().
+    void remove(uint32_t primitive);
+    // A primitive moved; its tree is refit on update().
+    void setBox(uint32_t primitive, const Aabb& box);
+    [[nodiscard]] const Aabb& getBox(uint32_t primitive) const;
+
+    // Brings the tree up to date with the changes since the last update:
+    // rebuilt if primitives were added or removed or refitting has made it
+    // too slow, refit otherwise. Returns true if it was rebuilt.
+    bool update();
+    // A fresh build over the live primitives, whatever changed.
+    void rebuild();
+
+    // Appends the primitives whose boxes may be inside `frustum`.
+    void cull(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+
+    // The nearest primitive along `ray` within `maxDistance`, as far as
+    // `hitPrimitive(primitive, maxDistance)` tells: the distance at which the
+    // ray hits the primitive itself, nearer than `maxDistance`, or nothing.
+    // Children are visited nearest first, and boxes beyond the nearest hit so
+    // far not at all.
+    template <typename HitFn>
+    [[nodiscard]] std::optional<BvhHit>
+    raycast(const Ray& ray, float maxDistance, HitFn&& hitPrimitive) const;
+    // The nearest primitive box along `ray`.
+    [[nodiscard]] std::optional<BvhHit>
+    raycastBoxes(const Ray& ray,
+                 float maxDistance = std::numeric_limits<float>::max()) const;
+
+    // live primitives
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] BvhStats getStats() const;
+    // bytes held
+    [[nodiscard]] size_t getMemoryUsage() const;
+
+  private:
+    struct Node
+    {
+        Aabb box;
+        // the first of `count` primitives in `order` for a leaf, the left
+        // child (the right one is next to it) otherwise
+        uint32_t first = 0;
+        // 0 for inner nodes
+        uint32_t count = 0;
+    };
+    static_assert(sizeof(Node) == 32);
+
+    static constexpr uint32_t noNode = ~uint32_t{0};
+    static constexpr size_t maxDepth = 64;
+
+    // children always come after their parent
+    std::vector<Node> nodes;
+    std::vector<uint32_t> parents;
+    // primitive ids, a range per leaf
+    std::vector<uint32_t> order;
+
+    // per primitive
+    std::vector<Aabb> boxes;
+    std::vector<uint32_t> leafOf;
+    std::vector<uint8_t> live;
+    std::vector<uint32_t> freeIds;
+
+    // moved since the last update
+    std::vector<uint32_t> moved;
+    bool structureChanged = false;
+
+    // sum of the node areas, weighted by what visiting each costs; the SAH
+    // cost is this over the root's area
+    double weightedArea = 0.0;
+    float builtCost = 0.0F;
+    size_t builds = 0;
+    size_t refits = 0;
+
+    void refit();
+    void refitAll();
+    // Recomputes the box of `node` from its children or primitives, and
+    // returns whether it changed.
+    bool refitNode(uint32_t node);
+    [[nodiscard]] float currentCost() const;
+    [[nodiscard]] double nodeWeight(const Node& node) const;
+};
+
+// Triangles to cast rays against, e.g. the full detail level of a shape, in
+// a Bvh of their own.
+class RaycastMesh
+{
+  public:
+    RaycastMesh(std::vector<glm::vec3> positions,
+                std::vector<uint32_t> indices);
+
+    // Distance to the nearest triangle along `ray`.
+    [[nodiscard]] std::optional<float>
+    raycast(const Ray& ray,
+            float maxDistance = std::numeric_limits<float>::max()) const;
+
+    [[nodiscard]] size_t getTriangleCount() const;
+    // bytes held
+    [[nodiscard]] size_t getMemoryUsage() const;
+
+  private:
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    Bvh bvh;
+};
+
+template <typename HitFn>
+std::optional<BvhHit> Bvh::raycast(const Ray& ray, float maxDistance,
+                                   HitFn&& hitPrimitive) const
+{
+    if (nodes.empty()) {
+        return std::nullopt;
+    }
+    glm::vec3 inverseDirection = 1.0F / ray.direction;
+    std::optional<BvhHit> nearest;
+    float limit = maxDistance;
+
+    struct Pending
+    {
+        uint32_t node;
+        float distance;
+    };
+    Pending stack[maxDepth * 2];
+    size_t stackSize = 0;
+    if (auto entry =
+          intersectRayBox(ray, inverseDirection, nodes[0].box, limit))
+    {
+        stack[stackSize++] = {0, *entry};
+    }
+    while (stackSize > 0) {
+        Pending pending = stack[--stackSize];
+        if (pending.distance >= limit) {
+            continue;
+        }
+        const Node& node = nodes[pending.node];
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                uint32_t primitive = order[i];
+                if (auto distance = hitPrimitive(primitive, limit);
+                    distance && *distance < limit)
+                {
+                    limit = *distance;
+                    nearest = BvhHit{primitive, *distance};
+                }
+            }
+            continue;
+        }
+
+        // the nearer child goes on top, to be visited first
+        auto left = intersectRayBox(ray, inverseDirection,
+                                    nodes[node.first].box, limit);
+        auto right = intersectRayBox(ray, inverseDirection,
+                                     nodes[node.first + 1].box, limit);
+        if (left && right && *left < *right) {
+            stack[stackSize++] = {node.first + 1, *right};
+            stack[stackSize++] = {node.first, *left};
+        } else {
+            if (left) {
+                stack[stackSize++] = {node.first, *left};
+            }
+            if (right) {
+                stack[stackSize++] = {node.first + 1, *right};
+            }
+        }
+    }
+    return nearest;
+}
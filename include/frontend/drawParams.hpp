@@ -0,0 +1,40 @@
+#pragma once
+
+#include "frontend/vertexLayout.hpp"
+#include "frontend/vertexQuantize.hpp"
+
+#include <glm/glm.hpp>
+
+// What changes from one draw of the Phong shaders to the next besides the
+// geometry: the decode transform of quantized vertices and the texture layer.
+// The shaders read them as vertex attributes 6 to 8 rather than uniforms. A
+// single draw sets them as constant attribute values; a multi-draw reads them
+// from a buffer, one element per draw picked by each command's base instance,
+// so draws that differ only in these still merge into one call.
+struct DrawParams
+{
+    // xyz the quantized position offset, w the texture array layer or -1 for
+    // the 2D texture
+    glm::vec4 positionOffset{0.0F, 0.0F, 0.0F, -1.0F};
+    // xyz the quantized position scale, w 1 if the texture's top row is first
+    glm::vec4 positionScale{1.0F, 1.0F, 1.0F, 0.0F};
+    // xy the texture coordinate offset, zw the scale
+    glm::vec4 texCoordTransform{0.0F, 0.0F, 1.0F, 1.0F};
+
+    bool operator==(const DrawParams&) const = default;
+};
+
+static_assert(sizeof(DrawParams) == 48);
+
+// `quantization` is null for full float vertices.
+[[nodiscard]] DrawParams
+makeDrawParams(const QuantizationTransform* quantization, int textureLayer,
+               bool topRowFirst);
+
+// DrawParams at locations 6, 7 and 8, one element per instance.
+[[nodiscard]] const VertexLayout& drawParamsLayout();
+
+// Sets `params` as the constant attribute values, for draws from vertex
+// arrays that do not read them from a buffer, through GLState: setting the
+// values already set issues nothing.
+void setConstantDrawParams(const DrawParams& params);
@@ -1,10 +1,14 @@
 #pragma once
 
+#include "frontend/glState.hpp"
+
 #include <GL/glew.h>
 
 // Simple framebuffer - one color attachment + optional depth.
 // Unmaintained for now.
 // Work on this when we actually need multiple render targets.
+// Always rebinds the default framebuffer after setting up or querying, as
+// draws would otherwise silently land in this one.
 class Framebuffer
 {
     GLuint fbo = 0;
@@ -17,11 +21,11 @@ class Framebuffer
     Framebuffer(uint32_t w, uint32_t h) : width(w), height(h)
     {
         glGenFramebuffers(1, &fbo);
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        GLState::current().bindFramebuffer(fbo);
 
         // Color attachment
         glGenTextures(1, &colorTexture);
-        glBindTexture(GL_TEXTURE_2D, colorTexture);
+        GLState::current().bindTexture(GL_TEXTURE_2D, colorTexture);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA,
                      GL_UNSIGNED_BYTE, nullptr);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -29,17 +33,17 @@ class Framebuffer
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
                                GL_TEXTURE_2D, colorTexture, 0);
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLState::current().bindFramebuffer(0);
     }
 
     ~Framebuffer()
     {
         if (fbo != 0)
-            glDeleteFramebuffers(1, &fbo);
+            GLState::current().deleteFramebuffer(fbo);
         if (colorTexture != 0)
-            glDeleteTextures(1, &colorTexture);
+            GLState::current().deleteTexture(colorTexture);
         if (depthTexture != 0)
-            glDeleteTextures(1, &depthTexture);
+            GLState::current().deleteTexture(depthTexture);
     }
 
     // Non-copyable, moveable
@@ -62,11 +66,11 @@ class Framebuffer
     {
         if (this != &other) {
             if (fbo != 0)
-                glDeleteFramebuffers(1, &fbo);
+                GLState::current().deleteFramebuffer(fbo);
             if (colorTexture != 0)
-                glDeleteTextures(1, &colorTexture);
+                GLState::current().deleteTexture(colorTexture);
             if (depthTexture != 0)
-                glDeleteTextures(1, &depthTexture);
+                GLState::current().deleteTexture(depthTexture);
 
             fbo = other.fbo;
             colorTexture = other.colorTexture;
@@ -86,35 +90,35 @@ class Framebuffer
     void addDepthAttachment()
     {
         glGenTextures(1, &depthTexture);
-        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        GLState::current().bindTexture(GL_TEXTURE_2D, depthTexture);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0,
                      GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        GLState::current().bindFramebuffer(fbo);
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
                                GL_TEXTURE_2D, depthTexture, 0);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLState::current().bindFramebuffer(0);
     }
 
     bool isComplete() const
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        GLState::current().bindFramebuffer(fbo);
         GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLState::current().bindFramebuffer(0);
         return status == GL_FRAMEBUFFER_COMPLETE;
     }
 
     void bind() const
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        GLState::current().bindFramebuffer(fbo);
         glViewport(0, 0, width, height);
     }
 
     void unbind() const
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLState::current().bindFramebuffer(0);
     }
 
     GLuint getColorTexture() const
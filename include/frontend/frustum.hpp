@@ -0,0 +1,96 @@
+#pragma once
+
+#include "frontend/camera.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// View frustum culling of bounding volumes, one at a time or in batches.
+//
+// Batches are kept as structure of arrays and tested 8 (AVX2) or 4 (SSE2) at
+// a time when the build targets those, plain C++ otherwise, so culling every
+// shape of a scene costs a few nanoseconds each.
+
+// Axis aligned bounding box.
+struct Aabb
+{
+    glm::vec3 min{0.0F};
+    glm::vec3 max{0.0F};
+
+    [[nodiscard]] glm::vec3 center() const
+    {
+        return (min + max) * 0.5F;
+    }
+
+    // half the size
+    [[nodiscard]] glm::vec3 extent() const
+    {
+        return (max - min) * 0.5F;
+    }
+};
+
+// The box around `box` after `transform`, an affine one.
+[[nodiscard]] Aabb transformAabb(const Aabb& box, const glm::mat4& transform);
+
+// The six planes of a camera's view volume.
+struct Frustum
+{
+    // left, right, bottom, top, near, far; xyz normalised, pointing inwards
+    std::array<glm::vec4, 6> planes{};
+
+    Frustum() = default;
+    // In the space `clipFromSpace` maps to clip space: world space for a
+    // view projection matrix, an object's space with its model matrix
+    // multiplied in.
+    explicit Frustum(const glm::mat4& clipFromSpace);
+    // In world space.
+    explicit Frustum(const Camera& camera);
+
+    // Whether any of the sphere may be inside.
+    [[nodiscard]] bool intersectsSphere(glm::vec3 center, float radius) const;
+    // Whether any of the box may be inside.
+    [[nodiscard]] bool intersectsBox(const Aabb& box) const;
+};
+
+// "AVX2", "SSE2" or "scalar", whichever CullBounds::cull was compiled for.
+[[nodiscard]] const char* frustumSimdPath();
+
+// Bounding volumes to cull together, each a box and a sphere around its
+// center. A volume is culled if either of them is outside a plane; the
+// sphere is the tighter of the two for round shapes, the box for long ones.
+class CullBounds
+{
+  public:
+    void clear();
+    void reserve(size_t count);
+    // `radius` is of a sphere around the box's center containing everything
+    // the box does; a box from a single sphere is a cube around it.
+    void add(const Aabb& box, float radius);
+    void addSphere(glm::vec3 center, float radius);
+
+    [[nodiscard]] size_t size() const;
+
+    // Sets `visible[i]` to 1 if volume i may be inside `frustum`, 0 if not,
+    // and returns how many may be.
+    size_t cull(const Frustum& frustum, std::vector<uint8_t>& visible) const;
+    // The same, a volume at a time; what cull() is checked against.
+    size_t cullScalar(const Frustum& frustum,
+                      std::vector<uint8_t>& visible) const;
+
+  private:
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> extentX;
+    std::vector<float> extentY;
+    std::vector<float> extentZ;
+    std::vector<float> radius;
+
+    // cullScalar() from volume `first` on
+    size_t cullScalarFrom(const Frustum& frustum, size_t first,
+                          std::vector<uint8_t>& visible) const;
+};
@@ -0,0 +1,248 @@
+#pragma once
+
+#include "frontend/drawParams.hpp"
+#include "frontend/glState.hpp"
+#include "frontend/shader.hpp"
+#include "frontend/vertexBuffer.hpp"
+#include "frontend/vertexLayout.hpp"
+#include "util/error.hpp"
+#include "util/rangeAllocator.hpp"
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+// The vertices and indices of many meshes in one large vertex buffer and one
+// large index buffer, behind a single VAO. Meshes in an arena draw with a base
+// vertex, so going from one to the next binds nothing, and a run of their
+// draws can be issued as one glMultiDrawElementsIndirect.
+//
+// Ranges are handed out by a RangeAllocator per buffer. A buffer that has no
+// room grows (copied on the GPU, the old one deleted); once freed ranges leave
+// more holes than there is geometry the arena compacts, moving every
+// allocation to the front, so allocations are handles and their ranges are
+// looked up at draw time.
+
+// A command as glMultiDrawElementsIndirect reads them.
+struct DrawElementsIndirectCommand
+{
+    GLuint count = 0;
+    GLuint instanceCount = 1;
+    GLuint firstIndex = 0;
+    GLint baseVertex = 0;
+    GLuint baseInstance = 0;
+};
+
+static_assert(sizeof(DrawElementsIndirectCommand) == 20);
+
+// Whether glMultiDrawElementsIndirect can be used, with base instances: GL
+// 4.3, or ARB_multi_draw_indirect and ARB_base_instance. Asked once.
+[[nodiscard]] bool multiDrawIndirectSupported();
+
+// Where an allocation is in its arena's buffers.
+struct ArenaRange
+{
+    // the first vertex, which the indices count from
+    GLint baseVertex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+};
+
+// Memory of one or more arenas. Counts add up with +=.
+struct GeometryArenaStats
+{
+    size_t arenas = 0;
+    size_t allocations = 0;
+    size_t usedBytes = 0;
+    size_t capacityBytes = 0;
+    size_t growths = 0;
+    size_t compactions = 0;
+
+    GeometryArenaStats& operator+=(const GeometryArenaStats& other)
+    {
+        arenas += other.arenas;
+        allocations += other.allocations;
+        usedBytes += other.usedBytes;
+        capacityBytes += other.capacityBytes;
+        growths += other.growths;
+        compactions += other.compactions;
+        return *this;
+    }
+};
+
+// Vertices of one VertexLayout and indices of one type (GL_UNSIGNED_SHORT or
+// GL_UNSIGNED_INT). Meshes point at their arena, so it cannot move.
+class GeometryArena
+{
+  public:
+    using Allocation = uint32_t;
+
+    GeometryArena(const VertexLayout& layout, GLenum indexType);
+    ~GeometryArena();
+
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+    GeometryArena(GeometryArena&&) = delete;
+    GeometryArena& operator=(GeometryArena&&) = delete;
+
+    // Copies `vertices` and `indices` in. `Vertex` must be a vertex of the
+    // layout and `Index` the arena's index type.
+    template <typename Vertex, typename Index>
+    [[nodiscard]] Allocation allocate(std::span<const Vertex> vertices,
+                                      std::span<const Index> indices)
+    {
+        if (sizeof(Vertex) != layout.getStride() ||
+            sizeof(Index) != getIndexSize())
+        {
+            throw IrrecoverableError{
+              "Geometry does not match the layout of its arena"};
+        }
+        return allocateBytes(vertices.data(), vertices.size(), indices.data(),
+                             indices.size());
+    }
+
+    // Frees the ranges of `allocation`, compacting the buffers if that leaves
+    // more holes than geometry.
+    void free(Allocation allocation);
+
+    // Moves every allocation to the front of the buffers.
+    void compact();
+
+    // Where `allocation` is now; it moves when the arena compacts.
+    [[nodiscard]] const ArenaRange& rangeOf(Allocation allocation) const
+    {
+        return slots[allocation].range;
+    }
+
+    // `count` indices from `first` of `range`, as Mesh::drawIndexRange.
+    void drawRange(const Shader::BindObject& shader, const ArenaRange& range,
+                   size_t first, size_t count, GLenum primitive) const;
+    // Parts of `range`, as Mesh::drawIndexRanges; `offsets` are in bytes from
+    // the start of the range.
+    void drawRanges(const Shader::BindObject& shader, const ArenaRange& range,
+                    std::span<const GLsizei> counts,
+                    std::span<const void* const> offsets,
+                    GLenum primitive) const;
+    // As Mesh::drawIndexRangeInstanced.
+    void drawRangeInstanced(const Shader::BindObject& shader,
+                            const ArenaRange& range, size_t first, size_t count,
+                            const VertexBuffer& instances,
+                            const VertexLayout& instanceLayout,
+                            size_t firstInstance, size_t instanceCount,
+                            GLenum primitive) const;
+
+    // Issues `count` commands of the bound GL_DRAW_INDIRECT_BUFFER, from
+    // `firstCommand`, as one call, each reading the DrawParams of its base
+    // instance from `drawParams`. Only if multiDrawIndirectSupported().
+    void multiDrawIndirect(const Shader::BindObject& shader,
+                           const VertexBuffer& drawParams, size_t firstCommand,
+                           size_t count, GLenum primitive = GL_TRIANGLES) const;
+
+    [[nodiscard]] GLuint getVAO() const
+    {
+        return vao;
+    }
+
+    [[nodiscard]] GLenum getIndexType() const
+    {
+        return indexType;
+    }
+
+    [[nodiscard]] size_t getIndexSize() const
+    {
+        return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t)
+                                              : sizeof(uint32_t);
+    }
+
+    [[nodiscard]] const VertexLayout& getLayout() const
+    {
+        return layout;
+    }
+
+    [[nodiscard]] GeometryArenaStats getStats() const;
+
+  private:
+    struct Slot
+    {
+        ArenaRange range;
+        bool live = false;
+    };
+
+    // One of the two buffers and the ranges handed out of it
+    struct Storage
+    {
+        GLuint buffer = 0;
+        RangeAllocator ranges;
+        size_t unitBytes = 0;
+    };
+
+    [[nodiscard]] Allocation allocateBytes(const void* vertices,
+                                           size_t vertexCount,
+                                           const void* indices,
+                                           size_t indexCount);
+    // `count` units of `storage`, growing it if need be
+    size_t allocateIn(Storage& storage, size_t count);
+    // A buffer of `capacity` units in place of the old one, with its contents
+    void replaceBuffer(Storage& storage, size_t capacity);
+    // Points the VAO at the current buffers
+    void attachBuffers();
+    // Whether the VAO reads DrawParams from a buffer or the constant values
+    void useDrawParamsArrays(bool arrays) const;
+    // Binds the VAO for draws taking the constant DrawParams
+    void bindForDraw() const;
+
+    VertexLayout layout;
+    GLenum indexType;
+    GLuint vao = 0;
+    Storage vertices;
+    Storage indices;
+    std::vector<Slot> slots;
+    std::vector<Allocation> freeSlots;
+    size_t growths = 0;
+    size_t compactions = 0;
+
+    // Attribute state of the VAO, which draws change
+    mutable AttributeSource instanceSource;
+    mutable AttributeSource drawParamsSource;
+    mutable bool drawParamsArrays = false;
+    // for drawRanges()
+    mutable std::vector<const void*> scratchOffsets;
+    mutable std::vector<GLint> scratchBaseVertices;
+};
+
+// One arena per layout and index type, created on first use.
+class GeometryArenas
+{
+  public:
+    GeometryArena& get(const VertexLayout& layout, GLenum indexType);
+
+    [[nodiscard]] GeometryArenaStats getStats() const;
+
+  private:
+    std::vector<std::unique_ptr<GeometryArena>> arenas;
+};
+
+// Commands for GeometryArena::multiDrawIndirect, replaced as a whole.
+class IndirectCommandBuffer
+{
+    GLuint buffer = 0;
+    size_t capacity = 0;
+
+  public:
+    IndirectCommandBuffer() = default;
+    ~IndirectCommandBuffer();
+
+    IndirectCommandBuffer(const IndirectCommandBuffer&) = delete;
+    IndirectCommandBuffer& operator=(const IndirectCommandBuffer&) = delete;
+    IndirectCommandBuffer(IndirectCommandBuffer&& other) noexcept;
+    IndirectCommandBuffer& operator=(IndirectCommandBuffer&& other) noexcept;
+
+    // Orphans the old storage and binds the buffer as GL_DRAW_INDIRECT_BUFFER.
+    void upload(std::span<const DrawElementsIndirectCommand> commands);
+    void bind() const;
+};
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <optional>
+
+// A shadow of the GL bindings the wrappers (Mesh, VertexBuffer, IndexBuffer,
+// Texture, TextureArray, Shader, Framebuffer) make, and of the constant
+// vertex attribute values, so a call that would not change anything is not
+// issued at all. Everything binding through it has to
+// delete through it too, or a reused name would be taken for still bound.
+//
+// GL calls that bypass it (ImGui, the benches) must be followed by
+// invalidate(); the next bind of each kind is then issued unconditionally.
+//
+// Debug builds still put bindings back to 0 after each use, so code relying
+// on a binding it did not make itself breaks there first; release builds
+// leave them for the next bind to skip.
+#ifdef DEBUG
+inline constexpr bool glUnbindAfterUse = true;
+#else
+inline constexpr bool glUnbindAfterUse = false;
+#endif
+
+// GL calls issued and skipped through GLState. Counts add up with +=.
+struct GLStateStats
+{
+    size_t issued = 0;
+    size_t skipped = 0;
+
+    GLStateStats& operator+=(const GLStateStats& other)
+    {
+        issued += other.issued;
+        skipped += other.skipped;
+        return *this;
+    }
+};
+
+class GLState
+{
+  public:
+    // binding not known, e.g. after invalidate(); never a GL name in practice
+    static constexpr GLuint unknown = ~GLuint{0};
+    // texture units tracked; binds to higher ones are always issued
+    static constexpr GLuint trackedTextureUnits = 16;
+    // uniform buffer binding points tracked, likewise
+    static constexpr GLuint trackedUniformBindings = 8;
+    // generic vertex attributes whose constant value is tracked, likewise
+    static constexpr GLuint trackedAttributes = 16;
+
+    // The state of the GL context; there is only one, and only the thread
+    // owning it may use this.
+    static GLState& current();
+
+    void useProgram(GLuint program)
+    {
+        if (change(program, this->program)) {
+            glUseProgram(program);
+        }
+    }
+
+    void bindVertexArray(GLuint vao)
+    {
+        if (change(vao, vertexArray)) {
+            glBindVertexArray(vao);
+            // the element buffer binding belongs to the vertex array
+            buffers[slotOf(GL_ELEMENT_ARRAY_BUFFER)] = unknown;
+        }
+    }
+
+    void bindBuffer(GLenum target, GLuint buffer)
+    {
+        size_t slot = slotOf(target);
+        if (slot == untracked) {
+            ++stats.issued;
+            glBindBuffer(target, buffer);
+            return;
+        }
+        if (change(buffer, buffers[slot])) {
+            glBindBuffer(target, buffer);
+        }
+    }
+
+    // `size` bytes of `buffer` from `offset` to binding point `index`; also
+    // binds `buffer` to `target` itself, as GL does.
+    void bindBufferRange(GLenum target, GLuint index, GLuint buffer,
+                         GLintptr offset, GLsizeiptr size)
+    {
+        if (bindIndexed(target, index, {buffer, offset, size})) {
+            glBindBufferRange(target, index, buffer, offset, size);
+        }
+    }
+
+    // All of `buffer` to binding point `index`.
+    void bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+    {
+        if (bindIndexed(target, index, {buffer, 0, wholeBuffer})) {
+            glBindBufferBase(target, index, buffer);
+        }
+    }
+
+    // Binds `texture` to the active unit, as for uploading to it.
+    void bindTexture(GLenum target, GLuint texture)
+    {
+        bindTextureUnit(activeUnit == unknown ? 0 : activeUnit, target,
+                        texture);
+    }
+
+    void bindTextureUnit(GLuint unit, GLenum target, GLuint texture)
+    {
+        size_t slot = textureSlotOf(target);
+        if (unit >= trackedTextureUnits || slot == untracked) {
+            activeTexture(unit);
+            ++stats.issued;
+            glBindTexture(target, texture);
+            return;
+        }
+        GLuint& bound = textures[unit][slot];
+        if (texture == bound) {
+            ++stats.skipped;
+            return;
+        }
+        activeTexture(unit);
+        ++stats.issued;
+        glBindTexture(target, texture);
+        bound = texture;
+    }
+
+    void bindFramebuffer(GLuint fbo)
+    {
+        if (change(fbo, framebuffer)) {
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        }
+    }
+
+    // Sets the constant value of generic attribute `index`, read by draws
+    // from vertex arrays that do not enable an array for it.
+    void vertexAttrib4fv(GLuint index, const GLfloat* value)
+    {
+        if (index >= trackedAttributes) {
+            ++stats.issued;
+            glVertexAttrib4fv(index, value);
+            return;
+        }
+        std::optional<std::array<GLfloat, 4>>& set = attributes[index];
+        if (set && std::equal(set->begin(), set->end(), value)) {
+            ++stats.skipped;
+            return;
+        }
+        ++stats.issued;
+        glVertexAttrib4fv(index, value);
+        set.emplace();
+        std::copy_n(value, 4, set->begin());
+    }
+
+    // Forgets the constant attribute values, after a draw that read any of
+    // them from an enabled array: GL leaves their values undefined then.
+    void forgetVertexAttribs();
+
+    // Delete through these, so the name is not taken for bound once reused.
+    void deleteProgram(GLuint program);
+    void deleteVertexArray(GLuint vao);
+    void deleteBuffer(GLuint buffer);
+    void deleteTexture(GLuint texture);
+    void deleteFramebuffer(GLuint fbo);
+
+    // Forgets every binding and attribute value, after GL calls that
+    // bypassed this.
+    void invalidate();
+
+    [[nodiscard]] const GLStateStats& getStats() const;
+    // The counts so far, which start again from 0; typically once per frame.
+    GLStateStats takeStats();
+
+  private:
+    static constexpr size_t untracked = ~size_t{0};
+    // size of a bindBufferBase() binding
+    static constexpr GLsizeiptr wholeBuffer = -1;
+
+    struct IndexedBinding
+    {
+        GLuint buffer = unknown;
+        GLintptr offset = 0;
+        GLsizeiptr size = 0;
+    };
+
+    // True (and counted as issued) if `binding` is not what `index` of
+    // `target` has, which then becomes it
+    bool bindIndexed(GLenum target, GLuint index, IndexedBinding binding)
+    {
+        size_t slot = slotOf(target);
+        if (target == GL_UNIFORM_BUFFER && index < trackedUniformBindings) {
+            IndexedBinding& bound = uniformBindings[index];
+            if (bound.buffer == binding.buffer &&
+                bound.offset == binding.offset && bound.size == binding.size)
+            {
+                ++stats.skipped;
+                return false;
+            }
+            bound = binding;
+        }
+        if (slot != untracked) {
+            buffers[slot] = binding.buffer;
+        }
+        ++stats.issued;
+        return true;
+    }
+
+    // True (and counted as issued) if `value` is not what is `bound`, which
+    // then becomes it
+    bool change(GLuint value, GLuint& bound)
+    {
+        if (value == bound) {
+            ++stats.skipped;
+            return false;
+        }
+        ++stats.issued;
+        bound = value;
+        return true;
+    }
+
+    void activeTexture(GLuint unit)
+    {
+        if (change(unit, activeUnit)) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+        }
+    }
+
+    static size_t slotOf(GLenum target)
+    {
+        switch (target) {
+            case GL_ARRAY_BUFFER:
+                return 0;
+            case GL_ELEMENT_ARRAY_BUFFER:
+                return 1;
+            case GL_UNIFORM_BUFFER:
+                return 2;
+            case GL_DRAW_INDIRECT_BUFFER:
+                return 3;
+            default:
+                return untracked;
+        }
+    }
+
+    static size_t textureSlotOf(GLenum target)
+    {
+        switch (target) {
+            case GL_TEXTURE_2D:
+                return 0;
+            case GL_TEXTURE_2D_ARRAY:
+                return 1;
+            default:
+                return untracked;
+        }
+    }
+
+    GLuint program = unknown;
+    GLuint vertexArray = unknown;
+    std::array<GLuint, 4> buffers{unknown, unknown, unknown, unknown};
+    std::array<IndexedBinding, trackedUniformBindings> uniformBindings{};
+    GLuint activeUnit = unknown;
+    std::array<std::array<GLuint, 2>, trackedTextureUnits> textures{};
+    GLuint framebuffer = unknown;
+    // nothing where the value is not known
+    std::array<std::optional<std::array<GLfloat, 4>>, trackedAttributes>
+      attributes{};
+    GLStateStats stats;
+
+    GLState();
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "frontend/glState.hpp"
+
 #include <GL/glew.h>
 
 #include <cstdint>
@@ -9,6 +11,18 @@ class IndexBuffer
 {
     GLuint ebo = 0;
     size_t indexCount = 0;
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, whichever was uploaded last
+    GLenum indexType = GL_UNSIGNED_INT;
+
+    template <typename Index>
+    void upload(const Index* indices, size_t count, GLenum type, GLenum usage)
+    {
+        indexCount = count;
+        indexType = type;
+        GLState::current().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(Index), indices,
+                     usage);
+    }
 
   public:
     IndexBuffer()
@@ -19,7 +33,7 @@ class IndexBuffer
     ~IndexBuffer()
     {
         if (ebo != 0) {
-            glDeleteBuffers(1, &ebo);
+            GLState::current().deleteBuffer(ebo);
         }
     }
 
@@ -28,7 +42,8 @@ class IndexBuffer
     IndexBuffer& operator=(const IndexBuffer&) = delete;
 
     IndexBuffer(IndexBuffer&& other) noexcept
-      : ebo(other.ebo), indexCount(other.indexCount)
+      : ebo(other.ebo), indexCount(other.indexCount),
+        indexType(other.indexType)
     {
         other.ebo = 0;
         other.indexCount = 0;
@@ -38,9 +53,10 @@ class IndexBuffer
     {
         if (this != &other) {
             if (ebo != 0)
-                glDeleteBuffers(1, &ebo);
+                GLState::current().deleteBuffer(ebo);
             ebo = other.ebo;
             indexCount = other.indexCount;
+            indexType = other.indexType;
             other.ebo = 0;
             other.indexCount = 0;
         }
@@ -50,35 +66,46 @@ class IndexBuffer
     void uploadData(const std::vector<uint32_t>& indices,
                     GLenum usage = GL_STATIC_DRAW)
     {
-        indexCount = indices.size();
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t),
-                     indices.data(), usage);
+        uploadData(indices.data(), indices.size(), usage);
+    }
+
+    void uploadData(const std::vector<uint16_t>& indices,
+                    GLenum usage = GL_STATIC_DRAW)
+    {
+        uploadData(indices.data(), indices.size(), usage);
     }
 
     void uploadData(const uint32_t* indices, size_t count,
                     GLenum usage = GL_STATIC_DRAW)
     {
-        indexCount = count;
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(uint32_t), indices,
-                     usage);
+        upload(indices, count, GL_UNSIGNED_INT, usage);
+    }
+
+    // Half the memory and fetch bandwidth, for meshes of up to 65536 vertices
+    void uploadData(const uint16_t* indices, size_t count,
+                    GLenum usage = GL_STATIC_DRAW)
+    {
+        upload(indices, count, GL_UNSIGNED_SHORT, usage);
     }
 
     void bind() const
     {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        GLState::current().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
     }
 
     void unbind() const
     {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        GLState::current().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     }
 
     size_t getIndexCount() const
     {
         return indexCount;
     }
+    GLenum getIndexType() const
+    {
+        return indexType;
+    }
     GLuint getId() const
     {
         return ebo;
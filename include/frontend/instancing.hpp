@@ -0,0 +1,59 @@
+#pragma once
+
+#include "frontend/vertexBuffer.hpp"
+#include "frontend/vertexLayout.hpp"
+#include "frontend/worldPose.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Many copies of one object drawn with a single instanced draw per shape and
+// level of detail. Each copy's pose goes into a per-instance vertex buffer
+// that the `Instanced` vertex shaders read in place of the Object block.
+
+// A WorldPose as the instanced shaders read it, 40 bytes rather than the 64
+// of a matrix; the shader rotates with the quaternion directly.
+struct InstanceTransform
+{
+    // quaternion, xyz the vector part, w the scalar
+    glm::vec4 rotation{0.0F, 0.0F, 0.0F, 1.0F};
+    glm::vec3 position{0.0F};
+    glm::vec3 scale{1.0F};
+};
+
+static_assert(sizeof(InstanceTransform) == 40);
+static_assert(std::is_trivially_copyable_v<InstanceTransform>);
+
+[[nodiscard]] InstanceTransform packInstance(const WorldPose& pose);
+
+// InstanceTransform at locations 3 (rotation), 4 (position) and 5 (scale),
+// stepping once per instance.
+[[nodiscard]] const VertexLayout& instanceTransformLayout();
+
+// The poses of the instances of an object, and the GPU buffer they are
+// packed into once per frame.
+class InstanceSet
+{
+  public:
+    // Edit freely; the changes reach the GPU on the next upload().
+    std::vector<WorldPose> poses;
+
+    // Packs `poses[order[i]]` into instance `i` of the buffer, replacing what
+    // was there. The old storage is orphaned, so draws still reading it do not
+    // stall the upload.
+    void upload(std::span<const uint32_t> order);
+    // Packs all the poses, in order.
+    void upload();
+
+    [[nodiscard]] const VertexBuffer& getBuffer() const;
+    // Instances in the buffer, as of the last upload.
+    [[nodiscard]] size_t getUploadedCount() const;
+
+  private:
+    std::vector<InstanceTransform> packed;
+    VertexBuffer buffer;
+};
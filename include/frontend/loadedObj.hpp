@@ -1,16 +1,140 @@
 #pragma once
 
+#include "frontend/bvh.hpp"
+#include "frontend/camera.hpp"
+#include "frontend/frustum.hpp"
+#include "frontend/geometryArena.hpp"
+#include "frontend/instancing.hpp"
 #include "frontend/mesh.hpp"
+#include "frontend/meshCache.hpp"
+#include "frontend/meshSimplify.hpp"
+#include "frontend/meshlets.hpp"
+#include "frontend/objImport.hpp"
+#include "frontend/occlusion.hpp"
+#include "frontend/renderQueue.hpp"
 #include "frontend/shader.hpp"
 #include "frontend/texture.hpp"
+#include "frontend/textureStreaming.hpp"
+#include "frontend/vertexQuantize.hpp"
 #include "frontend/worldPose.hpp"
+#include "util/perf.hpp"
+#include "util/threadPool.hpp"
 
 #include <tiny_obj_loader.h>
 
+#include <array>
 #include <filesystem>
+#include <future>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+struct ObjLoadOptions
+{
+    VertexFormat vertexFormat = VertexFormat::Float;
+    // of the material textures; compressed textures and CPU built mips are
+    // cached next to each image (see TextureCache)
+    TextureImportOptions textures;
+    // Pack material textures of the same size and format into texture
+    // arrays, so shapes using them need no texture binds in between.
+    bool textureArrays = false;
+    // Put the shapes' geometry into these shared arenas rather than buffers
+    // and a VAO each, so a RenderQueue can merge their draws. Must outlive
+    // the object.
+    GeometryArenas* arenas = nullptr;
+    // Keep each shape's full detail triangles on the CPU, in a Bvh, so rays
+    // hit the surface (LoadedObject::raycast) rather than the bounds.
+    bool raycastMeshes = false;
+    // Keep a coarse level of detail of each shape on the CPU as its
+    // occluder (see OcclusionBuffer), so the shapes hide what is behind them.
+    bool occluders = false;
+};
+
+// Bounds of all of a shape's vertices (every level of detail), object space.
+struct ShapeBounds
+{
+    Aabb box;
+    // of a sphere around the box's center
+    float radius = 0.0F;
+};
+
+// The CPU half of loading a LoadedObject: either the mapped mesh cache, or the
+// freshly parsed and deduplicated .obj laid out as one in memory (and written
+// to the cache). Touches no GL state, so it can be prepared on any thread.
+struct PreparedObject
+{
+    std::filesystem::path path;
+    ObjLoadOptions options;
+    MeshCache cache;
+    // one per shape
+    std::vector<ShapeBounds> bounds;
+    // one per shape with `ObjLoadOptions::raycastMeshes`
+    std::vector<std::shared_ptr<const RaycastMesh>> raycastMeshes;
+    // one per shape with `ObjLoadOptions::occluders`
+    std::vector<std::shared_ptr<const OccluderMesh>> occluders;
+
+    // The shapes, wherever they came from. Views live as long as this object.
+    [[nodiscard]] const std::vector<MeshCache::ShapeView>& getShapes() const;
+};
+
+// Maps the mesh cache of `path`, or imports the .obj with its shapes built
+// concurrently on `pool` and refreshes the cache. Vertices are then packed
+// as `options` asks.
+[[nodiscard]] PreparedObject
+prepareObject(const std::filesystem::path& path, ObjLoadOptions options = {},
+              ThreadPool& pool = ThreadPool::global());
+
+// Settings of LoadedObject::submit.
+struct ObjDrawSettings
+{
+    // skip shapes whose bounds are outside the frustum
+    bool shapeCulling = true;
+    // skip shapes hidden behind the occluders, when given an OcclusionBuffer
+    bool occlusionCulling = true;
+    // skip meshlets that are outside the frustum or facing away
+    bool meshletCulling = true;
+    // Shapes are drawn at the coarsest level of detail whose error, projected
+    // onto the screen, stays within this many pixels. 0 draws full detail.
+    float lodPixelError = 1.0F;
+    // of the framebuffer drawn to, in pixels
+    float viewportHeight = 1080.0F;
+};
+
+// What LoadedObject::submit submitted. Counts add up with +=.
+struct ObjDrawStats
+{
+    // only counted with `ObjDrawSettings::meshletCulling`
+    MeshletCullStats culling;
+    // shapes submitted, and left out for being outside the frustum
+    size_t shapesVisible = 0;
+    size_t shapesCulled = 0;
+    // and left out for being behind the occluders
+    size_t shapesOccluded = 0;
+    // for drawInstanced, counted once per shape and instance
+    std::array<size_t, maxShapeLods> shapesPerLod{};
+    size_t trianglesDrawn = 0;
+    // only counted by LoadedObject::drawInstanced
+    size_t instancesCulled = 0;
+
+    ObjDrawStats& operator+=(const ObjDrawStats& other)
+    {
+        culling += other.culling;
+        shapesVisible += other.shapesVisible;
+        shapesCulled += other.shapesCulled;
+        shapesOccluded += other.shapesOccluded;
+        for (size_t lod = 0; lod < maxShapeLods; ++lod) {
+            shapesPerLod[lod] += other.shapesPerLod[lod];
+        }
+        trianglesDrawn += other.trianglesDrawn;
+        instancesCulled += other.instancesCulled;
+        return *this;
+    }
+};
+
 struct LoadedObject
 {
     // a single drawable part of the larger object.
@@ -19,16 +143,148 @@ struct LoadedObject
         Mesh mesh;
         // index into the materials vector. -1 if no material
         int materialId = -1;
+        // only used for `VertexFormat::Quantized`
+        QuantizationTransform quantization;
+        // levels of detail, each a range of the index buffer, finest first
+        std::vector<ShapeLod> lods;
+        // cover the whole index buffer, for culling parts of the shape
+        std::vector<Meshlet> meshlets;
+        // bounding box and sphere (around the box's center), object space
+        Aabb box;
+        glm::vec3 center{0.0F};
+        float radius = 0.0F;
+        // only with `ObjLoadOptions::raycastMeshes`
+        std::shared_ptr<const RaycastMesh> raycastMesh;
+        // only with `ObjLoadOptions::occluders`
+        std::shared_ptr<const OccluderMesh> occluder;
     };
 
     std::vector<Shape> shapes;
+    // the shapes' bounds again, one per shape, to be culled in batches
+    CullBounds shapeBounds;
+    VertexFormat vertexFormat = VertexFormat::Float;
+    // where a texture packed into one of `textureArrays` is
+    struct TextureLayer
+    {
+        size_t array = 0;
+        int layer = 0;
+    };
+
     std::vector<tinyobj::material_t> materials;
     std::unordered_map<std::string, Texture> textures;
+    // with `ObjLoadOptions::textureArrays`; packed textures are not in
+    // `textures`
+    std::vector<TextureArray> textureArrays;
+    std::unordered_map<std::string, TextureLayer> textureLayers;
     WorldPose pose;
 
     [[nodiscard]] LoadedObject() = default;
-    [[nodiscard]] LoadedObject(const std::filesystem::path& path);
+    [[nodiscard]] LoadedObject(const std::filesystem::path& path,
+                               ObjLoadOptions options = {});
+    // The GL half of loading: uploads the geometry and loads the textures,
+    // decoding them on `pool`. Must run on the thread owning the GL context.
+    [[nodiscard]] explicit LoadedObject(
+      PreparedObject prepared, ThreadPool& pool = ThreadPool::global());
 
     void setInitUniforms(Shader::BindObject& shader) const;
+    // `VertexFormat::Quantized` objects need a shader that decodes them
+    // (e.g. `vertQuantized.glsl`).
+    // Draws every shape at full detail, with the Object block the caller has
+    // bound for `pose` (see FrameUniforms).
     void draw(Shader::BindObject& shader) const;
+    // Submits every shape to `queue`, drawn with `shader` at the level of
+    // detail `camera` needs, skipping shapes and meshlets that it cannot see.
+    // With `occlusion` rasterised for `camera`, shapes hidden behind its
+    // occluders are skipped too. The object must outlive the queue's
+    // execute().
+    ObjDrawStats submit(RenderQueue& queue, Shader& shader,
+                        const Camera& camera, const ObjDrawSettings& settings,
+                        const OcclusionBuffer* occlusion = nullptr) const;
+    // Draws every shape once per pose of `instances` (`pose` is not used),
+    // with a shader reading InstanceTransform (e.g. `vertInstanced.glsl`) and
+    // the Camera block already bound. Instances outside `camera`'s frustum are
+    // left out and the rest uploaded nearest first, so the ones sharing a
+    // level of detail (picked by the whole object's size on screen) are a run
+    // drawn with one call per shape. Meshlets are not culled.
+    ObjDrawStats drawInstanced(Shader::BindObject& shader,
+                               InstanceSet& instances, const Camera& camera,
+                               const ObjDrawSettings& settings) const;
+    // Queues the shapes' occluders, at `pose`, to be rasterised into
+    // `occlusion`. Shapes without one (see ObjLoadOptions::occluders) hide
+    // nothing.
+    void addOccluders(OcclusionBuffer& occlusion) const;
+    // Box around the shapes' boxes, object space; empty at the origin while
+    // there are no shapes.
+    [[nodiscard]] Aabb computeBox() const;
+    // Distance along `ray`, in world space, to the nearest shape it hits: to
+    // its triangles if it has a raycast mesh, to its box otherwise.
+    [[nodiscard]] std::optional<float>
+    raycast(const Ray& ray,
+            float maxDistance = std::numeric_limits<float>::max()) const;
+    // Asks `streamer` for the mips of the streamed textures that the shapes
+    // need at their size on screen.
+    void requestTextureLevels(const Camera& camera,
+                              const ObjDrawSettings& settings,
+                              TextureStreamer& streamer);
+};
+
+// A LoadedObject loading in the background. File I/O, parsing and texture
+// decoding run on other threads; the GL uploads are done by commitUploads(),
+// a shape or texture at a time, within the time the caller allows per frame.
+// `object` can be drawn all along and fills in as shapes are uploaded.
+//
+// Destroying the handle waits for the background work to finish.
+class AsyncObjectLoad
+{
+  public:
+    enum class Status
+    {
+        Loading,
+        Done,
+        Failed,
+    };
+
+    using DecodedTextures = std::vector<std::pair<std::string, DecodedTexture>>;
+
+    LoadedObject object;
+
+    // Starts loading `path` and returns right away.
+    explicit AsyncObjectLoad(const std::filesystem::path& path,
+                             ObjLoadOptions options = {},
+                             ThreadPool& pool = ThreadPool::global());
+
+    AsyncObjectLoad(const AsyncObjectLoad&) = delete;
+    AsyncObjectLoad& operator=(const AsyncObjectLoad&) = delete;
+    AsyncObjectLoad(AsyncObjectLoad&&) = default;
+    AsyncObjectLoad& operator=(AsyncObjectLoad&&) = default;
+    ~AsyncObjectLoad() = default;
+
+    // Uploads whatever the background threads have ready until
+    // `budgetMilliseconds` have passed (one item may overrun it). Must run on
+    // the thread owning the GL context, typically once per frame.
+    Status commitUploads(double budgetMilliseconds);
+
+    [[nodiscard]] Status getStatus() const;
+    // Why loading failed, empty otherwise.
+    [[nodiscard]] const std::string& getError() const;
+    [[nodiscard]] size_t getUploadedShapeCount() const;
+    // 0 until the object has been parsed
+    [[nodiscard]] size_t getShapeCount() const;
+
+  private:
+    std::filesystem::path path;
+    ObjLoadOptions options;
+    Status status = Status::Loading;
+    std::string error;
+    Stopwatch timer;
+
+    std::future<PreparedObject> preparedFuture;
+    std::future<DecodedTextures> texturesFuture;
+    std::optional<PreparedObject> prepared;
+    std::vector<MeshCache::ShapeView> preparedShapes;
+    std::optional<DecodedTextures> textures;
+    size_t uploadedTextures = 0;
+
+    // the background thread; its future waits for it when destroyed
+    std::future<void> job;
 };
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "frontend/geometryArena.hpp"
+#include "frontend/glState.hpp"
 #include "frontend/shader.hpp"
 #include "indexBuffer.hpp"
 #include "vertexBuffer.hpp"
@@ -7,15 +9,26 @@
 
 #include <GL/glew.h>
 
+#include <cstddef>
 #include <optional>
+#include <span>
+#include <utility>
 
+// Geometry with a VAO and buffers of its own, or a range of a GeometryArena
+// (which then owns those). The draw calls are the same either way.
 class Mesh
 {
     GLuint vao = 0;
-    VertexBuffer vertexBuffer;
+    std::optional<VertexBuffer> vertexBuffer;
     std::optional<IndexBuffer> indexBuffer;
     VertexLayout layout;
     size_t drawCount = 0;
+    // where the VAO's per-instance attributes point, see
+    // drawIndexRangeInstanced()
+    mutable AttributeSource instanceSource;
+    // only for meshes in an arena
+    GeometryArena* arena = nullptr;
+    GeometryArena::Allocation allocation = 0;
 
   public:
     Mesh()
@@ -40,11 +53,20 @@ class Mesh
         setIndexData(indices);
     }
 
+    // Copies the geometry into `arena`, whose layout and index type it has to
+    // match, and which must outlive the mesh. The set*Data() functions are not
+    // for such meshes.
+    template <typename VertexType, typename Index>
+    Mesh(GeometryArena& arena, std::span<const VertexType> vertices,
+         std::span<const Index> indices)
+      : layout{arena.getLayout()}, drawCount{indices.size()}, arena{&arena},
+        allocation{arena.allocate(vertices, indices)}
+    {
+    }
+
     ~Mesh()
     {
-        if (vao != 0) {
-            glDeleteVertexArrays(1, &vao);
-        }
+        release();
     }
 
     // Non-copyable, moveable
@@ -52,27 +74,29 @@ class Mesh
     Mesh& operator=(const Mesh&) = delete;
 
     Mesh(Mesh&& other) noexcept
-      : vao(other.vao), vertexBuffer(std::move(other.vertexBuffer)),
+      : vao(std::exchange(other.vao, 0)),
+        vertexBuffer(std::move(other.vertexBuffer)),
         indexBuffer(std::move(other.indexBuffer)),
-        layout(std::move(other.layout)), drawCount(other.drawCount)
+        layout(std::move(other.layout)),
+        drawCount(std::exchange(other.drawCount, 0)),
+        instanceSource(std::exchange(other.instanceSource, {})),
+        arena(std::exchange(other.arena, nullptr)),
+        allocation(other.allocation)
     {
-        other.vao = 0;
-        other.drawCount = 0;
     }
 
     Mesh& operator=(Mesh&& other) noexcept
     {
         if (this != &other) {
-            if (vao != 0) {
-                glDeleteVertexArrays(1, &vao);
-            }
-            vao = other.vao;
+            release();
+            vao = std::exchange(other.vao, 0);
             vertexBuffer = std::move(other.vertexBuffer);
             indexBuffer = std::move(other.indexBuffer);
             layout = std::move(other.layout);
-            drawCount = other.drawCount;
-            other.vao = 0;
-            other.drawCount = 0;
+            drawCount = std::exchange(other.drawCount, 0);
+            instanceSource = std::exchange(other.instanceSource, {});
+            arena = std::exchange(other.arena, nullptr);
+            allocation = other.allocation;
         }
         return *this;
     }
@@ -80,43 +104,196 @@ class Mesh
     template <typename VertexType>
     void setVertexData(const std::vector<VertexType>& vertices,
                        const VertexLayout& vertexLayout)
+    {
+        setVertexData(vertices.data(), vertices.size(), vertexLayout);
+    }
+
+    // `vertices` is only read during the call, e.g. it may point into a
+    // memory mapped file.
+    template <typename VertexType>
+    void setVertexData(const VertexType* vertices, size_t count,
+                       const VertexLayout& vertexLayout)
     {
         layout = vertexLayout;
 
-        glBindVertexArray(vao);
-        vertexBuffer.uploadData(vertices);
+        GLState::current().bindVertexArray(vao);
+        if (!vertexBuffer) {
+            vertexBuffer.emplace();
+        }
+        vertexBuffer->uploadData(vertices, count);
         layout.apply();
 
-        drawCount = vertices.size();
-        glBindVertexArray(0);
+        drawCount = count;
+        if (glUnbindAfterUse) {
+            GLState::current().bindVertexArray(0);
+        }
     }
 
     void setIndexData(const std::vector<uint32_t>& indices)
     {
-        glBindVertexArray(vao);
+        setIndexData(indices.data(), indices.size());
+    }
+
+    void setIndexData(const std::vector<uint16_t>& indices)
+    {
+        setIndexData(indices.data(), indices.size());
+    }
+
+    // `Index` is uint32_t or uint16_t; draw() uses whichever was set last.
+    template <typename Index>
+    void setIndexData(const Index* indices, size_t count)
+    {
+        GLState::current().bindVertexArray(vao);
         if (!indexBuffer) {
             indexBuffer.emplace();
         }
-        indexBuffer->uploadData(indices);
-        drawCount = indices.size();
-        glBindVertexArray(0);
+        indexBuffer->uploadData(indices, count);
+        drawCount = count;
+        if (glUnbindAfterUse) {
+            GLState::current().bindVertexArray(0);
+        }
     }
 
-    void draw(const Shader::BindObject& /*shader*/,
+    void draw(const Shader::BindObject& shader,
               GLenum primitive = GL_TRIANGLES) const
     {
-        glBindVertexArray(vao);
+        if (arena != nullptr) {
+            arena->drawRange(shader, getArenaRange(), 0, drawCount, primitive);
+            return;
+        }
+        GLState::current().bindVertexArray(vao);
         if (indexBuffer) {
             glDrawElements(primitive, static_cast<GLsizei>(drawCount),
-                           GL_UNSIGNED_INT, nullptr);
+                           indexBuffer->getIndexType(), nullptr);
         } else {
             glDrawArrays(primitive, 0, static_cast<GLsizei>(drawCount));
         }
-        glBindVertexArray(0);
+        if (glUnbindAfterUse) {
+            GLState::current().bindVertexArray(0);
+        }
+    }
+
+    // Draws `count` indices starting at index `first`.
+    void drawIndexRange(const Shader::BindObject& shader, size_t first,
+                        size_t count, GLenum primitive = GL_TRIANGLES) const
+    {
+        if (arena != nullptr) {
+            arena->drawRange(shader, getArenaRange(), first, count, primitive);
+            return;
+        }
+        if (!indexBuffer || count == 0) {
+            return;
+        }
+        GLState::current().bindVertexArray(vao);
+        glDrawElements(primitive, static_cast<GLsizei>(count),
+                       indexBuffer->getIndexType(),
+                       reinterpret_cast<const void*>(first * getIndexSize()));
+        if (glUnbindAfterUse) {
+            GLState::current().bindVertexArray(0);
+        }
+    }
+
+    // Draws `count` indices starting at index `first` once for each of
+    // `instanceCount` instances, whose attributes (`instanceLayout`, with a
+    // divisor) are read from `instances` starting at `firstInstance`. The
+    // VAO keeps pointing there, so drawing the same instances again sets
+    // nothing up.
+    void drawIndexRangeInstanced(const Shader::BindObject& shader,
+                                 size_t first, size_t count,
+                                 const VertexBuffer& instances,
+                                 const VertexLayout& instanceLayout,
+                                 size_t firstInstance, size_t instanceCount,
+                                 GLenum primitive = GL_TRIANGLES) const
+    {
+        if (arena != nullptr) {
+            arena->drawRangeInstanced(shader, getArenaRange(), first, count,
+                                      instances, instanceLayout, firstInstance,
+                                      instanceCount, primitive);
+            return;
+        }
+        if (!indexBuffer || count == 0 || instanceCount == 0) {
+            return;
+        }
+        GLState::current().bindVertexArray(vao);
+        // GL 4.1 has no base instance to draw from, so the attributes are
+        // pointed at the first one instead
+        instanceLayout.applyFrom(instances.getId(),
+                                 firstInstance * instanceLayout.getStride(),
+                                 instanceSource);
+        glDrawElementsInstanced(
+          primitive, static_cast<GLsizei>(count), indexBuffer->getIndexType(),
+          reinterpret_cast<const void*>(first * getIndexSize()),
+          static_cast<GLsizei>(instanceCount));
+        if (glUnbindAfterUse) {
+            GLState::current().bindVertexArray(0);
+        }
+    }
+
+    // Draws several parts of the index buffer in one call: `counts[i]`
+    // indices starting `offsets[i]` bytes into it (see getIndexSize()).
+    void drawIndexRanges(const Shader::BindObject& shader,
+                         std::span<const GLsizei> counts,
+                         std::span<const void* const> offsets,
+                         GLenum primitive = GL_TRIANGLES) const
+    {
+        if (arena != nullptr) {
+            arena->drawRanges(shader, getArenaRange(), counts, offsets,
+                              primitive);
+            return;
+        }
+        if (!indexBuffer || counts.empty()) {
+            return;
+        }
+        GLState::current().bindVertexArray(vao);
+        glMultiDrawElements(primitive, counts.data(),
+                            indexBuffer->getIndexType(), offsets.data(),
+                            static_cast<GLsizei>(counts.size()));
+        if (glUnbindAfterUse) {
+            GLState::current().bindVertexArray(0);
+        }
+    }
+
+    // Bytes per index, 0 if there is no index buffer.
+    [[nodiscard]] size_t getIndexSize() const
+    {
+        if (arena != nullptr) {
+            return arena->getIndexSize();
+        }
+        if (!indexBuffer) {
+            return 0;
+        }
+        return indexBuffer->getIndexType() == GL_UNSIGNED_SHORT
+                 ? sizeof(uint16_t)
+                 : sizeof(uint32_t);
     }
 
     [[nodiscard]] GLuint getVAO() const
     {
-        return vao;
+        return arena != nullptr ? arena->getVAO() : vao;
+    }
+
+    // The arena the mesh is in, if any.
+    [[nodiscard]] const GeometryArena* getArena() const
+    {
+        return arena;
+    }
+
+    // Where the mesh is in its arena.
+    [[nodiscard]] const ArenaRange& getArenaRange() const
+    {
+        return arena->rangeOf(allocation);
+    }
+
+  private:
+    void release()
+    {
+        if (arena != nullptr) {
+            arena->free(allocation);
+            arena = nullptr;
+        }
+        if (vao != 0) {
+            GLState::current().deleteVertexArray(vao);
+            vao = 0;
+        }
     }
 };
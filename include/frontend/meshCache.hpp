@@ -0,0 +1,100 @@
+#pragma once
+
+#include "frontend/objImport.hpp"
+#include "frontend/vertexQuantize.hpp"
+#include "util/mappedFile.hpp"
+
+#include <tiny_obj_loader.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <variant>
+#include <vector>
+
+// On-disk cache of the deduplicated geometry `importObjFile` produces, stored
+// next to the source as `<name>.obj.meshcache`, or as
+// `<name>.obj.quantized.meshcache` for `VertexFormat::Quantized`.
+//
+// The file is a small header and record tables followed by the raw vertex,
+// index, meshlet and level of detail arrays of every shape, each 16-byte
+// aligned. Indices are 16-bit, the way they are uploaded: `importObjFile`
+// splits shapes so none has more vertices than that reaches. On a hit the
+// file is memory mapped and the arrays are handed to the GL buffers straight
+// from the mapped pages, so nothing is parsed or copied on the CPU. On a
+// miss the same layout is built in memory, so loads take one path either way.
+// A quantized cache also holds each shape's `QuantizedObjVertex` array and
+// its transform, so vertices are only packed when the cache is built.
+//
+// A cache is valid while the .obj has the size it was built from, and either
+// the same mtime or (if only the mtime changed, e.g. after a checkout) the
+// same content hash. The .mtl files it references are tracked by size/mtime,
+// and those missing when it was built by their absence.
+class MeshCache
+{
+  public:
+    // Bump whenever the file layout, `LoadedObjVertex`, `QuantizedObjVertex`,
+    // `Meshlet`, `ShapeLod` or the geometry `importObjFile` produces changes.
+    static constexpr uint32_t formatVersion = 9;
+
+    struct ShapeView
+    {
+        std::span<const LoadedObjVertex> vertices;
+        std::span<const uint16_t> indices;
+        std::span<const Meshlet> meshlets;
+        std::span<const ShapeLod> lods;
+        // `vertices` packed, in a quantized cache; empty otherwise
+        std::span<const QuantizedObjVertex> quantizedVertices;
+        QuantizationTransform quantization;
+        int materialId = -1;
+    };
+
+  private:
+    // the mapped file, or the bytes `build` laid out
+    using Storage = std::variant<std::vector<std::byte>, MappedFile>;
+
+    Storage storage;
+    std::vector<ShapeView> shapes;
+    std::vector<tinyobj::material_t> materials;
+    VertexFormat vertexFormat = VertexFormat::Float;
+
+    explicit MeshCache(Storage storage);
+
+    [[nodiscard]] std::span<const std::byte> bytes() const;
+    // Fills `shapes` and `materials` from the bytes; false if they are
+    // corrupt.
+    [[nodiscard]] bool readContents();
+
+  public:
+    // Empty: no shapes or materials.
+    MeshCache() = default;
+
+    [[nodiscard]] static std::filesystem::path
+    pathFor(const std::filesystem::path& objPath,
+            VertexFormat format = VertexFormat::Float);
+
+    // Maps and validates the `format` cache belonging to `objPath`.
+    // Returns nothing if there is no cache or it is stale/corrupt.
+    [[nodiscard]] static std::optional<MeshCache>
+    open(const std::filesystem::path& objPath,
+         VertexFormat format = VertexFormat::Float);
+
+    // Lays `object`, imported from `objPath`, out as its cache, in memory;
+    // a quantized one if `quantized` holds the packed vertices of each of its
+    // shapes. Throws IrrecoverableError if `objPath` cannot be read.
+    [[nodiscard]] static MeshCache
+    build(const std::filesystem::path& objPath, const ImportedObject& object,
+          std::span<const QuantizedShape> quantized = {});
+
+    // Writes (or replaces) the cache of this one's format belonging to
+    // `objPath` with this one.
+    // Throws IrrecoverableError if the file cannot be written.
+    void save(const std::filesystem::path& objPath) const;
+
+    // Views point into the mapping (or memory) and live as long as this
+    // object.
+    [[nodiscard]] const std::vector<ShapeView>& getShapes() const;
+    [[nodiscard]] const std::vector<tinyobj::material_t>& getMaterials() const;
+    [[nodiscard]] VertexFormat getVertexFormat() const;
+};
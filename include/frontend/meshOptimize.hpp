@@ -0,0 +1,87 @@
+#pragma once
+
+#include "frontend/objImport.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Import-time reordering of triangle lists for the GPU: better post-transform
+// vertex cache use, less overdraw and more linear vertex fetches. None of it
+// changes what gets drawn, only the order.
+
+// Post-transform cache efficiency of an index buffer, measured against a
+// simulated FIFO cache. Counts add up, so stats of several shapes can be
+// combined with +=.
+struct VertexCacheStats
+{
+    size_t transformed = 0; // cache misses, i.e. vertex shader invocations
+    size_t triangles = 0;
+    size_t vertices = 0;
+
+    // Average cache miss ratio: transformed vertices per triangle. 0.5 is
+    // the ideal for a regular grid, 3 means no reuse at all.
+    [[nodiscard]] double acmr() const
+    {
+        return triangles == 0 ? 0.0
+                              : static_cast<double>(transformed) /
+                                  static_cast<double>(triangles);
+    }
+
+    // Average transform to vertex ratio: how often each vertex gets shaded.
+    // 1 is optimal.
+    [[nodiscard]] double atvr() const
+    {
+        return vertices == 0 ? 0.0
+                             : static_cast<double>(transformed) /
+                                 static_cast<double>(vertices);
+    }
+
+    VertexCacheStats& operator+=(const VertexCacheStats& other)
+    {
+        transformed += other.transformed;
+        triangles += other.triangles;
+        vertices += other.vertices;
+        return *this;
+    }
+};
+
+// Cache size used by the optimisers and the analysis. Real hardware differs,
+// but orderings that do well on a 16-entry FIFO do well on all of them.
+inline constexpr size_t vertexCacheSize = 16;
+
+[[nodiscard]] VertexCacheStats
+analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount,
+                   size_t cacheSize = vertexCacheSize);
+
+// Reorders triangles for the post-transform cache with Tipsify (Sander et
+// al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+void optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount,
+                         size_t cacheSize = vertexCacheSize);
+
+// Splits an already cache-optimised triangle list into clusters and sorts the
+// clusters so the ones facing away from the mesh centre (likely in front)
+// come first. `threshold` is how much ACMR may get worse (1.05 = 5%) in
+// exchange for smaller clusters, i.e. better sorting.
+void optimizeOverdraw(std::span<uint32_t> indices,
+                      std::span<const LoadedObjVertex> vertices,
+                      float threshold = 1.05F);
+
+// Reorders the vertices of `shape` into the order the index buffer first
+// uses them, so vertex fetches walk memory linearly.
+void optimizeVertexFetch(ImportedShape& shape);
+
+// Runs all of the above in the right order.
+void optimizeShape(ImportedShape& shape);
+
+// Most vertices a shape can have and still be drawn with 16-bit indices.
+inline constexpr size_t maxShortIndexVertices = size_t{1} << 16;
+
+// Splits `shape` into consecutive runs of its triangles that each use at most
+// `maxVertices` vertices, so every part can use 16-bit indices. Triangle order
+// (and the first-use vertex order within each part) is kept; vertices shared
+// across a cut are duplicated. Shapes that already fit come back as is.
+[[nodiscard]] std::vector<ImportedShape>
+splitForShortIndices(ImportedShape shape,
+                     size_t maxVertices = maxShortIndexVertices);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "frontend/objImport.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Import-time mesh simplification for levels of detail.
+
+// Most levels of detail a shape gets, counting the full detail one.
+inline constexpr size_t maxShapeLods = 6;
+
+// Shapes (or levels) with fewer triangles are not simplified further.
+inline constexpr size_t minLodTriangles = 128;
+
+struct SimplifiedMesh
+{
+    std::vector<uint32_t> indices;
+    // roughly how far the simplified surface is from the input, object space
+    float error = 0.0F;
+};
+
+// Quadric error edge collapse (Garland and Heckbert, "Surface Simplification
+// Using Quadric Error Metrics") down to about `targetIndexCount` indices.
+// Vertices only ever collapse onto a neighbour, so the result indexes the
+// same `vertices`. Vertices on open borders and on seams (where vertices of
+// the same position differ in normal or UV) never move, so there are no
+// cracks between shapes or along UV islands. Stops early if nothing more
+// can be collapsed without flipping triangles.
+[[nodiscard]] SimplifiedMesh
+simplifyMesh(std::span<const uint32_t> indices,
+             std::span<const LoadedObjVertex> vertices,
+             size_t targetIndexCount);
+
+// Appends up to `maxShapeLods - 1` simplified levels, each about half the
+// triangles of the one before, to `shape.indices` and describes all of them
+// in `shape.lods`. Each level is optimised for the vertex cache. Meshlets
+// are not built (see buildShapeMeshlets()).
+void buildLodChain(ImportedShape& shape);
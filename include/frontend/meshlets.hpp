@@ -0,0 +1,92 @@
+#pragma once
+
+#include "frontend/frustum.hpp"
+#include "frontend/objImport.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Splitting shapes into meshlets (small clusters of triangles) and culling
+// them on the CPU, so parts of a big shape that are off-screen or face away
+// from the camera are not drawn.
+//
+// Meshlets are consecutive runs of the shape's (already optimised) index
+// buffer, so the triangle order, and with it the vertex cache and overdraw
+// work, is kept, and visible neighbours merge into a single range.
+
+inline constexpr size_t maxMeshletVertices = 64;
+inline constexpr size_t maxMeshletTriangles = 124;
+
+// Cuts `indices` into meshlets of at most `maxVertices` distinct vertices and
+// `maxTriangles` triangles each, and computes their culling bounds.
+[[nodiscard]] std::vector<Meshlet>
+buildMeshlets(std::span<const uint32_t> indices,
+              std::span<const LoadedObjVertex> vertices,
+              size_t maxVertices = maxMeshletVertices,
+              size_t maxTriangles = maxMeshletTriangles);
+
+// Builds the meshlets of every level of detail of `shape` into
+// `shape.meshlets`, and points `shape.lods` at them.
+void buildShapeMeshlets(ImportedShape& shape);
+
+// What the culler made of meshlets, summed over a frame. Counts add up with +=.
+struct MeshletCullStats
+{
+    size_t meshlets = 0;
+    size_t frustumCulled = 0;
+    size_t backfaceCulled = 0;
+    size_t triangles = 0;
+    size_t trianglesCulled = 0;
+
+    [[nodiscard]] size_t meshletsCulled() const
+    {
+        return frustumCulled + backfaceCulled;
+    }
+
+    MeshletCullStats& operator+=(const MeshletCullStats& other)
+    {
+        meshlets += other.meshlets;
+        frustumCulled += other.frustumCulled;
+        backfaceCulled += other.backfaceCulled;
+        triangles += other.triangles;
+        trianglesCulled += other.trianglesCulled;
+        return *this;
+    }
+};
+
+enum class MeshletVisibility
+{
+    Visible,
+    OutsideFrustum,
+    BackFacing,
+};
+
+// Tests the meshlets of one object against a camera. Everything happens in
+// the object's space, so the meshlet bounds are used as stored.
+class MeshletCuller
+{
+    Frustum frustum;
+    glm::vec3 cameraPosition{0.0F};
+    // a mirroring model matrix flips which side is the front
+    bool coneCulling = true;
+
+  public:
+    // `cameraPosition` is in world space, `model` the object's transform.
+    MeshletCuller(const glm::mat4& viewProjection, const glm::mat4& model,
+                  glm::vec3 cameraPosition);
+
+    [[nodiscard]] MeshletVisibility classify(const Meshlet& meshlet) const;
+    // Whether any of the sphere, in object space, may be inside the frustum.
+    [[nodiscard]] bool intersectsFrustum(glm::vec3 center, float radius) const;
+    // in object space
+    [[nodiscard]] const Frustum& getFrustum() const;
+
+    // Classifies `meshlet` and adds the result to `stats`.
+    [[nodiscard]] bool isVisible(const Meshlet& meshlet,
+                                 MeshletCullStats& stats) const;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "frontend/blockCompression.hpp"
+#include "util/threadPool.hpp"
+
+#include <vector>
+
+// Mip chain generation on the CPU, so mips look the same on every driver and
+// can be cached with the texture instead of rebuilt on every load.
+//
+// Filtering happens on float RGBA in linear light (colour of sRGB images is
+// converted on the way in and out), one level from the one before, as a
+// separable horizontal then vertical pass. Both passes are vectorised: SSE2
+// or AVX2 when the build targets them, plain C++ otherwise.
+
+enum class MipFilter : uint32_t
+{
+    // averages 2x2 texels, like glGenerateMipmap
+    Box = 0,
+    // Kaiser windowed sinc over 8x8 texels: sharper mips with less aliasing
+    Kaiser = 1,
+};
+
+[[nodiscard]] const char* mipFilterName(MipFilter filter);
+
+// "AVX2", "SSE2" or "scalar", whichever the filters were compiled for.
+[[nodiscard]] const char* mipSimdPath();
+
+// Halves `image` until it is 1x1, starting with a copy of `image` itself.
+// Colour is filtered in linear light if `srgb`; alpha never is. Rows of each
+// level are spread over `pool`.
+[[nodiscard]] std::vector<RgbaImage>
+buildMipChain(const RgbaImage& image, bool srgb,
+              MipFilter filter = MipFilter::Kaiser,
+              ThreadPool& pool = ThreadPool::global());
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "util/threadPool.hpp"
+
+#include <glm/glm.hpp>
+
+#include <tiny_obj_loader.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <type_traits>
+#include <vector>
+
+// The vertex format every shape of a LoadedObject is built from.
+// Its raw bytes are written to (and mapped back from) the mesh cache, so any
+// change to its layout must bump `MeshCache::formatVersion`.
+struct LoadedObjVertex
+{
+    glm::vec3 position{};
+    glm::vec3 normal{};
+    glm::vec2 texCoord{};
+
+    LoadedObjVertex() = default;
+
+    LoadedObjVertex(const tinyobj::index_t& index,
+                    const tinyobj::attrib_t& attrib)
+    {
+        // Position
+        if (index.vertex_index >= 0) {
+            position = {attrib.vertices[(3 * index.vertex_index) + 0],
+                        attrib.vertices[(3 * index.vertex_index) + 1],
+                        attrib.vertices[(3 * index.vertex_index) + 2]};
+        }
+
+        // Normal
+        if (index.normal_index >= 0) {
+            normal = {attrib.normals[(3 * index.normal_index) + 0],
+                      attrib.normals[(3 * index.normal_index) + 1],
+                      attrib.normals[(3 * index.normal_index) + 2]};
+        }
+
+        // TexCoord (flip V)
+        if (index.texcoord_index >= 0) {
+            texCoord = {attrib.texcoords[(2 * index.texcoord_index) + 0],
+                        1.0F -
+                          attrib.texcoords[(2 * index.texcoord_index) + 1]};
+        }
+    }
+
+    // Needed for use as a key in std::unordered_map
+    bool operator==(const LoadedObjVertex& other) const
+    {
+        return position == other.position && normal == other.normal &&
+               texCoord == other.texCoord;
+    }
+} __attribute__((packed));
+
+static_assert(sizeof(LoadedObjVertex) == 32);
+static_assert(std::is_trivially_copyable_v<LoadedObjVertex>);
+
+// A run of consecutive triangles of a shape's index buffer that is culled as
+// a unit (see meshlets.hpp). Stored in the mesh cache as raw bytes, like
+// LoadedObjVertex.
+struct Meshlet
+{
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    // bounding sphere, object space
+    glm::vec3 center{0.0F};
+    float radius = 0.0F;
+    // normal cone: every triangle faces away from a viewer at v (relative to
+    // the sphere) if `dot(-v, coneAxis) >= coneCutoff * |v| + radius`.
+    // A cutoff of 1 or more never culls.
+    glm::vec3 coneAxis{0.0F};
+    float coneCutoff = 1.0F;
+};
+
+static_assert(sizeof(Meshlet) == 40);
+static_assert(std::is_trivially_copyable_v<Meshlet>);
+
+// One level of detail of a shape: a range of its index buffer, and the
+// meshlets covering that range. All levels share the shape's vertices.
+// Stored in the mesh cache as raw bytes.
+struct ShapeLod
+{
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    uint32_t firstMeshlet = 0;
+    uint32_t meshletCount = 0;
+    // how far this level's surface may be from the full detail one, in
+    // object space units
+    float error = 0.0F;
+};
+
+static_assert(sizeof(ShapeLod) == 20);
+static_assert(std::is_trivially_copyable_v<ShapeLod>);
+
+// CPU-side geometry of a single shape, deduplicated and ready for upload.
+struct ImportedShape
+{
+    std::vector<LoadedObjVertex> vertices;
+    // the index ranges of all levels of detail, finest first
+    std::vector<uint32_t> indices;
+    // covers `indices` in order, without gaps
+    std::vector<Meshlet> meshlets;
+    // at least one (the full detail) for a shape with triangles
+    std::vector<ShapeLod> lods;
+    // index into the materials vector. -1 if no material
+    int materialId = -1;
+};
+
+// Everything parsed out of an .obj (and its .mtl files) before any GL work.
+struct ImportedObject
+{
+    std::vector<ImportedShape> shapes;
+    std::vector<tinyobj::material_t> materials;
+};
+
+// Parses the .obj at `path` (with the chunked parser, or tinyobj for files it
+// does not handle) and builds deduplicated vertex/index arrays for every
+// shape, shapes in parallel on `pool`. Touches no GL state.
+[[nodiscard]] ImportedObject
+importObjFile(const std::filesystem::path& path,
+              ThreadPool& pool = ThreadPool::global());
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "util/threadPool.hpp"
+
+#include <tiny_obj_loader.h>
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Raw contents of an .obj, laid out exactly as tinyobj lays them out.
+struct ParsedObj
+{
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warning;
+};
+
+// Parses with tinyobj (triangulating, .mtl files looked up next to `path`).
+// Throws IrrecoverableError if tinyobj fails.
+[[nodiscard]] ParsedObj parseObjWithTinyObj(const std::filesystem::path& path);
+
+// Multithreaded parser for large files. The file is memory mapped and split
+// into line-aligned chunks that are parsed in parallel on `pool`, then
+// stitched back together in file order.
+//
+// Produces the same shapes, materials and attrib vertices, normals,
+// texcoords and colors as `parseObjWithTinyObj` bit for bit: numbers are
+// parsed with tinyobj's own rounding and quads are split along the same
+// diagonal. The other attrib arrays (texture `w`s, weights) are left empty.
+// Vertex colours, lines, points and polygons with more than four corners are
+// left to tinyobj; for those files this returns nothing and the caller
+// should fall back.
+// Throws IrrecoverableError on malformed faces/indices.
+[[nodiscard]] std::optional<ParsedObj>
+parseObjChunked(const std::filesystem::path& path,
+                ThreadPool& pool = ThreadPool::global());
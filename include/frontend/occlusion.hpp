@@ -0,0 +1,155 @@
+#pragma once
+
+#include "frontend/camera.hpp"
+#include "frontend/frustum.hpp"
+#include "util/threadPool.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Occlusion culling on the CPU: a small depth buffer is rasterised from a
+// few coarse occluder meshes, then bounding boxes are tested against it, so
+// whatever is hidden behind walls is never submitted to the GPU.
+//
+// The buffer is split into tiles of 32 by 16 pixels. Occluder triangles are
+// set up and binned to the tiles they touch, a chunk of triangles at a time,
+// then each tile is rasterised on its own, 8 (AVX2) or 4 (SSE2) pixels of a
+// row at a time when the build targets those, plain C++ otherwise. Chunks
+// and tiles are spread over a ThreadPool. Nothing touches GL.
+//
+// Each pixel holds 1 / w, the reciprocal of the view depth, of the nearest
+// occluder: unlike w it is linear across the screen, and nearer is larger.
+
+// Triangles standing in for a shape when it hides others: a coarse level of
+// detail of it, with only the vertices that level uses. Being a level of
+// detail, it never leaves the shape's bounds, but may bulge out of its
+// surface by up to the level's error.
+struct OccluderMesh
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+};
+
+// What the last OcclusionBuffer::rasterise did.
+struct OcclusionStats
+{
+    size_t occluders = 0;
+    size_t triangles = 0;
+    // triangles facing the camera and on screen, after near plane clipping
+    size_t trianglesRasterised = 0;
+    double rasteriseMilliseconds = 0.0;
+};
+
+// "AVX2", "SSE2" or "scalar", whichever OcclusionBuffer::rasterise was
+// compiled for.
+[[nodiscard]] const char* occlusionSimdPath();
+
+class OcclusionBuffer
+{
+  public:
+    static constexpr int tileWidth = 32;
+    static constexpr int tileHeight = 16;
+
+    // Sizes are rounded up to whole tiles.
+    explicit OcclusionBuffer(int width = 256, int height = 128);
+
+    // Only clears the buffer if the (rounded) size changes.
+    void resize(int width, int height);
+    [[nodiscard]] int getWidth() const;
+    [[nodiscard]] int getHeight() const;
+
+    // Starts a frame seen through `clipFromWorld` (projection times view):
+    // forgets the occluders and clears every pixel to nothing.
+    void begin(const glm::mat4& clipFromWorld);
+    void begin(const Camera& camera);
+    // Queues `mesh`, placed in the world by `model`, for rasterise(). The
+    // mesh is only referenced and must outlive that call.
+    void addOccluder(const OccluderMesh& mesh, const glm::mat4& model);
+
+    // Draws the queued occluders' front faces, as the GPU would with back
+    // face culling.
+    void rasterise(ThreadPool& pool = ThreadPool::global());
+    // The same, a pixel at a time; what rasterise() is checked against.
+    void rasteriseScalar(ThreadPool& pool = ThreadPool::global());
+
+    // Whether any of `box`, placed in the world by `model`, may be in front
+    // of the occluders rasterised. Conservative: the box is tested where its
+    // nearest corner is, over every pixel its corners span plus one more
+    // around them, against the farthest each occluder gets within a pixel.
+    // Boxes crossing the near plane are always visible, those off screen
+    // never are. Occluders cover the pixels whose centers they cover, so gaps
+    // between them narrower than a pixel count as closed.
+    [[nodiscard]] bool isVisible(const Aabb& box, const glm::mat4& model) const;
+    // In world space.
+    [[nodiscard]] bool isVisible(const Aabb& box) const;
+
+    // 1 / w of the nearest occluder at a pixel, 0 if there is none. Row 0 is
+    // the top of the screen.
+    [[nodiscard]] float getDepth(int x, int y) const;
+    // The buffer as RGB bytes, top row first: nearer occluders brighter,
+    // black where there are none.
+    void writeDebugImage(std::vector<unsigned char>& rgb) const;
+
+    [[nodiscard]] const OcclusionStats& getStats() const;
+
+  private:
+    struct Occluder
+    {
+        const OccluderMesh* mesh = nullptr;
+        glm::mat4 clipFromObject{1.0F};
+        // of the occluders before this one
+        size_t firstTriangle = 0;
+    };
+
+    // A screen space triangle set up for rasterising: edge functions and
+    // 1 / w as planes over the pixel centers, and the pixels it may cover.
+    struct RasterTriangle
+    {
+        // inside where all three a * x + b * y + c are >= 0
+        float edgeA[3];
+        float edgeB[3];
+        float edgeC[3];
+        float depthA;
+        float depthB;
+        float depthC;
+        int minX;
+        int minY;
+        int maxX;
+        int maxY;
+    };
+
+    // The triangles a chunk of occluder triangles turned into, and which of
+    // them each tile has to rasterise.
+    struct Chunk
+    {
+        std::vector<RasterTriangle> triangles;
+        std::vector<std::vector<uint32_t>> tileTriangles;
+    };
+
+    int width = 0;
+    int height = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+    glm::mat4 clipFromWorld{1.0F};
+    // tile by tile, each tile row by row
+    std::vector<float> depths;
+    // the farthest pixel of each tile, for testing whole tiles at once
+    std::vector<float> tileMinDepths;
+    std::vector<Occluder> occluders;
+    size_t triangleCount = 0;
+    // only the first `chunkCount` are in use
+    std::vector<Chunk> chunks;
+    size_t chunkCount = 0;
+    OcclusionStats stats;
+
+    void setUpTriangles(ThreadPool& pool);
+    void addTriangle(Chunk& chunk, glm::vec4 a, glm::vec4 b,
+                     glm::vec4 c) const;
+    void rasteriseTiles(ThreadPool& pool, bool scalar);
+    void rasteriseTile(int tile, bool scalar);
+    [[nodiscard]] float* tilePixels(int tile);
+    [[nodiscard]] size_t pixelIndex(int x, int y) const;
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "frontend/camera.hpp"
+#include "frontend/drawParams.hpp"
+#include "frontend/geometryArena.hpp"
+#include "frontend/mesh.hpp"
+#include "frontend/shader.hpp"
+#include "frontend/uniformBlocks.hpp"
+#include "frontend/vertexQuantize.hpp"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Draws are not issued as objects are walked, but submitted to a RenderQueue
+// as packets and issued together once the frame's packets are in. The queue
+// sorts them by a 64-bit key so draws sharing a program and then textures
+// run back to back, front to back within such a bucket, and skips the state
+// changes that then turn out to be redundant.
+//
+// Key, from the most significant bit:
+//   program  10 bits
+//   textures 16 bits
+//   depth    22 bits, front to back
+//   mesh     16 bits
+// Programs and meshes are told apart by folding their addresses, textures by
+// their GL names; two that fold alike only cost a switch, never a wrong draw.
+//
+// The camera, lights and model matrices reach the shaders as the shared
+// uniform blocks (see uniformBlocks.hpp): the frame's objects are uploaded
+// in one go, and a draw of another object binds its range of that buffer.
+//
+// Packets of meshes in a GeometryArena that follow each other and differ only
+// in their geometry and DrawParams are merged into one
+// glMultiDrawElementsIndirect where the context has it; the commands and
+// DrawParams of the whole frame are uploaded before the first draw.
+//
+// All storage is kept from frame to frame, so once it has grown to the
+// largest frame a frame allocates nothing.
+
+// Texture state of a draw. 0 binds nothing and leaves what was bound.
+struct DrawMaterial
+{
+    // on unit 0
+    uint32_t texture = 0;
+    // on unit 1, sampled at `layer` if not 0
+    uint32_t textureArray = 0;
+    int layer = -1;
+    bool topRowFirst = false;
+};
+
+struct DrawPacket
+{
+    Shader* shader = nullptr;
+    const Mesh* mesh = nullptr;
+    DrawMaterial material;
+    // index returned by RenderQueue::addTransform()
+    uint32_t transform = 0;
+    // for quantized vertices; null otherwise
+    const QuantizationTransform* quantization = nullptr;
+    // `indexCount` indices from `firstIndex`, or, if `rangeCount` is not 0,
+    // `rangeCount` ranges from RenderQueue::addRange()'s `firstRange`
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    uint32_t firstRange = 0;
+    uint32_t rangeCount = 0;
+};
+
+// What executing the queue took. Counts add up with +=.
+struct RenderQueueStats
+{
+    size_t packets = 0;
+    size_t drawCalls = 0;
+    // glMultiDrawElementsIndirect calls among `drawCalls`, and the commands
+    // they issued
+    size_t multiDraws = 0;
+    size_t indirectCommands = 0;
+    size_t programBinds = 0;
+    size_t textureBinds = 0;
+    // vertex array switches; meshes in one arena share theirs
+    size_t meshBinds = 0;
+    double sortMilliseconds = 0.0;
+
+    RenderQueueStats& operator+=(const RenderQueueStats& other)
+    {
+        packets += other.packets;
+        drawCalls += other.drawCalls;
+        multiDraws += other.multiDraws;
+        indirectCommands += other.indirectCommands;
+        programBinds += other.programBinds;
+        textureBinds += other.textureBinds;
+        meshBinds += other.meshBinds;
+        sortMilliseconds += other.sortMilliseconds;
+        return *this;
+    }
+};
+
+class RenderQueue
+{
+  public:
+    // Forgets the previous frame's packets and starts one seen by `camera`
+    // and lit by `lighting`.
+    void begin(const Camera& camera, const SceneLighting& lighting = {});
+
+    // Model matrices are shared by all the packets of an object, as the
+    // Object block.
+    [[nodiscard]] uint32_t addTransform(const glm::mat4& model);
+    // An index range for a multi-draw packet: `count` indices from `offset`
+    // bytes into the index buffer. Ranges added one after another can be
+    // drawn by one packet; returns the index to give it as `firstRange`.
+    [[nodiscard]] uint32_t addRange(GLsizei count, const void* offset);
+
+    // `center` is where the draw is in world space, for depth sorting.
+    void submit(const DrawPacket& packet, const glm::vec3& center);
+
+    // A buffer of flags for whoever is submitting to cull with (e.g. which of
+    // an object's shapes are in the frustum), kept from frame to frame so it
+    // only allocates while it grows. Its contents are the caller's until the
+    // next call.
+    [[nodiscard]] std::vector<uint8_t>& visibilityScratch();
+
+    // Sorts the packets by key; execute() does it if need be.
+    void sort();
+
+    // Uploads the frame's uniform blocks and issues the packets, binding each
+    // program in turn. Must run on the thread owning the GL context, with no
+    // shader bound.
+    RenderQueueStats execute();
+
+    [[nodiscard]] size_t size() const;
+    // Packets in the order execute() issues them, once sorted.
+    [[nodiscard]] const DrawPacket& sortedPacket(size_t i) const;
+
+  private:
+    struct SortItem
+    {
+        uint64_t key = 0;
+        uint32_t packet = 0;
+    };
+
+    // Fills and uploads the commands and DrawParams of the packets of meshes
+    // in arenas, in sorted order
+    void buildIndirectCommands();
+
+    Camera camera;
+    SceneLighting lighting;
+    FrameUniforms frameUniforms;
+    std::vector<DrawPacket> packets;
+    std::vector<SortItem> order;
+    std::vector<SortItem> scratch;
+    std::vector<uint8_t> visibility;
+    std::vector<GLsizei> rangeCounts;
+    std::vector<const void*> rangeOffsets;
+    // for multi-draws; `firstCommands[i]` is the first command of the i-th
+    // sorted packet, with one more entry for the end
+    std::vector<DrawParams> drawParams;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<uint32_t> firstCommands;
+    // created on first use, so a queue can be made without a GL context
+    std::optional<VertexBuffer> drawParamsBuffer;
+    IndirectCommandBuffer commandBuffer;
+    bool sorted = true;
+    double sortMilliseconds = 0.0;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "frontend/bvh.hpp"
+#include "frontend/camera.hpp"
+#include "frontend/frustum.hpp"
+#include "frontend/loadedObj.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+// The world space ray from `camera` through `cursor`, in window coordinates
+// (origin top left) of a window `windowSize` big. Its direction is
+// normalised, so distances along it are world units.
+[[nodiscard]] Ray rayThroughCursor(const Camera& camera, glm::vec2 cursor,
+                                   glm::vec2 windowSize);
+
+// Where a ray hit a scene.
+struct SceneHit
+{
+    const LoadedObject* object = nullptr;
+    float distance = 0.0F;
+    glm::vec3 position{0.0F};
+};
+
+// The objects of a scene in a Bvh of their world space boxes, so culling
+// them and picking one under the cursor do not test every object. Objects
+// are only referenced; moving one (its `pose`) or adding shapes to it (as an
+// AsyncObjectLoad does) is picked up by update().
+class SceneBvh
+{
+  public:
+    // `object` must stay where it is until it is removed.
+    uint32_t add(const LoadedObject& object);
+    void remove(uint32_t id);
+
+    // Refits the boxes of the objects that moved or grew since the last
+    // call, or rebuilds the tree if that has made it too slow (or objects
+    // came or went). Once a frame, before the queries. Returns whether the
+    // tree was rebuilt.
+    bool update();
+
+    // Appends the objects that may be inside `frustum`.
+    void cull(const Frustum& frustum,
+              std::vector<const LoadedObject*>& visible) const;
+    // The nearest object surface along `ray` (see LoadedObject::raycast).
+    [[nodiscard]] std::optional<SceneHit>
+    raycast(const Ray& ray,
+            float maxDistance = std::numeric_limits<float>::max()) const;
+
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] const Bvh& getBvh() const;
+
+  private:
+    struct Entry
+    {
+        const LoadedObject* object = nullptr;
+        // what the box was computed from
+        glm::mat4 model{0.0F};
+        size_t shapeCount = 0;
+    };
+
+    // by Bvh primitive id
+    std::vector<Entry> entries;
+    Bvh bvh;
+
+    [[nodiscard]] static Aabb worldBoxOf(const LoadedObject& object,
+                                         const glm::mat4& model);
+};
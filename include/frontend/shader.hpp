@@ -1,14 +1,74 @@
 #pragma once
 
 #include "GL/glew.h"
+#include "util/error.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
+
+// GL type of the uniforms a T sets. An int also sets samplers.
+template <typename T>
+struct UniformType;
+template <>
+struct UniformType<int>
+{
+    static constexpr GLenum value = GL_INT;
+};
+template <>
+struct UniformType<float>
+{
+    static constexpr GLenum value = GL_FLOAT;
+};
+template <>
+struct UniformType<glm::vec2>
+{
+    static constexpr GLenum value = GL_FLOAT_VEC2;
+};
+template <>
+struct UniformType<glm::vec3>
+{
+    static constexpr GLenum value = GL_FLOAT_VEC3;
+};
+template <>
+struct UniformType<glm::vec4>
+{
+    static constexpr GLenum value = GL_FLOAT_VEC4;
+};
+template <>
+struct UniformType<glm::mat4>
+{
+    static constexpr GLenum value = GL_FLOAT_MAT4;
+};
+
+// A uniform of one Shader, looked up by name once (Shader::getUniformHandle)
+// so setting it through BindObject::set hashes no string. Setting an invalid
+// handle, for a uniform the program does not have, does nothing.
+template <typename T>
+class UniformHandle
+{
+    friend class Shader;
+
+    uint32_t programId = 0;
+    uint32_t slot = UINT32_MAX;
+
+  public:
+    [[nodiscard]] bool isValid() const
+    {
+        return slot != UINT32_MAX;
+    }
+};
 
 // TODO: Could make this class smaller by making functions static, etc.
 class Shader
@@ -21,6 +81,8 @@ class Shader
     void linkProgram(uint32_t vertexShader, uint32_t geoShader,
                      uint32_t fragmentShader);
     void discoverUniforms();
+    // to the binding points of the shared blocks (see uniformBlocks.hpp)
+    void bindUniformBlocks();
 
   public:
     struct UniformInfo
@@ -28,12 +90,45 @@ class Shader
         GLint location;
         GLenum type;
         std::string name;
+        // of the uniform's last value, in `slots`
+        uint32_t slot;
+    };
+
+    // Hashes std::string and std::string_view alike, so looking a uniform
+    // up by a literal does not build a string
+    struct NameHash
+    {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view name) const
+        {
+            return std::hash<std::string_view>{}(name);
+        }
     };
 
+    using UniformMap =
+      std::unordered_map<std::string, UniformInfo, NameHash, std::equal_to<>>;
+    using NameSet = std::unordered_set<std::string, NameHash, std::equal_to<>>;
+
   private:
-    std::unordered_map<std::string, UniformInfo> uniforms;
-    mutable std::unordered_set<std::string> warnedMissingUniforms;
-    mutable std::unordered_set<std::string> warnedTypeMismatches;
+    // The last value set to a uniform. Values are program state, so they
+    // hold from one bind to the next, and setting the same again is skipped.
+    struct UniformSlot
+    {
+        GLint location = -1;
+        bool known = false;
+        alignas(16) std::array<std::byte, sizeof(glm::mat4)> value{};
+    };
+
+    UniformMap uniforms;
+    std::vector<UniformSlot> slots;
+    mutable NameSet warnedMissingUniforms;
+    mutable NameSet warnedTypeMismatches;
+
+    // The uniform called `name`, or null; warns once if there is none or it
+    // is not of `expectedType`
+    [[nodiscard]] const UniformInfo* findUniform(std::string_view name,
+                                                 GLenum expectedType) const;
 
     void loadFromSource(const std::string& vertexSource,
                         const std::string& geoSource,
@@ -53,9 +148,37 @@ class Shader
 
         BindObject(uint32_t programId, Shader& shader);
 
-        // validate uniform and warn if needed
-        [[nodiscard]] std::optional<Shader::UniformInfo>
-        validateUniform(const std::string& name, GLenum expectedType) const;
+        template <typename T>
+        void setByName(std::string_view name, GLenum expectedType,
+                       const T& value)
+        {
+            if (const UniformInfo* info =
+                  shader.findUniform(name, expectedType))
+            {
+                setSlot(shader.slots[info->slot], value);
+            }
+        }
+
+        template <typename T>
+        static void setSlot(UniformSlot& slot, const T& value)
+        {
+            static_assert(sizeof(T) <= sizeof(slot.value));
+            if (slot.known &&
+                std::memcmp(slot.value.data(), &value, sizeof(T)) == 0)
+            {
+                return;
+            }
+            std::memcpy(slot.value.data(), &value, sizeof(T));
+            slot.known = true;
+            upload(slot.location, value);
+        }
+
+        static void upload(GLint location, int value);
+        static void upload(GLint location, float value);
+        static void upload(GLint location, const glm::vec2& value);
+        static void upload(GLint location, const glm::vec3& value);
+        static void upload(GLint location, const glm::vec4& value);
+        static void upload(GLint location, const glm::mat4& value);
 
       public:
         BindObject(const BindObject&) = delete;
@@ -65,17 +188,31 @@ class Shader
 
         ~BindObject();
 
-        void setUniformSampler2D(const std::string& name, int value);
-        void setUniformInt(const std::string& name, int value);
-        void setUniform(const std::string& name, float value);
-        void setUniform(const std::string& name, const glm::vec2& value);
-        void setUniform(const std::string& name, const glm::vec3& value);
-        void setUniform(const std::string& name, const glm::vec4& value);
-        void setUniform(const std::string& name, const glm::mat4& value);
+        void setUniformSampler2D(std::string_view name, int value);
+        void setUniformSampler2DArray(std::string_view name, int value);
+        void setUniformInt(std::string_view name, int value);
+        void setUniform(std::string_view name, float value);
+        void setUniform(std::string_view name, const glm::vec2& value);
+        void setUniform(std::string_view name, const glm::vec3& value);
+        void setUniform(std::string_view name, const glm::vec4& value);
+        void setUniform(std::string_view name, const glm::mat4& value);
+
+        template <typename T>
+        void set(UniformHandle<T> uniform, const T& value)
+        {
+            if (!uniform.isValid()) {
+                return;
+            }
+            if (uniform.programId != programId) {
+                throw IrrecoverableError{
+                  "Uniform handle used with another shader program"};
+            }
+            setSlot(shader.slots[uniform.slot], value);
+        }
 
         [[nodiscard]] const UniformInfo&
-        getUniformInfo(const std::string& name) const;
-        [[nodiscard]] bool hasUniform(const std::string& name) const;
+        getUniformInfo(std::string_view name) const;
+        [[nodiscard]] bool hasUniform(std::string_view name) const;
     };
 
     // uniforms are discovered automatically
@@ -95,7 +232,21 @@ class Shader
 
     [[nodiscard]] BindObject bind();
 
+    // Looks `name` up for setting it with BindObject::set. Warns once if the
+    // program has no such uniform, or one of another type.
+    template <typename T>
+    [[nodiscard]] UniformHandle<T> getUniformHandle(std::string_view name) const
+    {
+        UniformHandle<T> handle;
+        handle.programId = programId;
+        if (const UniformInfo* info =
+              findUniform(name, UniformType<T>::value))
+        {
+            handle.slot = info->slot;
+        }
+        return handle;
+    }
+
     // get all discovered uniforms
-    [[nodiscard]] const std::unordered_map<std::string, UniformInfo>&
-    getUniforms() const;
+    [[nodiscard]] const UniformMap& getUniforms() const;
 };
@@ -1,30 +1,120 @@
 #pragma once
 
+#include "frontend/blockCompression.hpp"
+#include "frontend/mipmaps.hpp"
+#include "frontend/textureCache.hpp"
 #include "shader.hpp"
+#include "util/mappedFile.hpp"
 
 #include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
 
+// How material textures are prepared for the GPU.
+struct TextureImportOptions
+{
+    TextureCompression compression = TextureCompression::None;
+    // Build the mips on the CPU once and keep them in the texture cache,
+    // instead of glGenerateMipmap on every load. Compressed textures always
+    // are.
+    bool cacheMips = false;
+    MipFilter mipFilter = MipFilter::Kaiser;
+    // Upload only the mips no larger than `streamTailSize` at first and leave
+    // the finer ones to a TextureStreamer. Implies `cacheMips`.
+    bool streamMips = false;
+    int streamTailSize = 128;
+};
+
+// An image file decoded into memory but not uploaded yet. Decoding touches no
+// GL state, so it can happen on any thread.
+//
+// Uncompressed TGAs are not decoded at all: the file is mapped and uploaded
+// straight from the mapped pages, with their BGR(A) channel order and row
+// order as stored. Everything else goes through stb_image.
+//
+// Asked for a block compressed format or cached mips, the mip chain is built
+// (and compressed) once and kept in a TextureCache next to the image, and it
+// is that cache that gets mapped from then on.
+struct DecodedTexture
+{
+    struct PixelDeleter
+    {
+        void operator()(unsigned char* pixels) const;
+    };
+
+    // decoded by stb_image, bottom row first, RGB(A) order
+    std::unique_ptr<unsigned char, PixelDeleter> pixels;
+    // or the pixels of a mapped file
+    std::optional<MappedFile> mapped;
+    const unsigned char* mappedPixels = nullptr;
+    // or every mip, possibly block compressed; no pixels then
+    std::optional<TextureCache> cached;
+
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    // 3 and 4 channel pixels are stored BGR(A)
+    bool bgr = false;
+    // rows are stored top row first, so V has to be flipped when sampling
+    bool topRowFirst = false;
+    std::string filePath;
+    // how long reading and decoding the file took
+    double decodeMilliseconds = 0.0;
+    // not 0 if only the mips up to this size should be uploaded, the rest
+    // being streamed from `cached` later
+    int streamTailSize = 0;
+
+    // Throws IrrecoverableError if the file cannot be decoded. If the mips
+    // cannot be built or cached as asked, that is logged and it is left to GL.
+    [[nodiscard]] static DecodedTexture
+    fromFile(const std::filesystem::path& path,
+             const TextureImportOptions& options = {});
+
+    // Null for cached textures.
+    [[nodiscard]] const unsigned char* data() const;
+    // Frees the pixels (or unmaps the file).
+    void release();
+};
+
 // Does not actually store the image file inside!
 // It gets copied over to the GPU memory.
+//
+// Streamed textures are the exception: they keep their texture cache mapped
+// and only the levels from `residentLevel` on are in VRAM, with
+// GL_TEXTURE_BASE_LEVEL pointing at the finest of them. A TextureStreamer
+// moves that level up and down.
 class Texture
 {
     uint32_t textureId = 0;
     int width = 0;
     int height = 0;
     int channels = 0;
+    bool topRowFirst = false;
     std::string filePath;
 
-    void loadFromFile(const std::filesystem::path& path);
+    std::optional<TextureCache> streamSource;
+    int residentLevel = 0;
+    int tailLevel = 0;
+
+    void loadFromDecoded(DecodedTexture&& decoded);
+    void loadFromCache(const TextureCache& cache, int firstLevel = 0);
     void loadFromData(const unsigned char* data, int dataWidth, int dataHeight,
                       GLenum format, GLenum internalFormat);
 
   public:
     Texture(const std::filesystem::path& path);
+    // Uploads an image decoded earlier, possibly on another thread. Streamed
+    // textures take over its mapped cache.
+    explicit Texture(DecodedTexture&& decoded);
 
     // `data` is borrowed here, caller must clean-up after the function.
     // We assume that both the internal format and format of `GL_RGB`.
     Texture(int width, int height, const unsigned char* data);
+    // Replaces the pixels of a texture made that way, of the same size; for
+    // images that change every frame, such as debug views.
+    void update(const unsigned char* data);
 
     Texture(const Texture&) = delete;
     Texture& operator=(const Texture&) = delete;
@@ -44,6 +134,84 @@ class Texture
     [[nodiscard]] int getWidth() const;
     [[nodiscard]] int getHeight() const;
     [[nodiscard]] int getChannels() const;
+    // Whether the image is stored upside down for GL, so shaders have to
+    // sample it at (u, 1 - v). Only happens for top-left origin TGAs, which
+    // are uploaded as stored.
+    [[nodiscard]] bool isTopRowFirst() const;
     [[nodiscard]] const std::string& getFilePath() const;
     [[nodiscard]] bool isValid() const;
+
+    [[nodiscard]] bool isStreamed() const;
+    // Finest mip level in VRAM; 0 unless streamed.
+    [[nodiscard]] int getResidentLevel() const;
+    // Levels from this one on stay resident. 0 unless streamed.
+    [[nodiscard]] int getTailLevel() const;
+    [[nodiscard]] int getLevelCount() const;
+    // VRAM taken by `level`; streamed textures only.
+    [[nodiscard]] size_t getLevelBytes(int level) const;
+    // VRAM taken by levels `firstLevel` to the last; streamed textures only.
+    [[nodiscard]] size_t getBytesFrom(int firstLevel) const;
+    // Uploads the level above the resident ones, if there is one.
+    void streamInLevel();
+    // Frees the finest resident level, unless it is part of the tail.
+    void evictLevel();
+};
+
+// Textures of the same size and format as the layers of one
+// GL_TEXTURE_2D_ARRAY, so shapes using any of them share a single bind.
+// Layers are always fully resident, they are not streamed.
+class TextureArray
+{
+    uint32_t textureId = 0;
+    int width = 0;
+    int height = 0;
+    int layerCount = 0;
+    bool topRowFirst = false;
+
+  public:
+    // What textures need to have in common to share an array.
+    struct Layout
+    {
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        bool bgr = false;
+        bool topRowFirst = false;
+        // whether the mips come from a texture cache, and what they hold
+        bool cached = false;
+        std::optional<BlockFormat> format;
+        bool srgb = false;
+        size_t levelCount = 0;
+
+        auto operator<=>(const Layout&) const = default;
+    };
+
+    // Nothing if `decoded` cannot be a layer, e.g. if its block format is
+    // not supported here.
+    [[nodiscard]] static std::optional<Layout>
+    layoutOf(const DecodedTexture& decoded);
+
+    // Uploads `layers` in order; they must all have the same layout.
+    explicit TextureArray(std::span<const DecodedTexture* const> layers);
+
+    TextureArray(const TextureArray&) = delete;
+    TextureArray& operator=(const TextureArray&) = delete;
+
+    TextureArray(TextureArray&& other) noexcept;
+    TextureArray& operator=(TextureArray&& other) noexcept;
+
+    ~TextureArray();
+
+    static void setInitUniform(Shader::BindObject& shader,
+                               const std::string& textureUniformName,
+                               GLuint textureUnit);
+
+    void bind(GLuint textureUnit) const;
+
+    [[nodiscard]] uint32_t getId() const;
+    [[nodiscard]] int getWidth() const;
+    [[nodiscard]] int getHeight() const;
+    [[nodiscard]] int getLayerCount() const;
+    // see Texture::isTopRowFirst()
+    [[nodiscard]] bool isTopRowFirst() const;
 };
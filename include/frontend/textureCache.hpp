@@ -0,0 +1,78 @@
+#pragma once
+
+#include "frontend/blockCompression.hpp"
+#include "frontend/mipmaps.hpp"
+#include "util/mappedFile.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+// On-disk cache of a texture's mip chain, block compressed or as 8-bit RGBA,
+// stored next to the source image as `<name>.texcache`.
+//
+// Laid out like a KTX2 file: a header, an index with the offset and size of
+// every mip level, then the levels' blocks, each 16-byte aligned. On a hit
+// the file is memory mapped and the levels are handed to
+// glCompressedTexImage2D (or glTexImage2D) straight from the mapped pages.
+//
+// A cache is valid while the source image has the size and mtime (or, if
+// only the mtime changed, the content hash) it was built from.
+class TextureCache
+{
+  public:
+    // Bump whenever the file layout or the encoders' output changes.
+    static constexpr uint32_t formatVersion = 2;
+
+    // What the levels hold and how they were made.
+    struct Description
+    {
+        // nothing for 8-bit RGBA
+        std::optional<BlockFormat> format;
+        MipFilter mipFilter = MipFilter::Box;
+        bool srgb = true;
+        // rows are stored top row first (see Texture::isTopRowFirst())
+        bool topRowFirst = false;
+        // of the source image
+        int channels = 0;
+        // of the top level
+        int width = 0;
+        int height = 0;
+    };
+
+    struct Level
+    {
+        int width = 0;
+        int height = 0;
+        std::span<const std::byte> blocks;
+    };
+
+  private:
+    MappedFile file;
+    Description description;
+    std::vector<Level> levels;
+
+    explicit TextureCache(MappedFile mapped);
+
+  public:
+    [[nodiscard]] static std::filesystem::path
+    pathFor(const std::filesystem::path& imagePath);
+
+    // Maps and validates the cache belonging to `imagePath`.
+    // Returns nothing if there is no cache or it is stale/corrupt.
+    [[nodiscard]] static std::optional<TextureCache>
+    open(const std::filesystem::path& imagePath);
+
+    // Writes (or replaces) the cache belonging to `imagePath`. `levels` are
+    // the blocks (or pixels) of every mip, full size first.
+    // Throws IrrecoverableError if the file cannot be written.
+    static void write(const std::filesystem::path& imagePath,
+                      const Description& description,
+                      const std::vector<std::vector<std::byte>>& levels);
+
+    [[nodiscard]] const Description& getDescription() const;
+    // Views point into the mapping and live as long as this object.
+    [[nodiscard]] const std::vector<Level>& getLevels() const;
+};
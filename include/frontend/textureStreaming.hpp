@@ -0,0 +1,68 @@
+#pragma once
+
+#include "frontend/texture.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+// Streaming the finer mips of textures loaded with
+// `TextureImportOptions::streamMips` in and out of VRAM.
+//
+// Such textures start with just their mip tail resident, so whatever uses
+// them can be drawn right away. Every frame the renderer requests, for each
+// texture, the finest level it could make use of; update() then uploads the
+// missing levels a few at a time, coarse ones first across all textures, and
+// when that would exceed the budget frees levels nobody asked for this frame,
+// least recently requested texture first.
+
+struct TextureStreamingSettings
+{
+    // VRAM the streamed textures may take, tails included
+    size_t budgetBytes = size_t{64} << 20;
+    // uploaded per update() at most, so frames stay short (one level may
+    // overrun it)
+    size_t uploadBytesPerFrame = size_t{4} << 20;
+    // added to the requested levels; positive streams in less
+    float lodBias = 0.0F;
+};
+
+// Of the textures the streamer knows about, after an update().
+struct TextureStreamingStats
+{
+    size_t streamedTextures = 0;
+    size_t residentBytes = 0;
+    // what the textures would take at the levels they were requested at
+    size_t requestedBytes = 0;
+    size_t uploadedBytes = 0;
+    size_t levelsUploaded = 0;
+    size_t levelsEvicted = 0;
+};
+
+// Tracks the textures it has seen requests for by address: a texture has to
+// be forget()-ten, or the streamer destroyed, before the texture is.
+class TextureStreamer
+{
+  public:
+    // Asks for `texture` down to mip `level` (fractional, before the bias)
+    // this frame. The finest level asked for wins. Non-streamed textures are
+    // ignored.
+    void request(Texture& texture, float level);
+
+    // Uploads and evicts levels for the requests since the last update(). Must
+    // run on the thread owning the GL context, typically once per frame.
+    TextureStreamingStats update(const TextureStreamingSettings& settings);
+
+    void forget(const Texture& texture);
+
+  private:
+    struct Entry
+    {
+        Texture* texture = nullptr;
+        float requestedLevel = 0.0F;
+        uint64_t lastRequestedFrame = 0;
+    };
+
+    std::unordered_map<const Texture*, Entry> entries;
+    uint64_t frame = 1;
+};
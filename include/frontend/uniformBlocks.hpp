@@ -0,0 +1,154 @@
+#pragma once
+
+#include "frontend/camera.hpp"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// Uniforms shared by every shader, in std140 uniform blocks at fixed binding
+// points: the camera and the lights once per frame, and each object's
+// transforms, all of a frame's at once. Shaders declare the blocks they use
+// by the names below, with the members laid out as the structs here; Shader
+// assigns their binding points when linking (GLSL 4.10 cannot).
+
+enum class UniformBlock : GLuint
+{
+    Camera = 0,
+    Lighting = 1,
+    Object = 2,
+};
+
+[[nodiscard]] const char* uniformBlockName(UniformBlock block);
+// The block a shader declares as `name`, if it is one of the above.
+[[nodiscard]] std::optional<UniformBlock>
+uniformBlockNamed(std::string_view name);
+
+// layout(std140) uniform Camera
+struct CameraBlock
+{
+    glm::mat4 view{1.0F};
+    glm::mat4 projection{1.0F};
+    glm::mat4 viewProjection{1.0F};
+    // w unused
+    glm::vec4 position{0.0F};
+};
+static_assert(sizeof(CameraBlock) == 208);
+
+inline constexpr int maxDirectionalLights = 4;
+
+// layout(std140) uniform Lighting
+struct LightingBlock
+{
+    struct Light
+    {
+        // towards where the light shines, normalised; w unused
+        glm::vec4 direction{0.0F};
+        // colour times intensity; w unused
+        glm::vec4 colour{0.0F};
+    };
+
+    std::array<Light, maxDirectionalLights> lights{};
+    // colour times strength; w unused
+    glm::vec4 ambient{0.0F};
+    // x specular strength, y shininess
+    glm::vec4 material{0.0F};
+    int32_t lightCount = 0;
+    std::array<int32_t, 3> padding{};
+};
+static_assert(sizeof(LightingBlock) == 176);
+static_assert(offsetof(LightingBlock, lightCount) == 160);
+
+// layout(std140) uniform Object
+struct ObjectBlock
+{
+    glm::mat4 model{1.0F};
+    // inverse transpose of the model matrix, for normals
+    glm::mat4 normalMatrix{1.0F};
+};
+static_assert(sizeof(ObjectBlock) == 128);
+
+struct DirectionalLight
+{
+    glm::vec3 direction{-0.5F, -1.0F, -0.7F};
+    glm::vec3 colour{1.0F};
+    float intensity = 1.0F;
+};
+
+// The lights of a scene, as data rather than shader constants.
+struct SceneLighting
+{
+    std::array<DirectionalLight, maxDirectionalLights> lights{};
+    // how many of `lights` shine
+    int lightCount = 1;
+    glm::vec3 ambientColour{1.0F};
+    float ambientStrength = 0.1F;
+    float specularStrength = 0.5F;
+    float shininess = 32.0F;
+
+    [[nodiscard]] LightingBlock toBlock() const;
+};
+
+// A GL uniform buffer, created on the first upload.
+class UniformBuffer
+{
+    GLuint ubo = 0;
+    size_t capacity = 0;
+
+  public:
+    UniformBuffer() = default;
+    ~UniformBuffer();
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+    UniformBuffer(UniformBuffer&& other) noexcept;
+    UniformBuffer& operator=(UniformBuffer&& other) noexcept;
+
+    // Replaces the contents with `bytes` bytes of `data`. The old storage is
+    // orphaned, so draws still reading it do not stall the upload.
+    void upload(const void* data, size_t bytes);
+
+    // All of it, or `bytes` bytes from `offset`, to `block`'s binding point.
+    void bind(UniformBlock block) const;
+    void bindRange(UniformBlock block, size_t offset, size_t bytes) const;
+
+    [[nodiscard]] GLuint getId() const;
+};
+
+// The per-frame and per-object blocks of a frame. Objects are added while the
+// frame is built up and uploaded together, then bound one at a time (a
+// glBindBufferRange each) as draws need them.
+class FrameUniforms
+{
+  public:
+    // Uploads and binds the Camera block.
+    void setCamera(const Camera& camera);
+    // Uploads and binds the Lighting block.
+    void setLighting(const SceneLighting& lighting);
+
+    // Forgets the objects of the last frame, keeping the memory.
+    void clearObjects();
+    // Returns the index to bindObject() the object with.
+    [[nodiscard]] uint32_t addObject(const glm::mat4& model);
+    // Uploads the objects added since clearObjects().
+    void uploadObjects();
+    // Binds an uploaded object's block.
+    void bindObject(uint32_t object) const;
+
+  private:
+    UniformBuffer camera;
+    UniformBuffer lighting;
+    UniformBuffer objects;
+    // ObjectBlocks, each at a multiple of `objectStride` bytes as binding
+    // offsets have to be aligned
+    std::vector<std::byte> objectBytes;
+    size_t objectStride = sizeof(ObjectBlock);
+    bool strideAligned = false;
+    uint32_t objectCount = 0;
+};
@@ -1,4 +1,7 @@
 #pragma once
+
+#include "frontend/glState.hpp"
+
 #include <GL/glew.h>
 #include <cstdint>
 #include <vector>
@@ -17,7 +20,7 @@ class VertexBuffer
     ~VertexBuffer()
     {
         if (vbo != 0) {
-            glDeleteBuffers(1, &vbo);
+            GLState::current().deleteBuffer(vbo);
         }
     }
 
@@ -36,7 +39,7 @@ class VertexBuffer
     {
         if (this != &other) {
             if (vbo != 0) {
-                glDeleteBuffers(1, &vbo);
+                GLState::current().deleteBuffer(vbo);
             }
             vbo = other.vbo;
             vertexCount = other.vertexCount;
@@ -50,7 +53,7 @@ class VertexBuffer
     void uploadData(const std::vector<T>& data, GLenum usage = GL_STATIC_DRAW)
     {
         vertexCount = data.size();
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        GLState::current().bindBuffer(GL_ARRAY_BUFFER, vbo);
         glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(T), data.data(),
                      usage);
     }
@@ -59,18 +62,18 @@ class VertexBuffer
     void uploadData(const T* data, size_t count, GLenum usage = GL_STATIC_DRAW)
     {
         vertexCount = count;
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        GLState::current().bindBuffer(GL_ARRAY_BUFFER, vbo);
         glBufferData(GL_ARRAY_BUFFER, count * sizeof(T), data, usage);
     }
 
     void bind() const
     {
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        GLState::current().bindBuffer(GL_ARRAY_BUFFER, vbo);
     }
 
     void unbind() const
     {
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        GLState::current().bindBuffer(GL_ARRAY_BUFFER, 0);
     }
 
     [[nodiscard]] size_t getVertexCount() const
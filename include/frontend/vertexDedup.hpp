@@ -0,0 +1,37 @@
+#pragma once
+
+#include "frontend/objImport.hpp"
+#include "util/threadPool.hpp"
+
+#include <cstddef>
+#include <span>
+
+// Vertex deduplication: turns one vertex per face corner into a vertex buffer
+// of unique vertices plus an index buffer.
+//
+// Vertices are compared by the bit patterns of their floats, except that -0
+// and +0 are the same, as they are to float comparison; NaNs with the same
+// bits are the same too. Unique vertices are numbered in order of first
+// appearance, and keep the bits of their first corner, so every variant below
+// produces exactly the same output for the same input.
+
+// Shapes with at least this many corners use the radix sort variant (when the
+// pool has a few workers), smaller ones the flat hash table.
+inline constexpr size_t radixSortDedupThreshold = size_t{1} << 20;
+
+// Picks the fastest variant for the size of `corners`.
+void dedupVertices(std::span<const LoadedObjVertex> corners,
+                   ImportedShape& shape,
+                   ThreadPool& pool = ThreadPool::global());
+
+// Single-threaded open-addressing hash table (linear probing), sized up front
+// from the corner count so it never rehashes.
+void dedupVerticesFlatHash(std::span<const LoadedObjVertex> corners,
+                           ImportedShape& shape);
+
+// Sorts corners by a 32-bit hash of their bits with a parallel LSD radix sort,
+// so equal vertices end up next to each other, then resolves each run in
+// parallel. Scales with cores at the cost of ~3x the memory traffic.
+void dedupVerticesRadixSort(std::span<const LoadedObjVertex> corners,
+                            ImportedShape& shape,
+                            ThreadPool& pool = ThreadPool::global());
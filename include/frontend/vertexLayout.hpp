@@ -1,5 +1,6 @@
 #pragma once
 
+#include "frontend/glState.hpp"
 #include "util/error.hpp"
 
 #include <GL/glew.h>
@@ -22,12 +23,24 @@ struct VertexAttribute
     //     offset(off), size(sz)
     // {
     // }
+
+    bool operator==(const VertexAttribute&) const = default;
+};
+
+// The buffer, and where in it, that a vertex array's attributes of some
+// layout read from; so they are not pointed there again.
+struct AttributeSource
+{
+    GLuint buffer = 0;
+    size_t offset = 0;
 };
 
 class VertexLayout
 {
     std::vector<VertexAttribute> attributes;
     size_t stride = 0;
+    // 0 advances the attributes per vertex, n every n instances
+    uint32_t divisor = 0;
 
   public:
     VertexLayout& addAttribute(uint32_t location, uint32_t componentCount,
@@ -36,9 +49,22 @@ class VertexLayout
         size_t typeSize = 0;
         switch (type) {
             case GL_FLOAT: typeSize = sizeof(float); break;
+            case GL_HALF_FLOAT: typeSize = sizeof(uint16_t); break;
             case GL_UNSIGNED_INT: typeSize = sizeof(uint32_t); break;
             case GL_INT: typeSize = sizeof(int32_t); break;
+            case GL_UNSIGNED_SHORT: typeSize = sizeof(uint16_t); break;
+            case GL_SHORT: typeSize = sizeof(int16_t); break;
             case GL_UNSIGNED_BYTE: typeSize = sizeof(uint8_t); break;
+            case GL_BYTE: typeSize = sizeof(int8_t); break;
+            case GL_INT_2_10_10_10_REV:
+            case GL_UNSIGNED_INT_2_10_10_10_REV:
+                // all four components share one 32-bit word
+                if (componentCount != 4) {
+                    throw IrrecoverableError{
+                      "Packed 2_10_10_10 attributes must have 4 components"};
+                }
+                typeSize = sizeof(uint32_t) / 4;
+                break;
             default:
                 throw IrrecoverableError{"Type not defined in addAttribute()"};
         }
@@ -50,20 +76,51 @@ class VertexLayout
         return *this;
     }
 
-    void apply() const
+    // Per-instance attributes, e.g. 1 to step once per instance of an
+    // instanced draw.
+    VertexLayout& setDivisor(uint32_t instancesPerElement)
+    {
+        divisor = instancesPerElement;
+        return *this;
+    }
+
+    // Points the attributes at the bound GL_ARRAY_BUFFER, `offset` bytes in.
+    void apply(size_t offset = 0) const
     {
         for (const auto& attr : attributes) {
             glVertexAttribPointer(
               attr.location, static_cast<int>(attr.componentCount), attr.type,
               attr.normalized ? GL_TRUE : GL_FALSE,
               static_cast<GLsizei>(stride),
-              reinterpret_cast<void*>(attr.offset));
+              reinterpret_cast<void*>(offset + attr.offset));
             glEnableVertexAttribArray(attr.location);
+            if (divisor != 0) {
+                glVertexAttribDivisor(attr.location, divisor);
+            }
         }
     }
 
+    // Points the attributes at `offset` bytes into `buffer`, with the vertex
+    // array they belong to bound, unless `source` says they already are.
+    void applyFrom(GLuint buffer, size_t offset, AttributeSource& source) const
+    {
+        if (source.buffer == buffer && source.offset == offset) {
+            return;
+        }
+        GLState::current().bindBuffer(GL_ARRAY_BUFFER, buffer);
+        apply(offset);
+        source = {.buffer = buffer, .offset = offset};
+    }
+
+    bool operator==(const VertexLayout&) const = default;
+
     [[nodiscard]] size_t getStride() const
     {
         return stride;
     }
+
+    [[nodiscard]] uint32_t getDivisor() const
+    {
+        return divisor;
+    }
 };
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "frontend/objImport.hpp"
+#include "frontend/vertexLayout.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// How the vertices of a LoadedObject are stored on the GPU.
+enum class VertexFormat
+{
+    // LoadedObjVertex as is, 32 bytes
+    Float,
+    // QuantizedObjVertex, 16 bytes; decoded by the `Quantized` vertex shaders
+    Quantized,
+};
+
+// 16-byte vertex:
+//  - position: unorm16 relative to the shape's bounding box (w is padding)
+//  - normal: octahedral encoding, stored as unorm16 of `0.5 * e + 0.5`.
+//    Unsigned on purpose: GL 4.1 and 4.2+ decode snorm values differently.
+//  - texCoord: unorm16 relative to the shape's UV bounds (UVs may tile)
+struct QuantizedObjVertex
+{
+    uint16_t position[4];
+    uint16_t normal[2];
+    uint16_t texCoord[2];
+};
+
+static_assert(sizeof(QuantizedObjVertex) == 16);
+static_assert(std::is_trivially_copyable_v<QuantizedObjVertex>);
+
+// Maps the unorm values of a shape back to object space:
+// `value = offset + scale * unorm`.
+struct QuantizationTransform
+{
+    glm::vec3 positionOffset{0.0F};
+    glm::vec3 positionScale{1.0F};
+    glm::vec2 texCoordOffset{0.0F};
+    glm::vec2 texCoordScale{1.0F};
+};
+
+struct QuantizedShape
+{
+    std::vector<QuantizedObjVertex> vertices;
+    QuantizationTransform transform;
+};
+
+// Worst case differences between the float and quantised vertices.
+struct QuantizationError
+{
+    float position = 0.0F;         // object space units
+    float positionRelative = 0.0F; // fraction of the bounding box diagonal
+    float normalDegrees = 0.0F;
+    float texCoord = 0.0F;         // UV units
+
+    QuantizationError& operator|=(const QuantizationError& other)
+    {
+        position = glm::max(position, other.position);
+        positionRelative = glm::max(positionRelative, other.positionRelative);
+        normalDegrees = glm::max(normalDegrees, other.normalDegrees);
+        texCoord = glm::max(texCoord, other.texCoord);
+        return *this;
+    }
+};
+
+[[nodiscard]] const VertexLayout& quantizedObjVertexLayout();
+
+[[nodiscard]] QuantizedShape
+quantizeVertices(std::span<const LoadedObjVertex> vertices);
+
+[[nodiscard]] LoadedObjVertex
+dequantizeVertex(const QuantizedObjVertex& vertex,
+                 const QuantizationTransform& transform);
+
+[[nodiscard]] QuantizationError
+measureQuantizationError(std::span<const LoadedObjVertex> original,
+                         const QuantizedShape& quantized);
+
+//
+// Encoders for individual attributes, also used to compare alternatives
+//
+
+// Octahedral mapping of a unit vector to [-1, 1]².
+[[nodiscard]] glm::vec2 encodeOctahedral(glm::vec3 n);
+[[nodiscard]] glm::vec3 decodeOctahedral(glm::vec2 e);
+
+// [0, 1] <-> unorm16, rounding to nearest.
+[[nodiscard]] uint16_t toUnorm16(float v);
+[[nodiscard]] float fromUnorm16(uint16_t v);
+
+// IEEE 754 binary16, for GL_HALF_FLOAT attributes.
+[[nodiscard]] uint16_t toHalf(float v);
+[[nodiscard]] float fromHalf(uint16_t v);
+
+// xyz as snorm10 (GL 4.2+ decoding) in GL_INT_2_10_10_10_REV layout, w = 0.
+[[nodiscard]] uint32_t toSnorm2101010(glm::vec3 v);
+[[nodiscard]] glm::vec3 fromSnorm2101010(uint32_t v);
@@ -42,4 +42,5 @@ class Window
     void endUpdate();
 
     [[nodiscard]] float getWidthOverHeight() const;
+    [[nodiscard]] uint32_t getHeight() const;
 };
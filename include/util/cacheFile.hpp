@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+
+/**
+ * @class CacheFile
+ * @brief What the on-disk caches (meshes, textures) share: telling whether
+ * the file a cache was built from has changed, reading records back out of
+ * a mapped cache, and writing a new cache without ever leaving a truncated
+ * one behind.
+ * @ingroup util
+ *
+ * @details A cache records its source file's size, modification time and
+ * content hash. It is still valid if the size matches and either the time
+ * or, when only the time differs (the file was touched or copied), the hash
+ * does; the cache's time is then patched so the next open skips the hash.
+ *
+ * Sections of a cache file start at multiples of `sectionAlignment`, so
+ * arrays in them can be used in place from a page-aligned mapping.
+ *
+ * @section Technicality
+ * `Writer` writes to a temporary next to the cache, named uniquely per
+ * process and writer, and renames it over the cache once complete. Rename
+ * is atomic on POSIX and Windows alike, so readers see either the old cache
+ * or the new one, and several threads or processes building the same cache
+ * at once each write their own temporary; the last rename wins.
+ */
+class CacheFile
+{
+  public:
+    static constexpr uint64_t sectionAlignment = 16;
+
+    /** @brief Size and modification time of a file. */
+    struct Stamp
+    {
+        uint64_t size = 0;
+        int64_t mtime = 0;
+    };
+
+    /** @brief The stamp of `path`, or nothing if it cannot be stat'ed. */
+    [[nodiscard]] static std::optional<Stamp>
+    stampOf(const std::filesystem::path& path);
+
+    /**
+     * @brief Hashes the whole of `path` with `Hash::bytes`.
+     * @throws IrrecoverableError if the file cannot be mapped.
+     */
+    [[nodiscard]] static uint64_t hashOf(const std::filesystem::path& path);
+
+    /**
+     * @brief Whether `source`, stamped `stamp`, is the file a cache recorded
+     * `size`, `mtime` and `hash` of. Sets `touched` if it is, but its time
+     * differs, so the caller should call `refreshMtime()`.
+     */
+    [[nodiscard]] static bool
+    matchesSource(const std::filesystem::path& source, const Stamp& stamp,
+                  uint64_t size, int64_t mtime, uint64_t hash, bool& touched);
+
+    /**
+     * @brief Best effort: overwrites the source time stored at byte `offset`
+     * of the cache at `cachePath` with `mtime`.
+     */
+    static void refreshMtime(const std::filesystem::path& cachePath,
+                             uint64_t offset, int64_t mtime);
+
+    /** @brief `offset` rounded up to the next section boundary. */
+    [[nodiscard]] static uint64_t alignUp(uint64_t offset)
+    {
+        return (offset + sectionAlignment - 1) & ~(sectionAlignment - 1);
+    }
+
+    /**
+     * @brief Copies the `T` at `offset` of `bytes` into `out`.
+     * @returns false if it would run past the end.
+     */
+    template <typename T>
+    [[nodiscard]] static bool readRecord(std::span<const std::byte> bytes,
+                                         uint64_t offset, T& out)
+    {
+        if (offset > bytes.size() || bytes.size() - offset < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&out, bytes.data() + offset, sizeof(T));
+        return true;
+    }
+
+    /**
+     * @brief Whether `count` elements of type `T` at `offset` lie inside
+     * `bytes` and are aligned to be used in place.
+     */
+    template <typename T>
+    [[nodiscard]] static bool validArray(std::span<const std::byte> bytes,
+                                         uint64_t offset, uint64_t count)
+    {
+        if (offset % alignof(T) != 0 || offset > bytes.size()) {
+            return false;
+        }
+        return count <= (bytes.size() - offset) / sizeof(T);
+    }
+
+    /**
+     * @class Writer
+     * @brief Writes a cache file to a temporary and swaps it in on
+     * `commit()`. Destroyed without committing, it removes the temporary.
+     */
+    class Writer
+    {
+      public:
+        /**
+         * @brief Starts writing the cache at `path`; `what` names it in
+         * errors (e.g. "mesh cache").
+         * @throws IrrecoverableError if the temporary cannot be created.
+         */
+        Writer(std::filesystem::path path, std::string what);
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+        Writer(Writer&&) = delete;
+        Writer& operator=(Writer&&) = delete;
+
+        ~Writer();
+
+        void write(const void* data, size_t size);
+
+        template <typename T>
+        void write(const T& value)
+        {
+            write(&value, sizeof(T));
+        }
+
+        /** @brief Writes zeros up to byte `target`. */
+        void padTo(uint64_t target);
+
+        /**
+         * @brief Replaces the cache with what was written.
+         * @throws IrrecoverableError if writing or replacing failed.
+         */
+        void commit();
+
+      private:
+        std::filesystem::path path;
+        std::filesystem::path tmpPath;
+        std::string what;
+        std::ofstream out;
+        uint64_t offset = 0;
+        bool committed = false;
+    };
+};
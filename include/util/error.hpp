@@ -39,4 +39,10 @@ struct IrrecoverableError : public std::exception
      * @param msg A string detailing the reason for the irrecoverable error.
      */
     explicit IrrecoverableError(std::string msg);
+
+    /**
+     * @brief The error message, so handlers catching `std::exception` can
+     * report it.
+     */
+    [[nodiscard]] const char* what() const noexcept override;
 };
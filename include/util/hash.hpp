@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @class Hash
+ * @brief A collection of fast, non-cryptographic 64-bit hash functions.
+ * @ingroup util
+ *
+ * @details Used wherever we need to fingerprint or bucket raw bytes, e.g. the
+ * content key of the on-disk mesh cache. Unlike `std::hash`, the results are
+ * stable across runs, platforms and standard library implementations, so they
+ * may be written to disk.
+ *
+ * @section Technicality
+ * `bytes()` is an implementation of **XXH64**. Input is consumed in 32-byte
+ * stripes by four independent accumulators, which keeps the multiply units
+ * busy and reaches several GB/s on a single core. `mix()` is the 64-bit
+ * finaliser from MurmurHash3 (`fmix64`), a cheap bijective avalanche that is
+ * useful on its own for hashing integers and bit patterns.
+ *
+ * @section Data and Code Sources
+ * XXH64 is by Yann Collet, https://github.com/Cyan4973/xxHash (BSD 2-Clause).
+ * `fmix64` is by Austin Appleby, from the public domain MurmurHash3 reference.
+ *
+ * @section Caveats
+ * These hashes are **not cryptographically secure**.
+ */
+class Hash
+{
+    static constexpr uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+    static constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+    static constexpr uint64_t prime3 = 0x165667B19E3779F9ULL;
+    static constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+    static constexpr uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+    /** @brief Performs a bitwise left rotation. */
+    static uint64_t rotl(uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    /** @brief Unaligned little-endian 64-bit read. */
+    static uint64_t read64(const unsigned char* p)
+    {
+        uint64_t v = 0;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    /** @brief Unaligned little-endian 32-bit read. */
+    static uint32_t read32(const unsigned char* p)
+    {
+        uint32_t v = 0;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    /** @brief Mixes one 8-byte lane into an accumulator. */
+    static uint64_t round(uint64_t acc, uint64_t input)
+    {
+        acc += input * prime2;
+        acc = rotl(acc, 31);
+        return acc * prime1;
+    }
+
+    /** @brief Folds a finished accumulator into the final hash. */
+    static uint64_t mergeRound(uint64_t acc, uint64_t val)
+    {
+        acc ^= round(0, val);
+        return (acc * prime1) + prime4;
+    }
+
+  public:
+    /**
+     * @brief Avalanches the bits of a 64-bit value.
+     * @param x The value to mix.
+     * @return A well-distributed 64-bit hash of `x`.
+     */
+    static uint64_t mix(uint64_t x)
+    {
+        x ^= x >> 33;
+        x *= 0xFF51AFD7ED558CCDULL;
+        x ^= x >> 33;
+        x *= 0xC4CEB9FE1A85EC53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    /**
+     * @brief Hashes a range of bytes with XXH64.
+     * @param data Pointer to the first byte. May be unaligned.
+     * @param length Number of bytes to hash.
+     * @param seed Optional seed, to derive independent hash functions.
+     * @return The 64-bit hash of the range.
+     */
+    static uint64_t bytes(const void* data, size_t length, uint64_t seed = 0)
+    {
+        const auto* p = static_cast<const unsigned char*>(data);
+        const unsigned char* const end = p + length;
+        uint64_t h = 0;
+
+        if (length >= 32) {
+            const unsigned char* const limit = end - 32;
+            uint64_t v1 = seed + prime1 + prime2;
+            uint64_t v2 = seed + prime2;
+            uint64_t v3 = seed;
+            uint64_t v4 = seed - prime1;
+
+            do {
+                v1 = round(v1, read64(p));
+                v2 = round(v2, read64(p + 8));
+                v3 = round(v3, read64(p + 16));
+                v4 = round(v4, read64(p + 24));
+                p += 32;
+            } while (p <= limit);
+
+            h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            h = mergeRound(h, v1);
+            h = mergeRound(h, v2);
+            h = mergeRound(h, v3);
+            h = mergeRound(h, v4);
+        } else {
+            h = seed + prime5;
+        }
+
+        h += static_cast<uint64_t>(length);
+
+        while (p + 8 <= end) {
+            h ^= round(0, read64(p));
+            h = (rotl(h, 27) * prime1) + prime4;
+            p += 8;
+        }
+
+        if (p + 4 <= end) {
+            h ^= static_cast<uint64_t>(read32(p)) * prime1;
+            h = (rotl(h, 23) * prime2) + prime3;
+            p += 4;
+        }
+
+        while (p < end) {
+            h ^= static_cast<uint64_t>(*p) * prime5;
+            h = rotl(h, 11) * prime1;
+            ++p;
+        }
+
+        h ^= h >> 33;
+        h *= prime2;
+        h ^= h >> 29;
+        h *= prime3;
+        h ^= h >> 32;
+        return h;
+    }
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+/**
+ * @class MappedFile
+ * @brief A read-only, RAII memory mapping of a whole file.
+ * @ingroup util
+ *
+ * @details Maps a file into the address space so it can be read as a plain
+ * byte range without copying it into a heap buffer first. Pages are faulted
+ * in lazily by the OS on first access, and are shared with the page cache, so
+ * re-opening a recently used file costs little more than the page faults.
+ *
+ * @section Technicality
+ * On POSIX systems this uses `mmap` with `MAP_PRIVATE`/`PROT_READ`, on Windows
+ * `CreateFileMapping`/`MapViewOfFile`. The base address of a mapping is always
+ * page-aligned, so any offset that is aligned within the file is also aligned
+ * in memory. Empty files are valid and produce an empty mapping.
+ *
+ * @section Caveats
+ * The file must not be truncated by another process while it is mapped;
+ * touching pages past the new end of file raises `SIGBUS` on POSIX systems.
+ */
+class MappedFile
+{
+    const std::byte* mappedData = nullptr;
+    size_t mappedSize = 0;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+
+    /** @brief Releases the mapping and any OS handles. */
+    void release() noexcept;
+
+  public:
+    /**
+     * @brief Maps the file at `path`.
+     * @throws IrrecoverableError if the file cannot be opened or mapped.
+     */
+    explicit MappedFile(const std::filesystem::path& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    ~MappedFile();
+
+    /** @brief Pointer to the first byte of the file. */
+    [[nodiscard]] const std::byte* data() const
+    {
+        return mappedData;
+    }
+
+    /** @brief Size of the file in bytes. */
+    [[nodiscard]] size_t size() const
+    {
+        return mappedSize;
+    }
+
+    /** @brief The whole file as a byte range. */
+    [[nodiscard]] std::span<const std::byte> bytes() const
+    {
+        return {mappedData, mappedSize};
+    }
+
+    /**
+     * @brief Hints to the OS that the whole mapping will be read front to
+     * back soon, so it can start read-ahead. No-op where unsupported.
+     */
+    void adviseSequential() const;
+};
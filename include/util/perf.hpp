@@ -105,3 +105,44 @@ class IterationsPerSecondCounter
         }
     }
 };
+
+/**
+ * @class Stopwatch
+ * @brief Measures the wall-clock time elapsed since construction or the last
+ * `restart()`.
+ * @ingroup util
+ *
+ * @details Intended for one-off timings such as asset load phases, where a
+ * rate counter like `IterationsPerSecondCounter` does not make sense.
+ *
+ * @example
+ * ```cpp
+ * Stopwatch timer;
+ * parseTheThing();
+ * LOG("Parsed in " << timer.elapsedMilliseconds() << " ms");
+ * ```
+ */
+class Stopwatch
+{
+    /** @brief The time point measurements are taken relative to. */
+    std::chrono::steady_clock::time_point start;
+
+  public:
+    Stopwatch() : start(std::chrono::steady_clock::now())
+    {
+    }
+
+    /** @brief Resets the start time to now. */
+    void restart()
+    {
+        start = std::chrono::steady_clock::now();
+    }
+
+    /** @brief Milliseconds elapsed since the start time. */
+    [[nodiscard]] double elapsedMilliseconds() const
+    {
+        std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+};
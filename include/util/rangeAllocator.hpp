@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+/**
+ * @class RangeAllocator
+ * @brief Hands out ranges of a one-dimensional space of `capacity` units,
+ * e.g. the vertices or indices of a GPU buffer.
+ * @ingroup util
+ *
+ * @details Only the bookkeeping: the caller owns whatever the units are and
+ * moves the data itself when growing or compacting.
+ *
+ * @section Technicality
+ * Free space is a list of ranges sorted by offset. Allocation takes the
+ * first range that fits (first fit keeps allocations towards the front,
+ * leaving one large range at the end); freeing merges the range with free
+ * neighbours, so the list never holds two adjacent ranges.
+ *
+ * @section Caveats
+ * Frees are not checked against what was allocated; freeing a range twice,
+ * or one never handed out, corrupts the list.
+ */
+class RangeAllocator
+{
+  public:
+    /** @brief A free range, in units. */
+    struct Range
+    {
+        size_t offset = 0;
+        size_t count = 0;
+    };
+
+    explicit RangeAllocator(size_t capacity = 0);
+
+    /**
+     * @brief The offset of `count` free units, which are then in use, or
+     * nothing if no free range is large enough.
+     */
+    [[nodiscard]] std::optional<size_t> allocate(size_t count);
+
+    /** @brief Returns `count` units from `offset` to the free space. */
+    void free(size_t offset, size_t count);
+
+    /** @brief Adds units to the end of the space, free. */
+    void grow(size_t newCapacity);
+
+    /**
+     * @brief Marks the first `usedCount` units in use and the rest free, as after
+     * the caller has moved every allocation to the front.
+     */
+    void reset(size_t usedCount);
+
+    [[nodiscard]] size_t getCapacity() const
+    {
+        return capacity;
+    }
+
+    /** @brief Units handed out and not freed. */
+    [[nodiscard]] size_t getUsed() const
+    {
+        return used;
+    }
+
+    /** @brief Free units before the last allocation, i.e. not at the end. */
+    [[nodiscard]] size_t getFreeInHoles() const;
+
+    [[nodiscard]] const std::vector<Range>& getFreeRanges() const
+    {
+        return freeRanges;
+    }
+
+  private:
+    /** @brief Sorted by offset, never adjacent or empty. */
+    std::vector<Range> freeRanges;
+    size_t capacity = 0;
+    size_t used = 0;
+};
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ * @brief A fixed-size pool of worker threads for CPU-bound jobs.
+ * @ingroup util
+ *
+ * @details Work is either submitted as individual tasks with `submit()`, which
+ * returns a `std::future` for the result, or spread over an index range with
+ * `parallelFor()`, which blocks until every index has been processed.
+ *
+ * @section Architecture
+ * Like the `Logger`, the pool is built around a `std::queue` of pending tasks
+ * protected by a `std::mutex` and a `std::condition_variable`. Workers sleep
+ * on the condition variable until a task arrives or shutdown is requested.
+ * `global()` returns a process-wide pool sized to the machine, which is what
+ * asset loading uses unless told otherwise.
+ *
+ * @section Technicality
+ * `parallelFor()` hands out indices from a shared atomic counter, so uneven
+ * work items balance themselves. The calling thread takes part in the loop
+ * instead of idling, which also means calling `parallelFor()` from inside a
+ * pool task cannot deadlock: in the worst case the caller processes every
+ * index itself. Helpers that start after the range is exhausted return
+ * without touching the caller's state.
+ *
+ * @section Caveats
+ * The destructor finishes all queued tasks before joining the workers.
+ * Exceptions thrown by `parallelFor()` bodies are rethrown on the calling
+ * thread once the loop has drained (only the first one is kept).
+ */
+class ThreadPool
+{
+    /** @brief The worker threads. */
+    std::vector<std::thread> workers;
+
+    /** @brief Tasks waiting for a free worker. */
+    std::queue<std::function<void()>> tasks;
+
+    /** @brief Protects `tasks` and `shutdownRequested`. */
+    std::mutex queueMutex;
+
+    /** @brief Signals workers that a task is available or shutdown began. */
+    std::condition_variable queueCondition;
+
+    /** @brief Set by the destructor to stop the workers. */
+    bool shutdownRequested = false;
+
+    /** @brief The loop each worker thread runs. */
+    void processTasks();
+
+    /** @brief Queues a type-erased task and wakes a worker. */
+    void enqueue(std::function<void()> task);
+
+  public:
+    /**
+     * @brief Spawns `threadCount` workers. Zero means run everything on the
+     * calling thread.
+     */
+    explicit ThreadPool(size_t threadCount = defaultThreadCount());
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    ~ThreadPool();
+
+    /** @brief One worker per hardware thread, minus the caller's own. */
+    [[nodiscard]] static size_t defaultThreadCount();
+
+    /** @brief The shared pool used by asset loading. */
+    [[nodiscard]] static ThreadPool& global();
+
+    /** @brief Number of worker threads (not counting callers). */
+    [[nodiscard]] size_t size() const
+    {
+        return workers.size();
+    }
+
+    /**
+     * @brief Runs `fn()` on a worker.
+     * @return A future holding the result (or exception) of `fn`.
+     */
+    template <typename Fn>
+    [[nodiscard]] std::future<std::invoke_result_t<Fn>> submit(Fn&& fn)
+    {
+        using Result = std::invoke_result_t<Fn>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(
+          std::forward<Fn>(fn));
+        std::future<Result> result = task->get_future();
+
+        if (workers.empty()) {
+            (*task)();
+        } else {
+            enqueue([task]() {
+                (*task)();
+            });
+        }
+        return result;
+    }
+
+    /**
+     * @brief Calls `fn(i)` for every `i` in `[0, count)` across the pool and
+     * the calling thread, and returns once all calls have finished.
+     */
+    template <typename Fn>
+    void parallelFor(size_t count, Fn&& fn)
+    {
+        if (count == 0) {
+            return;
+        }
+        if (count == 1 || workers.empty()) {
+            for (size_t i = 0; i < count; ++i) {
+                fn(i);
+            }
+            return;
+        }
+
+        struct LoopState
+        {
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> completed{0};
+            size_t count = 0;
+            std::function<void(size_t)> body;
+            std::mutex doneMutex;
+            std::condition_variable doneCondition;
+            std::exception_ptr error;
+        };
+
+        auto state = std::make_shared<LoopState>();
+        state->count = count;
+        state->body = [&fn](size_t i) {
+            fn(i);
+        };
+
+        auto drain = [](LoopState& s) {
+            size_t i = 0;
+            while ((i = s.next.fetch_add(1)) < s.count) {
+                try {
+                    s.body(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(s.doneMutex);
+                    if (!s.error) {
+                        s.error = std::current_exception();
+                    }
+                }
+                if (s.completed.fetch_add(1) + 1 == s.count) {
+                    std::lock_guard<std::mutex> lock(s.doneMutex);
+                    s.doneCondition.notify_all();
+                }
+            }
+        };
+
+        size_t helpers = std::min(workers.size(), count - 1);
+        for (size_t h = 0; h < helpers; ++h) {
+            enqueue([state, drain]() {
+                drain(*state);
+            });
+        }
+
+        drain(*state);
+
+        std::unique_lock<std::mutex> lock(state->doneMutex);
+        state->doneCondition.wait(lock, [&state] {
+            return state->completed.load() == state->count;
+        });
+
+        if (state->error) {
+            std::rethrow_exception(state->error);
+        }
+    }
+};
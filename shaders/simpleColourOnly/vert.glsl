@@ -5,12 +5,23 @@ layout (location = 1) in vec3 aColour;
 
 out vec3 vertexColour;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Shared blocks, laid out as in uniformBlocks.hpp
+layout(std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+};
+
+layout(std140) uniform Object
+{
+    mat4 model;
+    mat4 normalMatrix;
+};
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = viewProjection * model * vec4(aPos, 1.0);
     vertexColour = aColour;
 }
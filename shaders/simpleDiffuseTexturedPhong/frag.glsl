@@ -5,35 +5,59 @@ out vec4 FragColour;
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoord;
+// of theTextureArray, or -1 for theTexture (from the draw's DrawParams)
+flat in int TextureLayer;
 
 uniform sampler2D theTexture; // The diffuse texture
+// or, if TextureLayer is not -1, that layer of theTextureArray
+uniform sampler2DArray theTextureArray;
 
-uniform vec3 viewPos;
-
-void main()
+// Shared blocks, laid out as in uniformBlocks.hpp
+layout(std140) uniform Camera
 {
-    vec3 objectColour = texture(theTexture, TexCoord).rgb;
-    float shininess = 32.0;
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+};
 
-    vec3 lightDir = normalize(vec3(-0.5, -1.0, -0.7));
-    vec3 lightColour = vec3(1.0, 1.0, 1.0); // white light
+struct DirectionalLight
+{
+    vec4 direction; // towards where it shines
+    vec4 colour;    // times intensity
+};
 
-    // Ambient Lighting
-    float ambientStrength = 0.1;
-    vec3 ambient = ambientStrength * lightColour;
+layout(std140) uniform Lighting
+{
+    DirectionalLight lights[4];
+    vec4 ambient;  // colour times strength
+    vec4 material; // x specular strength, y shininess
+    int lightCount;
+};
 
-    // Diffuse Lighting
+void main()
+{
+    vec3 objectColour =
+        TextureLayer >= 0
+            ? texture(theTextureArray, vec3(TexCoord, float(TextureLayer))).rgb
+            : texture(theTexture, TexCoord).rgb;
     vec3 norm = normalize(Normal);
-    float diff = max(dot(norm, -lightDir), 0.0);
-    vec3 diffuse = diff * lightColour;
+    vec3 viewDir = normalize(cameraPosition.xyz - FragPos);
+
+    vec3 diffuse = vec3(0.0);
+    vec3 specular = vec3(0.0);
+    for (int i = 0; i < lightCount; ++i) {
+        vec3 lightDir = lights[i].direction.xyz;
+        vec3 lightColour = lights[i].colour.rgb;
+
+        float diff = max(dot(norm, -lightDir), 0.0);
+        diffuse += diff * lightColour;
 
-    // Specular Lighting
-    float specularStrength = 0.5;
-    vec3 viewDir = normalize(viewPos - FragPos);
-    vec3 reflectDir = reflect(lightDir, norm);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
-    vec3 specular = specularStrength * spec * lightColour;
+        vec3 reflectDir = reflect(lightDir, norm);
+        float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.y);
+        specular += material.x * spec * lightColour;
+    }
 
-    vec3 result = (ambient + diffuse) * objectColour + specular;
+    vec3 result = (ambient.rgb + diffuse) * objectColour + specular;
     FragColour = vec4(result, 1.0);
 }
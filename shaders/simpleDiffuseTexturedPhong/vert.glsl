@@ -3,19 +3,41 @@
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec2 aTexCoord;
+// DrawParams, laid out as in drawParams.hpp; only the texture's are used
+layout(location = 6) in vec4 aDrawPositionOffset; // w: texture layer
+layout(location = 7) in vec4 aDrawPositionScale;  // w: texture top row first
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Shared blocks, laid out as in uniformBlocks.hpp
+layout(std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+};
+
+layout(std140) uniform Object
+{
+    mat4 model;
+    mat4 normalMatrix;
+};
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoord;
+flat out int TextureLayer;
+
+// V flips for textures stored top row first (e.g. a mapped TGA)
+vec2 textureUV(vec2 uv)
+{
+    return aDrawPositionScale.w != 0.0 ? vec2(uv.x, 1.0 - uv.y) : uv;
+}
 
 void main()
 {
     FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
-    TexCoord = aTexCoord;
-    gl_Position = projection * view * vec4(FragPos, 1.0);
+    Normal = mat3(normalMatrix) * aNormal;
+    TexCoord = textureUV(aTexCoord);
+    TextureLayer = int(aDrawPositionOffset.w);
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
 }
@@ -0,0 +1,65 @@
+#version 410 core
+
+// Same as vertQuantized.glsl, drawn instanced: the model transform comes from
+// the per-instance attributes (InstanceTransform in instancing.hpp) rather
+// than the Object block.
+layout(location = 0) in vec4 aPos;
+layout(location = 1) in vec2 aNormal;
+layout(location = 2) in vec2 aTexCoord;
+layout(location = 3) in vec4 aInstanceRotation;
+layout(location = 4) in vec3 aInstancePosition;
+layout(location = 5) in vec3 aInstanceScale;
+// DrawParams, laid out as in drawParams.hpp
+layout(location = 6) in vec4 aDrawPositionOffset; // w: texture layer
+layout(location = 7) in vec4 aDrawPositionScale;  // w: texture top row first
+layout(location = 8) in vec4 aDrawTexCoord;       // xy offset, zw scale
+
+// Shared blocks, laid out as in uniformBlocks.hpp
+layout(std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+};
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoord;
+flat out int TextureLayer;
+
+// V flips for textures stored top row first (e.g. a mapped TGA)
+vec2 textureUV(vec2 uv)
+{
+    return aDrawPositionScale.w != 0.0 ? vec2(uv.x, 1.0 - uv.y) : uv;
+}
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+// `v` rotated by the unit quaternion `q`
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main()
+{
+    vec3 position =
+        aDrawPositionOffset.xyz + aDrawPositionScale.xyz * aPos.xyz;
+    vec3 normal = decodeOctahedral(aNormal * 2.0 - 1.0);
+
+    FragPos = aInstancePosition + rotate(aInstanceRotation,
+                                         aInstanceScale * position);
+    // the inverse transpose of rotation times scale
+    Normal = rotate(aInstanceRotation, normal / aInstanceScale);
+    TexCoord = textureUV(aDrawTexCoord.xy + aDrawTexCoord.zw * aTexCoord);
+    TextureLayer = int(aDrawPositionOffset.w);
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
+}
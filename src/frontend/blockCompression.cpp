@@ -0,0 +1,775 @@
+#include "frontend/blockCompression.hpp"
+
+#include "util/error.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace
+{
+constexpr int blockTexels = 16;
+
+// RGBA texels of one block, 0 to 255
+using Block = std::array<std::array<float, 4>, blockTexels>;
+
+// Texel positions outside the image repeat the last row/column, so partial
+// blocks at the edges compress as well as full ones.
+Block loadBlock(const RgbaImage& image, int blockX, int blockY)
+{
+    Block block{};
+    for (int y = 0; y < 4; ++y) {
+        int sy = std::min((blockY * 4) + y, image.height - 1);
+        for (int x = 0; x < 4; ++x) {
+            int sx = std::min((blockX * 4) + x, image.width - 1);
+            const uint8_t* p =
+              &image.pixels[((static_cast<size_t>(sy) * image.width) + sx) * 4];
+            for (int c = 0; c < 4; ++c) {
+                block[(y * 4) + x][c] = p[c];
+            }
+        }
+    }
+    return block;
+}
+
+template <int N>
+using Vec = std::array<float, N>;
+
+template <int N>
+Vec<N> meanOf(const Block& block)
+{
+    Vec<N> mean{};
+    for (const auto& texel : block) {
+        for (int c = 0; c < N; ++c) {
+            mean[c] += texel[c];
+        }
+    }
+    for (int c = 0; c < N; ++c) {
+        mean[c] /= blockTexels;
+    }
+    return mean;
+}
+
+// Direction the first N channels of the block vary most along, by power
+// iteration on their covariance. Zero if the block is flat.
+template <int N>
+Vec<N> principalAxis(const Block& block, const Vec<N>& mean)
+{
+    std::array<std::array<float, N>, N> covariance{};
+    for (const auto& texel : block) {
+        for (int i = 0; i < N; ++i) {
+            for (int j = 0; j < N; ++j) {
+                covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+            }
+        }
+    }
+
+    Vec<N> axis;
+    axis.fill(1.0F);
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        Vec<N> next{};
+        float length = 0.0F;
+        for (int i = 0; i < N; ++i) {
+            for (int j = 0; j < N; ++j) {
+                next[i] += covariance[i][j] * axis[j];
+            }
+            length += next[i] * next[i];
+        }
+        if (length < 1e-12F) {
+            return Vec<N>{};
+        }
+        for (int i = 0; i < N; ++i) {
+            axis[i] = next[i] / std::sqrt(length);
+        }
+    }
+    return axis;
+}
+
+// The endpoints of the segment through the block along its principal axis.
+template <int N>
+void fitEndpoints(const Block& block, Vec<N>& low, Vec<N>& high)
+{
+    Vec<N> mean = meanOf<N>(block);
+    Vec<N> axis = principalAxis<N>(block, mean);
+    float minT = 0.0F;
+    float maxT = 0.0F;
+    for (const auto& texel : block) {
+        float t = 0.0F;
+        for (int c = 0; c < N; ++c) {
+            t += (texel[c] - mean[c]) * axis[c];
+        }
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    for (int c = 0; c < N; ++c) {
+        low[c] = std::clamp(mean[c] + (minT * axis[c]), 0.0F, 255.0F);
+        high[c] = std::clamp(mean[c] + (maxT * axis[c]), 0.0F, 255.0F);
+    }
+}
+
+// Best `low` and `high` for texels known to sit at `t` (0 at low, 1 at high)
+// along the segment, in the least squares sense. False if the fit is
+// degenerate (all texels at the same t).
+template <int N>
+bool refitEndpoints(const Block& block, const std::array<float, blockTexels>& t,
+                    Vec<N>& low, Vec<N>& high)
+{
+    float aa = 0.0F;
+    float ab = 0.0F;
+    float bb = 0.0F;
+    Vec<N> ax{};
+    Vec<N> bx{};
+    for (int i = 0; i < blockTexels; ++i) {
+        float a = 1.0F - t[i];
+        float b = t[i];
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < N; ++c) {
+            ax[c] += a * block[i][c];
+            bx[c] += b * block[i][c];
+        }
+    }
+    float det = (aa * bb) - (ab * ab);
+    if (std::abs(det) < 1e-6F) {
+        return false;
+    }
+    for (int c = 0; c < N; ++c) {
+        low[c] = std::clamp(((bb * ax[c]) - (ab * bx[c])) / det, 0.0F, 255.0F);
+        high[c] = std::clamp(((aa * bx[c]) - (ab * ax[c])) / det, 0.0F, 255.0F);
+    }
+    return true;
+}
+
+void storeLittleEndian(std::byte* out, uint64_t value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; ++i) {
+        out[i] = static_cast<std::byte>((value >> (8 * i)) & 0xFFU);
+    }
+}
+
+uint64_t loadLittleEndian(const std::byte* in, size_t bytes)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+//
+// BC1 colour blocks
+//
+
+uint16_t to565(const Vec<3>& colour)
+{
+    auto quantize = [](float v, int maxValue) {
+        return static_cast<uint16_t>(
+          std::lround(std::clamp(v, 0.0F, 255.0F) * maxValue / 255.0F));
+    };
+    return static_cast<uint16_t>((quantize(colour[0], 31) << 11) |
+                                 (quantize(colour[1], 63) << 5) |
+                                 quantize(colour[2], 31));
+}
+
+std::array<int, 3> from565(uint16_t colour)
+{
+    int r = (colour >> 11) & 31;
+    int g = (colour >> 5) & 63;
+    int b = colour & 31;
+    return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+}
+
+// The four colours of a block in four colour mode, as decoders compute them.
+std::array<std::array<int, 3>, 4> colourPalette(uint16_t c0, uint16_t c1)
+{
+    std::array<int, 3> p0 = from565(c0);
+    std::array<int, 3> p1 = from565(c1);
+    std::array<std::array<int, 3>, 4> palette{p0, p1};
+    for (int c = 0; c < 3; ++c) {
+        palette[2][c] = ((2 * p0[c]) + p1[c]) / 3;
+        palette[3][c] = (p0[c] + (2 * p1[c])) / 3;
+    }
+    return palette;
+}
+
+struct ColourBlock
+{
+    uint16_t c0 = 0;
+    uint16_t c1 = 0;
+    std::array<uint8_t, blockTexels> indices{};
+    float error = std::numeric_limits<float>::max();
+};
+
+// Picks the palette entry for every texel. Always four colour mode (c0 > c1),
+// which BC3 requires and which suits opaque BC1 textures best.
+ColourBlock evaluateColourBlock(const Block& block, uint16_t c0, uint16_t c1)
+{
+    ColourBlock result;
+    if (c0 < c1) {
+        std::swap(c0, c1);
+    }
+    result.c0 = c0;
+    result.c1 = c1;
+    result.error = 0.0F;
+
+    auto palette = colourPalette(c0, c1);
+    // equal endpoints decode in three colour mode, where only index 0 is c0
+    int entries = c0 == c1 ? 1 : 4;
+    for (int i = 0; i < blockTexels; ++i) {
+        float bestError = std::numeric_limits<float>::max();
+        for (int e = 0; e < entries; ++e) {
+            float error = 0.0F;
+            for (int c = 0; c < 3; ++c) {
+                float d = block[i][c] - static_cast<float>(palette[e][c]);
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                result.indices[i] = static_cast<uint8_t>(e);
+            }
+        }
+        result.error += bestError;
+    }
+    return result;
+}
+
+void encodeColourBlock(const Block& block, std::byte* out)
+{
+    Vec<3> low{};
+    Vec<3> high{};
+    fitEndpoints<3>(block, low, high);
+
+    // Pull the endpoints in a little: the extremes are usually outliers
+    for (int c = 0; c < 3; ++c) {
+        float inset = (high[c] - low[c]) / 16.0F;
+        low[c] += inset;
+        high[c] -= inset;
+    }
+    ColourBlock best = evaluateColourBlock(block, to565(high), to565(low));
+
+    // Index 0 is c0, 1 is c1, 2 and 3 are a third and two thirds of the way
+    static constexpr std::array<float, 4> towardsC1{0.0F, 1.0F, 1.0F / 3.0F,
+                                                    2.0F / 3.0F};
+    for (int iteration = 0; iteration < 2; ++iteration) {
+        std::array<float, blockTexels> t{};
+        for (int i = 0; i < blockTexels; ++i) {
+            t[i] = towardsC1[best.indices[i]];
+        }
+        Vec<3> c0{};
+        Vec<3> c1{};
+        if (!refitEndpoints<3>(block, t, c0, c1)) {
+            break;
+        }
+        ColourBlock candidate =
+          evaluateColourBlock(block, to565(c0), to565(c1));
+        if (candidate.error >= best.error) {
+            break;
+        }
+        best = candidate;
+    }
+
+    uint32_t bits = 0;
+    for (int i = 0; i < blockTexels; ++i) {
+        bits |= static_cast<uint32_t>(best.indices[i]) << (2 * i);
+    }
+    storeLittleEndian(out, best.c0, 2);
+    storeLittleEndian(out + 2, best.c1, 2);
+    storeLittleEndian(out + 4, bits, 4);
+}
+
+void decodeColourBlock(const std::byte* in, bool forceFourColours,
+                       std::array<std::array<uint8_t, 4>, blockTexels>& texels)
+{
+    auto c0 = static_cast<uint16_t>(loadLittleEndian(in, 2));
+    auto c1 = static_cast<uint16_t>(loadLittleEndian(in + 2, 2));
+    auto bits = static_cast<uint32_t>(loadLittleEndian(in + 4, 4));
+
+    std::array<std::array<int, 4>, 4> palette{};
+    std::array<int, 3> p0 = from565(c0);
+    std::array<int, 3> p1 = from565(c1);
+    bool fourColours = forceFourColours || c0 > c1;
+    for (int c = 0; c < 3; ++c) {
+        palette[0][c] = p0[c];
+        palette[1][c] = p1[c];
+        palette[2][c] = fourColours ? ((2 * p0[c]) + p1[c]) / 3
+                                    : (p0[c] + p1[c]) / 2;
+        palette[3][c] = fourColours ? (p0[c] + (2 * p1[c])) / 3 : 0;
+    }
+    palette[0][3] = palette[1][3] = palette[2][3] = 255;
+    palette[3][3] = fourColours ? 255 : 0;
+
+    for (int i = 0; i < blockTexels; ++i) {
+        const auto& colour = palette[(bits >> (2 * i)) & 3U];
+        for (int c = 0; c < 4; ++c) {
+            texels[i][c] = static_cast<uint8_t>(colour[c]);
+        }
+    }
+}
+
+//
+// BC4 single channel blocks (BC3 alpha, and both halves of BC5)
+//
+
+void encodeChannelBlock(const Block& block, int channel, std::byte* out)
+{
+    float low = 255.0F;
+    float high = 0.0F;
+    for (const auto& texel : block) {
+        low = std::min(low, texel[channel]);
+        high = std::max(high, texel[channel]);
+    }
+    auto a0 = static_cast<int>(std::lround(high));
+    auto a1 = static_cast<int>(std::lround(low));
+
+    uint64_t bits = 0;
+    if (a0 > a1) {
+        // eight value mode: a0, a1 and six steps in between
+        std::array<int, 8> palette{a0, a1};
+        for (int k = 1; k <= 6; ++k) {
+            palette[k + 1] = (((7 - k) * a0) + (k * a1)) / 7;
+        }
+        for (int i = 0; i < blockTexels; ++i) {
+            uint64_t bestIndex = 0;
+            float bestError = std::numeric_limits<float>::max();
+            for (uint64_t e = 0; e < palette.size(); ++e) {
+                float error =
+                  std::abs(block[i][channel] - static_cast<float>(palette[e]));
+                if (error < bestError) {
+                    bestError = error;
+                    bestIndex = e;
+                }
+            }
+            bits |= bestIndex << (3 * i);
+        }
+    }
+    // otherwise the block is flat and every index 0 (a0) is exact
+
+    out[0] = static_cast<std::byte>(a0);
+    out[1] = static_cast<std::byte>(a1);
+    storeLittleEndian(out + 2, bits, 6);
+}
+
+void decodeChannelBlock(const std::byte* in, int channel,
+                        std::array<std::array<uint8_t, 4>, blockTexels>& texels)
+{
+    auto a0 = static_cast<int>(in[0]);
+    auto a1 = static_cast<int>(in[1]);
+    uint64_t bits = loadLittleEndian(in + 2, 6);
+
+    std::array<int, 8> palette{a0, a1};
+    if (a0 > a1) {
+        for (int k = 1; k <= 6; ++k) {
+            palette[k + 1] = (((7 - k) * a0) + (k * a1)) / 7;
+        }
+    } else {
+        for (int k = 1; k <= 4; ++k) {
+            palette[k + 1] = (((5 - k) * a0) + (k * a1)) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+    for (int i = 0; i < blockTexels; ++i) {
+        texels[i][channel] =
+          static_cast<uint8_t>(palette[(bits >> (3 * i)) & 7U]);
+    }
+}
+
+//
+// BC7, mode 6 only: one RGBA segment with 7-bit endpoints plus a shared low
+// bit ("p-bit") each, and 4-bit indices. Suits the smooth colour and alpha
+// of typical material textures well and keeps the encoder simple.
+//
+
+constexpr std::array<int, 16> bc7Weights{0,  4,  9,  13, 17, 21, 26, 30,
+                                         34, 38, 43, 47, 51, 55, 60, 64};
+
+struct Bc7Block
+{
+    // 7-bit endpoint values
+    std::array<int, 4> q0{};
+    std::array<int, 4> q1{};
+    int p0 = 0;
+    int p1 = 0;
+    std::array<uint8_t, blockTexels> indices{};
+    float error = std::numeric_limits<float>::max();
+};
+
+Bc7Block evaluateBc7Block(const Block& block, const Vec<4>& low,
+                          const Vec<4>& high, int p0, int p1)
+{
+    Bc7Block result;
+    result.p0 = p0;
+    result.p1 = p1;
+    std::array<int, 4> e0{};
+    std::array<int, 4> e1{};
+    for (int c = 0; c < 4; ++c) {
+        result.q0[c] = std::clamp(
+          static_cast<int>(std::lround((low[c] - static_cast<float>(p0)) / 2.0F)),
+          0, 127);
+        result.q1[c] = std::clamp(
+          static_cast<int>(std::lround((high[c] - static_cast<float>(p1)) / 2.0F)),
+          0, 127);
+        e0[c] = (result.q0[c] << 1) | p0;
+        e1[c] = (result.q1[c] << 1) | p1;
+    }
+
+    std::array<std::array<int, 4>, 16> palette{};
+    for (size_t k = 0; k < bc7Weights.size(); ++k) {
+        for (int c = 0; c < 4; ++c) {
+            palette[k][c] = (((64 - bc7Weights[k]) * e0[c]) +
+                             (bc7Weights[k] * e1[c]) + 32) >>
+                            6;
+        }
+    }
+
+    result.error = 0.0F;
+    for (int i = 0; i < blockTexels; ++i) {
+        float bestError = std::numeric_limits<float>::max();
+        for (size_t k = 0; k < palette.size(); ++k) {
+            float error = 0.0F;
+            for (int c = 0; c < 4; ++c) {
+                float d = block[i][c] - static_cast<float>(palette[k][c]);
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                result.indices[i] = static_cast<uint8_t>(k);
+            }
+        }
+        result.error += bestError;
+    }
+    return result;
+}
+
+Bc7Block bestBc7Block(const Block& block, const Vec<4>& low,
+                      const Vec<4>& high)
+{
+    Bc7Block best;
+    for (int p0 = 0; p0 < 2; ++p0) {
+        for (int p1 = 0; p1 < 2; ++p1) {
+            Bc7Block candidate = evaluateBc7Block(block, low, high, p0, p1);
+            if (candidate.error < best.error) {
+                best = candidate;
+            }
+        }
+    }
+    return best;
+}
+
+class BitWriter
+{
+    std::byte* out;
+    size_t position = 0;
+
+  public:
+    explicit BitWriter(std::byte* out) : out{out}
+    {
+    }
+
+    void write(uint32_t value, int bits)
+    {
+        for (int i = 0; i < bits; ++i, ++position) {
+            if (((value >> i) & 1U) != 0) {
+                out[position / 8] |= static_cast<std::byte>(1U << (position % 8));
+            }
+        }
+    }
+};
+
+class BitReader
+{
+    const std::byte* in;
+    size_t position = 0;
+
+  public:
+    explicit BitReader(const std::byte* in) : in{in}
+    {
+    }
+
+    uint32_t read(int bits)
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < bits; ++i, ++position) {
+            auto bit = static_cast<uint32_t>(in[position / 8]) >>
+                       (position % 8);
+            value |= (bit & 1U) << i;
+        }
+        return value;
+    }
+};
+
+void encodeBc7Block(const Block& block, std::byte* out)
+{
+    Vec<4> low{};
+    Vec<4> high{};
+    fitEndpoints<4>(block, low, high);
+    Bc7Block best = bestBc7Block(block, low, high);
+
+    for (int iteration = 0; iteration < 2; ++iteration) {
+        std::array<float, blockTexels> t{};
+        for (int i = 0; i < blockTexels; ++i) {
+            t[i] = static_cast<float>(bc7Weights[best.indices[i]]) / 64.0F;
+        }
+        if (!refitEndpoints<4>(block, t, low, high)) {
+            break;
+        }
+        Bc7Block candidate = bestBc7Block(block, low, high);
+        if (candidate.error >= best.error) {
+            break;
+        }
+        best = candidate;
+    }
+
+    // The first texel's index is stored without its top bit, so it must be
+    // in the lower half; swapping the endpoints mirrors all indices
+    if (best.indices[0] >= 8) {
+        std::swap(best.q0, best.q1);
+        std::swap(best.p0, best.p1);
+        for (auto& index : best.indices) {
+            index = static_cast<uint8_t>(15 - index);
+        }
+    }
+
+    std::memset(out, 0, 16);
+    BitWriter bits{out};
+    bits.write(1U << 6, 7); // mode 6
+    for (int c = 0; c < 4; ++c) {
+        bits.write(static_cast<uint32_t>(best.q0[c]), 7);
+        bits.write(static_cast<uint32_t>(best.q1[c]), 7);
+    }
+    bits.write(static_cast<uint32_t>(best.p0), 1);
+    bits.write(static_cast<uint32_t>(best.p1), 1);
+    bits.write(best.indices[0], 3);
+    for (int i = 1; i < blockTexels; ++i) {
+        bits.write(best.indices[i], 4);
+    }
+}
+
+void decodeBc7Block(const std::byte* in,
+                    std::array<std::array<uint8_t, 4>, blockTexels>& texels)
+{
+    BitReader bits{in};
+    if (bits.read(7) != (1U << 6)) {
+        // not a mode 6 block; shows up as magenta
+        for (auto& texel : texels) {
+            texel = {255, 0, 255, 255};
+        }
+        return;
+    }
+
+    std::array<int, 4> e0{};
+    std::array<int, 4> e1{};
+    for (int c = 0; c < 4; ++c) {
+        e0[c] = static_cast<int>(bits.read(7)) << 1;
+        e1[c] = static_cast<int>(bits.read(7)) << 1;
+    }
+    auto p0 = static_cast<int>(bits.read(1));
+    auto p1 = static_cast<int>(bits.read(1));
+    for (int c = 0; c < 4; ++c) {
+        e0[c] |= p0;
+        e1[c] |= p1;
+    }
+
+    for (int i = 0; i < blockTexels; ++i) {
+        int weight = bc7Weights[bits.read(i == 0 ? 3 : 4)];
+        for (int c = 0; c < 4; ++c) {
+            texels[i][c] = static_cast<uint8_t>(
+              (((64 - weight) * e0[c]) + (weight * e1[c]) + 32) >> 6);
+        }
+    }
+}
+
+int channelsStored(BlockFormat format)
+{
+    switch (format) {
+        case BlockFormat::BC1: return 3;
+        case BlockFormat::BC5: return 2;
+        case BlockFormat::BC3:
+        case BlockFormat::BC7: return 4;
+    }
+    return 4;
+}
+} // namespace
+
+const char* blockFormatName(BlockFormat format)
+{
+    switch (format) {
+        case BlockFormat::BC1: return "BC1";
+        case BlockFormat::BC3: return "BC3";
+        case BlockFormat::BC5: return "BC5";
+        case BlockFormat::BC7: return "BC7";
+    }
+    return "unknown";
+}
+
+size_t blockBytes(BlockFormat format)
+{
+    return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t compressedSize(int width, int height, BlockFormat format)
+{
+    auto blocksX = static_cast<size_t>((width + 3) / 4);
+    auto blocksY = static_cast<size_t>((height + 3) / 4);
+    return blocksX * blocksY * blockBytes(format);
+}
+
+std::optional<BlockFormat> blockFormatFor(TextureCompression compression,
+                                          int channels)
+{
+    switch (compression) {
+        case TextureCompression::None: return std::nullopt;
+        case TextureCompression::Auto:
+            if (channels <= 2) {
+                return BlockFormat::BC5;
+            }
+            return channels == 3 ? BlockFormat::BC1 : BlockFormat::BC3;
+        case TextureCompression::BC1: return BlockFormat::BC1;
+        case TextureCompression::BC3: return BlockFormat::BC3;
+        case TextureCompression::BC5: return BlockFormat::BC5;
+        case TextureCompression::BC7: return BlockFormat::BC7;
+    }
+    return std::nullopt;
+}
+
+RgbaImage toRgbaImage(const unsigned char* pixels, int width, int height,
+                      int channels, bool bgr)
+{
+    if (channels < 1 || channels > 4) {
+        throw IrrecoverableError{"Cannot convert " + std::to_string(channels) +
+                                 " channel pixels to RGBA"};
+    }
+
+    RgbaImage image;
+    image.width = width;
+    image.height = height;
+    size_t count = static_cast<size_t>(width) * static_cast<size_t>(height);
+    image.pixels.resize(count * 4);
+    for (size_t i = 0; i < count; ++i) {
+        const unsigned char* in = pixels + (i * static_cast<size_t>(channels));
+        uint8_t* out = &image.pixels[i * 4];
+        out[0] = in[0];
+        out[1] = channels >= 2 ? in[1] : 0;
+        out[2] = channels >= 3 ? in[2] : 0;
+        out[3] = channels == 4 ? in[3] : 255;
+        if (bgr && channels >= 3) {
+            std::swap(out[0], out[2]);
+        }
+    }
+    return image;
+}
+
+std::vector<std::byte> compressImage(const RgbaImage& image,
+                                     BlockFormat format, ThreadPool& pool)
+{
+    int blocksX = (image.width + 3) / 4;
+    int blocksY = (image.height + 3) / 4;
+    size_t bytesPerBlock = blockBytes(format);
+    std::vector<std::byte> blocks(compressedSize(image.width, image.height,
+                                                 format));
+
+    pool.parallelFor(static_cast<size_t>(blocksY), [&](size_t row) {
+        auto by = static_cast<int>(row);
+        for (int bx = 0; bx < blocksX; ++bx) {
+            Block block = loadBlock(image, bx, by);
+            std::byte* out =
+              blocks.data() +
+              (((row * static_cast<size_t>(blocksX)) + static_cast<size_t>(bx)) *
+               bytesPerBlock);
+            switch (format) {
+                case BlockFormat::BC1: encodeColourBlock(block, out); break;
+                case BlockFormat::BC3:
+                    encodeChannelBlock(block, 3, out);
+                    encodeColourBlock(block, out + 8);
+                    break;
+                case BlockFormat::BC5:
+                    encodeChannelBlock(block, 0, out);
+                    encodeChannelBlock(block, 1, out + 8);
+                    break;
+                case BlockFormat::BC7: encodeBc7Block(block, out); break;
+            }
+        }
+    });
+    return blocks;
+}
+
+RgbaImage decompressImage(std::span<const std::byte> blocks, int width,
+                          int height, BlockFormat format)
+{
+    if (blocks.size() < compressedSize(width, height, format)) {
+        throw IrrecoverableError{"Too few bytes for a " +
+                                 std::to_string(width) + "x" +
+                                 std::to_string(height) + " " +
+                                 blockFormatName(format) + " image"};
+    }
+
+    RgbaImage image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(static_cast<size_t>(width) * height * 4);
+
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+    size_t bytesPerBlock = blockBytes(format);
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            const std::byte* in =
+              blocks.data() +
+              ((static_cast<size_t>(by * blocksX) + bx) * bytesPerBlock);
+            std::array<std::array<uint8_t, 4>, blockTexels> texels{};
+            switch (format) {
+                case BlockFormat::BC1:
+                    decodeColourBlock(in, false, texels);
+                    break;
+                case BlockFormat::BC3:
+                    decodeColourBlock(in + 8, true, texels);
+                    decodeChannelBlock(in, 3, texels);
+                    break;
+                case BlockFormat::BC5:
+                    decodeChannelBlock(in, 0, texels);
+                    decodeChannelBlock(in + 8, 1, texels);
+                    for (auto& texel : texels) {
+                        texel[2] = 0;
+                        texel[3] = 255;
+                    }
+                    break;
+                case BlockFormat::BC7: decodeBc7Block(in, texels); break;
+            }
+
+            for (int y = 0; y < 4 && (by * 4) + y < height; ++y) {
+                for (int x = 0; x < 4 && (bx * 4) + x < width; ++x) {
+                    size_t offset = ((static_cast<size_t>((by * 4) + y) * width) +
+                                     (bx * 4) + x) *
+                                    4;
+                    std::memcpy(&image.pixels[offset], texels[(y * 4) + x].data(),
+                                4);
+                }
+            }
+        }
+    }
+    return image;
+}
+
+double blockPsnr(const RgbaImage& original, const RgbaImage& decoded,
+                 BlockFormat format)
+{
+    int channels = channelsStored(format);
+    double squaredError = 0.0;
+    size_t count = std::min(original.pixels.size(), decoded.pixels.size()) / 4;
+    for (size_t i = 0; i < count; ++i) {
+        for (int c = 0; c < channels; ++c) {
+            double d = static_cast<double>(original.pixels[(i * 4) + c]) -
+                       static_cast<double>(decoded.pixels[(i * 4) + c]);
+            squaredError += d * d;
+        }
+    }
+    if (squaredError == 0.0 || count == 0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    double mse = squaredError / static_cast<double>(count * channels);
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
@@ -0,0 +1,533 @@
+#include "frontend/bvh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+
+namespace
+{
+// SAH costs, relative to testing a primitive
+constexpr double traversalCost = 1.0;
+constexpr int binCount = 12;
+
+Aabb emptyBox()
+{
+    return {.min = glm::vec3{std::numeric_limits<float>::max()},
+            .max = glm::vec3{std::numeric_limits<float>::lowest()}};
+}
+
+void grow(Aabb& box, const Aabb& other)
+{
+    box.min = glm::min(box.min, other.min);
+    box.max = glm::max(box.max, other.max);
+}
+
+void grow(Aabb& box, glm::vec3 point)
+{
+    box.min = glm::min(box.min, point);
+    box.max = glm::max(box.max, point);
+}
+
+// 0 for an empty box
+double surfaceArea(const Aabb& box)
+{
+    glm::dvec3 size = glm::max(glm::dvec3{box.max - box.min}, glm::dvec3{0.0});
+    return 2.0 * ((size.x * size.y) + (size.y * size.z) + (size.z * size.x));
+}
+
+bool operator==(const Aabb& a, const Aabb& b)
+{
+    return a.min == b.min && a.max == b.max;
+}
+
+// Where a node of the primitives order[first, first + count) is best split,
+// going by the bins of their centroids.
+struct Split
+{
+    int axis = -1;
+    // the primitives in bins up to this one go left
+    int bin = 0;
+    double cost = std::numeric_limits<double>::max();
+};
+
+Split findSplit(std::span<const uint32_t> primitives,
+                const std::vector<glm::vec3>& centroids,
+                const std::vector<Aabb>& boxes, const Aabb& centroidBounds)
+{
+    Split best;
+    for (int axis = 0; axis < 3; ++axis) {
+        float low = centroidBounds.min[axis];
+        float extent = centroidBounds.max[axis] - low;
+        if (extent <= 0.0F) {
+            continue;
+        }
+        float scale = static_cast<float>(binCount) / extent;
+
+        std::array<Aabb, binCount> binBoxes;
+        binBoxes.fill(emptyBox());
+        std::array<uint32_t, binCount> binCounts{};
+        for (uint32_t primitive : primitives) {
+            int bin = std::min(
+              binCount - 1,
+              static_cast<int>((centroids[primitive][axis] - low) * scale));
+            grow(binBoxes[bin], boxes[primitive]);
+            ++binCounts[bin];
+        }
+
+        // area times count of everything right of each split, then the left
+        std::array<double, binCount> rightCosts{};
+        Aabb right = emptyBox();
+        uint32_t rightCount = 0;
+        for (int bin = binCount - 1; bin > 0; --bin) {
+            grow(right, binBoxes[bin]);
+            rightCount += binCounts[bin];
+            rightCosts[bin - 1] = surfaceArea(right) * rightCount;
+        }
+        Aabb left = emptyBox();
+        uint32_t leftCount = 0;
+        for (int bin = 0; bin < binCount - 1; ++bin) {
+            grow(left, binBoxes[bin]);
+            leftCount += binCounts[bin];
+            double cost = (surfaceArea(left) * leftCount) + rightCosts[bin];
+            if (leftCount > 0 && leftCount < primitives.size() &&
+                cost < best.cost)
+            {
+                best = {.axis = axis, .bin = bin, .cost = cost};
+            }
+        }
+    }
+    return best;
+}
+
+int binOf(glm::vec3 centroid, const Split& split, const Aabb& centroidBounds)
+{
+    float low = centroidBounds.min[split.axis];
+    float scale = static_cast<float>(binCount) /
+                  (centroidBounds.max[split.axis] - low);
+    return std::min(binCount - 1,
+                    static_cast<int>((centroid[split.axis] - low) * scale));
+}
+} // anonymous namespace
+
+std::optional<float> intersectRayBox(const Ray& ray, glm::vec3 inverseDirection,
+                                     const Aabb& box, float maxDistance)
+{
+    glm::vec3 toMin = (box.min - ray.origin) * inverseDirection;
+    glm::vec3 toMax = (box.max - ray.origin) * inverseDirection;
+    glm::vec3 nearSlab = glm::min(toMin, toMax);
+    glm::vec3 farSlab = glm::max(toMin, toMax);
+    float enter = std::max({nearSlab.x, nearSlab.y, nearSlab.z, 0.0F});
+    float exit = std::min({farSlab.x, farSlab.y, farSlab.z});
+    if (enter > exit || enter >= maxDistance) {
+        return std::nullopt;
+    }
+    return enter;
+}
+
+std::optional<float> intersectRayTriangle(const Ray& ray, glm::vec3 a,
+                                          glm::vec3 b, glm::vec3 c,
+                                          float maxDistance)
+{
+    // Möller-Trumbore
+    glm::vec3 edge1 = b - a;
+    glm::vec3 edge2 = c - a;
+    glm::vec3 p = glm::cross(ray.direction, edge2);
+    float determinant = glm::dot(edge1, p);
+    if (determinant == 0.0F) {
+        return std::nullopt;
+    }
+    float inverse = 1.0F / determinant;
+    glm::vec3 s = ray.origin - a;
+    float u = glm::dot(s, p) * inverse;
+    if (u < 0.0F || u > 1.0F) {
+        return std::nullopt;
+    }
+    glm::vec3 q = glm::cross(s, edge1);
+    float v = glm::dot(ray.direction, q) * inverse;
+    if (v < 0.0F || u + v > 1.0F) {
+        return std::nullopt;
+    }
+    float distance = glm::dot(edge2, q) * inverse;
+    if (distance < 0.0F || distance >= maxDistance) {
+        return std::nullopt;
+    }
+    return distance;
+}
+
+Bvh::Bvh(std::span<const Aabb> boxes)
+  : boxes{boxes.begin(), boxes.end()}, live(boxes.size(), 1)
+{
+    rebuild();
+}
+
+uint32_t Bvh::add(const Aabb& box)
+{
+    structureChanged = true;
+    if (!freeIds.empty()) {
+        uint32_t primitive = freeIds.back();
+        freeIds.pop_back();
+        boxes[primitive] = box;
+        live[primitive] = 1;
+        return primitive;
+    }
+    boxes.push_back(box);
+    live.push_back(1);
+    leafOf.push_back(noNode);
+    return static_cast<uint32_t>(boxes.size() - 1);
+}
+
+void Bvh::remove(uint32_t primitive)
+{
+    live[primitive] = 0;
+    freeIds.push_back(primitive);
+    structureChanged = true;
+}
+
+void Bvh::setBox(uint32_t primitive, const Aabb& box)
+{
+    boxes[primitive] = box;
+    if (leafOf[primitive] != noNode) {
+        moved.push_back(primitive);
+    }
+}
+
+const Aabb& Bvh::getBox(uint32_t primitive) const
+{
+    return boxes[primitive];
+}
+
+bool Bvh::update()
+{
+    if (structureChanged) {
+        rebuild();
+        return true;
+    }
+    if (moved.empty()) {
+        return false;
+    }
+    refit();
+    if (currentCost() > builtCost * rebuildCostRatio) {
+        rebuild();
+        return true;
+    }
+    return false;
+}
+
+void Bvh::rebuild()
+{
+    order.clear();
+    for (uint32_t primitive = 0; primitive < boxes.size(); ++primitive) {
+        if (live[primitive] != 0) {
+            order.push_back(primitive);
+        }
+    }
+    nodes.clear();
+    parents.clear();
+    leafOf.assign(boxes.size(), noNode);
+    moved.clear();
+    structureChanged = false;
+    weightedArea = 0.0;
+    builtCost = 0.0F;
+    ++builds;
+    if (order.empty()) {
+        return;
+    }
+
+    std::vector<glm::vec3> centroids(boxes.size());
+    for (uint32_t primitive : order) {
+        centroids[primitive] = boxes[primitive].center();
+    }
+
+    nodes.reserve(2 * order.size());
+    nodes.push_back({.box = emptyBox(),
+                     .first = 0,
+                     .count = static_cast<uint32_t>(order.size())});
+    parents.push_back(noNode);
+
+    struct Task
+    {
+        uint32_t node;
+        size_t depth;
+    };
+    std::vector<Task> tasks{{0, 1}};
+    while (!tasks.empty()) {
+        Task task = tasks.back();
+        tasks.pop_back();
+        uint32_t first = nodes[task.node].first;
+        uint32_t count = nodes[task.node].count;
+        std::span<uint32_t> primitives{order.data() + first, count};
+
+        Aabb box = emptyBox();
+        Aabb centroidBounds = emptyBox();
+        for (uint32_t primitive : primitives) {
+            grow(box, boxes[primitive]);
+            grow(centroidBounds, centroids[primitive]);
+        }
+        nodes[task.node].box = box;
+        if (count <= 1 || task.depth + 1 >= maxDepth) {
+            continue;
+        }
+
+        //
+        // Split where the SAH is lowest, or not at all if a leaf is cheaper
+        //
+        Split split = findSplit(primitives, centroids, boxes, centroidBounds);
+        double leafCost = surfaceArea(box) * count;
+        double splitCost = (traversalCost * surfaceArea(box)) + split.cost;
+        if (count <= maxLeafPrimitives &&
+            (split.axis < 0 || splitCost >= leafCost))
+        {
+            continue;
+        }
+
+        uint32_t middle = first + (count / 2);
+        if (split.axis >= 0) {
+            auto* end = std::partition(
+              primitives.data(), primitives.data() + count,
+              [&](uint32_t primitive) {
+                  return binOf(centroids[primitive], split, centroidBounds) <=
+                         split.bin;
+              });
+            middle = static_cast<uint32_t>(end - order.data());
+        } else {
+            // all centroids in one spot: halves, whatever their order
+            int axis = 0;
+            glm::vec3 size = box.max - box.min;
+            if (size.y > size[axis]) {
+                axis = 1;
+            }
+            if (size.z > size[axis]) {
+                axis = 2;
+            }
+            std::nth_element(primitives.begin(),
+                             primitives.begin() + (count / 2), primitives.end(),
+                             [&](uint32_t a, uint32_t b) {
+                return centroids[a][axis] < centroids[b][axis];
+            });
+        }
+
+        auto left = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(
+          {.box = emptyBox(), .first = first, .count = middle - first});
+        nodes.push_back({.box = emptyBox(),
+                         .first = middle,
+                         .count = first + count - middle});
+        parents.push_back(task.node);
+        parents.push_back(task.node);
+        nodes[task.node].first = left;
+        nodes[task.node].count = 0;
+        tasks.push_back({left, task.depth + 1});
+        tasks.push_back({left + 1, task.depth + 1});
+    }
+
+    for (uint32_t node = 0; node < nodes.size(); ++node) {
+        const Node& n = nodes[node];
+        for (uint32_t i = n.first; i < n.first + n.count; ++i) {
+            leafOf[order[i]] = node;
+        }
+        weightedArea += surfaceArea(n.box) * nodeWeight(n);
+    }
+    builtCost = currentCost();
+}
+
+void Bvh::refit()
+{
+    ++refits;
+    // past a point, one pass over everything beats walking up from each
+    if (moved.size() * 4 > nodes.size()) {
+        refitAll();
+    } else {
+        for (uint32_t primitive : moved) {
+            uint32_t node = leafOf[primitive];
+            while (node != noNode && refitNode(node)) {
+                node = parents[node];
+            }
+        }
+    }
+    moved.clear();
+}
+
+void Bvh::refitAll()
+{
+    // children come after their parents, so backwards is bottom up
+    for (size_t node = nodes.size(); node-- > 0;) {
+        (void)refitNode(static_cast<uint32_t>(node));
+    }
+}
+
+bool Bvh::refitNode(uint32_t node)
+{
+    Node& n = nodes[node];
+    Aabb box = emptyBox();
+    if (n.count > 0) {
+        for (uint32_t i = n.first; i < n.first + n.count; ++i) {
+            grow(box, boxes[order[i]]);
+        }
+    } else {
+        box = nodes[n.first].box;
+        grow(box, nodes[n.first + 1].box);
+    }
+    if (box == n.box) {
+        return false;
+    }
+    weightedArea += (surfaceArea(box) - surfaceArea(n.box)) * nodeWeight(n);
+    n.box = box;
+    return true;
+}
+
+float Bvh::currentCost() const
+{
+    double rootArea = nodes.empty() ? 0.0 : surfaceArea(nodes[0].box);
+    return rootArea > 0.0 ? static_cast<float>(weightedArea / rootArea) : 0.0F;
+}
+
+double Bvh::nodeWeight(const Node& node) const
+{
+    return node.count > 0 ? static_cast<double>(node.count) : traversalCost;
+}
+
+void Bvh::cull(const Frustum& frustum, std::vector<uint32_t>& visible) const
+{
+    if (nodes.empty()) {
+        return;
+    }
+
+    // Which of `planes` (a bit each) `box` is not entirely inside of, or
+    // nothing if it is entirely outside one
+    auto classify = [&frustum](const Aabb& box,
+                               uint32_t planes) -> std::optional<uint32_t> {
+        glm::vec3 center = box.center();
+        glm::vec3 extent = box.extent();
+        for (uint32_t p = 0; p < 6; ++p) {
+            if ((planes & (1U << p)) == 0) {
+                continue;
+            }
+            const glm::vec4& plane = frustum.planes[p];
+            float distance = glm::dot(glm::vec3{plane}, center) + plane.w;
+            float radius = glm::dot(glm::abs(glm::vec3{plane}), extent);
+            if (distance + radius < 0.0F) {
+                return std::nullopt;
+            }
+            if (distance - radius >= 0.0F) {
+                planes &= ~(1U << p);
+            }
+        }
+        return planes;
+    };
+
+    // planes a node's box is inside of are not tested again below it
+    struct Pending
+    {
+        uint32_t node;
+        uint32_t planes;
+    };
+    Pending stack[maxDepth * 2];
+    size_t stackSize = 0;
+    stack[stackSize++] = {0, 0x3FU};
+    while (stackSize > 0) {
+        Pending pending = stack[--stackSize];
+        const Node& node = nodes[pending.node];
+        std::optional<uint32_t> planes = classify(node.box, pending.planes);
+        if (!planes) {
+            continue;
+        }
+        if (node.count == 0) {
+            stack[stackSize++] = {node.first + 1, *planes};
+            stack[stackSize++] = {node.first, *planes};
+            continue;
+        }
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+            uint32_t primitive = order[i];
+            if (*planes == 0 || node.count == 1 ||
+                classify(boxes[primitive], *planes))
+            {
+                visible.push_back(primitive);
+            }
+        }
+    }
+}
+
+std::optional<BvhHit> Bvh::raycastBoxes(const Ray& ray,
+                                        float maxDistance) const
+{
+    glm::vec3 inverseDirection = 1.0F / ray.direction;
+    return raycast(ray, maxDistance, [&](uint32_t primitive, float limit) {
+        return intersectRayBox(ray, inverseDirection, boxes[primitive], limit);
+    });
+}
+
+size_t Bvh::size() const
+{
+    return boxes.size() - freeIds.size();
+}
+
+BvhStats Bvh::getStats() const
+{
+    BvhStats stats{.primitives = size(),
+                   .nodes = nodes.size(),
+                   .sahCost = currentCost(),
+                   .builds = builds,
+                   .refits = refits};
+    std::vector<size_t> depths(nodes.size(), 1);
+    for (size_t node = 0; node < nodes.size(); ++node) {
+        const Node& n = nodes[node];
+        if (n.count > 0) {
+            ++stats.leaves;
+            stats.depth = std::max(stats.depth, depths[node]);
+        } else {
+            depths[n.first] = depths[node] + 1;
+            depths[n.first + 1] = depths[node] + 1;
+        }
+    }
+    return stats;
+}
+
+size_t Bvh::getMemoryUsage() const
+{
+    return (nodes.capacity() * sizeof(Node)) +
+           ((parents.capacity() + order.capacity() + leafOf.capacity() +
+             freeIds.capacity() + moved.capacity()) *
+            sizeof(uint32_t)) +
+           (boxes.capacity() * sizeof(Aabb)) + live.capacity();
+}
+
+RaycastMesh::RaycastMesh(std::vector<glm::vec3> positions,
+                         std::vector<uint32_t> indices)
+  : positions{std::move(positions)}, indices{std::move(indices)}
+{
+    std::vector<Aabb> triangles(this->indices.size() / 3, emptyBox());
+    for (size_t t = 0; t < triangles.size(); ++t) {
+        for (size_t corner = 0; corner < 3; ++corner) {
+            grow(triangles[t], this->positions[this->indices[(3 * t) + corner]]);
+        }
+    }
+    bvh = Bvh{triangles};
+}
+
+std::optional<float> RaycastMesh::raycast(const Ray& ray,
+                                          float maxDistance) const
+{
+    auto hit = bvh.raycast(ray, maxDistance,
+                           [&](uint32_t triangle, float limit) {
+        const uint32_t* corners = indices.data() + (3 * size_t{triangle});
+        return intersectRayTriangle(ray, positions[corners[0]],
+                                    positions[corners[1]],
+                                    positions[corners[2]], limit);
+    });
+    if (!hit) {
+        return std::nullopt;
+    }
+    return hit->distance;
+}
+
+size_t RaycastMesh::getTriangleCount() const
+{
+    return indices.size() / 3;
+}
+
+size_t RaycastMesh::getMemoryUsage() const
+{
+    return (positions.capacity() * sizeof(glm::vec3)) +
+           (indices.capacity() * sizeof(uint32_t)) + bvh.getMemoryUsage();
+}
@@ -0,0 +1,41 @@
+#include "frontend/drawParams.hpp"
+
+#include "frontend/glState.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+DrawParams makeDrawParams(const QuantizationTransform* quantization,
+                          int textureLayer, bool topRowFirst)
+{
+    DrawParams params;
+    if (quantization != nullptr) {
+        params.positionOffset = glm::vec4{quantization->positionOffset, 0.0F};
+        params.positionScale = glm::vec4{quantization->positionScale, 0.0F};
+        const glm::vec2& offset = quantization->texCoordOffset;
+        const glm::vec2& scale = quantization->texCoordScale;
+        params.texCoordTransform = {offset.x, offset.y, scale.x, scale.y};
+    }
+    params.positionOffset.w = static_cast<float>(textureLayer);
+    params.positionScale.w = topRowFirst ? 1.0F : 0.0F;
+    return params;
+}
+
+const VertexLayout& drawParamsLayout()
+{
+    static const VertexLayout layout =
+      VertexLayout{}
+        .addAttribute(6, 4, GL_FLOAT)  // position offset, texture layer
+        .addAttribute(7, 4, GL_FLOAT)  // position scale, top row first
+        .addAttribute(8, 4, GL_FLOAT)  // texture coordinate offset, scale
+        .setDivisor(1);
+    return layout;
+}
+
+void setConstantDrawParams(const DrawParams& params)
+{
+    // Current attribute values belong to the context, not a vertex array
+    GLState& state = GLState::current();
+    state.vertexAttrib4fv(6, glm::value_ptr(params.positionOffset));
+    state.vertexAttrib4fv(7, glm::value_ptr(params.positionScale));
+    state.vertexAttrib4fv(8, glm::value_ptr(params.texCoordTransform));
+}
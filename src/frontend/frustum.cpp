@@ -0,0 +1,262 @@
+#include "frontend/frustum.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+glm::vec4 normalizePlane(glm::vec4 plane)
+{
+    float length = glm::length(glm::vec3{plane});
+    return length > 0.0F ? plane / length : plane;
+}
+
+// Whether a volume at `center` is outside `plane`, with `radius` the sphere's
+// and `extent` the box's. Both the sphere and the box project onto the
+// normal as a radius, and the smaller one decides. The vectorised loops
+// compute exactly this, in this order.
+bool outside(const glm::vec4& plane, glm::vec3 center, glm::vec3 extent,
+             float radius)
+{
+    float distance =
+      (plane.x * center.x) + (plane.y * center.y) + (plane.z * center.z) +
+      plane.w;
+    float boxRadius = (std::abs(plane.x) * extent.x) +
+                      (std::abs(plane.y) * extent.y) +
+                      (std::abs(plane.z) * extent.z);
+    return distance + std::min(radius, boxRadius) < 0.0F;
+}
+
+// x, y, z, w of `plane` and the absolute x, y, z, each splatted across a
+// register by the vectorised loops
+std::array<float, 7> planeComponents(const glm::vec4& plane)
+{
+    return {plane.x,           plane.y,           plane.z,          plane.w,
+            std::abs(plane.x), std::abs(plane.y), std::abs(plane.z)};
+}
+} // anonymous namespace
+
+Aabb transformAabb(const Aabb& box, const glm::mat4& transform)
+{
+    // Arvo: the new extent is the old one through the absolute matrix
+    glm::vec3 center = glm::vec3{transform * glm::vec4{box.center(), 1.0F}};
+    glm::vec3 extent = (glm::abs(glm::vec3{transform[0]}) * box.extent().x) +
+                       (glm::abs(glm::vec3{transform[1]}) * box.extent().y) +
+                       (glm::abs(glm::vec3{transform[2]}) * box.extent().z);
+    return {.min = center - extent, .max = center + extent};
+}
+
+Frustum::Frustum(const glm::mat4& clipFromSpace)
+{
+    // Gribb/Hartmann: the planes of clip space pulled back through the matrix
+    const glm::mat4& m = clipFromSpace;
+    auto row = [&m](int i) {
+        return glm::vec4{m[0][i], m[1][i], m[2][i], m[3][i]};
+    };
+    planes[0] = normalizePlane(row(3) + row(0));
+    planes[1] = normalizePlane(row(3) - row(0));
+    planes[2] = normalizePlane(row(3) + row(1));
+    planes[3] = normalizePlane(row(3) - row(1));
+    planes[4] = normalizePlane(row(3) + row(2));
+    planes[5] = normalizePlane(row(3) - row(2));
+}
+
+Frustum::Frustum(const Camera& camera)
+  : Frustum(camera.computeProjectionMatrix() * camera.computeViewMatrix())
+{
+}
+
+bool Frustum::intersectsSphere(glm::vec3 center, float radius) const
+{
+    for (const auto& plane : planes) {
+        if (glm::dot(glm::vec3{plane}, center) + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::intersectsBox(const Aabb& box) const
+{
+    glm::vec3 center = box.center();
+    glm::vec3 extent = box.extent();
+    for (const auto& plane : planes) {
+        if (glm::dot(glm::vec3{plane}, center) + plane.w <
+            -glm::dot(glm::abs(glm::vec3{plane}), extent))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* frustumSimdPath()
+{
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE2__) || defined(_M_X64)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void CullBounds::clear()
+{
+    for (auto* values : {&centerX, &centerY, &centerZ, &extentX, &extentY,
+                         &extentZ, &radius})
+    {
+        values->clear();
+    }
+}
+
+void CullBounds::reserve(size_t count)
+{
+    for (auto* values : {&centerX, &centerY, &centerZ, &extentX, &extentY,
+                         &extentZ, &radius})
+    {
+        values->reserve(count);
+    }
+}
+
+void CullBounds::add(const Aabb& box, float radius)
+{
+    glm::vec3 center = box.center();
+    glm::vec3 extent = box.extent();
+    centerX.push_back(center.x);
+    centerY.push_back(center.y);
+    centerZ.push_back(center.z);
+    extentX.push_back(extent.x);
+    extentY.push_back(extent.y);
+    extentZ.push_back(extent.z);
+    this->radius.push_back(radius);
+}
+
+void CullBounds::addSphere(glm::vec3 center, float radius)
+{
+    add({.min = center - radius, .max = center + radius}, radius);
+}
+
+size_t CullBounds::size() const
+{
+    return radius.size();
+}
+
+size_t CullBounds::cull(const Frustum& frustum,
+                        std::vector<uint8_t>& visible) const
+{
+    visible.resize(size());
+    size_t i = 0;
+    size_t count = 0;
+#if defined(__AVX2__)
+    // a std::array of them would drop their alignment attributes
+    __m256 planes[6][7];
+    for (size_t p = 0; p < 6; ++p) {
+        for (size_t c = 0; c < 7; ++c) {
+            planes[p][c] =
+              _mm256_set1_ps(planeComponents(frustum.planes[p])[c]);
+        }
+    }
+    const __m256 zero = _mm256_setzero_ps();
+    for (; i + 8 <= size(); i += 8) {
+        __m256 cx = _mm256_loadu_ps(centerX.data() + i);
+        __m256 cy = _mm256_loadu_ps(centerY.data() + i);
+        __m256 cz = _mm256_loadu_ps(centerZ.data() + i);
+        __m256 ex = _mm256_loadu_ps(extentX.data() + i);
+        __m256 ey = _mm256_loadu_ps(extentY.data() + i);
+        __m256 ez = _mm256_loadu_ps(extentZ.data() + i);
+        __m256 r = _mm256_loadu_ps(radius.data() + i);
+        __m256 out = zero;
+        for (const auto& plane : planes) {
+            __m256 distance = _mm256_add_ps(
+              _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(plane[0], cx),
+                                          _mm256_mul_ps(plane[1], cy)),
+                            _mm256_mul_ps(plane[2], cz)),
+              plane[3]);
+            __m256 boxRadius = _mm256_add_ps(
+              _mm256_add_ps(_mm256_mul_ps(plane[4], ex),
+                            _mm256_mul_ps(plane[5], ey)),
+              _mm256_mul_ps(plane[6], ez));
+            out = _mm256_or_ps(
+              out, _mm256_cmp_ps(_mm256_add_ps(distance,
+                                               _mm256_min_ps(r, boxRadius)),
+                                 zero, _CMP_LT_OQ));
+        }
+        auto in = static_cast<unsigned>(~_mm256_movemask_ps(out) & 0xFF);
+        for (size_t k = 0; k < 8; ++k) {
+            visible[i + k] = static_cast<uint8_t>((in >> k) & 1U);
+        }
+        count += static_cast<size_t>(std::popcount(in));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    // a std::array of them would drop their alignment attributes
+    __m128 planes[6][7];
+    for (size_t p = 0; p < 6; ++p) {
+        for (size_t c = 0; c < 7; ++c) {
+            planes[p][c] = _mm_set1_ps(planeComponents(frustum.planes[p])[c]);
+        }
+    }
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= size(); i += 4) {
+        __m128 cx = _mm_loadu_ps(centerX.data() + i);
+        __m128 cy = _mm_loadu_ps(centerY.data() + i);
+        __m128 cz = _mm_loadu_ps(centerZ.data() + i);
+        __m128 ex = _mm_loadu_ps(extentX.data() + i);
+        __m128 ey = _mm_loadu_ps(extentY.data() + i);
+        __m128 ez = _mm_loadu_ps(extentZ.data() + i);
+        __m128 r = _mm_loadu_ps(radius.data() + i);
+        __m128 out = zero;
+        for (const auto& plane : planes) {
+            __m128 distance = _mm_add_ps(
+              _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane[0], cx),
+                                    _mm_mul_ps(plane[1], cy)),
+                         _mm_mul_ps(plane[2], cz)),
+              plane[3]);
+            __m128 boxRadius =
+              _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane[4], ex),
+                                    _mm_mul_ps(plane[5], ey)),
+                         _mm_mul_ps(plane[6], ez));
+            out = _mm_or_ps(
+              out,
+              _mm_cmplt_ps(_mm_add_ps(distance, _mm_min_ps(r, boxRadius)),
+                           zero));
+        }
+        auto in = static_cast<unsigned>(~_mm_movemask_ps(out) & 0xF);
+        for (size_t k = 0; k < 4; ++k) {
+            visible[i + k] = static_cast<uint8_t>((in >> k) & 1U);
+        }
+        count += static_cast<size_t>(std::popcount(in));
+    }
+#endif
+    return count + cullScalarFrom(frustum, i, visible);
+}
+
+size_t CullBounds::cullScalar(const Frustum& frustum,
+                              std::vector<uint8_t>& visible) const
+{
+    visible.resize(size());
+    return cullScalarFrom(frustum, 0, visible);
+}
+
+size_t CullBounds::cullScalarFrom(const Frustum& frustum, size_t first,
+                                  std::vector<uint8_t>& visible) const
+{
+    size_t count = 0;
+    for (size_t i = first; i < size(); ++i) {
+        glm::vec3 center{centerX[i], centerY[i], centerZ[i]};
+        glm::vec3 extent{extentX[i], extentY[i], extentZ[i]};
+        bool in = std::ranges::none_of(frustum.planes, [&](const auto& plane) {
+            return outside(plane, center, extent, radius[i]);
+        });
+        visible[i] = in ? 1 : 0;
+        count += in ? 1 : 0;
+    }
+    return count;
+}
@@ -0,0 +1,435 @@
+#include "frontend/geometryArena.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+// Units a buffer starts with, so small meshes do not grow it one by one
+constexpr size_t initialVertices = size_t{1} << 16;
+constexpr size_t initialIndices = size_t{1} << 18;
+// Holes smaller than this are not worth a compaction
+constexpr size_t minCompactBytes = size_t{1} << 20;
+} // namespace
+
+bool multiDrawIndirectSupported()
+{
+    static const bool supported =
+      glewIsSupported("GL_VERSION_4_3") != 0 ||
+      glewIsSupported("GL_ARB_multi_draw_indirect GL_ARB_base_instance") != 0;
+    return supported;
+}
+
+GeometryArena::GeometryArena(const VertexLayout& layout, GLenum indexType)
+  : layout{layout}, indexType{indexType}
+{
+    if (indexType != GL_UNSIGNED_SHORT && indexType != GL_UNSIGNED_INT) {
+        throw IrrecoverableError{"Geometry arenas hold 16 or 32-bit indices"};
+    }
+    vertices.unitBytes = layout.getStride();
+    indices.unitBytes = getIndexSize();
+    glGenVertexArrays(1, &vao);
+}
+
+GeometryArena::~GeometryArena()
+{
+    if (vao != 0) {
+        GLState::current().deleteVertexArray(vao);
+    }
+    for (GLuint buffer : {vertices.buffer, indices.buffer}) {
+        if (buffer != 0) {
+            GLState::current().deleteBuffer(buffer);
+        }
+    }
+}
+
+GeometryArena::Allocation GeometryArena::allocateBytes(const void* vertexData,
+                                                      size_t vertexCount,
+                                                      const void* indexData,
+                                                      size_t indexCount)
+{
+    size_t vertexOffset = allocateIn(vertices, vertexCount);
+    size_t indexOffset = allocateIn(indices, indexCount);
+
+    GLState& state = GLState::current();
+    // not GL_ELEMENT_ARRAY_BUFFER, which would rebind the bound VAO's
+    state.bindBuffer(GL_COPY_WRITE_BUFFER, vertices.buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER,
+                    static_cast<GLintptr>(vertexOffset * vertices.unitBytes),
+                    static_cast<GLsizeiptr>(vertexCount * vertices.unitBytes),
+                    vertexData);
+    state.bindBuffer(GL_COPY_WRITE_BUFFER, indices.buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER,
+                    static_cast<GLintptr>(indexOffset * indices.unitBytes),
+                    static_cast<GLsizeiptr>(indexCount * indices.unitBytes),
+                    indexData);
+
+    Allocation allocation = 0;
+    if (freeSlots.empty()) {
+        allocation = static_cast<Allocation>(slots.size());
+        slots.emplace_back();
+    } else {
+        allocation = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    slots[allocation] = {
+      .range = {.baseVertex = static_cast<GLint>(vertexOffset),
+                .vertexCount = static_cast<uint32_t>(vertexCount),
+                .firstIndex = static_cast<uint32_t>(indexOffset),
+                .indexCount = static_cast<uint32_t>(indexCount)},
+      .live = true,
+    };
+    return allocation;
+}
+
+size_t GeometryArena::allocateIn(Storage& storage, size_t count)
+{
+    // an empty range still needs an offset
+    size_t units = std::max<size_t>(count, 1);
+    if (auto offset = storage.ranges.allocate(units)) {
+        return *offset;
+    }
+
+    size_t initial = &storage == &vertices ? initialVertices : initialIndices;
+    size_t capacity = storage.ranges.getCapacity();
+    size_t grown = std::max({initial, capacity * 2, capacity + units});
+    replaceBuffer(storage, grown);
+    storage.ranges.grow(grown);
+    if (capacity > 0) {
+        ++growths;
+    }
+    return *storage.ranges.allocate(units);
+}
+
+void GeometryArena::replaceBuffer(Storage& storage, size_t capacity)
+{
+    GLState& state = GLState::current();
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    state.bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER,
+                 static_cast<GLsizeiptr>(capacity * storage.unitBytes), nullptr,
+                 GL_STATIC_DRAW);
+
+    if (storage.buffer != 0) {
+        state.bindBuffer(GL_COPY_READ_BUFFER, storage.buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                            static_cast<GLsizeiptr>(
+                              storage.ranges.getCapacity() * storage.unitBytes));
+        state.deleteBuffer(storage.buffer);
+    }
+    storage.buffer = buffer;
+    attachBuffers();
+}
+
+void GeometryArena::attachBuffers()
+{
+    GLState& state = GLState::current();
+    state.bindVertexArray(vao);
+    if (indices.buffer != 0) {
+        state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices.buffer);
+    }
+    if (vertices.buffer != 0) {
+        state.bindBuffer(GL_ARRAY_BUFFER, vertices.buffer);
+        layout.apply(0);
+    }
+    if (glUnbindAfterUse) {
+        state.bindVertexArray(0);
+    }
+}
+
+void GeometryArena::free(Allocation allocation)
+{
+    Slot& slot = slots[allocation];
+    if (!slot.live) {
+        return;
+    }
+    const ArenaRange& range = slot.range;
+    vertices.ranges.free(static_cast<size_t>(range.baseVertex),
+                         std::max<size_t>(range.vertexCount, 1));
+    indices.ranges.free(range.firstIndex,
+                        std::max<size_t>(range.indexCount, 1));
+    slot.live = false;
+    freeSlots.push_back(allocation);
+
+    size_t holes = (vertices.ranges.getFreeInHoles() * vertices.unitBytes) +
+                   (indices.ranges.getFreeInHoles() * indices.unitBytes);
+    size_t used = (vertices.ranges.getUsed() * vertices.unitBytes) +
+                  (indices.ranges.getUsed() * indices.unitBytes);
+    if (holes > used && holes >= minCompactBytes) {
+        compact();
+    }
+}
+
+void GeometryArena::compact()
+{
+    std::vector<Allocation> live;
+    for (Allocation a = 0; a < slots.size(); ++a) {
+        if (slots[a].live) {
+            live.push_back(a);
+        }
+    }
+
+    // Each buffer keeps the order its allocations were in
+    auto compactStorage = [&](Storage& storage, auto offsetOf, auto countOf,
+                              auto setOffset) {
+        if (storage.buffer == 0) {
+            return;
+        }
+        std::ranges::sort(live, {}, [&](Allocation a) {
+            return offsetOf(slots[a].range);
+        });
+
+        GLState& state = GLState::current();
+        GLuint old = storage.buffer;
+        GLuint buffer = 0;
+        glGenBuffers(1, &buffer);
+        state.bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER,
+                     static_cast<GLsizeiptr>(storage.ranges.getCapacity() *
+                                             storage.unitBytes),
+                     nullptr, GL_STATIC_DRAW);
+        state.bindBuffer(GL_COPY_READ_BUFFER, old);
+
+        size_t next = 0;
+        for (Allocation a : live) {
+            ArenaRange& range = slots[a].range;
+            size_t units = std::max<size_t>(countOf(range), 1);
+            glCopyBufferSubData(
+              GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+              static_cast<GLintptr>(offsetOf(range) * storage.unitBytes),
+              static_cast<GLintptr>(next * storage.unitBytes),
+              static_cast<GLsizeiptr>(units * storage.unitBytes));
+            setOffset(range, next);
+            next += units;
+        }
+        storage.ranges.reset(next);
+        state.deleteBuffer(old);
+        storage.buffer = buffer;
+    };
+
+    compactStorage(
+      vertices,
+      [](const ArenaRange& r) {
+          return static_cast<size_t>(r.baseVertex);
+      },
+      [](const ArenaRange& r) {
+          return static_cast<size_t>(r.vertexCount);
+      },
+      [](ArenaRange& r, size_t offset) {
+          r.baseVertex = static_cast<GLint>(offset);
+      });
+    compactStorage(
+      indices,
+      [](const ArenaRange& r) {
+          return static_cast<size_t>(r.firstIndex);
+      },
+      [](const ArenaRange& r) {
+          return static_cast<size_t>(r.indexCount);
+      },
+      [](ArenaRange& r, size_t offset) {
+          r.firstIndex = static_cast<uint32_t>(offset);
+      });
+
+    attachBuffers();
+    ++compactions;
+}
+
+void GeometryArena::useDrawParamsArrays(bool arrays) const
+{
+    if (arrays == drawParamsArrays) {
+        return;
+    }
+    for (GLuint location : {6U, 7U, 8U}) {
+        if (arrays) {
+            glEnableVertexAttribArray(location);
+        } else {
+            glDisableVertexAttribArray(location);
+        }
+    }
+    drawParamsArrays = arrays;
+}
+
+void GeometryArena::bindForDraw() const
+{
+    GLState::current().bindVertexArray(vao);
+    useDrawParamsArrays(false);
+}
+
+void GeometryArena::drawRange(const Shader::BindObject& /*shader*/,
+                              const ArenaRange& range, size_t first,
+                              size_t count, GLenum primitive) const
+{
+    if (count == 0) {
+        return;
+    }
+    bindForDraw();
+    glDrawElementsBaseVertex(
+      primitive, static_cast<GLsizei>(count), indexType,
+      reinterpret_cast<const void*>((range.firstIndex + first) *
+                                    getIndexSize()),
+      range.baseVertex);
+    if (glUnbindAfterUse) {
+        GLState::current().bindVertexArray(0);
+    }
+}
+
+void GeometryArena::drawRanges(const Shader::BindObject& /*shader*/,
+                               const ArenaRange& range,
+                               std::span<const GLsizei> counts,
+                               std::span<const void* const> offsets,
+                               GLenum primitive) const
+{
+    if (counts.empty()) {
+        return;
+    }
+    size_t start = range.firstIndex * getIndexSize();
+    scratchOffsets.resize(offsets.size());
+    std::ranges::transform(offsets, scratchOffsets.begin(),
+                           [start](const void* offset) {
+        return static_cast<const void*>(static_cast<const char*>(offset) +
+                                        start);
+    });
+    scratchBaseVertices.assign(counts.size(), range.baseVertex);
+
+    bindForDraw();
+    glMultiDrawElementsBaseVertex(primitive, counts.data(), indexType,
+                                  scratchOffsets.data(),
+                                  static_cast<GLsizei>(counts.size()),
+                                  scratchBaseVertices.data());
+    if (glUnbindAfterUse) {
+        GLState::current().bindVertexArray(0);
+    }
+}
+
+void GeometryArena::drawRangeInstanced(const Shader::BindObject& /*shader*/,
+                                       const ArenaRange& range, size_t first,
+                                       size_t count,
+                                       const VertexBuffer& instances,
+                                       const VertexLayout& instanceLayout,
+                                       size_t firstInstance,
+                                       size_t instanceCount,
+                                       GLenum primitive) const
+{
+    if (count == 0 || instanceCount == 0) {
+        return;
+    }
+    bindForDraw();
+    instanceLayout.applyFrom(instances.getId(),
+                             firstInstance * instanceLayout.getStride(),
+                             instanceSource);
+    glDrawElementsInstancedBaseVertex(
+      primitive, static_cast<GLsizei>(count), indexType,
+      reinterpret_cast<const void*>((range.firstIndex + first) *
+                                    getIndexSize()),
+      static_cast<GLsizei>(instanceCount), range.baseVertex);
+    if (glUnbindAfterUse) {
+        GLState::current().bindVertexArray(0);
+    }
+}
+
+void GeometryArena::multiDrawIndirect(const Shader::BindObject& /*shader*/,
+                                      const VertexBuffer& drawParams,
+                                      size_t firstCommand, size_t count,
+                                      GLenum primitive) const
+{
+    if (count == 0) {
+        return;
+    }
+    GLState::current().bindVertexArray(vao);
+    drawParamsLayout().applyFrom(drawParams.getId(), 0, drawParamsSource);
+    useDrawParamsArrays(true);
+    glMultiDrawElementsIndirect(
+      primitive, indexType,
+      reinterpret_cast<const void*>(firstCommand *
+                                    sizeof(DrawElementsIndirectCommand)),
+      static_cast<GLsizei>(count), 0);
+    // the arrays leave the constant DrawParams undefined, so the next draw
+    // taking them sets them again
+    GLState::current().forgetVertexAttribs();
+    if (glUnbindAfterUse) {
+        GLState::current().bindVertexArray(0);
+    }
+}
+
+GeometryArenaStats GeometryArena::getStats() const
+{
+    return {
+      .arenas = 1,
+      .allocations = slots.size() - freeSlots.size(),
+      .usedBytes = (vertices.ranges.getUsed() * vertices.unitBytes) +
+                   (indices.ranges.getUsed() * indices.unitBytes),
+      .capacityBytes = (vertices.ranges.getCapacity() * vertices.unitBytes) +
+                       (indices.ranges.getCapacity() * indices.unitBytes),
+      .growths = growths,
+      .compactions = compactions,
+    };
+}
+
+GeometryArena& GeometryArenas::get(const VertexLayout& layout,
+                                   GLenum indexType)
+{
+    for (const auto& arena : arenas) {
+        if (arena->getIndexType() == indexType && arena->getLayout() == layout) {
+            return *arena;
+        }
+    }
+    return *arenas.emplace_back(
+      std::make_unique<GeometryArena>(layout, indexType));
+}
+
+GeometryArenaStats GeometryArenas::getStats() const
+{
+    GeometryArenaStats stats;
+    for (const auto& arena : arenas) {
+        stats += arena->getStats();
+    }
+    return stats;
+}
+
+IndirectCommandBuffer::~IndirectCommandBuffer()
+{
+    if (buffer != 0) {
+        GLState::current().deleteBuffer(buffer);
+    }
+}
+
+IndirectCommandBuffer::IndirectCommandBuffer(
+  IndirectCommandBuffer&& other) noexcept
+  : buffer{std::exchange(other.buffer, 0)},
+    capacity{std::exchange(other.capacity, 0)}
+{
+}
+
+IndirectCommandBuffer& IndirectCommandBuffer::operator=(
+  IndirectCommandBuffer&& other) noexcept
+{
+    if (this != &other) {
+        if (buffer != 0) {
+            GLState::current().deleteBuffer(buffer);
+        }
+        buffer = std::exchange(other.buffer, 0);
+        capacity = std::exchange(other.capacity, 0);
+    }
+    return *this;
+}
+
+void IndirectCommandBuffer::upload(
+  std::span<const DrawElementsIndirectCommand> commands)
+{
+    if (buffer == 0) {
+        glGenBuffers(1, &buffer);
+    }
+    bind();
+    size_t bytes = commands.size_bytes();
+    capacity = std::max(capacity, bytes);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, static_cast<GLsizeiptr>(capacity),
+                 nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0,
+                    static_cast<GLsizeiptr>(bytes), commands.data());
+}
+
+void IndirectCommandBuffer::bind() const
+{
+    GLState::current().bindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+}
@@ -0,0 +1,96 @@
+#include "frontend/glState.hpp"
+
+GLState::GLState()
+{
+    invalidate();
+}
+
+GLState& GLState::current()
+{
+    static GLState state;
+    return state;
+}
+
+void GLState::deleteProgram(GLuint program)
+{
+    // a deleted program stays in use until another one is
+    if (program == this->program) {
+        this->program = unknown;
+    }
+    glDeleteProgram(program);
+}
+
+void GLState::deleteVertexArray(GLuint vao)
+{
+    if (vao == vertexArray) {
+        vertexArray = 0;
+        buffers[slotOf(GL_ELEMENT_ARRAY_BUFFER)] = unknown;
+    }
+    glDeleteVertexArrays(1, &vao);
+}
+
+void GLState::deleteBuffer(GLuint buffer)
+{
+    for (GLuint& bound : buffers) {
+        if (bound == buffer) {
+            bound = 0;
+        }
+    }
+    for (IndexedBinding& bound : uniformBindings) {
+        if (bound.buffer == buffer) {
+            bound = {.buffer = 0};
+        }
+    }
+    glDeleteBuffers(1, &buffer);
+}
+
+void GLState::deleteTexture(GLuint texture)
+{
+    for (auto& unit : textures) {
+        for (GLuint& bound : unit) {
+            if (bound == texture) {
+                bound = 0;
+            }
+        }
+    }
+    glDeleteTextures(1, &texture);
+}
+
+void GLState::deleteFramebuffer(GLuint fbo)
+{
+    if (fbo == framebuffer) {
+        framebuffer = 0;
+    }
+    glDeleteFramebuffers(1, &fbo);
+}
+
+void GLState::forgetVertexAttribs()
+{
+    attributes.fill(std::nullopt);
+}
+
+void GLState::invalidate()
+{
+    program = unknown;
+    vertexArray = unknown;
+    buffers.fill(unknown);
+    uniformBindings.fill({});
+    activeUnit = unknown;
+    for (auto& unit : textures) {
+        unit.fill(unknown);
+    }
+    framebuffer = unknown;
+    forgetVertexAttribs();
+}
+
+const GLStateStats& GLState::getStats() const
+{
+    return stats;
+}
+
+GLStateStats GLState::takeStats()
+{
+    GLStateStats taken = stats;
+    stats = {};
+    return taken;
+}
@@ -0,0 +1,47 @@
+#include "frontend/instancing.hpp"
+
+InstanceTransform packInstance(const WorldPose& pose)
+{
+    const glm::quat& q = pose.rotation;
+    return {.rotation = {q.x, q.y, q.z, q.w},
+            .position = pose.position,
+            .scale = pose.scale};
+}
+
+const VertexLayout& instanceTransformLayout()
+{
+    static const VertexLayout layout = VertexLayout{}
+                                         .addAttribute(3, 4, GL_FLOAT) // rotation
+                                         .addAttribute(4, 3, GL_FLOAT) // position
+                                         .addAttribute(5, 3, GL_FLOAT) // scale
+                                         .setDivisor(1);
+    return layout;
+}
+
+void InstanceSet::upload(std::span<const uint32_t> order)
+{
+    packed.resize(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        packed[i] = packInstance(poses[order[i]]);
+    }
+    buffer.uploadData(packed, GL_STREAM_DRAW);
+}
+
+void InstanceSet::upload()
+{
+    packed.resize(poses.size());
+    for (size_t i = 0; i < poses.size(); ++i) {
+        packed[i] = packInstance(poses[i]);
+    }
+    buffer.uploadData(packed, GL_STREAM_DRAW);
+}
+
+const VertexBuffer& InstanceSet::getBuffer() const
+{
+    return buffer;
+}
+
+size_t InstanceSet::getUploadedCount() const
+{
+    return buffer.getVertexCount();
+}
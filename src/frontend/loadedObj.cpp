@@ -1,87 +1,201 @@
 #include "frontend/loadedObj.hpp"
 
+#include "frontend/meshCache.hpp"
+#include "frontend/meshOptimize.hpp"
+#include "frontend/objImport.hpp"
 #include "frontend/shader.hpp"
 #include "frontend/texture.hpp"
 #include "frontend/vertexLayout.hpp"
 #include "util/error.hpp"
 #include "util/logger.hpp"
+#include "util/perf.hpp"
 
-#define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 
-#include <glm/glm.hpp>
-
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <span>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 namespace
 {
-struct LoadedObjVertex
+const VertexLayout loadedObjVertexLayout =
+  VertexLayout{}
+    .addAttribute(0, 3, GL_FLOAT)  // position
+    .addAttribute(1, 3, GL_FLOAT)  // normal
+    .addAttribute(2, 2, GL_FLOAT); // texCoord
+
+// Box around `vertices`, and the sphere around its center.
+ShapeBounds computeBounds(std::span<const LoadedObjVertex> vertices)
 {
-    glm::vec3 position{};
-    glm::vec3 normal{};
-    glm::vec2 texCoord{};
+    ShapeBounds bounds;
+    if (vertices.empty()) {
+        return bounds;
+    }
+    bounds.box.min = glm::vec3{std::numeric_limits<float>::max()};
+    bounds.box.max = glm::vec3{std::numeric_limits<float>::lowest()};
+    for (const auto& vertex : vertices) {
+        bounds.box.min = glm::min(bounds.box.min, glm::vec3{vertex.position});
+        bounds.box.max = glm::max(bounds.box.max, glm::vec3{vertex.position});
+    }
+    glm::vec3 center = bounds.box.center();
+    float radiusSquared = 0.0F;
+    for (const auto& vertex : vertices) {
+        glm::vec3 d = glm::vec3{vertex.position} - center;
+        radiusSquared = std::max(radiusSquared, glm::dot(d, d));
+    }
+    bounds.radius = std::sqrt(radiusSquared);
+    return bounds;
+}
 
-    // Needed for use as a key in std::unordered_map
-    bool operator==(const LoadedObjVertex& other) const
-    {
-        return position == other.position && normal == other.normal &&
-               texCoord == other.texCoord;
+// A mesh of its own, or a range of the arena for `layout` and `Index`.
+template <typename Vertex, typename Index>
+Mesh uploadMesh(std::span<const Vertex> vertices, const VertexLayout& layout,
+                std::span<const Index> indices, GeometryArenas* arenas)
+{
+    if (arenas != nullptr) {
+        GLenum indexType = sizeof(Index) == sizeof(uint16_t)
+                             ? GL_UNSIGNED_SHORT
+                             : GL_UNSIGNED_INT;
+        return Mesh{arenas->get(layout, indexType), vertices, indices};
     }
+    Mesh mesh;
+    mesh.setVertexData(vertices.data(), vertices.size(), layout);
+    mesh.setIndexData(indices.data(), indices.size());
+    return mesh;
+}
 
-    LoadedObjVertex(const tinyobj::index_t& index,
-                    const tinyobj::attrib_t& attrib)
-    {
-        // Position
-        if (index.vertex_index >= 0) {
-            position = {attrib.vertices[(3 * index.vertex_index) + 0],
-                        attrib.vertices[(3 * index.vertex_index) + 1],
-                        attrib.vertices[(3 * index.vertex_index) + 2]};
-        }
+// Packs the vertices of every shape of `object`, imported from `path`, for
+// its quantized mesh cache.
+std::vector<QuantizedShape> quantizeShapes(const ImportedObject& object,
+                                           const std::filesystem::path& path,
+                                           ThreadPool& pool)
+{
+    const std::vector<ImportedShape>& shapes = object.shapes;
+    std::vector<QuantizationError> errors(shapes.size());
+    std::vector<QuantizedShape> quantized(shapes.size());
 
-        // Normal
-        if (index.normal_index >= 0) {
-            normal = {attrib.normals[(3 * index.normal_index) + 0],
-                      attrib.normals[(3 * index.normal_index) + 1],
-                      attrib.normals[(3 * index.normal_index) + 2]};
-        }
+    pool.parallelFor(shapes.size(), [&](size_t s) {
+        quantized[s] = quantizeVertices(shapes[s].vertices);
+        errors[s] = measureQuantizationError(shapes[s].vertices, quantized[s]);
+    });
 
-        // TexCoord (flip V)
-        if (index.texcoord_index >= 0) {
-            texCoord = {attrib.texcoords[(2 * index.texcoord_index) + 0],
-                        1.0F -
-                          attrib.texcoords[(2 * index.texcoord_index) + 1]};
-        }
+    QuantizationError worst;
+    size_t vertexCount = 0;
+    for (size_t s = 0; s < shapes.size(); ++s) {
+        worst |= errors[s];
+        vertexCount += shapes[s].vertices.size();
     }
-} __attribute__((packed));
+    LOG("Quantized " << vertexCount << " vertices of " << path << " ("
+                     << vertexCount * sizeof(LoadedObjVertex) / 1024
+                     << " KiB -> "
+                     << vertexCount * sizeof(QuantizedObjVertex) / 1024
+                     << " KiB), max error: position " << worst.position
+                     << " (" << worst.positionRelative * 100.0F
+                     << "% of bounds), normal " << worst.normalDegrees
+                     << " deg, uv " << worst.texCoord);
+    return quantized;
+}
 
-const VertexLayout loadedObjVertexLayout =
-  VertexLayout{}
-    .addAttribute(0, 3, GL_FLOAT)  // position
-    .addAttribute(1, 3, GL_FLOAT)  // normal
-    .addAttribute(2, 2, GL_FLOAT); // texCoord
+void boundShapes(PreparedObject& prepared, ThreadPool& pool)
+{
+    const std::vector<MeshCache::ShapeView>& shapes = prepared.getShapes();
+    prepared.bounds.resize(shapes.size());
+    pool.parallelFor(shapes.size(), [&](size_t s) {
+        prepared.bounds[s] = computeBounds(shapes[s].vertices);
+    });
+}
 
-struct VertexHasher
+void buildRaycastMeshes(PreparedObject& prepared, ThreadPool& pool)
 {
-    static size_t hashVec(const glm::vec2& v)
-    {
-        return std::hash<float>()(v.x) ^ (std::hash<float>()(v.y) << 1);
-    }
-    static size_t hashVec(const glm::vec3& v)
-    {
-        return ((std::hash<float>()(v.x) ^ (std::hash<float>()(v.y) << 1)) >>
-                1) ^
-               (std::hash<float>()(v.z) << 1);
+    Stopwatch timer;
+    const std::vector<MeshCache::ShapeView>& shapes = prepared.getShapes();
+    prepared.raycastMeshes.resize(shapes.size());
+
+    pool.parallelFor(shapes.size(), [&](size_t s) {
+        const auto& shape = shapes[s];
+        std::vector<glm::vec3> positions(shape.vertices.size());
+        std::ranges::transform(shape.vertices, positions.begin(),
+                               [](const LoadedObjVertex& vertex) {
+            return glm::vec3{vertex.position};
+        });
+        // full detail only; the coarser levels are close enough to it
+        std::vector<uint32_t> indices;
+        if (!shape.lods.empty()) {
+            auto lod = shape.indices.subspan(shape.lods[0].firstIndex,
+                                             shape.lods[0].indexCount);
+            indices.assign(lod.begin(), lod.end());
+        }
+        prepared.raycastMeshes[s] = std::make_shared<const RaycastMesh>(
+          std::move(positions), std::move(indices));
+    });
+
+    size_t triangles = 0;
+    size_t bytes = 0;
+    for (const auto& mesh : prepared.raycastMeshes) {
+        triangles += mesh->getTriangleCount();
+        bytes += mesh->getMemoryUsage();
     }
+    LOG("Built raycast meshes of " << triangles << " triangles of "
+                                   << prepared.path << " (" << bytes / 1024
+                                   << " KiB) in " << timer.elapsedMilliseconds()
+                                   << " ms");
+}
 
-    std::size_t operator()(const LoadedObjVertex& v) const
-    {
-        // A simple hash combination
-        size_t h1 = hashVec(v.position);
-        size_t h2 = hashVec(v.normal);
-        size_t h3 = hashVec(v.texCoord);
-        return ((h1 ^ (h2 << 1)) >> 1) ^ (h3 << 1);
+// The coarsest level of detail of each shape still within this much of its
+// surface, relative to its bounding radius, becomes its occluder. An
+// occluder bulging out of its shape hides what should be seen.
+constexpr float maxOccluderError = 0.01F;
+
+void buildOccluderMeshes(PreparedObject& prepared, ThreadPool& pool)
+{
+    Stopwatch timer;
+    const std::vector<MeshCache::ShapeView>& shapes = prepared.getShapes();
+    prepared.occluders.resize(shapes.size());
+
+    pool.parallelFor(shapes.size(), [&](size_t s) {
+        const auto& shape = shapes[s];
+        auto occluder = std::make_shared<OccluderMesh>();
+        float maxError = maxOccluderError * prepared.bounds[s].radius;
+        // levels go from fine to coarse
+        const ShapeLod* lod = nullptr;
+        for (const ShapeLod& level : shape.lods) {
+            if (level.error <= maxError) {
+                lod = &level;
+            }
+        }
+        if (lod != nullptr) {
+            // only the vertices that level uses, in order of first use
+            std::unordered_map<uint32_t, uint32_t> remap;
+            for (uint32_t index :
+                 shape.indices.subspan(lod->firstIndex, lod->indexCount))
+            {
+                auto [it, inserted] = remap.try_emplace(
+                  index, static_cast<uint32_t>(occluder->positions.size()));
+                if (inserted) {
+                    occluder->positions.emplace_back(
+                      shape.vertices[index].position);
+                }
+                occluder->indices.push_back(it->second);
+            }
+        }
+        prepared.occluders[s] = std::move(occluder);
+    });
+
+    size_t triangles = 0;
+    for (const auto& occluder : prepared.occluders) {
+        triangles += occluder->indices.size() / 3;
     }
-};
+    LOG("Built occluders of " << triangles << " triangles of "
+                              << prepared.path << " in "
+                              << timer.elapsedMilliseconds() << " ms");
+}
 } // anonymous namespace
 
 namespace
@@ -89,119 +203,391 @@ namespace
 
 // TODO: Better abstraction needed.
 // To add support for a new texture map,
-// 1. Add a new load function
-//      (and call it in loadTextures)
-// 2. Add a new bind function
-//      (and call it in draw)
+// 1. Collect its file names
+//      (in textureNamesOf)
+// 2. Add it to DrawMaterial
+//      (set it in drawMaterialOf, and bind it in bindShape and RenderQueue)
 // 3. Register what uniform name corresponds to the texture number
 //      (in `setInitUniforms()`)
 // 4. Make sure to update the shader to support it
 
-void loadDiffuseMapFrom(const tinyobj::material_t& mat,
-                        const std::filesystem::path& parentDir,
-                        std::unordered_map<std::string, Texture>& textures)
-{
-    if (!mat.diffuse_texname.empty()) {
-        if (!textures.contains(mat.diffuse_texname)) {
-            try {
-                std::filesystem::path texturePath =
-                  parentDir / mat.diffuse_texname;
-                textures.emplace(mat.diffuse_texname, Texture(texturePath));
-            } catch (const std::exception& e) {
-                LOG("Failed to load texture: " << mat.diffuse_texname << " ("
-                                               << e.what() << ")");
-            }
+// What a draw has bound to the diffuse texture units so far, so shapes
+// sharing a texture (or texture array) do not bind it again.
+struct BoundTextures
+{
+    uint32_t texture = 0;
+    uint32_t textureArray = 0;
+};
+
+// Every texture file `materials` use, each once, in order of first use.
+std::vector<std::string>
+textureNamesOf(const std::vector<tinyobj::material_t>& materials)
+{
+    std::vector<std::string> names;
+    std::unordered_set<std::string> seen;
+    auto add = [&](const std::string& name) {
+        if (!name.empty() && seen.insert(name).second) {
+            names.push_back(name);
         }
+    };
+    for (const auto& mat : materials) {
+        // DIFFUSE MAP
+        add(mat.diffuse_texname);
+        // add other textures as needed...
+    }
+    return names;
+}
+
+// Decodes (or builds the cached mips of) the textures `materials` use on
+// `pool`, without touching GL. Ones that fail to load are logged and left out.
+AsyncObjectLoad::DecodedTextures
+decodeTextures(const std::filesystem::path& parentDir,
+               const std::vector<tinyobj::material_t>& materials,
+               const TextureImportOptions& options, ThreadPool& pool)
+{
+    std::vector<std::string> names = textureNamesOf(materials);
+    std::vector<std::optional<DecodedTexture>> slots(names.size());
+    std::vector<std::string> errors(names.size());
+    pool.parallelFor(names.size(), [&](size_t i) {
+        try {
+            slots[i] = DecodedTexture::fromFile(parentDir / names[i], options);
+        } catch (const std::exception& e) {
+            errors[i] = e.what();
+        }
+    });
+
+    AsyncObjectLoad::DecodedTextures decoded;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (slots[i]) {
+            decoded.emplace_back(std::move(names[i]), std::move(*slots[i]));
+        } else {
+            LOG("Failed to load texture: " << names[i] << " (" << errors[i]
+                                           << ")");
+        }
+    }
+    return decoded;
+}
+
+// Creates the GL texture for `decoded` and frees its pixels. Must run on the
+// thread owning the GL context.
+void uploadTexture(const std::string& name, DecodedTexture& decoded,
+                   std::unordered_map<std::string, Texture>& textures)
+{
+    try {
+        int width = decoded.width;
+        int height = decoded.height;
+        double decodeMs = decoded.decodeMilliseconds;
+        Stopwatch timer;
+        textures.emplace(name, Texture{std::move(decoded)});
+        LOG("Loaded texture " << name << " (" << width << "x" << height
+                              << "): decode " << decodeMs << " ms, upload "
+                              << timer.elapsedMilliseconds() << " ms");
+    } catch (const std::exception& e) {
+        LOG("Failed to load texture: " << name << " (" << e.what() << ")");
     }
+    decoded.release();
 }
 
-void bindDiffuseMapFrom(
-  const tinyobj::material_t& mat,
-  const std::unordered_map<std::string, Texture>& textures,
-  Shader::BindObject& shader)
+// Uploads the textures of `decoded` that share their size and format with
+// others as layers of texture arrays, and takes them out of `decoded`. Must
+// run on the thread owning the GL context.
+void packTextureArrays(AsyncObjectLoad::DecodedTextures& decoded,
+                       LoadedObject& object)
 {
-    if (!mat.diffuse_texname.empty()) {
-        const auto& tex = textures.at(mat.diffuse_texname);
-        tex.bind(shader, 0);
+    std::map<TextureArray::Layout, std::vector<size_t>> groups;
+    for (size_t i = 0; i < decoded.size(); ++i) {
+        if (auto layout = TextureArray::layoutOf(decoded[i].second)) {
+            groups[*layout].push_back(i);
+        }
+    }
+
+    std::vector<bool> packed(decoded.size(), false);
+    for (const auto& [layout, members] : groups) {
+        if (members.size() < 2) {
+            continue;
+        }
+        std::vector<const DecodedTexture*> layers;
+        for (size_t i : members) {
+            layers.push_back(&decoded[i].second);
+        }
+        try {
+            Stopwatch timer;
+            object.textureArrays.emplace_back(layers);
+            for (size_t layer = 0; layer < members.size(); ++layer) {
+                object.textureLayers[decoded[members[layer]].first] = {
+                  .array = object.textureArrays.size() - 1,
+                  .layer = static_cast<int>(layer)};
+                packed[members[layer]] = true;
+            }
+            LOG("Packed " << members.size() << " textures (" << layout.width
+                          << "x" << layout.height
+                          << ") into a texture array in "
+                          << timer.elapsedMilliseconds() << " ms");
+        } catch (const std::exception& e) {
+            // uploaded one by one instead
+            LOG("Could not pack texture array (" << e.what() << ")");
+        }
+    }
+
+    AsyncObjectLoad::DecodedTextures rest;
+    for (size_t i = 0; i < decoded.size(); ++i) {
+        if (!packed[i]) {
+            rest.push_back(std::move(decoded[i]));
+        }
     }
+    decoded = std::move(rest);
 }
 
 void loadTextures(const std::filesystem::path& parentDir,
-                  const std::vector<tinyobj::material_t>& materials,
-                  std::unordered_map<std::string, Texture>& textures)
+                  LoadedObject& object, const ObjLoadOptions& options,
+                  ThreadPool& pool)
 {
-    //
-    // Load textures from materials
-    //
-    for (const auto& mat : materials) {
-        // DIFFUSE MAP
-        loadDiffuseMapFrom(mat, parentDir, textures);
-        // load other textures as needed...
+    Stopwatch timer;
+    AsyncObjectLoad::DecodedTextures decoded =
+      decodeTextures(parentDir, object.materials, options.textures, pool);
+    double decodeMs = timer.elapsedMilliseconds();
+    size_t count = decoded.size();
+    if (options.textureArrays) {
+        packTextureArrays(decoded, object);
+    }
+    for (auto& [name, texture] : decoded) {
+        uploadTexture(name, texture, object.textures);
     }
+    LOG("Loaded " << count << " textures in " << timer.elapsedMilliseconds()
+                  << " ms (" << decodeMs << " ms decoding on "
+                  << pool.size() + 1 << " threads)");
 }
-} // anonymous namespace
 
-LoadedObject::LoadedObject(const std::filesystem::path& path)
+// Uploads shape `s` and adds it to `object`.
+void addPreparedShape(LoadedObject& object, const PreparedObject& prepared,
+                      const std::vector<MeshCache::ShapeView>& preparedShapes,
+                      size_t s)
 {
-    if (!std::filesystem::exists(path)) {
-        throw IrrecoverableError("Object file not found: " + path.string());
+    const auto& shape = preparedShapes[s];
+    GeometryArenas* arenas = prepared.options.arenas;
+    bool quantized =
+      prepared.options.vertexFormat == VertexFormat::Quantized;
+    Mesh mesh = quantized ? uploadMesh(shape.quantizedVertices,
+                                       quantizedObjVertexLayout(),
+                                       shape.indices, arenas)
+                          : uploadMesh(shape.vertices, loadedObjVertexLayout,
+                                       shape.indices, arenas);
+
+    // Built around the uploaded mesh: a default Mesh would make a vertex
+    // array only to delete it again
+    const ShapeBounds& bounds = prepared.bounds[s];
+    object.shapeBounds.add(bounds.box, bounds.radius);
+    object.shapes.push_back(LoadedObject::Shape{
+      .mesh = std::move(mesh),
+      .materialId = shape.materialId,
+      .quantization = quantized ? shape.quantization : QuantizationTransform{},
+      .lods = {shape.lods.begin(), shape.lods.end()},
+      .meshlets = {shape.meshlets.begin(), shape.meshlets.end()},
+      .box = bounds.box,
+      .center = bounds.box.center(),
+      .radius = bounds.radius,
+      .raycastMesh = prepared.raycastMeshes.empty() ? nullptr
+                                                    : prepared.raycastMeshes[s],
+      .occluder =
+        prepared.occluders.empty() ? nullptr : prepared.occluders[s]});
+}
+
+// Texture state `shape` is drawn with by a RenderQueue.
+DrawMaterial drawMaterialOf(const LoadedObject& object,
+                            const LoadedObject::Shape& shape)
+{
+    DrawMaterial material;
+    if (shape.materialId < 0) {
+        return material;
+    }
+    const std::string& name = object.materials[shape.materialId].diffuse_texname;
+    if (name.empty()) {
+        return material;
     }
 
-    std::filesystem::path parentDir =
-      path.has_parent_path() ? path.parent_path() : "";
+    auto layer = object.textureLayers.find(name);
+    if (layer != object.textureLayers.end()) {
+        const TextureArray& array = object.textureArrays[layer->second.array];
+        material.textureArray = array.getId();
+        material.layer = layer->second.layer;
+        material.topRowFirst = array.isTopRowFirst();
+        return material;
+    }
 
-    tinyobj::ObjReaderConfig reader_config;
-    reader_config.mtl_search_path = parentDir.string();
-    reader_config.triangulate = true; // ensure triangles
+    // may have failed to load, or still be loading
+    auto tex = object.textures.find(name);
+    if (tex != object.textures.end()) {
+        material.texture = tex->second.getId();
+        material.topRowFirst = tex->second.isTopRowFirst();
+    }
+    return material;
+}
 
-    tinyobj::ObjReader reader;
-    if (!reader.ParseFromFile(path.string(), reader_config)) {
-        std::string msg = reader.Error();
-        if (!reader.Warning().empty()) {
-            msg += "\nWarning: " + reader.Warning();
+// Textures and DrawParams of `shape`, for drawing it straight away.
+void bindShape(const LoadedObject& object, const LoadedObject::Shape& shape,
+               BoundTextures& bound)
+{
+    DrawMaterial material = drawMaterialOf(object, shape);
+    if (material.textureArray != 0) {
+        if (bound.textureArray != material.textureArray) {
+            GLState::current().bindTextureUnit(1, GL_TEXTURE_2D_ARRAY,
+                                               material.textureArray);
+            bound.textureArray = material.textureArray;
         }
-        throw IrrecoverableError{"Failed to load .obj file: " + msg};
+    } else if (material.texture != 0 && bound.texture != material.texture) {
+        GLState::current().bindTextureUnit(0, GL_TEXTURE_2D, material.texture);
+        bound.texture = material.texture;
     }
 
-    if (!reader.Warning().empty()) {
-        LOG("Warning while loading .obj: " << reader.Warning());
+    bool textured = material.textureArray != 0 || material.texture != 0;
+    setConstantDrawParams(makeDrawParams(
+      object.vertexFormat == VertexFormat::Quantized ? &shape.quantization
+                                                     : nullptr,
+      textured ? material.layer : -1, material.topRowFirst));
+}
+
+// Pixels an object space unit of `shape` covers on screen at most, or
+// nothing if the camera is (nearly) inside its bounding sphere.
+// `pixelsPerUnit` is the projection's scale at distance 1, `modelScale` the
+// largest scale of the model matrix.
+std::optional<float> pixelsPerObjectUnitOf(const LoadedObject::Shape& shape,
+                                           const glm::mat4& model,
+                                           float modelScale,
+                                           const Camera& camera,
+                                           float pixelsPerUnit)
+{
+    glm::vec3 center = glm::vec3{model * glm::vec4{shape.center, 1.0F}};
+    float radius = shape.radius * modelScale;
+    // nearest the surface can be, or inside the sphere
+    float distance = glm::length(center - camera.position) - radius;
+    if (distance <= camera.nearPlane) {
+        return std::nullopt;
     }
+    return pixelsPerUnit * modelScale / distance;
+}
 
-    const tinyobj::attrib_t& attrib = reader.GetAttrib();
-    const std::vector<tinyobj::shape_t>& objShapes = reader.GetShapes();
-    materials = reader.GetMaterials();
+// The coarsest level of detail of `shape` whose error stays within
+// `pixelError` pixels on screen.
+size_t selectLod(const LoadedObject::Shape& shape, const glm::mat4& model,
+                 float modelScale, const Camera& camera, float pixelsPerUnit,
+                 float pixelError)
+{
+    std::optional<float> pixelsPerObjectUnit = pixelsPerObjectUnitOf(
+      shape, model, modelScale, camera, pixelsPerUnit);
+    if (!pixelsPerObjectUnit) {
+        return 0;
+    }
 
-    loadTextures(parentDir, materials, textures);
+    size_t lod = 0;
+    while (lod + 1 < shape.lods.size() &&
+           shape.lods[lod + 1].error * *pixelsPerObjectUnit <= pixelError)
+    {
+        ++lod;
+    }
+    return lod;
+}
 
-    // Build meshes for shapes
-    for (const auto& shape : objShapes) {
-        std::vector<LoadedObjVertex> vertices;
-        std::vector<uint32_t> indices;
-        std::unordered_map<LoadedObjVertex, uint32_t, VertexHasher>
-          uniqueVertices;
+// Sphere around the spheres of the shapes; a radius of 0 if there are none.
+void objectBoundsOf(const LoadedObject& object, glm::vec3& center,
+                    float& radius)
+{
+    glm::vec3 minPosition{std::numeric_limits<float>::max()};
+    glm::vec3 maxPosition{std::numeric_limits<float>::lowest()};
+    bool any = false;
+    for (const auto& shape : object.shapes) {
+        if (!shape.lods.empty()) {
+            minPosition = glm::min(minPosition, shape.center - shape.radius);
+            maxPosition = glm::max(maxPosition, shape.center + shape.radius);
+            any = true;
+        }
+    }
+    center = any ? (minPosition + maxPosition) * 0.5F : glm::vec3{0.0F};
+    radius = 0.0F;
+    for (const auto& shape : object.shapes) {
+        if (!shape.lods.empty()) {
+            radius = std::max(radius, glm::length(shape.center - center) +
+                                        shape.radius);
+        }
+    }
+}
+} // anonymous namespace
 
-        for (const auto& index : shape.mesh.indices) {
-            LoadedObjVertex vertex{index, attrib};
+const std::vector<MeshCache::ShapeView>& PreparedObject::getShapes() const
+{
+    return cache.getShapes();
+}
 
-            // Deduplicate
-            if (!uniqueVertices.contains(vertex)) {
-                uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                vertices.push_back(vertex);
-            }
-            indices.push_back(uniqueVertices[vertex]);
-        }
+PreparedObject prepareObject(const std::filesystem::path& path,
+                             ObjLoadOptions options, ThreadPool& pool)
+{
+    if (!std::filesystem::exists(path)) {
+        throw IrrecoverableError("Object file not found: " + path.string());
+    }
 
-        // Upload mesh
-        Shape loadedShape;
-        loadedShape.mesh.setVertexData(vertices, loadedObjVertexLayout);
-        loadedShape.mesh.setIndexData(indices);
+    PreparedObject prepared;
+    prepared.path = path;
+    prepared.options = options;
 
-        if (!shape.mesh.material_ids.empty()) {
-            loadedShape.materialId = shape.mesh.material_ids[0];
+    Stopwatch timer;
+    if (auto cache = MeshCache::open(path, options.vertexFormat)) {
+        prepared.cache = std::move(*cache);
+        LOG("Mapped mesh cache of " << path << " in "
+                                    << timer.elapsedMilliseconds() << " ms");
+    } else {
+        ImportedObject imported = importObjFile(path, pool);
+        LOG("Parsed " << path << " in " << timer.elapsedMilliseconds()
+                      << " ms (" << pool.size() + 1 << " threads)");
+        std::vector<QuantizedShape> quantized;
+        if (options.vertexFormat == VertexFormat::Quantized) {
+            quantized = quantizeShapes(imported, path, pool);
         }
+        prepared.cache = MeshCache::build(path, imported, quantized);
+
+        try {
+            prepared.cache.save(path);
+        } catch (const std::exception& e) {
+            LOG("Could not write mesh cache for " << path << " (" << e.what()
+                                                  << ")");
+        }
+    }
+
+    boundShapes(prepared, pool);
+    if (options.raycastMeshes) {
+        buildRaycastMeshes(prepared, pool);
+    }
+    if (options.occluders) {
+        buildOccluderMeshes(prepared, pool);
+    }
+    return prepared;
+}
+
+LoadedObject::LoadedObject(const std::filesystem::path& path,
+                           ObjLoadOptions options)
+    : LoadedObject(prepareObject(path, options))
+{
+}
+
+LoadedObject::LoadedObject(PreparedObject prepared, ThreadPool& pool)
+  : vertexFormat{prepared.options.vertexFormat}
+{
+    const std::filesystem::path& path = prepared.path;
+    std::filesystem::path parentDir =
+      path.has_parent_path() ? path.parent_path() : "";
 
-        shapes.push_back(std::move(loadedShape));
+    Stopwatch timer;
+
+    // Vertices and indices go straight from the cache's bytes (mapped, or
+    // built on a miss) to the GPU
+    const std::vector<MeshCache::ShapeView>& preparedShapes =
+      prepared.getShapes();
+    for (size_t s = 0; s < preparedShapes.size(); ++s) {
+        addPreparedShape(*this, prepared, preparedShapes, s);
     }
+    materials = prepared.cache.getMaterials();
+    LOG("Uploaded geometry of " << path << " in "
+                                << timer.elapsedMilliseconds() << " ms");
+
+    loadTextures(parentDir, *this, prepared.options, pool);
 }
 
 void LoadedObject::setInitUniforms(Shader::BindObject& shader) const
@@ -210,20 +596,439 @@ void LoadedObject::setInitUniforms(Shader::BindObject& shader) const
     // bind texture maps we might load
     //
     Texture::setInitUniform(shader, "theTexture", 0); // DIFFUSE MAP
+    // or a layer of it, if packed
+    TextureArray::setInitUniform(shader, "theTextureArray", 1);
 }
 
 void LoadedObject::draw(Shader::BindObject& shader) const
 {
-    shader.setUniform("model", pose.computeTransform());
+    BoundTextures bound;
+    for (const auto& shape : shapes) {
+        if (shape.lods.empty()) {
+            continue;
+        }
+        bindShape(*this, shape, bound);
+        shape.mesh.drawIndexRange(shader, shape.lods[0].firstIndex,
+                                  shape.lods[0].indexCount);
+    }
+}
+
+ObjDrawStats LoadedObject::submit(RenderQueue& queue, Shader& shader,
+                                  const Camera& camera,
+                                  const ObjDrawSettings& settings,
+                                  const OcclusionBuffer* occlusion) const
+{
+    glm::mat4 model = pose.computeTransform();
+    uint32_t transform = queue.addTransform(model);
+
+    glm::mat4 projection = camera.computeProjectionMatrix();
+    MeshletCuller culler{projection * camera.computeViewMatrix(), model,
+                         camera.position};
+    float modelScale = std::max({glm::length(glm::vec3{model[0]}),
+                                 glm::length(glm::vec3{model[1]}),
+                                 glm::length(glm::vec3{model[2]})});
+    float pixelsPerUnit = projection[1][1] * 0.5F * settings.viewportHeight;
+
+    // All shapes against the frustum at once, in object space, into the
+    // queue's scratch so steady frames cull without allocating
+    std::vector<uint8_t>& visible = queue.visibilityScratch();
+    if (settings.shapeCulling) {
+        (void)shapeBounds.cull(culler.getFrustum(), visible);
+    }
+
+    ObjDrawStats stats;
+    for (size_t s = 0; s < shapes.size(); ++s) {
+        const Shape& shape = shapes[s];
+        if (shape.lods.empty()) {
+            continue;
+        }
+        if (settings.shapeCulling && visible[s] == 0) {
+            ++stats.shapesCulled;
+            continue;
+        }
+        if (settings.occlusionCulling && occlusion != nullptr &&
+            !occlusion->isVisible(shape.box, model))
+        {
+            ++stats.shapesOccluded;
+            continue;
+        }
+        ++stats.shapesVisible;
+        size_t lodIndex = selectLod(shape, model, modelScale, camera,
+                                    pixelsPerUnit, settings.lodPixelError);
+        const ShapeLod& lod = shape.lods[lodIndex];
+        ++stats.shapesPerLod[lodIndex];
+
+        DrawPacket packet{
+          .shader = &shader,
+          .mesh = &shape.mesh,
+          .material = drawMaterialOf(*this, shape),
+          .transform = transform,
+          .quantization = vertexFormat == VertexFormat::Quantized
+                            ? &shape.quantization
+                            : nullptr,
+          .firstIndex = lod.firstIndex,
+          .indexCount = lod.indexCount,
+        };
+        glm::vec3 center = glm::vec3{model * glm::vec4{shape.center, 1.0F}};
+
+        if (!settings.meshletCulling) {
+            queue.submit(packet, center);
+            stats.trianglesDrawn += lod.indexCount / 3;
+            continue;
+        }
+
+        //
+        // Collect the surviving meshlets, merging neighbours into one range
+        //
+        size_t indexSize = shape.mesh.getIndexSize();
+        uint32_t rangeStart = 0;
+        uint32_t rangeEnd = 0;
+        auto addRange = [&] {
+            uint32_t index = queue.addRange(
+              static_cast<GLsizei>(rangeEnd - rangeStart),
+              reinterpret_cast<const void*>(
+                static_cast<uintptr_t>(rangeStart) * indexSize));
+            if (packet.rangeCount++ == 0) {
+                packet.firstRange = index;
+            }
+        };
+        for (const auto& meshlet : std::span<const Meshlet>{shape.meshlets}
+                                     .subspan(lod.firstMeshlet,
+                                              lod.meshletCount))
+        {
+            if (!culler.isVisible(meshlet, stats.culling)) {
+                continue;
+            }
+            if (rangeEnd != rangeStart && rangeEnd != meshlet.firstIndex) {
+                addRange();
+            }
+            if (rangeEnd != meshlet.firstIndex) {
+                rangeStart = meshlet.firstIndex;
+            }
+            rangeEnd = meshlet.firstIndex + meshlet.indexCount;
+            stats.trianglesDrawn += meshlet.indexCount / 3;
+        }
+        if (rangeEnd == rangeStart) {
+            continue;
+        }
+        addRange();
+        queue.submit(packet, center);
+    }
+    return stats;
+}
+
+ObjDrawStats LoadedObject::drawInstanced(Shader::BindObject& shader,
+                                         InstanceSet& instances,
+                                         const Camera& camera,
+                                         const ObjDrawSettings& settings) const
+{
+    glm::vec3 objectCenter{0.0F};
+    float objectRadius = 0.0F;
+    objectBoundsOf(*this, objectCenter, objectRadius);
+
+    glm::mat4 projection = camera.computeProjectionMatrix();
+    float pixelsPerUnit = projection[1][1] * 0.5F * settings.viewportHeight;
+
+    // World space sphere of an instance, and its largest scale
+    auto boundsOf = [&](const WorldPose& pose) {
+        float scale = std::max({std::abs(pose.scale.x), std::abs(pose.scale.y),
+                                std::abs(pose.scale.z)});
+        glm::vec3 center =
+          pose.position + pose.rotation * (pose.scale * objectCenter);
+        return std::pair{center, scale};
+    };
+
+    //
+    // Cull in one batch, then sort the rest by how many pixels an object
+    // space unit covers
+    //
+    CullBounds bounds;
+    bounds.reserve(instances.poses.size());
+    for (const WorldPose& pose : instances.poses) {
+        auto [center, scale] = boundsOf(pose);
+        bounds.addSphere(center, objectRadius * scale);
+    }
+    std::vector<uint8_t> inFrustum;
+    size_t visibleCount =
+      bounds.cull(Frustum{projection * camera.computeViewMatrix()}, inFrustum);
+
+    struct Visible
+    {
+        float pixelsPerObjectUnit;
+        uint32_t pose;
+    };
+    std::vector<Visible> visible;
+    visible.reserve(visibleCount);
+    ObjDrawStats stats;
+    stats.instancesCulled = instances.poses.size() - visibleCount;
+    for (size_t i = 0; i < instances.poses.size(); ++i) {
+        if (inFrustum[i] == 0) {
+            continue;
+        }
+        auto [center, scale] = boundsOf(instances.poses[i]);
+        float radius = objectRadius * scale;
+        // full detail if the camera is (nearly) inside
+        float distance = glm::length(center - camera.position) - radius;
+        float pixels = distance <= camera.nearPlane
+                         ? std::numeric_limits<float>::infinity()
+                         : pixelsPerUnit * scale / distance;
+        visible.push_back({pixels, static_cast<uint32_t>(i)});
+    }
+    std::ranges::sort(visible, std::ranges::greater{},
+                      &Visible::pixelsPerObjectUnit);
+
+    std::vector<uint32_t> order(visible.size());
+    std::ranges::transform(visible, order.begin(), &Visible::pose);
+    instances.upload(order);
+    if (visible.empty()) {
+        return stats;
+    }
+
+    BoundTextures bound;
+    for (const auto& shape : shapes) {
+        if (shape.lods.empty()) {
+            continue;
+        }
+        bindShape(*this, shape, bound);
+
+        // A coarser level's error grows, so the instances that may use it are
+        // a tail of the nearest first order
+        size_t first = 0;
+        for (size_t lodIndex = 0; lodIndex < shape.lods.size(); ++lodIndex) {
+            size_t end = visible.size();
+            if (lodIndex + 1 < shape.lods.size()) {
+                float coarserError = shape.lods[lodIndex + 1].error;
+                end = static_cast<size_t>(
+                  std::ranges::partition_point(visible,
+                                               [&](const Visible& v) {
+                      return coarserError > 0.0F &&
+                             coarserError * v.pixelsPerObjectUnit >
+                               settings.lodPixelError;
+                  }) -
+                  visible.begin());
+                end = std::max(end, first);
+            }
+            if (end == first) {
+                continue;
+            }
+            const ShapeLod& lod = shape.lods[lodIndex];
+            shape.mesh.drawIndexRangeInstanced(
+              shader, lod.firstIndex, lod.indexCount, instances.getBuffer(),
+              instanceTransformLayout(), first, end - first);
+            stats.shapesPerLod[lodIndex] += end - first;
+            stats.trianglesDrawn += (end - first) * (lod.indexCount / 3);
+            first = end;
+        }
+    }
+    return stats;
+}
+
+void LoadedObject::addOccluders(OcclusionBuffer& occlusion) const
+{
+    glm::mat4 model = pose.computeTransform();
+    for (const auto& shape : shapes) {
+        if (shape.occluder) {
+            occlusion.addOccluder(*shape.occluder, model);
+        }
+    }
+}
+
+Aabb LoadedObject::computeBox() const
+{
+    Aabb box{.min = glm::vec3{std::numeric_limits<float>::max()},
+             .max = glm::vec3{std::numeric_limits<float>::lowest()}};
+    bool any = false;
+    for (const auto& shape : shapes) {
+        if (!shape.lods.empty()) {
+            box.min = glm::min(box.min, shape.box.min);
+            box.max = glm::max(box.max, shape.box.max);
+            any = true;
+        }
+    }
+    return any ? box : Aabb{};
+}
+
+std::optional<float> LoadedObject::raycast(const Ray& ray,
+                                           float maxDistance) const
+{
+    // Distances along the ray survive the affine transform into object
+    // space, as its direction is not normalised
+    glm::mat4 objectFromWorld = glm::inverse(pose.computeTransform());
+    Ray objectRay{
+      .origin = glm::vec3{objectFromWorld * glm::vec4{ray.origin, 1.0F}},
+      .direction = glm::vec3{objectFromWorld * glm::vec4{ray.direction, 0.0F}}};
+    glm::vec3 inverseDirection = 1.0F / objectRay.direction;
 
+    std::optional<float> nearest;
     for (const auto& shape : shapes) {
-        if (shape.materialId >= 0) {
-            //
-            // bind relevant material properties
-            //
-            const auto& mat = materials[shape.materialId];
-            bindDiffuseMapFrom(mat, textures, shader);
+        if (shape.lods.empty()) {
+            continue;
+        }
+        std::optional<float> distance = intersectRayBox(
+          objectRay, inverseDirection, shape.box, maxDistance);
+        if (distance && shape.raycastMesh) {
+            distance = shape.raycastMesh->raycast(objectRay, maxDistance);
+        }
+        if (distance) {
+            nearest = maxDistance = *distance;
         }
-        shape.mesh.draw(shader);
     }
+    return nearest;
+}
+
+void LoadedObject::requestTextureLevels(const Camera& camera,
+                                        const ObjDrawSettings& settings,
+                                        TextureStreamer& streamer)
+{
+    glm::mat4 model = pose.computeTransform();
+    glm::mat4 projection = camera.computeProjectionMatrix();
+    float modelScale = std::max({glm::length(glm::vec3{model[0]}),
+                                 glm::length(glm::vec3{model[1]}),
+                                 glm::length(glm::vec3{model[2]})});
+    float pixelsPerUnit = projection[1][1] * 0.5F * settings.viewportHeight;
+
+    for (const auto& shape : shapes) {
+        if (shape.materialId < 0) {
+            continue;
+        }
+        const std::string& name = materials[shape.materialId].diffuse_texname;
+        auto texture = textures.find(name);
+        if (name.empty() || texture == textures.end()) {
+            continue;
+        }
+
+        // Assumes the texture is stretched over the shape once: it needs
+        // about as many texels across as the shape covers pixels
+        float level = 0.0F;
+        if (std::optional<float> pixelsPerObjectUnit = pixelsPerObjectUnitOf(
+              shape, model, modelScale, camera, pixelsPerUnit))
+        {
+            float pixels =
+              std::max(1.0F, 2.0F * shape.radius * *pixelsPerObjectUnit);
+            float texels = static_cast<float>(std::max(
+              texture->second.getWidth(), texture->second.getHeight()));
+            level = std::max(0.0F, std::log2(texels / pixels));
+        }
+        streamer.request(texture->second, level);
+    }
+}
+
+AsyncObjectLoad::AsyncObjectLoad(const std::filesystem::path& path,
+                                 ObjLoadOptions options, ThreadPool& pool)
+  : path{path}, options{options}
+{
+    object.vertexFormat = options.vertexFormat;
+
+    std::promise<PreparedObject> preparedPromise;
+    std::promise<DecodedTextures> texturesPromise;
+    preparedFuture = preparedPromise.get_future();
+    texturesFuture = texturesPromise.get_future();
+
+    // A thread of its own rather than a pool task: the pool may have no
+    // workers, and prepareObject() spreads its own work over the pool anyway
+    job = std::async(
+      std::launch::async,
+      [path, options, &pool, preparedPromise = std::move(preparedPromise),
+       texturesPromise = std::move(texturesPromise)]() mutable {
+          std::vector<tinyobj::material_t> materials;
+          try {
+              PreparedObject prepared = prepareObject(path, options, pool);
+              materials = prepared.cache.getMaterials();
+              // geometry can be uploaded while the textures decode
+              preparedPromise.set_value(std::move(prepared));
+          } catch (...) {
+              preparedPromise.set_exception(std::current_exception());
+              texturesPromise.set_value({});
+              return;
+          }
+
+          std::filesystem::path parentDir =
+            path.has_parent_path() ? path.parent_path() : "";
+          texturesPromise.set_value(
+            decodeTextures(parentDir, materials, options.textures, pool));
+      });
+}
+
+AsyncObjectLoad::Status AsyncObjectLoad::commitUploads(
+  double budgetMilliseconds)
+{
+    if (status != Status::Loading) {
+        return status;
+    }
+
+    Stopwatch frameTimer;
+    auto withinBudget = [&] {
+        return frameTimer.elapsedMilliseconds() < budgetMilliseconds;
+    };
+    auto isReady = [](const auto& future) {
+        return future.valid() && future.wait_for(std::chrono::seconds{0}) ==
+                                   std::future_status::ready;
+    };
+
+    try {
+        if (!prepared && isReady(preparedFuture)) {
+            prepared = preparedFuture.get();
+            preparedShapes = prepared->getShapes();
+            object.materials = prepared->cache.getMaterials();
+        }
+        if (prepared) {
+            while (object.shapes.size() < preparedShapes.size() &&
+                   withinBudget())
+            {
+                addPreparedShape(object, *prepared, preparedShapes,
+                                 object.shapes.size());
+            }
+        }
+
+        if (!textures && isReady(texturesFuture)) {
+            textures = texturesFuture.get();
+            if (options.textureArrays) {
+                packTextureArrays(*textures, object);
+            }
+        }
+        if (textures) {
+            while (uploadedTextures < textures->size() && withinBudget()) {
+                auto& [name, decoded] = (*textures)[uploadedTextures++];
+                uploadTexture(name, decoded, object.textures);
+            }
+        }
+    } catch (const std::exception& e) {
+        status = Status::Failed;
+        error = e.what();
+        LOG("Failed to load " << path << ": " << error);
+        return status;
+    }
+
+    if (prepared && object.shapes.size() == preparedShapes.size() &&
+        textures && uploadedTextures == textures->size())
+    {
+        status = Status::Done;
+        // unmaps the mesh cache
+        preparedShapes.clear();
+        prepared.reset();
+        textures.reset();
+        LOG("Loaded " << path << " in the background in "
+                      << timer.elapsedMilliseconds() << " ms");
+    }
+    return status;
+}
+
+AsyncObjectLoad::Status AsyncObjectLoad::getStatus() const
+{
+    return status;
+}
+
+const std::string& AsyncObjectLoad::getError() const
+{
+    return error;
+}
+
+size_t AsyncObjectLoad::getUploadedShapeCount() const
+{
+    return object.shapes.size();
+}
+
+size_t AsyncObjectLoad::getShapeCount() const
+{
+    return prepared ? preparedShapes.size() : object.shapes.size();
 }
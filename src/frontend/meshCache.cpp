@@ -0,0 +1,586 @@
+#include "frontend/meshCache.hpp"
+
+#include "frontend/meshOptimize.hpp"
+#include "util/cacheFile.hpp"
+#include "util/error.hpp"
+#include "util/hash.hpp"
+#include "util/logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+namespace
+{
+constexpr std::array<char, 8> cacheMagic{'O', 'B', 'J', 'C', 'A', 'C', 'H', 'E'};
+
+struct StringRef
+{
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct FileHeader
+{
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t vertexSize;
+    // a VertexFormat
+    uint32_t vertexFormat;
+    uint32_t reserved;
+
+    // the .obj this cache was built from
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t sourceHash;
+
+    uint32_t shapeCount;
+    uint32_t materialCount;
+    uint32_t dependencyCount;
+    uint32_t stringsSize;
+
+    uint64_t shapesOffset;
+    uint64_t materialsOffset;
+    uint64_t dependenciesOffset;
+    uint64_t stringsOffset;
+};
+
+struct ShapeRecord
+{
+    uint64_t vertexOffset;
+    uint64_t vertexCount;
+    uint64_t indexOffset;
+    uint64_t indexCount;
+    uint64_t meshletOffset;
+    uint64_t meshletCount;
+    uint64_t lodOffset;
+    uint64_t lodCount;
+    // as many as the vertices in a `VertexFormat::Quantized` cache, none
+    // otherwise
+    uint64_t quantizedOffset;
+    uint64_t quantizedCount;
+    QuantizationTransform quantization;
+    int32_t materialId;
+    uint32_t reserved;
+};
+
+static_assert(std::is_trivially_copyable_v<QuantizationTransform>);
+
+// Only the material properties the renderer uses are kept.
+struct MaterialRecord
+{
+    StringRef name;
+    StringRef diffuseTexname;
+    std::array<float, 3> ambient;
+    std::array<float, 3> diffuse;
+    std::array<float, 3> specular;
+    float shininess;
+    float dissolve;
+    int32_t illum;
+};
+
+// A file (.mtl) the cached data depends on, relative to the .obj's directory.
+// One that was missing is recorded too, so the cache goes stale once it is
+// added.
+struct DependencyRecord
+{
+    StringRef path;
+    uint64_t size;
+    int64_t mtime;
+    // 1 if the file did not exist; size and mtime are then 0
+    uint32_t missing;
+    uint32_t reserved;
+};
+
+// Names listed on `mtllib` lines, in file order.
+std::vector<std::string> findMaterialLibraries(const MappedFile& obj)
+{
+    std::vector<std::string> libraries;
+    std::string_view text{reinterpret_cast<const char*>(obj.data()),
+                          obj.size()};
+
+    auto isSpace = [](char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    };
+
+    while (!text.empty()) {
+        size_t lineEnd = text.find('\n');
+        std::string_view line = text.substr(0, lineEnd);
+        text = lineEnd == std::string_view::npos ? std::string_view{}
+                                                 : text.substr(lineEnd + 1);
+
+        while (!line.empty() && isSpace(line.front())) {
+            line.remove_prefix(1);
+        }
+        if (!line.starts_with("mtllib") || line.size() < 7 ||
+            !isSpace(line[6]))
+        {
+            continue;
+        }
+        line.remove_prefix(7);
+
+        while (!line.empty()) {
+            while (!line.empty() && isSpace(line.front())) {
+                line.remove_prefix(1);
+            }
+            size_t tokenEnd = 0;
+            while (tokenEnd < line.size() && !isSpace(line[tokenEnd])) {
+                ++tokenEnd;
+            }
+            if (tokenEnd > 0) {
+                libraries.emplace_back(line.substr(0, tokenEnd));
+            }
+            line.remove_prefix(tokenEnd);
+        }
+    }
+
+    return libraries;
+}
+
+class StringTable
+{
+    std::string blob;
+
+  public:
+    StringRef add(std::string_view str)
+    {
+        StringRef ref{.offset = static_cast<uint32_t>(blob.size()),
+                      .length = static_cast<uint32_t>(str.size())};
+        blob.append(str);
+        return ref;
+    }
+
+    [[nodiscard]] const std::string& data() const
+    {
+        return blob;
+    }
+};
+
+std::optional<std::string_view> lookupString(std::string_view strings,
+                                             StringRef ref)
+{
+    if (ref.offset > strings.size() ||
+        strings.size() - ref.offset < ref.length)
+    {
+        return {};
+    }
+    return strings.substr(ref.offset, ref.length);
+}
+} // namespace
+
+MeshCache::MeshCache(Storage storage) : storage{std::move(storage)}
+{
+}
+
+std::span<const std::byte> MeshCache::bytes() const
+{
+    if (const auto* mapped = std::get_if<MappedFile>(&storage)) {
+        return mapped->bytes();
+    }
+    return std::get<std::vector<std::byte>>(storage);
+}
+
+std::filesystem::path MeshCache::pathFor(const std::filesystem::path& objPath,
+                                         VertexFormat format)
+{
+    std::filesystem::path cachePath = objPath;
+    cachePath += format == VertexFormat::Quantized ? ".quantized.meshcache"
+                                                   : ".meshcache";
+    return cachePath;
+}
+
+std::optional<MeshCache> MeshCache::open(const std::filesystem::path& objPath,
+                                         VertexFormat format)
+{
+    const std::filesystem::path cachePath = pathFor(objPath, format);
+    const std::filesystem::path parentDir =
+      objPath.has_parent_path() ? objPath.parent_path() : "";
+
+    std::error_code ec;
+    if (!std::filesystem::exists(cachePath, ec)) {
+        return {};
+    }
+
+    auto sourceStamp = CacheFile::stampOf(objPath);
+    if (!sourceStamp) {
+        return {};
+    }
+
+    try {
+        MeshCache cache{MappedFile{cachePath}};
+        std::span<const std::byte> bytes = cache.bytes();
+
+        FileHeader header{};
+        if (!CacheFile::readRecord(bytes, 0, header) ||
+            header.magic != cacheMagic ||
+            header.version != formatVersion ||
+            header.vertexSize != sizeof(LoadedObjVertex) ||
+            header.vertexFormat != static_cast<uint32_t>(format))
+        {
+            LOG("Ignoring mesh cache " << cachePath
+                                       << ": unknown or outdated format");
+            return {};
+        }
+
+        //
+        // Is it still the same source file?
+        //
+        bool touched = false;
+        if (!CacheFile::matchesSource(objPath, *sourceStamp, header.sourceSize,
+                                      header.sourceMtime, header.sourceHash,
+                                      touched))
+        {
+            return {};
+        }
+
+        if (!CacheFile::validArray<char>(bytes, header.stringsOffset,
+                                         header.stringsSize))
+        {
+            LOG("Ignoring mesh cache " << cachePath << ": corrupt");
+            return {};
+        }
+        std::string_view strings{
+          reinterpret_cast<const char*>(bytes.data() + header.stringsOffset),
+          header.stringsSize};
+
+        //
+        // Are the material libraries unchanged?
+        //
+        for (uint32_t i = 0; i < header.dependencyCount; ++i) {
+            DependencyRecord dep{};
+            if (!CacheFile::readRecord(bytes,
+                                       header.dependenciesOffset +
+                                         (i * sizeof(DependencyRecord)),
+                                       dep))
+            {
+                LOG("Ignoring mesh cache " << cachePath << ": corrupt");
+                return {};
+            }
+            auto depPath = lookupString(strings, dep.path);
+            if (!depPath) {
+                LOG("Ignoring mesh cache " << cachePath << ": corrupt");
+                return {};
+            }
+            auto depStamp = CacheFile::stampOf(parentDir / *depPath);
+            bool unchanged = dep.missing != 0
+                               ? !depStamp
+                               : depStamp && depStamp->size == dep.size &&
+                                   depStamp->mtime == dep.mtime;
+            if (!unchanged) {
+                return {};
+            }
+        }
+
+        if (!cache.readContents()) {
+            LOG("Ignoring mesh cache " << cachePath << ": corrupt");
+            return {};
+        }
+
+        if (touched) {
+            // Source was touched but not changed: remember the new mtime so
+            // we don't re-hash it next time
+            CacheFile::refreshMtime(cachePath,
+                                    offsetof(FileHeader, sourceMtime),
+                                    sourceStamp->mtime);
+        }
+
+        return cache;
+    } catch (const std::exception& e) {
+        LOG("Ignoring mesh cache " << cachePath << ": " << e.what());
+        return {};
+    }
+}
+
+bool MeshCache::readContents()
+{
+    std::span<const std::byte> bytes = this->bytes();
+    FileHeader header{};
+    if (!CacheFile::readRecord(bytes, 0, header) ||
+        !CacheFile::validArray<char>(bytes, header.stringsOffset,
+                                     header.stringsSize))
+    {
+        return false;
+    }
+    std::string_view strings{
+      reinterpret_cast<const char*>(bytes.data() + header.stringsOffset),
+      header.stringsSize};
+    if (header.vertexFormat != static_cast<uint32_t>(VertexFormat::Float) &&
+        header.vertexFormat != static_cast<uint32_t>(VertexFormat::Quantized))
+    {
+        return false;
+    }
+    vertexFormat = static_cast<VertexFormat>(header.vertexFormat);
+    bool quantized = vertexFormat == VertexFormat::Quantized;
+
+    //
+    // Materials
+    //
+    materials.reserve(header.materialCount);
+    for (uint32_t i = 0; i < header.materialCount; ++i) {
+        MaterialRecord rec{};
+        if (!CacheFile::readRecord(bytes,
+                                   header.materialsOffset +
+                                     (i * sizeof(MaterialRecord)),
+                                   rec))
+        {
+            return false;
+        }
+        auto name = lookupString(strings, rec.name);
+        auto diffuseTexname = lookupString(strings, rec.diffuseTexname);
+        if (!name || !diffuseTexname) {
+            return false;
+        }
+
+        tinyobj::material_t mat{};
+        mat.name = *name;
+        mat.diffuse_texname = *diffuseTexname;
+        std::ranges::copy(rec.ambient, mat.ambient);
+        std::ranges::copy(rec.diffuse, mat.diffuse);
+        std::ranges::copy(rec.specular, mat.specular);
+        mat.shininess = rec.shininess;
+        mat.dissolve = rec.dissolve;
+        mat.illum = rec.illum;
+        materials.push_back(std::move(mat));
+    }
+
+    //
+    // Shapes: views straight into the bytes
+    //
+    shapes.reserve(header.shapeCount);
+    for (uint32_t i = 0; i < header.shapeCount; ++i) {
+        ShapeRecord rec{};
+        if (!CacheFile::readRecord(
+              bytes, header.shapesOffset + (i * sizeof(ShapeRecord)), rec) ||
+            rec.vertexCount > maxShortIndexVertices ||
+            !CacheFile::validArray<LoadedObjVertex>(bytes, rec.vertexOffset,
+                                                    rec.vertexCount) ||
+            !CacheFile::validArray<uint16_t>(bytes, rec.indexOffset,
+                                             rec.indexCount) ||
+            !CacheFile::validArray<Meshlet>(bytes, rec.meshletOffset,
+                                            rec.meshletCount) ||
+            !CacheFile::validArray<ShapeLod>(bytes, rec.lodOffset,
+                                             rec.lodCount) ||
+            rec.quantizedCount != (quantized ? rec.vertexCount : 0) ||
+            !CacheFile::validArray<QuantizedObjVertex>(
+              bytes, rec.quantizedOffset, rec.quantizedCount))
+        {
+            return false;
+        }
+
+        shapes.push_back(ShapeView{
+          .vertices = {reinterpret_cast<const LoadedObjVertex*>(
+                         bytes.data() + rec.vertexOffset),
+                       rec.vertexCount},
+          .indices = {reinterpret_cast<const uint16_t*>(bytes.data() +
+                                                        rec.indexOffset),
+                      rec.indexCount},
+          .meshlets = {reinterpret_cast<const Meshlet*>(bytes.data() +
+                                                        rec.meshletOffset),
+                       rec.meshletCount},
+          .lods = {reinterpret_cast<const ShapeLod*>(bytes.data() +
+                                                     rec.lodOffset),
+                   rec.lodCount},
+          .quantizedVertices = {reinterpret_cast<const QuantizedObjVertex*>(
+                                  bytes.data() + rec.quantizedOffset),
+                                rec.quantizedCount},
+          .quantization = rec.quantization,
+          .materialId = rec.materialId});
+    }
+    return true;
+}
+
+MeshCache MeshCache::build(const std::filesystem::path& objPath,
+                           const ImportedObject& object,
+                           std::span<const QuantizedShape> quantized)
+{
+    if (!quantized.empty() && quantized.size() != object.shapes.size()) {
+        throw IrrecoverableError{"Mesh cache of " + objPath.string() +
+                                 " given quantized vertices of " +
+                                 std::to_string(quantized.size()) + " of " +
+                                 std::to_string(object.shapes.size()) +
+                                 " shapes"};
+    }
+
+    const std::filesystem::path parentDir =
+      objPath.has_parent_path() ? objPath.parent_path() : "";
+
+    auto sourceStamp = CacheFile::stampOf(objPath);
+    if (!sourceStamp) {
+        throw IrrecoverableError{"Could not stat " + objPath.string()};
+    }
+
+    StringTable strings;
+    FileHeader header{};
+    header.magic = cacheMagic;
+    header.version = formatVersion;
+    header.vertexSize = sizeof(LoadedObjVertex);
+    header.vertexFormat = static_cast<uint32_t>(
+      quantized.empty() ? VertexFormat::Float : VertexFormat::Quantized);
+    header.sourceSize = sourceStamp->size;
+    header.sourceMtime = sourceStamp->mtime;
+
+    std::vector<DependencyRecord> dependencies;
+    {
+        MappedFile source{objPath};
+        source.adviseSequential();
+        header.sourceHash = Hash::bytes(source.data(), source.size());
+
+        for (const auto& library : findMaterialLibraries(source)) {
+            auto stamp = CacheFile::stampOf(parentDir / library);
+            dependencies.push_back(DependencyRecord{
+              .path = strings.add(library),
+              .size = stamp ? stamp->size : 0,
+              .mtime = stamp ? stamp->mtime : 0,
+              .missing = stamp ? 0U : 1U,
+              .reserved = 0});
+        }
+    }
+
+    std::vector<MaterialRecord> materials;
+    materials.reserve(object.materials.size());
+    for (const auto& mat : object.materials) {
+        MaterialRecord rec{};
+        rec.name = strings.add(mat.name);
+        rec.diffuseTexname = strings.add(mat.diffuse_texname);
+        std::copy_n(mat.ambient, 3, rec.ambient.begin());
+        std::copy_n(mat.diffuse, 3, rec.diffuse.begin());
+        std::copy_n(mat.specular, 3, rec.specular.begin());
+        rec.shininess = mat.shininess;
+        rec.dissolve = mat.dissolve;
+        rec.illum = mat.illum;
+        materials.push_back(rec);
+    }
+
+    //
+    // Lay out the file
+    //
+    header.shapeCount = static_cast<uint32_t>(object.shapes.size());
+    header.materialCount = static_cast<uint32_t>(materials.size());
+    header.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    header.stringsSize = static_cast<uint32_t>(strings.data().size());
+
+    uint64_t offset = CacheFile::alignUp(sizeof(FileHeader));
+    header.shapesOffset = offset;
+    offset =
+      CacheFile::alignUp(offset + (header.shapeCount * sizeof(ShapeRecord)));
+    header.materialsOffset = offset;
+    offset = CacheFile::alignUp(offset + (header.materialCount *
+                                          sizeof(MaterialRecord)));
+    header.dependenciesOffset = offset;
+    offset = CacheFile::alignUp(offset + (header.dependencyCount *
+                                          sizeof(DependencyRecord)));
+    header.stringsOffset = offset;
+    offset = CacheFile::alignUp(offset + header.stringsSize);
+
+    std::vector<ShapeRecord> shapeRecords;
+    shapeRecords.reserve(object.shapes.size());
+    for (size_t i = 0; i < object.shapes.size(); ++i) {
+        const auto& shape = object.shapes[i];
+        if (shape.vertices.size() > maxShortIndexVertices) {
+            throw IrrecoverableError{
+              "Shape of " + objPath.string() +
+              " has too many vertices for 16-bit indices"};
+        }
+        ShapeRecord rec{};
+        rec.vertexOffset = offset;
+        rec.vertexCount = shape.vertices.size();
+        offset = CacheFile::alignUp(offset + (rec.vertexCount *
+                                              sizeof(LoadedObjVertex)));
+        rec.indexOffset = offset;
+        rec.indexCount = shape.indices.size();
+        offset =
+          CacheFile::alignUp(offset + (rec.indexCount * sizeof(uint16_t)));
+        rec.meshletOffset = offset;
+        rec.meshletCount = shape.meshlets.size();
+        offset =
+          CacheFile::alignUp(offset + (rec.meshletCount * sizeof(Meshlet)));
+        rec.lodOffset = offset;
+        rec.lodCount = shape.lods.size();
+        offset = CacheFile::alignUp(offset + (rec.lodCount * sizeof(ShapeLod)));
+        rec.quantizedOffset = offset;
+        if (!quantized.empty()) {
+            rec.quantizedCount = quantized[i].vertices.size();
+            rec.quantization = quantized[i].transform;
+        }
+        offset = CacheFile::alignUp(offset + (rec.quantizedCount *
+                                              sizeof(QuantizedObjVertex)));
+        rec.materialId = shape.materialId;
+        shapeRecords.push_back(rec);
+    }
+
+    //
+    // Fill it in; padding stays zero
+    //
+    std::vector<std::byte> bytes(offset);
+    auto place = [&bytes](uint64_t at, const void* data, size_t size) {
+        if (size > 0) {
+            std::memcpy(bytes.data() + at, data, size);
+        }
+    };
+    place(0, &header, sizeof(header));
+    place(header.shapesOffset, shapeRecords.data(),
+          shapeRecords.size() * sizeof(ShapeRecord));
+    place(header.materialsOffset, materials.data(),
+          materials.size() * sizeof(MaterialRecord));
+    place(header.dependenciesOffset, dependencies.data(),
+          dependencies.size() * sizeof(DependencyRecord));
+    place(header.stringsOffset, strings.data().data(), strings.data().size());
+
+    for (size_t i = 0; i < object.shapes.size(); ++i) {
+        const auto& shape = object.shapes[i];
+        const ShapeRecord& rec = shapeRecords[i];
+        place(rec.vertexOffset, shape.vertices.data(),
+              shape.vertices.size() * sizeof(LoadedObjVertex));
+        // every index fits, as there are no more vertices than that
+        for (size_t k = 0; k < shape.indices.size(); ++k) {
+            auto index = static_cast<uint16_t>(shape.indices[k]);
+            place(rec.indexOffset + (k * sizeof(uint16_t)), &index,
+                  sizeof(index));
+        }
+        place(rec.meshletOffset, shape.meshlets.data(),
+              shape.meshlets.size() * sizeof(Meshlet));
+        place(rec.lodOffset, shape.lods.data(),
+              shape.lods.size() * sizeof(ShapeLod));
+        if (!quantized.empty()) {
+            place(rec.quantizedOffset, quantized[i].vertices.data(),
+                  quantized[i].vertices.size() * sizeof(QuantizedObjVertex));
+        }
+    }
+
+    MeshCache cache{std::move(bytes)};
+    if (!cache.readContents()) {
+        throw IrrecoverableError{"Built a corrupt mesh cache of " +
+                                 objPath.string()};
+    }
+    return cache;
+}
+
+void MeshCache::save(const std::filesystem::path& objPath) const
+{
+    // Written to a temporary and swapped in, so a crash mid-write never
+    // leaves a truncated cache behind
+    CacheFile::Writer out{pathFor(objPath, vertexFormat), "mesh cache"};
+    std::span<const std::byte> contents = bytes();
+    out.write(contents.data(), contents.size());
+    out.commit();
+}
+
+const std::vector<MeshCache::ShapeView>& MeshCache::getShapes() const
+{
+    return shapes;
+}
+
+const std::vector<tinyobj::material_t>& MeshCache::getMaterials() const
+{
+    return materials;
+}
+
+VertexFormat MeshCache::getVertexFormat() const
+{
+    return vertexFormat;
+}
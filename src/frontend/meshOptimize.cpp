@@ -0,0 +1,356 @@
+#include "frontend/meshOptimize.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace
+{
+// FIFO post-transform cache: a vertex is resident while fewer than
+// `cacheSize` misses happened since it was loaded. Flushing just advances
+// the clock, so it is O(1).
+class CacheSimulator
+{
+    std::vector<uint32_t> loadedAt;
+    uint32_t clock;
+    uint32_t cacheSize;
+
+  public:
+    CacheSimulator(size_t vertexCount, size_t size)
+      : loadedAt(vertexCount, 0), clock(static_cast<uint32_t>(size) + 1),
+        cacheSize(static_cast<uint32_t>(size))
+    {
+    }
+
+    // Returns whether `vertex` had to be transformed.
+    bool access(uint32_t vertex)
+    {
+        if (clock - loadedAt[vertex] > cacheSize) {
+            loadedAt[vertex] = clock++;
+            return true;
+        }
+        return false;
+    }
+
+    size_t accessTriangle(const uint32_t* triangle)
+    {
+        return static_cast<size_t>(access(triangle[0])) +
+               static_cast<size_t>(access(triangle[1])) +
+               static_cast<size_t>(access(triangle[2]));
+    }
+
+    void flush()
+    {
+        clock += cacheSize + 1;
+    }
+};
+} // anonymous namespace
+
+VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices,
+                                    size_t vertexCount, size_t cacheSize)
+{
+    VertexCacheStats stats;
+    stats.triangles = indices.size() / 3;
+    stats.vertices = vertexCount;
+
+    CacheSimulator cache{vertexCount, cacheSize};
+    for (uint32_t index : indices) {
+        stats.transformed += static_cast<size_t>(cache.access(index));
+    }
+    return stats;
+}
+
+void optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount,
+                         size_t cacheSize)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Triangles using each vertex (compressed rows), and how many of those
+    // are still to be emitted
+    std::vector<uint32_t> live(vertexCount, 0);
+    for (uint32_t index : indices) {
+        ++live[index];
+    }
+    std::vector<uint32_t> firstAdjacent(vertexCount + 1, 0);
+    std::inclusive_scan(live.begin(), live.end(), firstAdjacent.begin() + 1);
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> cursor(firstAdjacent.begin(),
+                                     firstAdjacent.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<uint32_t> loadedAt(vertexCount, 0);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    const auto size = static_cast<uint32_t>(cacheSize);
+    uint32_t clock = size + 1;
+    size_t scan = 0;
+    int64_t fan = 0;
+
+    while (fan >= 0) {
+        // Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        auto current = static_cast<uint32_t>(fan);
+        for (uint32_t a = firstAdjacent[current];
+             a < firstAdjacent[current + 1]; ++a)
+        {
+            uint32_t t = adjacency[a];
+            if (emitted[t] != 0) {
+                continue;
+            }
+            for (size_t k = 0; k < 3; ++k) {
+                uint32_t v = indices[(3 * t) + k];
+                result.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (clock - loadedAt[v] > size) {
+                    loadedAt[v] = clock++;
+                }
+            }
+            emitted[t] = 1;
+        }
+
+        // Next fan: the oldest candidate that will still be in the cache
+        // after emitting its remaining triangles
+        fan = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            if (clock - loadedAt[v] + (2 * live[v]) <= size) {
+                priority = clock - loadedAt[v];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fan = v;
+            }
+        }
+
+        // Dead end: back up to a recently used vertex, or scan for any
+        while (fan < 0 && !deadEnds.empty()) {
+            uint32_t v = deadEnds.back();
+            deadEnds.pop_back();
+            if (live[v] > 0) {
+                fan = v;
+            }
+        }
+        while (fan < 0 && scan < vertexCount) {
+            if (live[scan] > 0) {
+                fan = static_cast<int64_t>(scan);
+            }
+            ++scan;
+        }
+    }
+
+    std::ranges::copy(result, indices.begin());
+}
+
+void optimizeOverdraw(std::span<uint32_t> indices,
+                      std::span<const LoadedObjVertex> vertices,
+                      float threshold)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // Hard cluster boundaries: triangles where the cache-optimised order
+    // restarts (all three vertices miss)
+    std::vector<size_t> hardStarts;
+    {
+        CacheSimulator cache{vertices.size(), vertexCacheSize};
+        for (size_t t = 0; t < triangleCount; ++t) {
+            if (cache.accessTriangle(&indices[3 * t]) == 3 || t == 0) {
+                hardStarts.push_back(t);
+            }
+        }
+        hardStarts.push_back(triangleCount);
+    }
+
+    // Soft boundaries: split hard clusters further wherever the current
+    // piece, drawn from a cold cache, is already about as cache friendly as
+    // the whole cluster
+    std::vector<size_t> clusterStarts;
+    {
+        CacheSimulator cache{vertices.size(), vertexCacheSize};
+        for (size_t h = 0; h + 1 < hardStarts.size(); ++h) {
+            size_t begin = hardStarts[h];
+            size_t end = hardStarts[h + 1];
+
+            cache.flush();
+            size_t clusterMisses = 0;
+            for (size_t t = begin; t < end; ++t) {
+                clusterMisses += cache.accessTriangle(&indices[3 * t]);
+            }
+            double limit = threshold * static_cast<double>(clusterMisses) /
+                           static_cast<double>(end - begin);
+
+            cache.flush();
+            clusterStarts.push_back(begin);
+            size_t misses = 0;
+            size_t triangles = 0;
+            for (size_t t = begin; t + 1 < end; ++t) {
+                misses += cache.accessTriangle(&indices[3 * t]);
+                ++triangles;
+                if (static_cast<double>(misses) <=
+                    limit * static_cast<double>(triangles))
+                {
+                    // the piece will be drawn on its own, so starts cold
+                    clusterStarts.push_back(t + 1);
+                    misses = 0;
+                    triangles = 0;
+                    cache.flush();
+                }
+            }
+        }
+        clusterStarts.push_back(triangleCount);
+    }
+
+    const size_t clusterCount = clusterStarts.size() - 1;
+    if (clusterCount < 2) {
+        return;
+    }
+
+    // Area weighted centroid and normal of every cluster and the whole mesh
+    std::vector<glm::vec3> centroids(clusterCount, glm::vec3{0.0F});
+    std::vector<glm::vec3> normals(clusterCount, glm::vec3{0.0F});
+    std::vector<float> areas(clusterCount, 0.0F);
+    glm::vec3 meshCentroid{0.0F};
+    float meshArea = 0.0F;
+
+    for (size_t c = 0; c < clusterCount; ++c) {
+        for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t) {
+            glm::vec3 p0 = vertices[indices[3 * t]].position;
+            glm::vec3 p1 = vertices[indices[(3 * t) + 1]].position;
+            glm::vec3 p2 = vertices[indices[(3 * t) + 2]].position;
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(n);
+
+            centroids[c] += (p0 + p1 + p2) * (area / 3.0F);
+            normals[c] += n;
+            areas[c] += area;
+        }
+        meshCentroid += centroids[c];
+        meshArea += areas[c];
+        if (areas[c] > 0.0F) {
+            centroids[c] /= areas[c];
+        }
+    }
+    if (meshArea > 0.0F) {
+        meshCentroid /= meshArea;
+    }
+
+    // Clusters facing away from the centre are the likely occluders
+    std::vector<float> sortKeys(clusterCount, 0.0F);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        float normalLength = glm::length(normals[c]);
+        if (normalLength > 0.0F) {
+            sortKeys[c] = glm::dot(centroids[c] - meshCentroid,
+                                   normals[c] / normalLength);
+        }
+    }
+
+    std::vector<size_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), size_t{0});
+    std::ranges::stable_sort(order, [&sortKeys](size_t a, size_t b) {
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (size_t c : order) {
+        result.insert(result.end(),
+                      indices.begin() +
+                        static_cast<std::ptrdiff_t>(3 * clusterStarts[c]),
+                      indices.begin() +
+                        static_cast<std::ptrdiff_t>(3 * clusterStarts[c + 1]));
+    }
+    std::ranges::copy(result, indices.begin());
+}
+
+void optimizeVertexFetch(ImportedShape& shape)
+{
+    constexpr uint32_t unused = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> remap(shape.vertices.size(), unused);
+    std::vector<LoadedObjVertex> reordered;
+    reordered.reserve(shape.vertices.size());
+
+    for (uint32_t& index : shape.indices) {
+        if (remap[index] == unused) {
+            remap[index] = static_cast<uint32_t>(reordered.size());
+            reordered.push_back(shape.vertices[index]);
+        }
+        index = remap[index];
+    }
+    shape.vertices = std::move(reordered);
+}
+
+void optimizeShape(ImportedShape& shape)
+{
+    optimizeVertexCache(shape.indices, shape.vertices.size());
+    optimizeOverdraw(shape.indices, shape.vertices);
+    optimizeVertexFetch(shape);
+}
+
+std::vector<ImportedShape> splitForShortIndices(ImportedShape shape,
+                                                size_t maxVertices)
+{
+    std::vector<ImportedShape> parts;
+    if (shape.vertices.size() <= maxVertices) {
+        parts.push_back(std::move(shape));
+        return parts;
+    }
+
+    constexpr uint32_t unused = std::numeric_limits<uint32_t>::max();
+    // local index in the current part; `usedIn` says which part set it
+    std::vector<uint32_t> local(shape.vertices.size(), unused);
+    std::vector<uint32_t> usedIn(shape.vertices.size(), unused);
+
+    ImportedShape part;
+    part.materialId = shape.materialId;
+    for (size_t t = 0; t + 2 < shape.indices.size(); t += 3) {
+        const uint32_t* triangle = &shape.indices[t];
+        auto partIndex = static_cast<uint32_t>(parts.size());
+
+        size_t newVertices = 0;
+        for (size_t k = 0; k < 3; ++k) {
+            newVertices += static_cast<size_t>(usedIn[triangle[k]] != partIndex);
+        }
+        if (part.vertices.size() + newVertices > maxVertices) {
+            parts.push_back(std::move(part));
+            part = {};
+            part.materialId = shape.materialId;
+            partIndex = static_cast<uint32_t>(parts.size());
+        }
+
+        for (size_t k = 0; k < 3; ++k) {
+            uint32_t v = triangle[k];
+            if (usedIn[v] != partIndex) {
+                usedIn[v] = partIndex;
+                local[v] = static_cast<uint32_t>(part.vertices.size());
+                part.vertices.push_back(shape.vertices[v]);
+            }
+            part.indices.push_back(local[v]);
+        }
+    }
+    if (!part.indices.empty()) {
+        parts.push_back(std::move(part));
+    }
+    return parts;
+}
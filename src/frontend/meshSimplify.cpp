@@ -0,0 +1,376 @@
+#include "frontend/meshSimplify.hpp"
+
+#include "frontend/meshOptimize.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+namespace
+{
+// Sum of squared distances to a set of planes, weighted by triangle area.
+// Symmetric 3x3 matrix A, vector b and constant c of `pᵀAp + 2bᵀp + c`.
+struct Quadric
+{
+    double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+    double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+    double c = 0.0;
+    double weight = 0.0;
+
+    // The plane `dot(n, p) + d = 0`, n normalised.
+    static Quadric fromPlane(glm::vec3 n, float d, double weight)
+    {
+        Quadric q;
+        q.a00 = weight * n.x * n.x;
+        q.a01 = weight * n.x * n.y;
+        q.a02 = weight * n.x * n.z;
+        q.a11 = weight * n.y * n.y;
+        q.a12 = weight * n.y * n.z;
+        q.a22 = weight * n.z * n.z;
+        q.b0 = weight * n.x * d;
+        q.b1 = weight * n.y * d;
+        q.b2 = weight * n.z * d;
+        q.c = weight * d * d;
+        q.weight = weight;
+        return q;
+    }
+
+    Quadric& operator+=(const Quadric& o)
+    {
+        a00 += o.a00;
+        a01 += o.a01;
+        a02 += o.a02;
+        a11 += o.a11;
+        a12 += o.a12;
+        a22 += o.a22;
+        b0 += o.b0;
+        b1 += o.b1;
+        b2 += o.b2;
+        c += o.c;
+        weight += o.weight;
+        return *this;
+    }
+
+    // Mean squared distance of `p` to the planes.
+    [[nodiscard]] double evaluate(glm::vec3 p) const
+    {
+        double x = p.x;
+        double y = p.y;
+        double z = p.z;
+        double e = (a00 * x * x) + (a11 * y * y) + (a22 * z * z) +
+                   (2.0 * ((a01 * x * y) + (a02 * x * z) + (a12 * y * z))) +
+                   (2.0 * ((b0 * x) + (b1 * y) + (b2 * z))) + c;
+        return weight > 0.0 ? std::max(e, 0.0) / weight : 0.0;
+    }
+};
+
+struct Collapse
+{
+    float cost;
+    uint32_t from;
+    uint32_t to;
+};
+
+glm::vec3 positionOf(std::span<const LoadedObjVertex> vertices, uint32_t i)
+{
+    return vertices[i].position;
+}
+
+bool isDegenerate(const uint32_t* t)
+{
+    return t[0] == t[1] || t[1] == t[2] || t[0] == t[2];
+}
+
+// Vertices with an edge that is not shared by exactly two consistently wound
+// triangles: open borders, seams and non-manifold bits.
+std::vector<uint8_t> findLockedVertices(std::span<const uint32_t> indices,
+                                        size_t vertexCount)
+{
+    auto key = [](uint32_t a, uint32_t b) {
+        return (static_cast<uint64_t>(a) << 32) | b;
+    };
+
+    std::vector<uint64_t> edges;
+    edges.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (size_t k = 0; k < 3; ++k) {
+            edges.push_back(key(indices[i + k], indices[i + ((k + 1) % 3)]));
+        }
+    }
+    std::ranges::sort(edges);
+
+    std::vector<uint8_t> locked(vertexCount, 0);
+    for (size_t i = 0; i < edges.size(); ++i) {
+        auto a = static_cast<uint32_t>(edges[i] >> 32);
+        auto b = static_cast<uint32_t>(edges[i]);
+        bool repeated = (i > 0 && edges[i - 1] == edges[i]) ||
+                        (i + 1 < edges.size() && edges[i + 1] == edges[i]);
+        auto opposite = std::ranges::equal_range(edges, key(b, a));
+        if (repeated || opposite.size() != 1) {
+            locked[a] = 1;
+            locked[b] = 1;
+        }
+    }
+    return locked;
+}
+
+// Triangles using each vertex, as compressed rows.
+struct Adjacency
+{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+
+    Adjacency(std::span<const uint32_t> indices, size_t vertexCount)
+      : offsets(vertexCount + 1, 0), triangles(indices.size())
+    {
+        for (uint32_t index : indices) {
+            ++offsets[index + 1];
+        }
+        for (size_t v = 0; v < vertexCount; ++v) {
+            offsets[v + 1] += offsets[v];
+        }
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    [[nodiscard]] std::span<const uint32_t> of(uint32_t vertex) const
+    {
+        return std::span<const uint32_t>{triangles}.subspan(
+          offsets[vertex], offsets[vertex + 1] - offsets[vertex]);
+    }
+};
+
+// Whether collapsing `from` onto `to` keeps the surface a manifold (the two
+// share exactly the two neighbours opposite their edge) and flips or
+// squashes none of the triangles that remain.
+bool canCollapse(const Collapse& collapse, std::span<const uint32_t> indices,
+                 std::span<const LoadedObjVertex> vertices,
+                 const Adjacency& adjacency, std::vector<uint32_t>& neighbours)
+{
+    size_t shared = 0;
+    for (uint32_t t : adjacency.of(collapse.from)) {
+        const uint32_t* tri = &indices[3 * size_t{t}];
+        if (tri[0] == collapse.to || tri[1] == collapse.to ||
+            tri[2] == collapse.to)
+        {
+            ++shared;
+            continue;
+        }
+
+        glm::vec3 p[3];
+        glm::vec3 q[3];
+        for (size_t k = 0; k < 3; ++k) {
+            p[k] = positionOf(vertices, tri[k]);
+            q[k] = tri[k] == collapse.from ? positionOf(vertices, collapse.to)
+                                           : p[k];
+        }
+        glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+        glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+        // reject turning the normal by more than ~75 degrees
+        if (glm::dot(before, after) <=
+            0.25F * glm::length(before) * glm::length(after))
+        {
+            return false;
+        }
+    }
+    if (shared != 2) {
+        return false;
+    }
+
+    // Link condition: any other common neighbour would pinch the surface
+    auto isNeighbourOfTo = [&](uint32_t v) {
+        return std::ranges::any_of(adjacency.of(collapse.to), [&](uint32_t t) {
+            const uint32_t* tri = &indices[3 * size_t{t}];
+            return tri[0] == v || tri[1] == v || tri[2] == v;
+        });
+    };
+    neighbours.clear();
+    for (uint32_t t : adjacency.of(collapse.from)) {
+        for (size_t k = 0; k < 3; ++k) {
+            uint32_t v = indices[(3 * size_t{t}) + k];
+            if (v != collapse.from && v != collapse.to) {
+                neighbours.push_back(v);
+            }
+        }
+    }
+    std::ranges::sort(neighbours);
+    auto [last, end] = std::ranges::unique(neighbours);
+    neighbours.erase(last, end);
+    return std::ranges::count_if(neighbours, isNeighbourOfTo) == 2;
+}
+} // anonymous namespace
+
+SimplifiedMesh simplifyMesh(std::span<const uint32_t> indices,
+                            std::span<const LoadedObjVertex> vertices,
+                            size_t targetIndexCount)
+{
+    SimplifiedMesh result;
+    result.indices.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        if (!isDegenerate(&indices[i])) {
+            result.indices.insert(result.indices.end(), &indices[i],
+                                  &indices[i] + 3);
+        }
+    }
+    std::vector<uint32_t>& current = result.indices;
+    const size_t vertexCount = vertices.size();
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < current.size(); i += 3) {
+        glm::vec3 a = positionOf(vertices, current[i]);
+        glm::vec3 b = positionOf(vertices, current[i + 1]);
+        glm::vec3 c = positionOf(vertices, current[i + 2]);
+        glm::vec3 n = glm::cross(b - a, c - a);
+        float doubleArea = glm::length(n);
+        if (doubleArea == 0.0F) {
+            continue;
+        }
+        n /= doubleArea;
+        Quadric q = Quadric::fromPlane(n, -glm::dot(n, a), 0.5 * doubleArea);
+        for (size_t k = 0; k < 3; ++k) {
+            quadrics[current[i + k]] += q;
+        }
+    }
+
+    const std::vector<uint8_t> locked =
+      findLockedVertices(current, vertexCount);
+    std::vector<uint8_t> touched(vertexCount);
+    std::vector<Collapse> candidates;
+    std::vector<uint32_t> neighbours;
+    double maxCost = 0.0;
+
+    while (current.size() > targetIndexCount) {
+        Adjacency adjacency{current, vertexCount};
+
+        //
+        // The cheaper direction of every edge. Interior edges show up in two
+        // triangles, once each way round, so only a < b is taken.
+        //
+        candidates.clear();
+        for (size_t i = 0; i < current.size(); i += 3) {
+            for (size_t k = 0; k < 3; ++k) {
+                uint32_t a = current[i + k];
+                uint32_t b = current[i + ((k + 1) % 3)];
+                if (a > b || (locked[a] != 0 && locked[b] != 0)) {
+                    continue;
+                }
+                Quadric q = quadrics[a];
+                q += quadrics[b];
+                double toB = locked[a] != 0
+                               ? std::numeric_limits<double>::max()
+                               : q.evaluate(positionOf(vertices, b));
+                double toA = locked[b] != 0
+                               ? std::numeric_limits<double>::max()
+                               : q.evaluate(positionOf(vertices, a));
+                candidates.push_back(
+                  toB <= toA ? Collapse{static_cast<float>(toB), a, b}
+                             : Collapse{static_cast<float>(toA), b, a});
+            }
+        }
+        if (candidates.empty()) {
+            break;
+        }
+
+        //
+        // Apply the cheapest collapses that do not touch each other. Only the
+        // cheapest quarter is considered per pass, so costs are re-evaluated
+        // before the error grows much.
+        //
+        size_t considered = std::max<size_t>(candidates.size() / 4, 1);
+        auto byCost = [](const Collapse& x, const Collapse& y) {
+            return x.cost < y.cost;
+        };
+        std::ranges::nth_element(candidates,
+                                 candidates.begin() +
+                                   static_cast<ptrdiff_t>(considered - 1),
+                                 byCost);
+        std::sort(candidates.begin(),
+                  candidates.begin() + static_cast<ptrdiff_t>(considered),
+                  byCost);
+
+        std::ranges::fill(touched, 0);
+        size_t trianglesToRemove = (current.size() - targetIndexCount) / 3;
+        size_t removed = 0;
+        for (size_t i = 0; i < considered && removed < trianglesToRemove; ++i)
+        {
+            const Collapse& collapse = candidates[i];
+            if (touched[collapse.from] != 0 || touched[collapse.to] != 0 ||
+                !canCollapse(collapse, current, vertices, adjacency,
+                             neighbours))
+            {
+                continue;
+            }
+
+            for (uint32_t t : adjacency.of(collapse.from)) {
+                uint32_t* tri = &current[3 * size_t{t}];
+                for (size_t k = 0; k < 3; ++k) {
+                    touched[tri[k]] = 1;
+                    if (tri[k] == collapse.from) {
+                        tri[k] = collapse.to;
+                    }
+                }
+                removed += isDegenerate(tri) ? 1 : 0;
+            }
+            quadrics[collapse.to] += quadrics[collapse.from];
+            maxCost = std::max(maxCost, static_cast<double>(collapse.cost));
+        }
+        if (removed == 0) {
+            break;
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < current.size(); i += 3) {
+            if (!isDegenerate(&current[i])) {
+                std::copy_n(&current[i], 3, &current[kept]);
+                kept += 3;
+            }
+        }
+        current.resize(kept);
+    }
+
+    result.error = static_cast<float>(std::sqrt(maxCost));
+    return result;
+}
+
+void buildLodChain(ImportedShape& shape)
+{
+    shape.lods.clear();
+    if (shape.indices.empty()) {
+        return;
+    }
+    shape.lods.push_back(
+      {.indexCount = static_cast<uint32_t>(shape.indices.size())});
+
+    float error = 0.0F;
+    while (shape.lods.size() < maxShapeLods) {
+        const ShapeLod& previous = shape.lods.back();
+        if (previous.indexCount / 3 < minLodTriangles) {
+            break;
+        }
+        std::span<const uint32_t> source{shape.indices.data() +
+                                           previous.firstIndex,
+                                         previous.indexCount};
+        SimplifiedMesh simplified = simplifyMesh(
+          source, shape.vertices, (previous.indexCount / 6) * 3);
+
+        // Not worth a level if it barely got smaller (mostly locked seams)
+        if (simplified.indices.size() * 10 > source.size() * 9) {
+            break;
+        }
+        optimizeVertexCache(simplified.indices, shape.vertices.size());
+
+        // Errors of successive levels can add up
+        error += simplified.error;
+        shape.lods.push_back(
+          {.firstIndex = static_cast<uint32_t>(shape.indices.size()),
+           .indexCount = static_cast<uint32_t>(simplified.indices.size()),
+           .error = error});
+        shape.indices.insert(shape.indices.end(), simplified.indices.begin(),
+                             simplified.indices.end());
+    }
+}
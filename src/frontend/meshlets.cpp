@@ -0,0 +1,206 @@
+#include "frontend/meshlets.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+// Bounding sphere and normal cone of the triangles in `indices`.
+void computeBounds(Meshlet& meshlet, std::span<const uint32_t> indices,
+                   std::span<const LoadedObjVertex> vertices)
+{
+    glm::vec3 minPosition{std::numeric_limits<float>::max()};
+    glm::vec3 maxPosition{std::numeric_limits<float>::lowest()};
+    for (uint32_t index : indices) {
+        minPosition = glm::min(minPosition, glm::vec3{vertices[index].position});
+        maxPosition = glm::max(maxPosition, glm::vec3{vertices[index].position});
+    }
+    meshlet.center = (minPosition + maxPosition) * 0.5F;
+
+    float radiusSquared = 0.0F;
+    for (uint32_t index : indices) {
+        glm::vec3 d = glm::vec3{vertices[index].position} - meshlet.center;
+        radiusSquared = std::max(radiusSquared, glm::dot(d, d));
+    }
+    meshlet.radius = std::sqrt(radiusSquared);
+
+    //
+    // Normal cone: the average face normal, and how far the faces spread
+    // around it
+    //
+    std::vector<glm::vec3> normals;
+    normals.reserve(indices.size() / 3);
+    glm::vec3 sum{0.0F};
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        glm::vec3 a = vertices[indices[i + 0]].position;
+        glm::vec3 b = vertices[indices[i + 1]].position;
+        glm::vec3 c = vertices[indices[i + 2]].position;
+        glm::vec3 n = glm::cross(b - a, c - a);
+        float length = glm::length(n);
+        if (length == 0.0F) {
+            continue; // degenerate, can never be seen
+        }
+        normals.push_back(n / length);
+        sum += normals.back();
+    }
+
+    meshlet.coneAxis = glm::vec3{0.0F};
+    meshlet.coneCutoff = 1.0F;
+    float sumLength = glm::length(sum);
+    if (normals.empty() || sumLength == 0.0F) {
+        return;
+    }
+    glm::vec3 axis = sum / sumLength;
+    float minDot = 1.0F;
+    for (const auto& n : normals) {
+        minDot = std::min(minDot, glm::dot(n, axis));
+    }
+    meshlet.coneAxis = axis;
+    // Cones wider than ~85 degrees can hardly ever be culled; leave them
+    // open rather than testing them every frame.
+    if (minDot > 0.1F) {
+        // sin of the cone's half angle = cos of the widest view angle (from
+        // the axis) at which all faces point away
+        meshlet.coneCutoff = std::sqrt(1.0F - (minDot * minDot));
+    }
+}
+} // anonymous namespace
+
+std::vector<Meshlet> buildMeshlets(std::span<const uint32_t> indices,
+                                   std::span<const LoadedObjVertex> vertices,
+                                   size_t maxVertices, size_t maxTriangles)
+{
+    std::vector<Meshlet> meshlets;
+    if (indices.size() < 3) {
+        return meshlets;
+    }
+
+    // Which meshlet (+1) last used each vertex, so counting a meshlet's
+    // distinct vertices needs no clearing between meshlets
+    std::vector<uint32_t> lastUse(vertices.size(), 0);
+    uint32_t meshletId = 1;
+
+    Meshlet current;
+    size_t vertexCount = 0;
+
+    auto finish = [&] {
+        computeBounds(current,
+                      indices.subspan(current.firstIndex, current.indexCount),
+                      vertices);
+        meshlets.push_back(current);
+        current = Meshlet{};
+        current.firstIndex = meshlets.back().firstIndex +
+                             meshlets.back().indexCount;
+        vertexCount = 0;
+        ++meshletId;
+    };
+
+    // Vertices of triangle `i` the current meshlet does not have yet
+    auto newVerticesOf = [&](size_t i) {
+        uint32_t a = indices[i];
+        uint32_t b = indices[i + 1];
+        uint32_t c = indices[i + 2];
+        size_t count = lastUse[a] != meshletId ? 1 : 0;
+        count += lastUse[b] != meshletId && b != a ? 1 : 0;
+        count += lastUse[c] != meshletId && c != a && c != b ? 1 : 0;
+        return count;
+    };
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        size_t newVertices = newVerticesOf(i);
+        if (current.indexCount / 3 + 1 > maxTriangles ||
+            vertexCount + newVertices > maxVertices)
+        {
+            finish();
+            newVertices = newVerticesOf(i);
+        }
+
+        for (size_t k = 0; k < 3; ++k) {
+            lastUse[indices[i + k]] = meshletId;
+        }
+        vertexCount += newVertices;
+        current.indexCount += 3;
+    }
+    if (current.indexCount > 0) {
+        finish();
+    }
+    return meshlets;
+}
+
+void buildShapeMeshlets(ImportedShape& shape)
+{
+    shape.meshlets.clear();
+    for (auto& lod : shape.lods) {
+        std::vector<Meshlet> meshlets = buildMeshlets(
+          std::span<const uint32_t>{shape.indices}.subspan(lod.firstIndex,
+                                                           lod.indexCount),
+          shape.vertices);
+        for (auto& meshlet : meshlets) {
+            meshlet.firstIndex += lod.firstIndex;
+        }
+        lod.firstMeshlet = static_cast<uint32_t>(shape.meshlets.size());
+        lod.meshletCount = static_cast<uint32_t>(meshlets.size());
+        shape.meshlets.insert(shape.meshlets.end(), meshlets.begin(),
+                              meshlets.end());
+    }
+}
+
+MeshletCuller::MeshletCuller(const glm::mat4& viewProjection,
+                             const glm::mat4& model, glm::vec3 cameraPosition)
+  // with the model matrix in it, the frustum is in object space
+  : frustum{viewProjection * model}
+{
+    // Facing is preserved by any affine transform that does not mirror, so
+    // the cones can be tested against the camera in object space
+    this->cameraPosition =
+      glm::vec3{glm::inverse(model) * glm::vec4{cameraPosition, 1.0F}};
+    coneCulling = glm::determinant(glm::mat3{model}) > 0.0F;
+}
+
+MeshletVisibility MeshletCuller::classify(const Meshlet& meshlet) const
+{
+    if (!intersectsFrustum(meshlet.center, meshlet.radius)) {
+        return MeshletVisibility::OutsideFrustum;
+    }
+
+    if (coneCulling && meshlet.coneCutoff < 1.0F) {
+        glm::vec3 view = meshlet.center - cameraPosition;
+        if (glm::dot(view, meshlet.coneAxis) >=
+            (meshlet.coneCutoff * glm::length(view)) + meshlet.radius)
+        {
+            return MeshletVisibility::BackFacing;
+        }
+    }
+    return MeshletVisibility::Visible;
+}
+
+bool MeshletCuller::intersectsFrustum(glm::vec3 center, float radius) const
+{
+    return frustum.intersectsSphere(center, radius);
+}
+
+const Frustum& MeshletCuller::getFrustum() const
+{
+    return frustum;
+}
+
+bool MeshletCuller::isVisible(const Meshlet& meshlet,
+                              MeshletCullStats& stats) const
+{
+    ++stats.meshlets;
+    stats.triangles += meshlet.indexCount / 3;
+
+    switch (classify(meshlet)) {
+    case MeshletVisibility::Visible:
+        return true;
+    case MeshletVisibility::OutsideFrustum:
+        ++stats.frustumCulled;
+        break;
+    case MeshletVisibility::BackFacing:
+        ++stats.backfaceCulled;
+        break;
+    }
+    stats.trianglesCulled += meshlet.indexCount / 3;
+    return false;
+}
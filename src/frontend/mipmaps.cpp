@@ -0,0 +1,300 @@
+#include "frontend/mipmaps.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+// Linear light RGBA, 4 floats per texel
+struct FloatImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<float> texels;
+
+    [[nodiscard]] float* row(int y)
+    {
+        return &texels[static_cast<size_t>(y) * width * 4];
+    }
+
+    [[nodiscard]] const float* row(int y) const
+    {
+        return &texels[static_cast<size_t>(y) * width * 4];
+    }
+};
+
+// Output texel `x` of a 2:1 downsample is the weighted sum of input texels
+// `2x + firstOffset` to `2x + firstOffset + weights.size() - 1`, clamped to
+// the edge.
+struct Kernel
+{
+    std::vector<float> weights;
+    int firstOffset = 0;
+};
+
+double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+Kernel kernelFor(MipFilter filter)
+{
+    if (filter == MipFilter::Box) {
+        return Kernel{.weights = {0.5F, 0.5F}, .firstOffset = 0};
+    }
+
+    // Distances are in output texels; the window reaches 2 of them
+    constexpr double alpha = 4.0;
+    constexpr double radius = 2.0;
+    Kernel kernel{.weights = {}, .firstOffset = -3};
+    double sum = 0.0;
+    std::array<double, 8> weights{};
+    for (size_t t = 0; t < weights.size(); ++t) {
+        double u = (static_cast<double>(kernel.firstOffset) +
+                    static_cast<double>(t) - 0.5) /
+                   2.0;
+        double sinc = std::sin(std::numbers::pi * u) / (std::numbers::pi * u);
+        double z = u / radius;
+        double window = besselI0(alpha * std::sqrt(1.0 - (z * z))) /
+                        besselI0(alpha);
+        weights[t] = sinc * window;
+        sum += weights[t];
+    }
+    for (double weight : weights) {
+        kernel.weights.push_back(static_cast<float>(weight / sum));
+    }
+    return kernel;
+}
+
+// Texel `2 * x + firstOffset + t` of a row `width` long, clamped
+int tapIndex(int x, const Kernel& kernel, size_t t, int width)
+{
+    return std::clamp((2 * x) + kernel.firstOffset + static_cast<int>(t), 0,
+                      width - 1);
+}
+
+void filterRow(const float* src, int srcWidth, float* dst, int dstWidth,
+               const Kernel& kernel)
+{
+    for (int x = 0; x < dstWidth; ++x) {
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+        // one texel is one register; AVX2 gains nothing on this gather
+        __m128 sum = _mm_setzero_ps();
+        for (size_t t = 0; t < kernel.weights.size(); ++t) {
+            __m128 texel =
+              _mm_loadu_ps(src + (4 * tapIndex(x, kernel, t, srcWidth)));
+            sum = _mm_add_ps(sum,
+                             _mm_mul_ps(texel, _mm_set1_ps(kernel.weights[t])));
+        }
+        _mm_storeu_ps(dst + (4 * x), sum);
+#else
+        std::array<float, 4> sum{};
+        for (size_t t = 0; t < kernel.weights.size(); ++t) {
+            const float* texel = src + (4 * tapIndex(x, kernel, t, srcWidth));
+            for (int c = 0; c < 4; ++c) {
+                sum[c] += texel[c] * kernel.weights[t];
+            }
+        }
+        std::copy(sum.begin(), sum.end(), dst + (4 * x));
+#endif
+    }
+}
+
+// dst[i] = sum of weights[t] * rows[t][i], for `count` floats
+void blendRows(const std::vector<const float*>& rows, const Kernel& kernel,
+               float* dst, size_t count)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 8 <= count; i += 8) {
+        __m256 sum = _mm256_setzero_ps();
+        for (size_t t = 0; t < rows.size(); ++t) {
+            sum = _mm256_add_ps(sum,
+                                _mm256_mul_ps(_mm256_loadu_ps(rows[t] + i),
+                                              _mm256_set1_ps(kernel.weights[t])));
+        }
+        _mm256_storeu_ps(dst + i, sum);
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    for (; i + 4 <= count; i += 4) {
+        __m128 sum = _mm_setzero_ps();
+        for (size_t t = 0; t < rows.size(); ++t) {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows[t] + i),
+                                             _mm_set1_ps(kernel.weights[t])));
+        }
+        _mm_storeu_ps(dst + i, sum);
+    }
+#endif
+    for (; i < count; ++i) {
+        float sum = 0.0F;
+        for (size_t t = 0; t < rows.size(); ++t) {
+            sum += rows[t][i] * kernel.weights[t];
+        }
+        dst[i] = sum;
+    }
+}
+
+FloatImage downsample(const FloatImage& src, const Kernel& kernel,
+                      ThreadPool& pool)
+{
+    int dstWidth = std::max(1, src.width / 2);
+    int dstHeight = std::max(1, src.height / 2);
+
+    // Horizontal pass: every row of `src`, half as wide
+    FloatImage narrow{.width = dstWidth, .height = src.height, .texels = {}};
+    narrow.texels.resize(static_cast<size_t>(dstWidth) * src.height * 4);
+    pool.parallelFor(static_cast<size_t>(src.height), [&](size_t y) {
+        filterRow(src.row(static_cast<int>(y)), src.width,
+                  narrow.row(static_cast<int>(y)), dstWidth, kernel);
+    });
+
+    // Vertical pass: half as many rows
+    FloatImage dst{.width = dstWidth, .height = dstHeight, .texels = {}};
+    dst.texels.resize(static_cast<size_t>(dstWidth) * dstHeight * 4);
+    pool.parallelFor(static_cast<size_t>(dstHeight), [&](size_t y) {
+        std::vector<const float*> rows;
+        for (size_t t = 0; t < kernel.weights.size(); ++t) {
+            rows.push_back(narrow.row(
+              tapIndex(static_cast<int>(y), kernel, t, src.height)));
+        }
+        blendRows(rows, kernel, dst.row(static_cast<int>(y)),
+                  static_cast<size_t>(dstWidth) * 4);
+    });
+    return dst;
+}
+
+float srgbToLinear(float value)
+{
+    return value <= 0.04045F ? value / 12.92F
+                             : std::pow((value + 0.055F) / 1.055F, 2.4F);
+}
+
+// Converts linear light back to 8-bit sRGB, rounding in sRGB space exactly
+// but without a pow() per texel.
+class SrgbEncoder
+{
+    // linear value halfway (in sRGB) between byte i and i + 1
+    std::array<float, 255> thresholds{};
+    // a guess within a step or two of the answer, indexed by sqrt(linear)
+    std::array<uint8_t, 1024> guesses{};
+
+  public:
+    SrgbEncoder()
+    {
+        for (size_t i = 0; i < thresholds.size(); ++i) {
+            thresholds[i] =
+              srgbToLinear((static_cast<float>(i) + 0.5F) / 255.0F);
+        }
+        for (size_t i = 0; i < guesses.size(); ++i) {
+            float root = static_cast<float>(i) /
+                         static_cast<float>(guesses.size() - 1);
+            guesses[i] = exact(root * root);
+        }
+    }
+
+    [[nodiscard]] uint8_t exact(float linear) const
+    {
+        return static_cast<uint8_t>(
+          std::upper_bound(thresholds.begin(), thresholds.end(), linear) -
+          thresholds.begin());
+    }
+
+    [[nodiscard]] uint8_t encode(float linear) const
+    {
+        linear = std::clamp(linear, 0.0F, 1.0F);
+        int value = guesses[static_cast<size_t>(
+          std::sqrt(linear) * static_cast<float>(guesses.size() - 1))];
+        while (value < 255 && linear >= thresholds[value]) {
+            ++value;
+        }
+        while (value > 0 && linear < thresholds[value - 1]) {
+            --value;
+        }
+        return static_cast<uint8_t>(value);
+    }
+};
+
+FloatImage toFloat(const RgbaImage& image, bool srgb)
+{
+    std::array<float, 256> colour{};
+    std::array<float, 256> plain{};
+    for (size_t i = 0; i < colour.size(); ++i) {
+        plain[i] = static_cast<float>(i) / 255.0F;
+        colour[i] = srgb ? srgbToLinear(plain[i]) : plain[i];
+    }
+
+    FloatImage result{.width = image.width, .height = image.height,
+                      .texels = {}};
+    result.texels.resize(image.pixels.size());
+    for (size_t i = 0; i < image.pixels.size(); ++i) {
+        // every fourth value is alpha
+        result.texels[i] = (i % 4 == 3 ? plain : colour)[image.pixels[i]];
+    }
+    return result;
+}
+
+RgbaImage toBytes(const FloatImage& image, bool srgb,
+                  const SrgbEncoder& encoder, ThreadPool& pool)
+{
+    RgbaImage result{.width = image.width, .height = image.height,
+                     .pixels = {}};
+    result.pixels.resize(image.texels.size());
+    size_t rowValues = static_cast<size_t>(image.width) * 4;
+    pool.parallelFor(static_cast<size_t>(image.height), [&](size_t y) {
+        for (size_t i = y * rowValues; i < (y + 1) * rowValues; ++i) {
+            float value = image.texels[i];
+            result.pixels[i] =
+              srgb && i % 4 != 3
+                ? encoder.encode(value)
+                : static_cast<uint8_t>(
+                    std::lround(std::clamp(value, 0.0F, 1.0F) * 255.0F));
+        }
+    });
+    return result;
+}
+} // namespace
+
+const char* mipFilterName(MipFilter filter)
+{
+    return filter == MipFilter::Box ? "box" : "Kaiser";
+}
+
+const char* mipSimdPath()
+{
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE2__) || defined(_M_X64)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+std::vector<RgbaImage> buildMipChain(const RgbaImage& image, bool srgb,
+                                     MipFilter filter, ThreadPool& pool)
+{
+    static const SrgbEncoder encoder;
+    Kernel kernel = kernelFor(filter);
+
+    std::vector<RgbaImage> levels{image};
+    FloatImage level = toFloat(image, srgb);
+    while (level.width > 1 || level.height > 1) {
+        level = downsample(level, kernel, pool);
+        levels.push_back(toBytes(level, srgb, encoder, pool));
+    }
+    return levels;
+}
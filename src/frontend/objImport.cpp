@@ -0,0 +1,97 @@
+#include "frontend/objImport.hpp"
+
+#include "frontend/meshOptimize.hpp"
+#include "frontend/meshSimplify.hpp"
+#include "frontend/meshlets.hpp"
+#include "frontend/objParser.hpp"
+#include "frontend/vertexDedup.hpp"
+
+#include "util/error.hpp"
+#include "util/logger.hpp"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+ImportedObject importObjFile(const std::filesystem::path& path,
+                             ThreadPool& pool)
+{
+    if (!std::filesystem::exists(path)) {
+        throw IrrecoverableError("Object file not found: " + path.string());
+    }
+
+    std::optional<ParsedObj> chunked = parseObjChunked(path, pool);
+    ParsedObj parsed =
+      chunked ? std::move(*chunked) : parseObjWithTinyObj(path);
+
+    if (!parsed.warning.empty()) {
+        LOG("Warning while loading .obj: " << parsed.warning);
+    }
+
+    const tinyobj::attrib_t& attrib = parsed.attrib;
+
+    ImportedObject imported;
+    imported.materials = std::move(parsed.materials);
+    // shapes too big for 16-bit indices are split into several parts
+    std::vector<std::vector<ImportedShape>> parts(parsed.shapes.size());
+    std::vector<VertexCacheStats> statsBefore(parsed.shapes.size());
+    std::vector<VertexCacheStats> statsAfter(parsed.shapes.size());
+
+    // Build vertex/index arrays for shapes. Shapes are independent, so they
+    // are built concurrently; big ones also parallelise their dedup.
+    pool.parallelFor(parsed.shapes.size(), [&](size_t s) {
+        const tinyobj::shape_t& shape = parsed.shapes[s];
+        ImportedShape importedShape;
+
+        std::vector<LoadedObjVertex> corners;
+        corners.reserve(shape.mesh.indices.size());
+        for (const auto& index : shape.mesh.indices) {
+            corners.emplace_back(index, attrib);
+        }
+        dedupVertices(corners, importedShape, pool);
+
+        statsBefore[s] = analyzeVertexCache(importedShape.indices,
+                                            importedShape.vertices.size());
+        optimizeShape(importedShape);
+        statsAfter[s] = analyzeVertexCache(importedShape.indices,
+                                           importedShape.vertices.size());
+
+        if (!shape.mesh.material_ids.empty()) {
+            importedShape.materialId = shape.mesh.material_ids[0];
+        }
+
+        parts[s] = splitForShortIndices(std::move(importedShape));
+        for (auto& part : parts[s]) {
+            buildLodChain(part);
+            buildShapeMeshlets(part);
+        }
+    });
+
+    size_t meshletCount = 0;
+    size_t lodCount = 0;
+    for (auto& shapeParts : parts) {
+        for (const auto& part : shapeParts) {
+            meshletCount += part.meshlets.size();
+            lodCount += part.lods.size();
+        }
+        std::ranges::move(shapeParts, std::back_inserter(imported.shapes));
+    }
+
+    VertexCacheStats before;
+    VertexCacheStats after;
+    for (size_t s = 0; s < parsed.shapes.size(); ++s) {
+        before += statsBefore[s];
+        after += statsAfter[s];
+    }
+    LOG("Vertex cache of " << path << ": ACMR " << before.acmr() << " -> "
+                           << after.acmr() << ", ATVR " << before.atvr()
+                           << " -> " << after.atvr() << ", "
+                           << meshletCount << " meshlets, " << lodCount
+                           << " levels of detail in "
+                           << imported.shapes.size() << " shapes");
+
+    return imported;
+}
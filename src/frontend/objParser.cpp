@@ -0,0 +1,949 @@
+#include "frontend/objParser.hpp"
+
+#include "util/error.hpp"
+#include "util/logger.hpp"
+#include "util/mappedFile.hpp"
+
+#include <tiny_obj_loader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string_view>
+
+namespace
+{
+constexpr size_t minChunkBytes = size_t{1} << 20;
+
+// Thrown by the chunk workers for malformed input.
+struct ObjParseError
+{
+    std::string msg;
+};
+
+// Thrown by the chunk workers for valid input this parser leaves to tinyobj.
+struct UnsupportedObj
+{
+    const char* reason;
+};
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+bool isDigit(char c)
+{
+    return static_cast<unsigned>(c - '0') < 10U;
+}
+
+//
+// Number parsing.
+// These intentionally mirror tinyobj's `tryParseDouble`/`parseReal`/
+// `parseTriple` (including how they round), so that both parsers produce
+// bit-identical output. They are already locale-free and allocation-free,
+// which is what makes them fast.
+//
+
+bool tryParseDouble(const char* s, const char* sEnd, double* result)
+{
+    if (s >= sEnd) {
+        return false;
+    }
+
+    double mantissa = 0.0;
+    int exponent = 0;
+    char sign = '+';
+    char expSign = '+';
+    const char* curr = s;
+    int read = 0;
+    bool endNotReached = false;
+    bool leadingDecimalDots = false;
+
+    if (*curr == '+' || *curr == '-') {
+        sign = *curr;
+        curr++;
+        if ((curr != sEnd) && (*curr == '.')) {
+            leadingDecimalDots = true;
+        }
+    } else if (isDigit(*curr)) {
+        // pass through
+    } else if (*curr == '.') {
+        leadingDecimalDots = true;
+    } else {
+        return false;
+    }
+
+    // integer part
+    endNotReached = (curr != sEnd);
+    if (!leadingDecimalDots) {
+        while (endNotReached && isDigit(*curr)) {
+            mantissa *= 10;
+            mantissa += static_cast<int>(*curr - 0x30);
+            curr++;
+            read++;
+            endNotReached = (curr != sEnd);
+        }
+        if (read == 0) {
+            return false;
+        }
+    }
+
+    if (endNotReached) {
+        // decimal part
+        if (*curr == '.') {
+            curr++;
+            read = 1;
+            endNotReached = (curr != sEnd);
+            while (endNotReached && isDigit(*curr)) {
+                static constexpr double powLut[] = {
+                  1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001,
+                };
+                constexpr int lutEntries = sizeof powLut / sizeof powLut[0];
+                mantissa += static_cast<int>(*curr - 0x30) *
+                            (read < lutEntries ? powLut[read]
+                                               : std::pow(10.0, -read));
+                read++;
+                curr++;
+                endNotReached = (curr != sEnd);
+            }
+        }
+
+        // exponent part
+        if (endNotReached && (*curr == 'e' || *curr == 'E')) {
+            curr++;
+            endNotReached = (curr != sEnd);
+            if (endNotReached && (*curr == '+' || *curr == '-')) {
+                expSign = *curr;
+                curr++;
+            } else if (endNotReached && isDigit(*curr)) {
+                // pass through
+            } else {
+                // empty E is not allowed
+                return false;
+            }
+
+            read = 0;
+            endNotReached = (curr != sEnd);
+            while (endNotReached && isDigit(*curr)) {
+                if (exponent > (2147483647 / 10)) {
+                    return false; // integer overflow
+                }
+                exponent *= 10;
+                exponent += static_cast<int>(*curr - 0x30);
+                curr++;
+                read++;
+                endNotReached = (curr != sEnd);
+            }
+            exponent *= (expSign == '+' ? 1 : -1);
+            if (read == 0) {
+                return false;
+            }
+        }
+    }
+
+    *result =
+      (sign == '+' ? 1 : -1) *
+      (exponent != 0 ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent)
+                     : mantissa);
+    return true;
+}
+
+// Parses one whitespace separated real, advancing `p`.
+tinyobj::real_t parseReal(const char*& p, const char* end,
+                          double defaultValue = 0.0)
+{
+    while (p < end && isSpace(*p)) {
+        ++p;
+    }
+    const char* tokenEnd = p;
+    while (tokenEnd < end && !isSpace(*tokenEnd) && *tokenEnd != '\r') {
+        ++tokenEnd;
+    }
+    double val = defaultValue;
+    tryParseDouble(p, tokenEnd, &val);
+    p = tokenEnd;
+    return static_cast<tinyobj::real_t>(val);
+}
+
+// atoi() semantics on a bounded range.
+int parseIntAt(const char* p, const char* end)
+{
+    while (p < end && (isSpace(*p) || *p == '\r')) {
+        ++p;
+    }
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+        negative = *p == '-';
+        ++p;
+    }
+    int value = 0;
+    while (p < end && isDigit(*p)) {
+        value = (value * 10) + (*p - '0');
+        ++p;
+    }
+    return negative ? -value : value;
+}
+
+// OBJ indices are 1-based, or negative for "relative to the latest".
+bool fixIndex(int idx, int n, int* ret)
+{
+    if (idx > 0) {
+        *ret = idx - 1;
+        return true;
+    }
+    if (idx == 0) {
+        return false;
+    }
+    *ret = n + idx;
+    return true;
+}
+
+// Skips to the next '/', space, tab or CR.
+const char* skipIndexToken(const char* p, const char* end)
+{
+    while (p < end && *p != '/' && !isSpace(*p) && *p != '\r') {
+        ++p;
+    }
+    return p;
+}
+
+// Parses `i`, `i/j`, `i//k` or `i/j/k`, advancing `p`.
+bool parseTriple(const char*& p, const char* end, int vSize, int vnSize,
+                 int vtSize, tinyobj::index_t& out)
+{
+    tinyobj::index_t vi{-1, -1, -1};
+
+    if (!fixIndex(parseIntAt(p, end), vSize, &vi.vertex_index)) {
+        return false;
+    }
+    p = skipIndexToken(p, end);
+    if (p >= end || *p != '/') {
+        out = vi;
+        return true;
+    }
+    ++p;
+
+    // i//k
+    if (p < end && *p == '/') {
+        ++p;
+        if (!fixIndex(parseIntAt(p, end), vnSize, &vi.normal_index)) {
+            return false;
+        }
+        p = skipIndexToken(p, end);
+        out = vi;
+        return true;
+    }
+
+    // i/j/k or i/j
+    if (!fixIndex(parseIntAt(p, end), vtSize, &vi.texcoord_index)) {
+        return false;
+    }
+    p = skipIndexToken(p, end);
+    if (p >= end || *p != '/') {
+        out = vi;
+        return true;
+    }
+    ++p;
+    if (!fixIndex(parseIntAt(p, end), vnSize, &vi.normal_index)) {
+        return false;
+    }
+    p = skipIndexToken(p, end);
+    out = vi;
+    return true;
+}
+
+//
+// Line classification, shared by both passes so they agree on counts.
+// Follows the order tinyobj tests prefixes in.
+//
+
+enum class LineKind
+{
+    Ignored,
+    Position,
+    Normal,
+    TexCoord,
+    Face,
+    UseMaterial,
+    MaterialLibrary,
+    Group,
+    Object,
+    Smoothing,
+    Unsupported,
+};
+
+LineKind classify(std::string_view token)
+{
+    auto spaceAt = [&token](size_t i) {
+        return token.size() > i && isSpace(token[i]);
+    };
+
+    if (token.empty() || token[0] == '#') {
+        return LineKind::Ignored;
+    }
+
+    switch (token[0]) {
+        case 'v':
+            if (spaceAt(1)) {
+                return LineKind::Position;
+            }
+            if (token.size() > 1 && token[1] == 'n' && spaceAt(2)) {
+                return LineKind::Normal;
+            }
+            if (token.size() > 1 && token[1] == 't' && spaceAt(2)) {
+                return LineKind::TexCoord;
+            }
+            // `vw` (weights) does not affect geometry
+            return LineKind::Ignored;
+        case 'l':
+        case 'p': return spaceAt(1) ? LineKind::Unsupported : LineKind::Ignored;
+        case 'f': return spaceAt(1) ? LineKind::Face : LineKind::Ignored;
+        default: break;
+    }
+
+    if (token.starts_with("usemtl")) {
+        return LineKind::UseMaterial;
+    }
+    if (token.starts_with("mtllib") && spaceAt(6)) {
+        return LineKind::MaterialLibrary;
+    }
+    if (token[0] == 'g' && spaceAt(1)) {
+        return LineKind::Group;
+    }
+    if (token[0] == 'o' && spaceAt(1)) {
+        return LineKind::Object;
+    }
+    if (token[0] == 's' && spaceAt(1)) {
+        return LineKind::Smoothing;
+    }
+    return LineKind::Ignored;
+}
+
+// Calls `fn(token)` for every line of `chunk` with leading blanks and the
+// trailing CR stripped.
+template <typename Fn>
+void forEachLine(std::string_view chunk, Fn&& fn)
+{
+    while (!chunk.empty()) {
+        size_t lineEnd = chunk.find('\n');
+        std::string_view line = chunk.substr(0, lineEnd);
+        chunk = lineEnd == std::string_view::npos ? std::string_view{}
+                                                  : chunk.substr(lineEnd + 1);
+
+        // trailing blanks are kept, as tinyobj keeps them: they make `g ` a
+        // group line and stay in `o` names
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        while (!line.empty() && isSpace(line.front())) {
+            line.remove_prefix(1);
+        }
+        fn(line);
+    }
+}
+
+std::vector<std::string_view> splitIntoChunks(std::string_view text,
+                                              size_t targetCount)
+{
+    std::vector<std::string_view> chunks;
+    size_t chunkBytes = std::max(text.size() / std::max<size_t>(targetCount, 1),
+                                 minChunkBytes);
+
+    while (!text.empty()) {
+        size_t cut = std::min(chunkBytes, text.size());
+        if (cut < text.size()) {
+            size_t newline = text.find('\n', cut - 1);
+            cut = newline == std::string_view::npos ? text.size() : newline + 1;
+        }
+        chunks.push_back(text.substr(0, cut));
+        text.remove_prefix(cut);
+    }
+    return chunks;
+}
+
+//
+// Per-chunk data
+//
+
+struct ChunkCounts
+{
+    size_t positions = 0;
+    size_t normals = 0;
+    size_t texCoords = 0;
+    size_t faces = 0;
+    bool unsupported = false;
+};
+
+// Something that changes which shape/material/smoothing group the faces
+// after it belong to.
+struct ChunkEvent
+{
+    LineKind kind;
+    size_t faceIndex; // number of faces in the chunk before this event
+    std::string text;
+};
+
+struct ChunkFaces
+{
+    std::vector<tinyobj::index_t> corners;
+    std::vector<uint8_t> faceSizes;
+    std::vector<ChunkEvent> events;
+};
+
+// A run of faces that all end up in the same shape with the same state.
+struct FaceRun
+{
+    size_t chunk;
+    size_t faceBegin;
+    size_t faceEnd;
+    size_t cornerBegin;
+    size_t slot;
+    int materialId;
+    unsigned smoothingId;
+};
+
+struct RunOutput
+{
+    std::vector<tinyobj::index_t> indices;
+    std::vector<unsigned int> numFaceVertices;
+    std::vector<int> materialIds;
+    std::vector<unsigned int> smoothingIds;
+    bool skippedDegenerate = false;
+    bool skippedInvalid = false;
+};
+
+std::string restOfLine(std::string_view token, size_t skip)
+{
+    return std::string{token.substr(std::min(skip, token.size()))};
+}
+
+void parseChunk(std::string_view chunk, const ChunkCounts& base,
+                tinyobj::attrib_t& attrib, ChunkFaces& out,
+                size_t expectedFaces)
+{
+    tinyobj::real_t* positions = attrib.vertices.data() + (3 * base.positions);
+    tinyobj::real_t* normals = attrib.normals.data() + (3 * base.normals);
+    tinyobj::real_t* texCoords = attrib.texcoords.data() + (2 * base.texCoords);
+
+    size_t nv = base.positions;
+    size_t nn = base.normals;
+    size_t nt = base.texCoords;
+
+    out.faceSizes.reserve(expectedFaces);
+    out.corners.reserve(expectedFaces * 3);
+
+    forEachLine(chunk, [&](std::string_view token) {
+        const char* p = token.data();
+        const char* end = p + token.size();
+
+        LineKind kind = classify(token);
+        switch (kind) {
+            case LineKind::Position:
+                p += 2;
+                *positions++ = parseReal(p, end);
+                *positions++ = parseReal(p, end);
+                *positions++ = parseReal(p, end);
+                while (p < end && isSpace(*p)) {
+                    ++p;
+                }
+                if (p != end) {
+                    throw UnsupportedObj{"has vertex colours"};
+                }
+                ++nv;
+                break;
+            case LineKind::Normal:
+                p += 3;
+                *normals++ = parseReal(p, end);
+                *normals++ = parseReal(p, end);
+                *normals++ = parseReal(p, end);
+                ++nn;
+                break;
+            case LineKind::TexCoord:
+                p += 3;
+                *texCoords++ = parseReal(p, end);
+                *texCoords++ = parseReal(p, end);
+                ++nt;
+                break;
+            case LineKind::Face: {
+                p += 2;
+                while (p < end && isSpace(*p)) {
+                    ++p;
+                }
+                size_t corners = 0;
+                while (p < end) {
+                    tinyobj::index_t index{};
+                    if (!parseTriple(p, end, static_cast<int>(nv),
+                                     static_cast<int>(nn), static_cast<int>(nt),
+                                     index))
+                    {
+                        throw ObjParseError{"Failed parse `f' line (e.g. "
+                                            "zero value for face index): " +
+                                            std::string{token}};
+                    }
+                    if (++corners > 4) {
+                        throw UnsupportedObj{"has polygons with more than 4 "
+                                             "corners"};
+                    }
+                    out.corners.push_back(index);
+                    while (p < end && (isSpace(*p) || *p == '\r')) {
+                        ++p;
+                    }
+                }
+                out.faceSizes.push_back(static_cast<uint8_t>(corners));
+                break;
+            }
+            case LineKind::UseMaterial:
+            case LineKind::MaterialLibrary:
+            case LineKind::Group:
+            case LineKind::Object:
+            case LineKind::Smoothing:
+                out.events.push_back(ChunkEvent{.kind = kind,
+                                                .faceIndex =
+                                                  out.faceSizes.size(),
+                                                .text = std::string{token}});
+                break;
+            case LineKind::Unsupported:
+            case LineKind::Ignored: break;
+        }
+    });
+}
+
+// Loads the first readable file named on an `mtllib` line.
+void loadMaterialLibraries(std::string_view token,
+                           const std::filesystem::path& parentDir,
+                           std::map<std::string, int>& materialMap,
+                           std::vector<tinyobj::material_t>& materials,
+                           std::string& warning)
+{
+    token.remove_prefix(std::min<size_t>(7, token.size()));
+
+    while (!token.empty()) {
+        while (!token.empty() && (isSpace(token.front()))) {
+            token.remove_prefix(1);
+        }
+        size_t nameEnd = 0;
+        while (nameEnd < token.size() && !isSpace(token[nameEnd])) {
+            ++nameEnd;
+        }
+        if (nameEnd == 0) {
+            break;
+        }
+        std::string name{token.substr(0, nameEnd)};
+        token.remove_prefix(nameEnd);
+
+        std::filesystem::path mtlPath =
+          parentDir.empty() ? std::filesystem::path{name} : parentDir / name;
+        std::ifstream stream{mtlPath};
+        if (!stream) {
+            warning += "Material file [ " + mtlPath.string() +
+                       " ] not found in a path : " + parentDir.string() + "\n";
+            continue;
+        }
+
+        std::string mtlWarning;
+        std::string mtlError;
+        tinyobj::LoadMtl(&materialMap, &materials, &stream, &mtlWarning,
+                         &mtlError);
+        warning += mtlWarning;
+        return;
+    }
+
+    warning += "Failed to load material file(s). Use default material.\n";
+}
+
+// Emits the faces of one run as triangles, the way tinyobj triangulates.
+void triangulateRun(const FaceRun& run, const ChunkFaces& faces,
+                    const tinyobj::attrib_t& attrib, RunOutput& out)
+{
+    const auto& v = attrib.vertices;
+    size_t faceCount = run.faceEnd - run.faceBegin;
+    out.indices.reserve(faceCount * 3);
+    out.numFaceVertices.reserve(faceCount);
+
+    auto emitTriangle = [&](const tinyobj::index_t& a,
+                            const tinyobj::index_t& b,
+                            const tinyobj::index_t& c) {
+        out.indices.push_back(a);
+        out.indices.push_back(b);
+        out.indices.push_back(c);
+        out.numFaceVertices.push_back(3);
+        out.materialIds.push_back(run.materialId);
+        out.smoothingIds.push_back(run.smoothingId);
+    };
+
+    size_t corner = run.cornerBegin;
+    for (size_t f = run.faceBegin; f < run.faceEnd; ++f) {
+        size_t n = faces.faceSizes[f];
+        const tinyobj::index_t* c = faces.corners.data() + corner;
+        corner += n;
+
+        if (n < 3) {
+            out.skippedDegenerate = true;
+            continue;
+        }
+        if (n == 3) {
+            emitTriangle(c[0], c[1], c[2]);
+            continue;
+        }
+
+        // Quad: split along the shorter diagonal
+        size_t vi0 = static_cast<size_t>(c[0].vertex_index);
+        size_t vi1 = static_cast<size_t>(c[1].vertex_index);
+        size_t vi2 = static_cast<size_t>(c[2].vertex_index);
+        size_t vi3 = static_cast<size_t>(c[3].vertex_index);
+        if (((3 * vi0 + 2) >= v.size()) || ((3 * vi1 + 2) >= v.size()) ||
+            ((3 * vi2 + 2) >= v.size()) || ((3 * vi3 + 2) >= v.size()))
+        {
+            out.skippedInvalid = true;
+            continue;
+        }
+
+        tinyobj::real_t e02x = v[vi2 * 3 + 0] - v[vi0 * 3 + 0];
+        tinyobj::real_t e02y = v[vi2 * 3 + 1] - v[vi0 * 3 + 1];
+        tinyobj::real_t e02z = v[vi2 * 3 + 2] - v[vi0 * 3 + 2];
+        tinyobj::real_t e13x = v[vi3 * 3 + 0] - v[vi1 * 3 + 0];
+        tinyobj::real_t e13y = v[vi3 * 3 + 1] - v[vi1 * 3 + 1];
+        tinyobj::real_t e13z = v[vi3 * 3 + 2] - v[vi1 * 3 + 2];
+
+        tinyobj::real_t sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+        tinyobj::real_t sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+
+        if (sqr02 < sqr13) {
+            emitTriangle(c[0], c[1], c[2]);
+            emitTriangle(c[0], c[2], c[3]);
+        } else {
+            emitTriangle(c[0], c[1], c[3]);
+            emitTriangle(c[1], c[2], c[3]);
+        }
+    }
+}
+
+// Throws if a triangle refers past the end of an attribute array, which
+// tinyobj would let through to crash later.
+void validateIndices(const RunOutput& out, const tinyobj::attrib_t& attrib)
+{
+    const auto nv = static_cast<int>(attrib.vertices.size() / 3);
+    const auto nn = static_cast<int>(attrib.normals.size() / 3);
+    const auto nt = static_cast<int>(attrib.texcoords.size() / 2);
+    for (const auto& idx : out.indices) {
+        if (idx.vertex_index < 0 || idx.vertex_index >= nv ||
+            idx.normal_index >= nn ||
+            idx.texcoord_index >= nt)
+        {
+            throw ObjParseError{"Face index out of range"};
+        }
+    }
+}
+} // namespace
+
+ParsedObj parseObjWithTinyObj(const std::filesystem::path& path)
+{
+    std::filesystem::path parentDir =
+      path.has_parent_path() ? path.parent_path() : "";
+
+    ParsedObj parsed;
+    std::string error;
+    bool ok = tinyobj::LoadObj(&parsed.attrib, &parsed.shapes,
+                               &parsed.materials, &parsed.warning, &error,
+                               path.string().c_str(),
+                               parentDir.string().c_str(), true);
+    if (!ok) {
+        if (!parsed.warning.empty()) {
+            error += "\nWarning: " + parsed.warning;
+        }
+        throw IrrecoverableError{"Failed to load .obj file: " + error};
+    }
+    return parsed;
+}
+
+std::optional<ParsedObj> parseObjChunked(const std::filesystem::path& path,
+                                         ThreadPool& pool)
+{
+    std::filesystem::path parentDir =
+      path.has_parent_path() ? path.parent_path() : "";
+
+    MappedFile file{path};
+    file.adviseSequential();
+    std::string_view text{reinterpret_cast<const char*>(file.data()),
+                          file.size()};
+
+    // Old Mac line endings (lone CR) are left to tinyobj
+    size_t firstCR = text.find('\r');
+    if (firstCR != std::string_view::npos &&
+        (firstCR + 1 >= text.size() || text[firstCR + 1] != '\n'))
+    {
+        LOG("Chunked .obj parser: " << path
+                                    << " uses CR line endings, falling back");
+        return {};
+    }
+
+    std::vector<std::string_view> chunks =
+      splitIntoChunks(text, (pool.size() + 1) * 4);
+    const size_t chunkCount = chunks.size();
+
+    //
+    // Pass 1: count attributes per chunk, so pass 2 knows where each chunk's
+    // data goes and what "relative" indices resolve to.
+    //
+    std::vector<ChunkCounts> counts(chunkCount);
+    pool.parallelFor(chunkCount, [&](size_t c) {
+        ChunkCounts& n = counts[c];
+        forEachLine(chunks[c], [&n](std::string_view token) {
+            switch (classify(token)) {
+                case LineKind::Position: ++n.positions; break;
+                case LineKind::Normal: ++n.normals; break;
+                case LineKind::TexCoord: ++n.texCoords; break;
+                case LineKind::Face: ++n.faces; break;
+                case LineKind::Unsupported: n.unsupported = true; break;
+                default: break;
+            }
+        });
+    });
+
+    std::vector<ChunkCounts> bases(chunkCount);
+    ChunkCounts total;
+    for (size_t c = 0; c < chunkCount; ++c) {
+        if (counts[c].unsupported) {
+            LOG("Chunked .obj parser: " << path
+                                        << " has lines or points, falling "
+                                           "back");
+            return {};
+        }
+        bases[c] = total;
+        total.positions += counts[c].positions;
+        total.normals += counts[c].normals;
+        total.texCoords += counts[c].texCoords;
+    }
+
+    ParsedObj parsed;
+    parsed.attrib.vertices.resize(3 * total.positions);
+    parsed.attrib.normals.resize(3 * total.normals);
+    parsed.attrib.texcoords.resize(2 * total.texCoords);
+    // files with vertex colours fall back, so they are all tinyobj's default
+    parsed.attrib.colors.resize(3 * total.positions, 1.0F);
+
+    //
+    // Pass 2: parse numbers straight into their final place, and faces
+    // (with absolute indices) into per-chunk lists.
+    //
+    std::vector<ChunkFaces> faces(chunkCount);
+    try {
+        pool.parallelFor(chunkCount, [&](size_t c) {
+            parseChunk(chunks[c], bases[c], parsed.attrib, faces[c],
+                       counts[c].faces);
+        });
+    } catch (const UnsupportedObj& e) {
+        LOG("Chunked .obj parser: " << path << " " << e.reason
+                                    << ", falling back");
+        return {};
+    } catch (const ObjParseError& e) {
+        throw IrrecoverableError{"Failed to load .obj file " + path.string() +
+                                 ": " + e.msg};
+    }
+
+    //
+    // Replay grouping directives in file order. This is cheap (a handful of
+    // events) and decides which shape slot, material and smoothing group
+    // every run of faces belongs to.
+    //
+    struct Slot
+    {
+        std::string name;
+        size_t indexCount = 0;
+        size_t faceCount = 0;
+    };
+    std::vector<Slot> slots(1);
+    std::vector<FaceRun> runs;
+    std::map<std::string, int> materialMap;
+    int material = -1;
+    unsigned smoothing = 0;
+
+    for (size_t c = 0; c < chunkCount; ++c) {
+        const ChunkFaces& chunk = faces[c];
+        size_t faceCursor = 0;
+        size_t cornerCursor = 0;
+
+        auto flushRun = [&](size_t faceEnd) {
+            if (faceEnd == faceCursor) {
+                return;
+            }
+            FaceRun run{.chunk = c,
+                        .faceBegin = faceCursor,
+                        .faceEnd = faceEnd,
+                        .cornerBegin = cornerCursor,
+                        .slot = slots.size() - 1,
+                        .materialId = material,
+                        .smoothingId = smoothing};
+            for (size_t f = faceCursor; f < faceEnd; ++f) {
+                cornerCursor += chunk.faceSizes[f];
+            }
+            faceCursor = faceEnd;
+            runs.push_back(run);
+        };
+
+        for (const auto& event : chunk.events) {
+            flushRun(event.faceIndex);
+            std::string_view token = event.text;
+
+            switch (event.kind) {
+                case LineKind::Group: {
+                    // multiple group names are joined with a space
+                    std::string name;
+                    std::string_view rest = token.substr(1);
+                    while (!rest.empty()) {
+                        while (!rest.empty() && isSpace(rest.front())) {
+                            rest.remove_prefix(1);
+                        }
+                        size_t len = 0;
+                        while (len < rest.size() && !isSpace(rest[len])) {
+                            ++len;
+                        }
+                        if (len > 0) {
+                            if (!name.empty()) {
+                                name += ' ';
+                            }
+                            name.append(rest.substr(0, len));
+                        }
+                        rest.remove_prefix(len);
+                    }
+                    slots.push_back(Slot{.name = std::move(name)});
+                    break;
+                }
+                case LineKind::Object:
+                    slots.push_back(Slot{.name = restOfLine(token, 2)});
+                    break;
+                case LineKind::UseMaterial: {
+                    std::string_view rest = token.substr(6);
+                    while (!rest.empty() && isSpace(rest.front())) {
+                        rest.remove_prefix(1);
+                    }
+                    size_t len = 0;
+                    while (len < rest.size() && !isSpace(rest[len])) {
+                        ++len;
+                    }
+                    std::string name{rest.substr(0, len)};
+                    auto it = materialMap.find(name);
+                    if (it != materialMap.end()) {
+                        material = it->second;
+                    } else {
+                        material = -1;
+                        parsed.warning +=
+                          "material [ '" + name + "' ] not found in .mtl\n";
+                    }
+                    break;
+                }
+                case LineKind::MaterialLibrary:
+                    loadMaterialLibraries(token, parentDir, materialMap,
+                                          parsed.materials, parsed.warning);
+                    break;
+                case LineKind::Smoothing: {
+                    std::string_view rest = token.substr(2);
+                    while (!rest.empty() && isSpace(rest.front())) {
+                        rest.remove_prefix(1);
+                    }
+                    if (rest.empty()) {
+                        break;
+                    }
+                    if (rest.starts_with("off")) {
+                        smoothing = 0;
+                    } else {
+                        int id = parseIntAt(rest.data(),
+                                            rest.data() + rest.size());
+                        smoothing = id < 0 ? 0 : static_cast<unsigned>(id);
+                    }
+                    break;
+                }
+                default: break;
+            }
+        }
+        flushRun(chunk.faceSizes.size());
+    }
+
+    //
+    // Pass 3: triangulate every run in parallel.
+    //
+    std::vector<RunOutput> outputs(runs.size());
+    try {
+        pool.parallelFor(runs.size(), [&](size_t r) {
+            triangulateRun(runs[r], faces[runs[r].chunk], parsed.attrib,
+                           outputs[r]);
+            validateIndices(outputs[r], parsed.attrib);
+        });
+    } catch (const ObjParseError& e) {
+        throw IrrecoverableError{"Failed to load .obj file " + path.string() +
+                                 ": " + e.msg};
+    }
+    faces.clear();
+
+    bool skippedDegenerate = false;
+    bool skippedInvalid = false;
+    for (size_t r = 0; r < runs.size(); ++r) {
+        Slot& slot = slots[runs[r].slot];
+        slot.indexCount += outputs[r].indices.size();
+        slot.faceCount += outputs[r].numFaceVertices.size();
+        skippedDegenerate |= outputs[r].skippedDegenerate;
+        skippedInvalid |= outputs[r].skippedInvalid;
+    }
+    if (skippedDegenerate) {
+        parsed.warning += "Degenerated face found\n.";
+    }
+    if (skippedInvalid) {
+        parsed.warning += "Face with invalid vertex index found.\n";
+    }
+
+    //
+    // Stitch runs back into shapes, dropping shapes without faces (as
+    // tinyobj does), copying every run in parallel.
+    //
+    std::vector<size_t> slotToShape(slots.size(), SIZE_MAX);
+    for (size_t s = 0; s < slots.size(); ++s) {
+        if (slots[s].indexCount == 0) {
+            continue;
+        }
+        slotToShape[s] = parsed.shapes.size();
+        tinyobj::shape_t shape;
+        shape.name = slots[s].name;
+        shape.mesh.indices.resize(slots[s].indexCount);
+        shape.mesh.num_face_vertices.resize(slots[s].faceCount);
+        shape.mesh.material_ids.resize(slots[s].faceCount);
+        shape.mesh.smoothing_group_ids.resize(slots[s].faceCount);
+        parsed.shapes.push_back(std::move(shape));
+    }
+
+    std::vector<size_t> indexOffsets(runs.size());
+    std::vector<size_t> faceOffsets(runs.size());
+    {
+        std::vector<size_t> indexCursor(slots.size(), 0);
+        std::vector<size_t> faceCursor(slots.size(), 0);
+        for (size_t r = 0; r < runs.size(); ++r) {
+            size_t s = runs[r].slot;
+            indexOffsets[r] = indexCursor[s];
+            faceOffsets[r] = faceCursor[s];
+            indexCursor[s] += outputs[r].indices.size();
+            faceCursor[s] += outputs[r].numFaceVertices.size();
+        }
+    }
+
+    pool.parallelFor(runs.size(), [&](size_t r) {
+        if (outputs[r].indices.empty()) {
+            return;
+        }
+        auto& mesh = parsed.shapes[slotToShape[runs[r].slot]].mesh;
+        std::ranges::copy(outputs[r].indices,
+                          mesh.indices.begin() +
+                            static_cast<std::ptrdiff_t>(indexOffsets[r]));
+        auto faceAt = static_cast<std::ptrdiff_t>(faceOffsets[r]);
+        std::ranges::copy(outputs[r].numFaceVertices,
+                          mesh.num_face_vertices.begin() + faceAt);
+        std::ranges::copy(outputs[r].materialIds,
+                          mesh.material_ids.begin() + faceAt);
+        std::ranges::copy(outputs[r].smoothingIds,
+                          mesh.smoothing_group_ids.begin() + faceAt);
+        outputs[r] = {};
+    });
+
+    return parsed;
+}
@@ -0,0 +1,577 @@
+#include "frontend/occlusion.hpp"
+
+#include "util/perf.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+// occluder triangles set up and binned together, by one thread
+constexpr size_t chunkTriangles = 1024;
+
+constexpr int tilePixelCount =
+  OcclusionBuffer::tileWidth * OcclusionBuffer::tileHeight;
+
+int roundUpToTiles(int size, int tileSize)
+{
+    int tiles = std::max(1, (size + tileSize - 1) / tileSize);
+    return tiles * tileSize;
+}
+
+// Which sides of the view volume `v`, in clip space, is outside of.
+enum Outside : uint32_t
+{
+    outsideLeft = 1U << 0U,
+    outsideRight = 1U << 1U,
+    outsideBottom = 1U << 2U,
+    outsideTop = 1U << 3U,
+    outsideNear = 1U << 4U,
+    outsideFar = 1U << 5U,
+};
+
+uint32_t outsideOf(const glm::vec4& v)
+{
+    uint32_t outside = 0;
+    outside |= v.x < -v.w ? outsideLeft : 0U;
+    outside |= v.x > v.w ? outsideRight : 0U;
+    outside |= v.y < -v.w ? outsideBottom : 0U;
+    outside |= v.y > v.w ? outsideTop : 0U;
+    outside |= v.z < -v.w ? outsideNear : 0U;
+    outside |= v.z > v.w ? outsideFar : 0U;
+    return outside;
+}
+
+// A triangle's pixels on one row of a tile: the edge functions and 1 / w
+// with that row's y put in, left to be evaluated at each pixel's x.
+struct RowSpan
+{
+    // screen x of the row's first pixel, that of the tile
+    int rowLeft = 0;
+    // screen x of the pixels to rasterise, all within the row
+    int first = 0;
+    int last = 0;
+    float edgeA[3] = {};
+    float rowEdge[3] = {};
+    float depthA = 0.0F;
+    float rowDepth = 0.0F;
+};
+
+// Keeps the nearer of `row`'s pixels and the triangle's where the triangle
+// covers the pixel's center. The vectorised rasteriseRow() covers whole
+// groups of pixels, those outside the span masked off, and computes exactly
+// this.
+void rasteriseRowScalar(const RowSpan& span, float* row)
+{
+    for (int x = span.first; x <= span.last; ++x) {
+        float centerX = static_cast<float>(x) + 0.5F;
+        float edge0 = (span.edgeA[0] * centerX) + span.rowEdge[0];
+        float edge1 = (span.edgeA[1] * centerX) + span.rowEdge[1];
+        float edge2 = (span.edgeA[2] * centerX) + span.rowEdge[2];
+        if (edge0 >= 0.0F && edge1 >= 0.0F && edge2 >= 0.0F) {
+            float depth = (span.depthA * centerX) + span.rowDepth;
+            float& pixel = row[x - span.rowLeft];
+            pixel = std::max(pixel, depth);
+        }
+    }
+}
+
+#if defined(__AVX2__)
+void rasteriseRow(const RowSpan& span, float* row)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 offsets =
+      _mm256_setr_ps(0.5F, 1.5F, 2.5F, 3.5F, 4.5F, 5.5F, 6.5F, 7.5F);
+    __m256 edgeA[3];
+    __m256 rowEdge[3];
+    for (size_t i = 0; i < 3; ++i) {
+        edgeA[i] = _mm256_set1_ps(span.edgeA[i]);
+        rowEdge[i] = _mm256_set1_ps(span.rowEdge[i]);
+    }
+    __m256 depthA = _mm256_set1_ps(span.depthA);
+    __m256 rowDepth = _mm256_set1_ps(span.rowDepth);
+    __m256 first = _mm256_set1_ps(static_cast<float>(span.first));
+    __m256 pastLast = _mm256_set1_ps(static_cast<float>(span.last + 1));
+
+    for (int x = (span.first - span.rowLeft) & ~7;
+         x <= span.last - span.rowLeft; x += 8)
+    {
+        __m256 centerX = _mm256_add_ps(
+          _mm256_set1_ps(static_cast<float>(span.rowLeft + x)), offsets);
+        __m256 inside =
+          _mm256_and_ps(_mm256_cmp_ps(centerX, first, _CMP_GT_OQ),
+                        _mm256_cmp_ps(centerX, pastLast, _CMP_LT_OQ));
+        for (size_t i = 0; i < 3; ++i) {
+            __m256 edge =
+              _mm256_add_ps(_mm256_mul_ps(edgeA[i], centerX), rowEdge[i]);
+            inside =
+              _mm256_and_ps(inside, _mm256_cmp_ps(edge, zero, _CMP_GE_OQ));
+        }
+        __m256 depth = _mm256_add_ps(_mm256_mul_ps(depthA, centerX), rowDepth);
+        __m256 old = _mm256_loadu_ps(row + x);
+        _mm256_storeu_ps(
+          row + x, _mm256_blendv_ps(old, _mm256_max_ps(old, depth), inside));
+    }
+}
+#elif defined(__SSE2__) || defined(_M_X64)
+void rasteriseRow(const RowSpan& span, float* row)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 offsets = _mm_setr_ps(0.5F, 1.5F, 2.5F, 3.5F);
+    __m128 edgeA[3];
+    __m128 rowEdge[3];
+    for (size_t i = 0; i < 3; ++i) {
+        edgeA[i] = _mm_set1_ps(span.edgeA[i]);
+        rowEdge[i] = _mm_set1_ps(span.rowEdge[i]);
+    }
+    __m128 depthA = _mm_set1_ps(span.depthA);
+    __m128 rowDepth = _mm_set1_ps(span.rowDepth);
+    __m128 first = _mm_set1_ps(static_cast<float>(span.first));
+    __m128 pastLast = _mm_set1_ps(static_cast<float>(span.last + 1));
+
+    for (int x = (span.first - span.rowLeft) & ~3;
+         x <= span.last - span.rowLeft; x += 4)
+    {
+        __m128 centerX = _mm_add_ps(
+          _mm_set1_ps(static_cast<float>(span.rowLeft + x)), offsets);
+        __m128 inside = _mm_and_ps(_mm_cmpgt_ps(centerX, first),
+                                   _mm_cmplt_ps(centerX, pastLast));
+        for (size_t i = 0; i < 3; ++i) {
+            __m128 edge = _mm_add_ps(_mm_mul_ps(edgeA[i], centerX), rowEdge[i]);
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(edge, zero));
+        }
+        __m128 depth = _mm_add_ps(_mm_mul_ps(depthA, centerX), rowDepth);
+        __m128 old = _mm_loadu_ps(row + x);
+        __m128 nearer = _mm_max_ps(old, depth);
+        _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer),
+                                         _mm_andnot_ps(inside, old)));
+    }
+}
+#else
+void rasteriseRow(const RowSpan& span, float* row)
+{
+    rasteriseRowScalar(span, row);
+}
+#endif
+} // anonymous namespace
+
+const char* occlusionSimdPath()
+{
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE2__) || defined(_M_X64)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+OcclusionBuffer::OcclusionBuffer(int width, int height)
+{
+    resize(width, height);
+}
+
+void OcclusionBuffer::resize(int newWidth, int newHeight)
+{
+    newWidth = roundUpToTiles(newWidth, tileWidth);
+    newHeight = roundUpToTiles(newHeight, tileHeight);
+    if (newWidth == width && newHeight == height) {
+        return;
+    }
+    width = newWidth;
+    height = newHeight;
+    tilesX = width / tileWidth;
+    tilesY = height / tileHeight;
+    depths.assign(static_cast<size_t>(width) * height, 0.0F);
+    tileMinDepths.assign(static_cast<size_t>(tilesX) * tilesY, 0.0F);
+    chunks.clear();
+    chunkCount = 0;
+}
+
+int OcclusionBuffer::getWidth() const
+{
+    return width;
+}
+
+int OcclusionBuffer::getHeight() const
+{
+    return height;
+}
+
+void OcclusionBuffer::begin(const glm::mat4& newClipFromWorld)
+{
+    clipFromWorld = newClipFromWorld;
+    occluders.clear();
+    triangleCount = 0;
+    chunkCount = 0;
+    std::ranges::fill(depths, 0.0F);
+    std::ranges::fill(tileMinDepths, 0.0F);
+    stats = {};
+}
+
+void OcclusionBuffer::begin(const Camera& camera)
+{
+    begin(camera.computeProjectionMatrix() * camera.computeViewMatrix());
+}
+
+void OcclusionBuffer::addOccluder(const OccluderMesh& mesh,
+                                  const glm::mat4& model)
+{
+    occluders.push_back({.mesh = &mesh,
+                         .clipFromObject = clipFromWorld * model,
+                         .firstTriangle = triangleCount});
+    triangleCount += mesh.indices.size() / 3;
+}
+
+void OcclusionBuffer::rasterise(ThreadPool& pool)
+{
+    Stopwatch timer;
+    setUpTriangles(pool);
+    rasteriseTiles(pool, false);
+    stats.rasteriseMilliseconds = timer.elapsedMilliseconds();
+}
+
+void OcclusionBuffer::rasteriseScalar(ThreadPool& pool)
+{
+    Stopwatch timer;
+    setUpTriangles(pool);
+    rasteriseTiles(pool, true);
+    stats.rasteriseMilliseconds = timer.elapsedMilliseconds();
+}
+
+bool OcclusionBuffer::isVisible(const Aabb& box, const glm::mat4& model) const
+{
+    glm::mat4 clipFromObject = clipFromWorld * model;
+
+    //
+    // The corners on screen, and the nearest of them
+    //
+    float minX = std::numeric_limits<float>::max();
+    float minY = std::numeric_limits<float>::max();
+    float maxX = std::numeric_limits<float>::lowest();
+    float maxY = std::numeric_limits<float>::lowest();
+    float nearest = 0.0F;
+    for (uint32_t corner = 0; corner < 8; ++corner) {
+        glm::vec4 position{(corner & 1U) != 0 ? box.max.x : box.min.x,
+                           (corner & 2U) != 0 ? box.max.y : box.min.y,
+                           (corner & 4U) != 0 ? box.max.z : box.min.z, 1.0F};
+        glm::vec4 clip = clipFromObject * position;
+        if (clip.w <= 0.0F || clip.z < -clip.w) {
+            return true;
+        }
+        float inverseW = 1.0F / clip.w;
+        float x =
+          ((clip.x * inverseW * 0.5F) + 0.5F) * static_cast<float>(width);
+        float y =
+          (0.5F - (clip.y * inverseW * 0.5F)) * static_cast<float>(height);
+        minX = std::min(minX, x);
+        minY = std::min(minY, y);
+        maxX = std::max(maxX, x);
+        maxY = std::max(maxY, y);
+        nearest = std::max(nearest, inverseW);
+    }
+
+    // Every pixel the corners touch and one more around them, so a box in
+    // the part of an occluder's edge pixel the occluder leaves uncovered
+    // still reaches a pixel past that edge
+    float left = std::floor(minX) - 1.0F;
+    float top = std::floor(minY) - 1.0F;
+    float right = std::floor(maxX) + 1.0F;
+    float bottom = std::floor(maxY) + 1.0F;
+    if (right < 0.0F || bottom < 0.0F || left >= static_cast<float>(width) ||
+        top >= static_cast<float>(height))
+    {
+        return false;
+    }
+    int x0 = static_cast<int>(std::max(left, 0.0F));
+    int y0 = static_cast<int>(std::max(top, 0.0F));
+    int x1 = static_cast<int>(std::min(right, static_cast<float>(width - 1)));
+    int y1 = static_cast<int>(std::min(bottom, static_cast<float>(height - 1)));
+
+    //
+    // Hidden if an occluder is nearer everywhere; whole tiles first
+    //
+    for (int tileY = y0 / tileHeight; tileY <= y1 / tileHeight; ++tileY) {
+        for (int tileX = x0 / tileWidth; tileX <= x1 / tileWidth; ++tileX) {
+            if (nearest < tileMinDepths[(tileY * tilesX) + tileX]) {
+                continue;
+            }
+            int fromY = std::max(y0, tileY * tileHeight);
+            int toY = std::min(y1, ((tileY + 1) * tileHeight) - 1);
+            int fromX = std::max(x0, tileX * tileWidth);
+            int toX = std::min(x1, ((tileX + 1) * tileWidth) - 1);
+            for (int y = fromY; y <= toY; ++y) {
+                for (int x = fromX; x <= toX; ++x) {
+                    if (depths[pixelIndex(x, y)] <= nearest) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool OcclusionBuffer::isVisible(const Aabb& box) const
+{
+    return isVisible(box, glm::mat4{1.0F});
+}
+
+float OcclusionBuffer::getDepth(int x, int y) const
+{
+    return depths[pixelIndex(x, y)];
+}
+
+void OcclusionBuffer::writeDebugImage(std::vector<unsigned char>& rgb) const
+{
+    float nearest = std::ranges::max(depths);
+    float scale = nearest > 0.0F ? 255.0F / nearest : 0.0F;
+    rgb.resize(static_cast<size_t>(width) * height * 3);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            auto value = static_cast<unsigned char>(
+              std::clamp(getDepth(x, y) * scale, 0.0F, 255.0F));
+            size_t pixel = ((static_cast<size_t>(y) * width) + x) * 3;
+            rgb[pixel] = value;
+            rgb[pixel + 1] = value;
+            rgb[pixel + 2] = value;
+        }
+    }
+}
+
+const OcclusionStats& OcclusionBuffer::getStats() const
+{
+    return stats;
+}
+
+void OcclusionBuffer::setUpTriangles(ThreadPool& pool)
+{
+    size_t tileCount = static_cast<size_t>(tilesX) * tilesY;
+    chunkCount = (triangleCount + chunkTriangles - 1) / chunkTriangles;
+    if (chunks.size() < chunkCount) {
+        chunks.resize(chunkCount);
+    }
+
+    pool.parallelFor(chunkCount, [&](size_t c) {
+        Chunk& chunk = chunks[c];
+        chunk.triangles.clear();
+        chunk.tileTriangles.resize(tileCount);
+        for (auto& triangles : chunk.tileTriangles) {
+            triangles.clear();
+        }
+
+        size_t first = c * chunkTriangles;
+        size_t last = std::min(first + chunkTriangles, triangleCount);
+        // the occluder holding `first`
+        auto occluder = std::ranges::upper_bound(occluders, first, {},
+                                                 &Occluder::firstTriangle) -
+                        1;
+        for (size_t t = first; t < last; ++t) {
+            while (t >= occluder->firstTriangle +
+                          (occluder->mesh->indices.size() / 3))
+            {
+                ++occluder;
+            }
+            const OccluderMesh& mesh = *occluder->mesh;
+            size_t index = (t - occluder->firstTriangle) * 3;
+            glm::vec4 clip[3];
+            for (size_t v = 0; v < 3; ++v) {
+                clip[v] = occluder->clipFromObject *
+                          glm::vec4{mesh.positions[mesh.indices[index + v]],
+                                    1.0F};
+            }
+
+            uint32_t outside0 = outsideOf(clip[0]);
+            uint32_t outside1 = outsideOf(clip[1]);
+            uint32_t outside2 = outsideOf(clip[2]);
+            if ((outside0 & outside1 & outside2) != 0) {
+                continue;
+            }
+            if (((outside0 | outside1 | outside2) & outsideNear) == 0) {
+                addTriangle(chunk, clip[0], clip[1], clip[2]);
+                continue;
+            }
+
+            // Clipped by the near plane into a triangle or a quad
+            glm::vec4 polygon[4];
+            size_t count = 0;
+            for (size_t v = 0; v < 3; ++v) {
+                const glm::vec4& from = clip[v];
+                const glm::vec4& to = clip[(v + 1) % 3];
+                float fromDistance = from.z + from.w;
+                float toDistance = to.z + to.w;
+                if (fromDistance >= 0.0F) {
+                    polygon[count++] = from;
+                }
+                if ((fromDistance >= 0.0F) != (toDistance >= 0.0F)) {
+                    float t = fromDistance / (fromDistance - toDistance);
+                    polygon[count++] = from + ((to - from) * t);
+                }
+            }
+            for (size_t v = 2; v < count; ++v) {
+                addTriangle(chunk, polygon[0], polygon[v - 1], polygon[v]);
+            }
+        }
+    });
+
+    stats.occluders = occluders.size();
+    stats.triangles = triangleCount;
+    stats.trianglesRasterised = 0;
+    for (size_t c = 0; c < chunkCount; ++c) {
+        stats.trianglesRasterised += chunks[c].triangles.size();
+    }
+}
+
+void OcclusionBuffer::addTriangle(Chunk& chunk, glm::vec4 a, glm::vec4 b,
+                                  glm::vec4 c) const
+{
+    if (a.w <= 0.0F || b.w <= 0.0F || c.w <= 0.0F) {
+        return;
+    }
+    // x and y in pixels, y down, and 1 / w
+    auto project = [this](const glm::vec4& v) {
+        float inverseW = 1.0F / v.w;
+        return glm::vec3{
+          ((v.x * inverseW * 0.5F) + 0.5F) * static_cast<float>(width),
+          (0.5F - (v.y * inverseW * 0.5F)) * static_cast<float>(height),
+          inverseW};
+    };
+    glm::vec3 p0 = project(a);
+    glm::vec3 p1 = project(b);
+    glm::vec3 p2 = project(c);
+
+    // Front faces are counter-clockwise in clip space, so clockwise with y
+    // down; swapping two corners makes them positive like back faces
+    float area =
+      ((p1.x - p0.x) * (p2.y - p0.y)) - ((p2.x - p0.x) * (p1.y - p0.y));
+    if (!(area < 0.0F)) {
+        return;
+    }
+    std::swap(p1, p2);
+    area = -area;
+
+    //
+    // The pixels whose centers may be inside
+    //
+    float left = std::ceil(std::min({p0.x, p1.x, p2.x}) - 0.5F);
+    float top = std::ceil(std::min({p0.y, p1.y, p2.y}) - 0.5F);
+    float right = std::floor(std::max({p0.x, p1.x, p2.x}) - 0.5F);
+    float bottom = std::floor(std::max({p0.y, p1.y, p2.y}) - 0.5F);
+    left = std::max(left, 0.0F);
+    top = std::max(top, 0.0F);
+    right = std::min(right, static_cast<float>(width - 1));
+    bottom = std::min(bottom, static_cast<float>(height - 1));
+    if (left > right || top > bottom) {
+        return;
+    }
+
+    RasterTriangle triangle{};
+    triangle.minX = static_cast<int>(left);
+    triangle.minY = static_cast<int>(top);
+    triangle.maxX = static_cast<int>(right);
+    triangle.maxY = static_cast<int>(bottom);
+
+    // Edge i runs from corner i to the next one, positive on the inside
+    const glm::vec3* corners[3] = {&p0, &p1, &p2};
+    for (size_t i = 0; i < 3; ++i) {
+        const glm::vec3& from = *corners[i];
+        const glm::vec3& to = *corners[(i + 1) % 3];
+        triangle.edgeA[i] = from.y - to.y;
+        triangle.edgeB[i] = to.x - from.x;
+        triangle.edgeC[i] = (from.x * to.y) - (from.y * to.x);
+    }
+
+    // 1 / w as a plane, lowered to the farthest it gets within a pixel so
+    // the pixel's center stands for all of it
+    float depthX = (((p1.z - p0.z) * (p2.y - p0.y)) -
+                    ((p2.z - p0.z) * (p1.y - p0.y))) /
+                   area;
+    float depthY = (((p2.z - p0.z) * (p1.x - p0.x)) -
+                    ((p1.z - p0.z) * (p2.x - p0.x))) /
+                   area;
+    triangle.depthA = depthX;
+    triangle.depthB = depthY;
+    triangle.depthC = p0.z - (depthX * p0.x) - (depthY * p0.y) -
+                      (0.5F * (std::abs(depthX) + std::abs(depthY)));
+
+    auto index = static_cast<uint32_t>(chunk.triangles.size());
+    chunk.triangles.push_back(triangle);
+    for (int tileY = triangle.minY / tileHeight;
+         tileY <= triangle.maxY / tileHeight; ++tileY)
+    {
+        for (int tileX = triangle.minX / tileWidth;
+             tileX <= triangle.maxX / tileWidth; ++tileX)
+        {
+            chunk.tileTriangles[(tileY * tilesX) + tileX].push_back(index);
+        }
+    }
+}
+
+void OcclusionBuffer::rasteriseTiles(ThreadPool& pool, bool scalar)
+{
+    pool.parallelFor(static_cast<size_t>(tilesX) * tilesY, [&](size_t tile) {
+        rasteriseTile(static_cast<int>(tile), scalar);
+    });
+}
+
+void OcclusionBuffer::rasteriseTile(int tile, bool scalar)
+{
+    float* pixels = tilePixels(tile);
+    std::fill_n(pixels, tilePixelCount, 0.0F);
+    int tileLeft = (tile % tilesX) * tileWidth;
+    int tileTop = (tile / tilesX) * tileHeight;
+
+    for (size_t c = 0; c < chunkCount; ++c) {
+        const Chunk& chunk = chunks[c];
+        for (uint32_t index : chunk.tileTriangles[tile]) {
+            const RasterTriangle& triangle = chunk.triangles[index];
+            RowSpan span;
+            span.rowLeft = tileLeft;
+            span.first = std::max(triangle.minX, tileLeft);
+            span.last = std::min(triangle.maxX, tileLeft + tileWidth - 1);
+            std::copy_n(triangle.edgeA, 3, span.edgeA);
+            span.depthA = triangle.depthA;
+            int y0 = std::max(triangle.minY, tileTop);
+            int y1 = std::min(triangle.maxY, tileTop + tileHeight - 1);
+            for (int y = y0; y <= y1; ++y) {
+                float centerY = static_cast<float>(y) + 0.5F;
+                for (size_t i = 0; i < 3; ++i) {
+                    span.rowEdge[i] =
+                      (triangle.edgeB[i] * centerY) + triangle.edgeC[i];
+                }
+                span.rowDepth = (triangle.depthB * centerY) + triangle.depthC;
+                float* row =
+                  pixels + (static_cast<ptrdiff_t>(y - tileTop) * tileWidth);
+                if (scalar) {
+                    rasteriseRowScalar(span, row);
+                } else {
+                    rasteriseRow(span, row);
+                }
+            }
+        }
+    }
+
+    tileMinDepths[tile] = *std::min_element(pixels, pixels + tilePixelCount);
+}
+
+float* OcclusionBuffer::tilePixels(int tile)
+{
+    return depths.data() + (static_cast<ptrdiff_t>(tile) * tilePixelCount);
+}
+
+size_t OcclusionBuffer::pixelIndex(int x, int y) const
+{
+    size_t tile = (static_cast<size_t>(y / tileHeight) * tilesX) +
+                  static_cast<size_t>(x / tileWidth);
+    return (tile * tilePixelCount) +
+           (static_cast<size_t>(y % tileHeight) * tileWidth) +
+           static_cast<size_t>(x % tileWidth);
+}
@@ -0,0 +1,301 @@
+#include "frontend/renderQueue.hpp"
+#include "frontend/glState.hpp"
+
+#include "util/perf.hpp"
+
+#include <algorithm>
+#include <array>
+#include <span>
+
+namespace
+{
+constexpr int programBits = 10;
+constexpr int textureBits = 16;
+constexpr int depthBits = 22;
+constexpr int meshBits = 16;
+static_assert(programBits + textureBits + depthBits + meshBits == 64);
+
+uint64_t fold(uint64_t value, int bits)
+{
+    uint64_t mask = (uint64_t{1} << bits) - 1;
+    uint64_t folded = 0;
+    while (value != 0) {
+        folded ^= value & mask;
+        value >>= bits;
+    }
+    return folded;
+}
+
+// Allocations are at least 16-byte aligned, so the low bits say nothing
+uint64_t foldAddress(const void* address, int bits)
+{
+    return fold(reinterpret_cast<uintptr_t>(address) >> 4, bits);
+}
+
+uint64_t sortKey(const DrawPacket& packet, float depth)
+{
+    uint32_t textures = packet.material.textureArray != 0
+                          ? packet.material.textureArray
+                          : packet.material.texture;
+    auto depthSteps = static_cast<uint64_t>(
+      std::clamp(depth, 0.0F, 1.0F) *
+      static_cast<float>((uint64_t{1} << depthBits) - 1));
+
+    uint64_t key = foldAddress(packet.shader, programBits);
+    key = (key << textureBits) | fold(textures, textureBits);
+    key = (key << depthBits) | depthSteps;
+    key = (key << meshBits) | foldAddress(packet.mesh, meshBits);
+    return key;
+}
+
+DrawParams drawParamsOf(const DrawPacket& packet)
+{
+    const DrawMaterial& material = packet.material;
+    bool textured = material.textureArray != 0 || material.texture != 0;
+    return makeDrawParams(packet.quantization, textured ? material.layer : -1,
+                          material.topRowFirst);
+}
+
+// Whether `next` can be drawn by the same multi-draw as `packet`
+bool mergeable(const DrawPacket& packet, const DrawPacket& next)
+{
+    return next.shader == packet.shader &&
+           next.mesh->getArena() == packet.mesh->getArena() &&
+           next.material.texture == packet.material.texture &&
+           next.material.textureArray == packet.material.textureArray &&
+           next.transform == packet.transform;
+}
+} // namespace
+
+void RenderQueue::begin(const Camera& camera, const SceneLighting& lighting)
+{
+    this->camera = camera;
+    this->lighting = lighting;
+    frameUniforms.clearObjects();
+    packets.clear();
+    order.clear();
+    rangeCounts.clear();
+    rangeOffsets.clear();
+    sorted = true;
+    sortMilliseconds = 0.0;
+}
+
+uint32_t RenderQueue::addTransform(const glm::mat4& model)
+{
+    return frameUniforms.addObject(model);
+}
+
+std::vector<uint8_t>& RenderQueue::visibilityScratch()
+{
+    return visibility;
+}
+
+uint32_t RenderQueue::addRange(GLsizei count, const void* offset)
+{
+    rangeCounts.push_back(count);
+    rangeOffsets.push_back(offset);
+    return static_cast<uint32_t>(rangeCounts.size() - 1);
+}
+
+void RenderQueue::submit(const DrawPacket& packet, const glm::vec3& center)
+{
+    float depth = glm::dot(center - camera.position, camera.computeForward()) /
+                  camera.farPlane;
+    order.push_back({.key = sortKey(packet, depth),
+                     .packet = static_cast<uint32_t>(packets.size())});
+    packets.push_back(packet);
+    sorted = false;
+}
+
+void RenderQueue::sort()
+{
+    if (sorted) {
+        return;
+    }
+    Stopwatch timer;
+
+    // Digits every key has alike need no pass
+    uint64_t varying = 0;
+    for (const SortItem& item : order) {
+        varying |= item.key ^ order.front().key;
+    }
+
+    // Least significant digit first, 8 bits at a time; each pass is stable
+    scratch.resize(order.size());
+    for (int shift = 0; shift < 64; shift += 8) {
+        if (((varying >> shift) & 0xFFU) == 0) {
+            continue;
+        }
+        std::array<size_t, 257> offsets{};
+        for (const SortItem& item : order) {
+            ++offsets[((item.key >> shift) & 0xFFU) + 1];
+        }
+        for (size_t digit = 1; digit < offsets.size(); ++digit) {
+            offsets[digit] += offsets[digit - 1];
+        }
+        for (const SortItem& item : order) {
+            scratch[offsets[(item.key >> shift) & 0xFFU]++] = item;
+        }
+        order.swap(scratch);
+    }
+
+    sorted = true;
+    sortMilliseconds = timer.elapsedMilliseconds();
+}
+
+void RenderQueue::buildIndirectCommands()
+{
+    drawParams.clear();
+    commands.clear();
+    firstCommands.clear();
+    for (const SortItem& item : order) {
+        firstCommands.push_back(static_cast<uint32_t>(commands.size()));
+        const DrawPacket& packet = packets[item.packet];
+        const GeometryArena* arena = packet.mesh->getArena();
+        if (arena == nullptr) {
+            continue;
+        }
+
+        const ArenaRange& range = packet.mesh->getArenaRange();
+        auto instance = static_cast<GLuint>(drawParams.size());
+        drawParams.push_back(drawParamsOf(packet));
+        auto addCommand = [&](size_t first, size_t count) {
+            commands.push_back({.count = static_cast<GLuint>(count),
+                                .instanceCount = 1,
+                                .firstIndex = static_cast<GLuint>(
+                                  range.firstIndex + first),
+                                .baseVertex = range.baseVertex,
+                                .baseInstance = instance});
+        };
+        if (packet.rangeCount == 0) {
+            addCommand(packet.firstIndex, packet.indexCount);
+            continue;
+        }
+        size_t indexSize = arena->getIndexSize();
+        for (uint32_t r = packet.firstRange;
+             r < packet.firstRange + packet.rangeCount; ++r)
+        {
+            addCommand(reinterpret_cast<uintptr_t>(rangeOffsets[r]) / indexSize,
+                       static_cast<size_t>(rangeCounts[r]));
+        }
+    }
+    firstCommands.push_back(static_cast<uint32_t>(commands.size()));
+
+    if (commands.empty()) {
+        return;
+    }
+    if (!drawParamsBuffer) {
+        drawParamsBuffer.emplace();
+    }
+    drawParamsBuffer->uploadData(drawParams, GL_STREAM_DRAW);
+    commandBuffer.upload(commands);
+}
+
+RenderQueueStats RenderQueue::execute()
+{
+    sort();
+
+    RenderQueueStats stats;
+    stats.packets = packets.size();
+    stats.sortMilliseconds = sortMilliseconds;
+
+    // Bound once for the whole frame
+    frameUniforms.setCamera(camera);
+    frameUniforms.setLighting(lighting);
+    frameUniforms.uploadObjects();
+
+    // Draws from arenas merge into multi-draws if the context has them
+    bool indirect = multiDrawIndirectSupported();
+    if (indirect) {
+        buildIndirectCommands();
+    }
+
+    size_t i = 0;
+    while (i < order.size()) {
+        Shader& shader = *packets[order[i].packet].shader;
+        auto bound = shader.bind();
+        ++stats.programBinds;
+
+        // Unchanged bindings are skipped by GLState, and unchanged DrawParams
+        // by setConstantDrawParams(); these only save comparing them
+        GLuint lastVertexArray = 0;
+        uint32_t lastTexture = 0;
+        uint32_t lastTextureArray = 0;
+        uint32_t lastTransform = UINT32_MAX;
+
+        while (i < order.size() && packets[order[i].packet].shader == &shader) {
+            const DrawPacket& packet = packets[order[i].packet];
+            const DrawMaterial& material = packet.material;
+
+            if (material.textureArray != 0) {
+                if (material.textureArray != lastTextureArray) {
+                    GLState::current().bindTextureUnit(
+                      1, GL_TEXTURE_2D_ARRAY, material.textureArray);
+                    lastTextureArray = material.textureArray;
+                    ++stats.textureBinds;
+                }
+            } else if (material.texture != 0 &&
+                       material.texture != lastTexture) {
+                GLState::current().bindTextureUnit(0, GL_TEXTURE_2D,
+                                                   material.texture);
+                lastTexture = material.texture;
+                ++stats.textureBinds;
+            }
+
+            if (packet.transform != lastTransform) {
+                frameUniforms.bindObject(packet.transform);
+                lastTransform = packet.transform;
+            }
+
+            if (packet.mesh->getVAO() != lastVertexArray) {
+                lastVertexArray = packet.mesh->getVAO();
+                ++stats.meshBinds;
+            }
+            ++stats.drawCalls;
+
+            const GeometryArena* arena =
+              indirect ? packet.mesh->getArena() : nullptr;
+            if (arena != nullptr) {
+                size_t end = i + 1;
+                while (end < order.size() &&
+                       mergeable(packet, packets[order[end].packet]))
+                {
+                    ++end;
+                }
+                size_t first = firstCommands[i];
+                size_t count = firstCommands[end] - first;
+                arena->multiDrawIndirect(bound, *drawParamsBuffer, first,
+                                         count);
+                ++stats.multiDraws;
+                stats.indirectCommands += count;
+                i = end;
+                continue;
+            }
+
+            setConstantDrawParams(drawParamsOf(packet));
+            if (packet.rangeCount != 0) {
+                packet.mesh->drawIndexRanges(
+                  bound,
+                  std::span<const GLsizei>{rangeCounts}.subspan(
+                    packet.firstRange, packet.rangeCount),
+                  std::span<const void* const>{rangeOffsets}.subspan(
+                    packet.firstRange, packet.rangeCount));
+            } else {
+                packet.mesh->drawIndexRange(bound, packet.firstIndex,
+                                            packet.indexCount);
+            }
+            ++i;
+        }
+    }
+    return stats;
+}
+
+size_t RenderQueue::size() const
+{
+    return packets.size();
+}
+
+const DrawPacket& RenderQueue::sortedPacket(size_t i) const
+{
+    return packets[order[i].packet];
+}
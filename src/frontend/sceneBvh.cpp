@@ -0,0 +1,93 @@
+#include "frontend/sceneBvh.hpp"
+
+Ray rayThroughCursor(const Camera& camera, glm::vec2 cursor,
+                     glm::vec2 windowSize)
+{
+    glm::vec2 ndc{((2.0F * cursor.x) / windowSize.x) - 1.0F,
+                  1.0F - ((2.0F * cursor.y) / windowSize.y)};
+    glm::mat4 worldFromClip = glm::inverse(camera.computeProjectionMatrix() *
+                                           camera.computeViewMatrix());
+    glm::vec4 nearClip = worldFromClip * glm::vec4{ndc.x, ndc.y, -1.0F, 1.0F};
+    glm::vec4 farClip = worldFromClip * glm::vec4{ndc.x, ndc.y, 1.0F, 1.0F};
+    glm::vec3 nearPoint = glm::vec3{nearClip} / nearClip.w;
+    glm::vec3 farPoint = glm::vec3{farClip} / farClip.w;
+    return {.origin = camera.position,
+            .direction = glm::normalize(farPoint - nearPoint)};
+}
+
+uint32_t SceneBvh::add(const LoadedObject& object)
+{
+    glm::mat4 model = object.pose.computeTransform();
+    uint32_t id = bvh.add(worldBoxOf(object, model));
+    if (id >= entries.size()) {
+        entries.resize(id + 1);
+    }
+    entries[id] = {.object = &object,
+                   .model = model,
+                   .shapeCount = object.shapes.size()};
+    return id;
+}
+
+void SceneBvh::remove(uint32_t id)
+{
+    bvh.remove(id);
+    entries[id] = {};
+}
+
+bool SceneBvh::update()
+{
+    for (uint32_t id = 0; id < entries.size(); ++id) {
+        Entry& entry = entries[id];
+        if (entry.object == nullptr) {
+            continue;
+        }
+        glm::mat4 model = entry.object->pose.computeTransform();
+        if (model != entry.model ||
+            entry.object->shapes.size() != entry.shapeCount)
+        {
+            entry.model = model;
+            entry.shapeCount = entry.object->shapes.size();
+            bvh.setBox(id, worldBoxOf(*entry.object, model));
+        }
+    }
+    return bvh.update();
+}
+
+void SceneBvh::cull(const Frustum& frustum,
+                    std::vector<const LoadedObject*>& visible) const
+{
+    std::vector<uint32_t> ids;
+    bvh.cull(frustum, ids);
+    for (uint32_t id : ids) {
+        visible.push_back(entries[id].object);
+    }
+}
+
+std::optional<SceneHit> SceneBvh::raycast(const Ray& ray,
+                                          float maxDistance) const
+{
+    auto hit = bvh.raycast(ray, maxDistance, [&](uint32_t id, float limit) {
+        return entries[id].object->raycast(ray, limit);
+    });
+    if (!hit) {
+        return std::nullopt;
+    }
+    return SceneHit{.object = entries[hit->primitive].object,
+                    .distance = hit->distance,
+                    .position = ray.origin + (ray.direction * hit->distance)};
+}
+
+size_t SceneBvh::size() const
+{
+    return bvh.size();
+}
+
+const Bvh& SceneBvh::getBvh() const
+{
+    return bvh;
+}
+
+Aabb SceneBvh::worldBoxOf(const LoadedObject& object, const glm::mat4& model)
+{
+    return transformAabb(object.computeBox(), model);
+}
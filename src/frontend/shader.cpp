@@ -1,7 +1,10 @@
 #include "frontend/shader.hpp"
+#include "frontend/glState.hpp"
+#include "frontend/uniformBlocks.hpp"
 #include "util/error.hpp"
 #include "util/logger.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -63,6 +66,7 @@ const char* getGLTypeName(GLenum type)
         case GL_FLOAT_MAT4: return "mat4";
         case GL_SAMPLER_2D: return "sampler2D";
         case GL_SAMPLER_CUBE: return "samplerCube";
+        case GL_SAMPLER_2D_ARRAY: return "sampler2DArray";
         default: return "unknown";
     }
 }
@@ -90,7 +94,7 @@ Shader::Shader(const std::filesystem::path& vertexPath,
 Shader::~Shader()
 {
     if (programId != 0) {
-        glDeleteProgram(programId);
+        GLState::current().deleteProgram(programId);
     }
 }
 
@@ -124,6 +128,7 @@ void Shader::loadFromSource(const std::string& vertexSource,
     try {
         linkProgram(vertexShader, geoShader, fragmentShader);
         discoverUniforms();
+        bindUniformBlocks();
     } catch (const IrrecoverableError& e) {
         glDeleteShader(vertexShader);
         if (geoShader != 0) {
@@ -211,6 +216,7 @@ void Shader::linkProgram(GLuint vertexShader, GLuint geoShader,
 void Shader::discoverUniforms()
 {
     uniforms.clear();
+    slots.clear();
 
     GLint uniformCount = 0;
     glGetProgramiv(programId, GL_ACTIVE_UNIFORMS, &uniformCount);
@@ -230,124 +236,175 @@ void Shader::discoverUniforms()
               glGetUniformLocation(programId, uniformName.c_str());
 
             if (location != -1) {
-                UniformInfo info{
-                  .location = location, .type = type, .name = uniformName};
+                UniformInfo info{.location = location,
+                                 .type = type,
+                                 .name = uniformName,
+                                 .slot = static_cast<uint32_t>(slots.size())};
                 uniforms[uniformName] = info;
+                slots.push_back({.location = location});
             }
         }
     }
 }
 
-const std::unordered_map<std::string, Shader::UniformInfo>&
-Shader::getUniforms() const
+void Shader::bindUniformBlocks()
+{
+    GLint blockCount = 0;
+    glGetProgramiv(programId, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+
+    for (GLint i = 0; i < blockCount; ++i) {
+        std::array<char, 256> name{};
+        GLsizei length = 0;
+        glGetActiveUniformBlockName(programId, static_cast<GLuint>(i),
+                                    name.size(), &length, name.data());
+
+        std::string_view blockName{name.data(),
+                                   static_cast<size_t>(std::max(length, 0))};
+        if (auto block = uniformBlockNamed(blockName)) {
+            glUniformBlockBinding(programId, static_cast<GLuint>(i),
+                                  static_cast<GLuint>(*block));
+        } else {
+            Logger::log("WARNING: Uniform block '" + std::string{blockName} +
+                        "' is not one of the shared blocks, left unbound");
+        }
+    }
+}
+
+const Shader::UniformMap& Shader::getUniforms() const
 {
     return uniforms;
 }
 
 const Shader::UniformInfo&
-Shader::BindObject::getUniformInfo(const std::string& name) const
+Shader::BindObject::getUniformInfo(std::string_view name) const
 {
     auto it = shader.uniforms.find(name);
     if (it == shader.uniforms.end()) {
-        throw IrrecoverableError{"Uniform '" + name +
+        throw IrrecoverableError{"Uniform '" + std::string{name} +
                                  "' does not exist in shader program"};
     }
     return it->second;
 }
 
-bool Shader::BindObject::hasUniform(const std::string& name) const
+bool Shader::BindObject::hasUniform(std::string_view name) const
 {
     return shader.uniforms.contains(name);
 }
 
-std::optional<Shader::UniformInfo>
-Shader::BindObject::validateUniform(const std::string& name,
-                                    GLenum expectedType) const
+const Shader::UniformInfo* Shader::findUniform(std::string_view name,
+                                               GLenum expectedType) const
 {
-    auto it = shader.uniforms.find(name);
-    if (it == shader.uniforms.end()) {
-        if (!shader.warnedMissingUniforms.contains(name)) {
-            Logger::log("WARNING: Uniform '" + name +
+    auto it = uniforms.find(name);
+    if (it == uniforms.end()) {
+        if (!warnedMissingUniforms.contains(name)) {
+            Logger::log("WARNING: Uniform '" + std::string{name} +
                         "' does not exist in shader program");
-            shader.warnedMissingUniforms.insert(name);
+            warnedMissingUniforms.emplace(name);
         }
-        return {};
+        return nullptr;
     }
 
-    if (it->second.type != expectedType) {
-        if (!shader.warnedTypeMismatches.contains(name)) {
-            Logger::log("WARNING: Uniform '" + name +
+    // ints set samplers too
+    GLenum type = it->second.type;
+    bool sampler = type == GL_SAMPLER_2D || type == GL_SAMPLER_2D_ARRAY;
+    if (type != expectedType && !(expectedType == GL_INT && sampler)) {
+        if (!warnedTypeMismatches.contains(it->first)) {
+            Logger::log("WARNING: Uniform '" + it->first +
                         "' type mismatch. Expected " +
                         getGLTypeName(expectedType) + ", got " +
-                        getGLTypeName(it->second.type));
-            shader.warnedTypeMismatches.insert(name);
+                        getGLTypeName(type));
+            warnedTypeMismatches.insert(it->first);
         }
     }
 
-    return it->second;
+    return &it->second;
 }
 
-void Shader::BindObject::setUniformSampler2D(const std::string& name, int value)
+void Shader::BindObject::setUniformSampler2D(std::string_view name, int value)
 {
-    if (const auto& info = validateUniform(name, GL_SAMPLER_2D)) {
-        glUniform1i(info->location, value);
-    }
+    setByName(name, GL_SAMPLER_2D, value);
 }
 
-void Shader::BindObject::setUniformInt(const std::string& name, int value)
+void Shader::BindObject::setUniformSampler2DArray(std::string_view name,
+                                                 int value)
 {
-    if (const auto& info = validateUniform(name, GL_INT)) {
-        glUniform1i(info->location, value);
-    }
+    setByName(name, GL_SAMPLER_2D_ARRAY, value);
 }
 
-void Shader::BindObject::setUniform(const std::string& name, float value)
+void Shader::BindObject::setUniformInt(std::string_view name, int value)
 {
-    if (const auto& info = validateUniform(name, GL_FLOAT)) {
-        glUniform1f(info->location, value);
-    }
+    setByName(name, GL_INT, value);
+}
+
+void Shader::BindObject::setUniform(std::string_view name, float value)
+{
+    setByName(name, GL_FLOAT, value);
 }
 
-void Shader::BindObject::setUniform(const std::string& name,
+void Shader::BindObject::setUniform(std::string_view name,
                                     const glm::vec2& value)
 {
-    if (const auto& info = validateUniform(name, GL_FLOAT_VEC2)) {
-        glUniform2f(info->location, value.x, value.y);
-    }
+    setByName(name, GL_FLOAT_VEC2, value);
 }
 
-void Shader::BindObject::setUniform(const std::string& name,
+void Shader::BindObject::setUniform(std::string_view name,
                                     const glm::vec3& value)
 {
-    if (const auto& info = validateUniform(name, GL_FLOAT_VEC3)) {
-        glUniform3f(info->location, value.x, value.y, value.z);
-    }
+    setByName(name, GL_FLOAT_VEC3, value);
 }
 
-void Shader::BindObject::setUniform(const std::string& name,
+void Shader::BindObject::setUniform(std::string_view name,
                                     const glm::vec4& value)
 {
-    if (const auto& info = validateUniform(name, GL_FLOAT_VEC4)) {
-        glUniform4f(info->location, value.x, value.y, value.z, value.w);
-    }
+    setByName(name, GL_FLOAT_VEC4, value);
 }
 
-void Shader::BindObject::setUniform(const std::string& name,
+void Shader::BindObject::setUniform(std::string_view name,
                                     const glm::mat4& value)
 {
-    if (const auto& info = validateUniform(name, GL_FLOAT_MAT4)) {
-        glUniformMatrix4fv(info->location, 1, GL_FALSE, glm::value_ptr(value));
-    }
+    setByName(name, GL_FLOAT_MAT4, value);
+}
+
+void Shader::BindObject::upload(GLint location, int value)
+{
+    glUniform1i(location, value);
+}
+
+void Shader::BindObject::upload(GLint location, float value)
+{
+    glUniform1f(location, value);
+}
+
+void Shader::BindObject::upload(GLint location, const glm::vec2& value)
+{
+    glUniform2f(location, value.x, value.y);
+}
+
+void Shader::BindObject::upload(GLint location, const glm::vec3& value)
+{
+    glUniform3f(location, value.x, value.y, value.z);
+}
+
+void Shader::BindObject::upload(GLint location, const glm::vec4& value)
+{
+    glUniform4f(location, value.x, value.y, value.z, value.w);
+}
+
+void Shader::BindObject::upload(GLint location, const glm::mat4& value)
+{
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
 }
 
 Shader::BindObject::BindObject(uint32_t programId, Shader& shader)
   : programId{programId}, shader{shader}
 {
-    glUseProgram(programId);
+    GLState::current().useProgram(programId);
 }
 
 Shader::BindObject::~BindObject()
 {
     Shader::isBound = false;
-    glUseProgram(0);
+    if (glUnbindAfterUse) {
+        GLState::current().useProgram(0);
+    }
 }
@@ -1,40 +1,369 @@
 #include "frontend/texture.hpp"
+#include "frontend/glState.hpp"
 #include "stb_image.h"
 
 #include "GL/glew.h"
+#include <algorithm>
+#include <cctype>
 #include <cmath>
+#include <cstdint>
 
 #include "util/error.hpp"
 #include "util/logger.hpp"
+#include "util/perf.hpp"
 
 namespace
 {
-void setTextureParameters()
+// `generateMipmaps` unless the mips were uploaded too.
+void setTextureParameters(GLenum target, bool generateMipmaps)
 {
     // wrapping params
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
     // filtering params
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                    GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
     // anisotropic filtering ((if available))
     if (glewIsSupported("GL_EXT_texture_filter_anisotropic") != 0) {
         GLfloat maxAnisotropy = NAN;
         glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT,
-                        maxAnisotropy);
+        glTexParameterf(target, GL_TEXTURE_MAX_ANISOTROPY_EXT, maxAnisotropy);
     }
 
-    glGenerateMipmap(GL_TEXTURE_2D); // mipmaps!
+    if (generateMipmaps) {
+        glGenerateMipmap(target); // mipmaps!
+    }
+}
+
+bool hasTgaExtension(const std::filesystem::path& path)
+{
+    std::string extension = path.extension().string();
+    std::ranges::transform(extension, extension.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return extension == ".tga";
+}
+
+// Maps `path` if it is an uncompressed, true colour or greyscale TGA with
+// left-to-right rows. Anything else (RLE, colour mapped, 16 bit) is left to
+// stb_image.
+std::optional<DecodedTexture> mapUncompressedTga(
+  const std::filesystem::path& path)
+{
+    constexpr size_t headerSize = 18;
+
+    MappedFile file{path};
+    if (file.size() < headerSize) {
+        return std::nullopt;
+    }
+    const auto* header = reinterpret_cast<const unsigned char*>(file.data());
+    auto u16 = [&](size_t offset) {
+        return static_cast<int>(header[offset] | (header[offset + 1] << 8));
+    };
+
+    unsigned idLength = header[0];
+    unsigned colourMapType = header[1];
+    unsigned imageType = header[2];
+    int width = u16(12);
+    int height = u16(14);
+    unsigned bitsPerPixel = header[16];
+    unsigned descriptor = header[17];
+
+    bool trueColour =
+      imageType == 2 && (bitsPerPixel == 24 || bitsPerPixel == 32);
+    bool greyscale = imageType == 3 && bitsPerPixel == 8;
+    bool rightToLeft = (descriptor & 0x10U) != 0;
+    bool interleaved = (descriptor & 0xC0U) != 0;
+    if (colourMapType != 0 || !(trueColour || greyscale) || rightToLeft ||
+        interleaved || width == 0 || height == 0)
+    {
+        return std::nullopt;
+    }
+
+    int channels = static_cast<int>(bitsPerPixel / 8);
+    size_t pixelOffset = headerSize + idLength;
+    size_t pixelBytes = static_cast<size_t>(width) *
+                        static_cast<size_t>(height) *
+                        static_cast<size_t>(channels);
+    if (file.size() < pixelOffset + pixelBytes) {
+        return std::nullopt;
+    }
+
+    DecodedTexture decoded;
+    decoded.width = width;
+    decoded.height = height;
+    decoded.channels = channels;
+    decoded.bgr = trueColour;
+    decoded.topRowFirst = (descriptor & 0x20U) != 0;
+    decoded.mappedPixels = header + pixelOffset;
+    // the upload reads it front to back
+    file.adviseSequential();
+    decoded.mapped = std::move(file);
+    return decoded;
+}
+
+DecodedTexture decodeImage(const std::filesystem::path& path)
+{
+    if (hasTgaExtension(path)) {
+        if (std::optional<DecodedTexture> mapped = mapUncompressedTga(path)) {
+            return std::move(*mapped);
+        }
+    }
+
+    // flip texture vertically for OpenGL. The flag is global in stb_image,
+    // so set it once rather than from every decoding thread.
+    static const bool flipped = [] {
+        stbi_set_flip_vertically_on_load(1);
+        return true;
+    }();
+    (void)flipped;
+
+    DecodedTexture decoded;
+    std::string filePath = path.string();
+    decoded.pixels.reset(stbi_load(filePath.c_str(), &decoded.width,
+                                   &decoded.height, &decoded.channels, 0));
+    if (!decoded.pixels) {
+        throw IrrecoverableError("Failed to load texture: " + filePath + " - " +
+                                 std::string(stbi_failure_reason()));
+    }
+    return decoded;
+}
+
+DecodedTexture fromCache(TextureCache cache)
+{
+    DecodedTexture decoded;
+    decoded.width = cache.getDescription().width;
+    decoded.height = cache.getDescription().height;
+    decoded.channels = cache.getDescription().channels;
+    decoded.topRowFirst = cache.getDescription().topRowFirst;
+    decoded.cached = std::move(cache);
+    return decoded;
+}
+
+// What the texture cache of an image with `channels` should hold for
+// `options`. Nothing if the image is not to be cached.
+std::optional<TextureCache::Description>
+cacheDescriptionFor(const TextureImportOptions& options, int channels)
+{
+    std::optional<BlockFormat> format =
+      blockFormatFor(options.compression, channels);
+    if (!format && !options.cacheMips && !options.streamMips) {
+        return std::nullopt;
+    }
+    return TextureCache::Description{
+      .format = format,
+      .mipFilter = options.mipFilter,
+      // like the uncompressed upload: colour is sRGB, one or two channels not
+      .srgb = channels >= 3,
+      .topRowFirst = false,
+      .channels = channels,
+      .width = 0,
+      .height = 0};
+}
+
+bool matches(const TextureCache::Description& cached,
+             const TextureImportOptions& options)
+{
+    auto wanted = cacheDescriptionFor(options, cached.channels);
+    return wanted && wanted->format == cached.format &&
+           wanted->mipFilter == cached.mipFilter;
+}
+
+// Builds the mips of `decoded`, compresses them if `description` says so and
+// writes them to the texture cache of `path`.
+void writeCache(const DecodedTexture& decoded,
+                TextureCache::Description description,
+                const std::filesystem::path& path)
+{
+    Stopwatch timer;
+    RgbaImage image = toRgbaImage(decoded.data(), decoded.width,
+                                  decoded.height, decoded.channels, decoded.bgr);
+    description.topRowFirst = decoded.topRowFirst;
+    description.width = decoded.width;
+    description.height = decoded.height;
+
+    std::vector<RgbaImage> mips =
+      buildMipChain(image, description.srgb, description.mipFilter);
+    double mipMs = timer.elapsedMilliseconds();
+
+    std::vector<std::vector<std::byte>> levels;
+    size_t cachedBytes = 0;
+    for (const RgbaImage& mip : mips) {
+        if (description.format) {
+            levels.push_back(compressImage(mip, *description.format));
+        } else {
+            const auto* pixels =
+              reinterpret_cast<const std::byte*>(mip.pixels.data());
+            levels.emplace_back(pixels, pixels + mip.pixels.size());
+        }
+        cachedBytes += levels.back().size();
+    }
+
+    if (description.format) {
+        BlockFormat format = *description.format;
+        double psnr = blockPsnr(image,
+                                decompressImage(levels.front(), image.width,
+                                                image.height, format),
+                                format);
+        size_t rawBytes = static_cast<size_t>(decoded.width) *
+                          static_cast<size_t>(decoded.height) *
+                          static_cast<size_t>(decoded.channels);
+        LOG("Compressed texture " << path << " to " << blockFormatName(format)
+                                  << " in " << timer.elapsedMilliseconds()
+                                  << " ms: " << rawBytes / 1024 << " KiB -> "
+                                  << levels.front().size() / 1024 << " KiB ("
+                                  << cachedBytes / 1024
+                                  << " KiB with mips), PSNR " << psnr << " dB");
+    }
+    LOG("Built " << mips.size() << " mips of " << path << " ("
+                 << mipFilterName(description.mipFilter) << ", "
+                 << mipSimdPath() << ") in " << mipMs << " ms");
+
+    TextureCache::write(path, description, levels);
+}
+
+GLenum compressedInternalFormat(BlockFormat format, bool srgb)
+{
+    switch (format) {
+        case BlockFormat::BC1:
+            return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+                        : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BlockFormat::BC3:
+            return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+                        : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+        case BlockFormat::BC7:
+            return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+                        : GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return GL_NONE;
+}
+
+bool isSupported(BlockFormat format)
+{
+    switch (format) {
+        case BlockFormat::BC1:
+        case BlockFormat::BC3:
+            return glewIsSupported("GL_EXT_texture_compression_s3tc") != 0;
+        // core since GL 3.0
+        case BlockFormat::BC5: return true;
+        case BlockFormat::BC7:
+            return glewIsSupported("GL_ARB_texture_compression_bptc") != 0;
+    }
+    return false;
+}
+
+struct PixelFormats
+{
+    GLenum format = GL_RGB;
+    GLenum internalFormat = GL_RGB;
+};
+
+// file format based on channels; nothing for unsupported channel counts
+std::optional<PixelFormats> pixelFormatsOf(const DecodedTexture& decoded)
+{
+    GLenum rgb = decoded.bgr ? GL_BGR : GL_RGB;
+    GLenum rgba = decoded.bgr ? GL_BGRA : GL_RGBA;
+    switch (decoded.channels) {
+        case 1: return PixelFormats{GL_RED, GL_RED};
+        case 2: return PixelFormats{GL_RG, GL_RG};
+        case 3: return PixelFormats{rgb, GL_SRGB};
+        case 4: return PixelFormats{rgba, GL_SRGB_ALPHA};
+        default: return std::nullopt;
+    }
+}
+
+// Uploads mip `level` of a cache to the bound texture. A level with no
+// `blocks` and no size frees the storage GL had for it.
+void uploadCachedLevel(const TextureCache::Description& description,
+                       int level, int levelWidth, int levelHeight,
+                       std::span<const std::byte> blocks)
+{
+    const void* data = blocks.empty() ? nullptr : blocks.data();
+    if (description.format) {
+        glCompressedTexImage2D(
+          GL_TEXTURE_2D, level,
+          compressedInternalFormat(*description.format, description.srgb),
+          levelWidth, levelHeight, 0, static_cast<GLsizei>(blocks.size()),
+          data);
+    } else {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, level,
+                     description.srgb ? GL_SRGB_ALPHA : GL_RGBA, levelWidth,
+                     levelHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
 }
 } // namespace
 
+void DecodedTexture::PixelDeleter::operator()(unsigned char* pixels) const
+{
+    stbi_image_free(pixels);
+}
+
+DecodedTexture DecodedTexture::fromFile(const std::filesystem::path& path,
+                                        const TextureImportOptions& options)
+{
+    Stopwatch timer;
+    std::optional<DecodedTexture> result;
+    if (options.compression != TextureCompression::None || options.cacheMips ||
+        options.streamMips)
+    {
+        std::optional<TextureCache> cache = TextureCache::open(path);
+        if (cache && matches(cache->getDescription(), options)) {
+            result = fromCache(std::move(*cache));
+        }
+    }
+
+    if (!result) {
+        result = decodeImage(path);
+        if (std::optional<TextureCache::Description> description =
+              cacheDescriptionFor(options, result->channels))
+        {
+            try {
+                writeCache(*result, *description, path);
+                if (std::optional<TextureCache> cache = TextureCache::open(path))
+                {
+                    result = fromCache(std::move(*cache));
+                }
+            } catch (const std::exception& e) {
+                LOG("Could not cache mips of texture " << path << " ("
+                                                       << e.what() << ")");
+            }
+        }
+    }
+
+    if (options.streamMips && result->cached) {
+        result->streamTailSize = options.streamTailSize;
+    }
+    result->filePath = path.string();
+    result->decodeMilliseconds = timer.elapsedMilliseconds();
+    return std::move(*result);
+}
+
+const unsigned char* DecodedTexture::data() const
+{
+    return pixels ? pixels.get() : mappedPixels;
+}
+
+void DecodedTexture::release()
+{
+    cached.reset();
+    pixels.reset();
+    mapped.reset();
+    mappedPixels = nullptr;
+}
+
 Texture::Texture(const std::filesystem::path& path)
 {
-    loadFromFile(path);
+    loadFromDecoded(DecodedTexture::fromFile(path));
+}
+
+Texture::Texture(DecodedTexture&& decoded)
+{
+    loadFromDecoded(std::move(decoded));
 }
 
 Texture::Texture(int width, int height, const unsigned char* data)
@@ -43,10 +372,28 @@ Texture::Texture(int width, int height, const unsigned char* data)
     loadFromData(data, width, height, GL_RGB, GL_RGB);
 }
 
+void Texture::update(const unsigned char* data)
+{
+    GLState::current().bindTexture(GL_TEXTURE_2D, textureId);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGB,
+                    GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    if (glUnbindAfterUse) {
+        GLState::current().bindTexture(GL_TEXTURE_2D, 0);
+    }
+}
+
 Texture::Texture(Texture&& other) noexcept
   : textureId(other.textureId), width(other.width), height(other.height),
-    channels(other.channels), filePath(std::move(other.filePath))
+    channels(other.channels), topRowFirst(other.topRowFirst),
+    filePath(std::move(other.filePath)),
+    streamSource(std::move(other.streamSource)),
+    residentLevel(other.residentLevel), tailLevel(other.tailLevel)
 {
+    other.streamSource.reset();
     other.textureId = 0;
     other.width = 0;
     other.height = 0;
@@ -57,15 +404,20 @@ Texture& Texture::operator=(Texture&& other) noexcept
 {
     if (this != &other) {
         if (textureId != 0) {
-            glDeleteTextures(1, &textureId);
+            GLState::current().deleteTexture(textureId);
         }
 
         textureId = other.textureId;
         width = other.width;
         height = other.height;
         channels = other.channels;
+        topRowFirst = other.topRowFirst;
         filePath = std::move(other.filePath);
+        streamSource = std::move(other.streamSource);
+        residentLevel = other.residentLevel;
+        tailLevel = other.tailLevel;
 
+        other.streamSource.reset();
         other.textureId = 0;
         other.width = 0;
         other.height = 0;
@@ -77,7 +429,7 @@ Texture& Texture::operator=(Texture&& other) noexcept
 Texture::~Texture()
 {
     if (textureId != 0) {
-        glDeleteTextures(1, &textureId);
+        GLState::current().deleteTexture(textureId);
     }
 }
 
@@ -85,7 +437,7 @@ void Texture::loadFromData(const unsigned char* data, int dataWidth,
                            int dataHeight, GLenum format, GLenum internalFormat)
 {
     if (textureId != 0) {
-        glDeleteTextures(1, &textureId);
+        GLState::current().deleteTexture(textureId);
         textureId = 0;
     }
 
@@ -95,67 +447,105 @@ void Texture::loadFromData(const unsigned char* data, int dataWidth,
     }
 
     glGenTextures(1, &textureId);
-    glBindTexture(GL_TEXTURE_2D, textureId);
+    GLState::current().bindTexture(GL_TEXTURE_2D, textureId);
 
+    // rows are tightly packed, whatever the width
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     glTexImage2D(GL_TEXTURE_2D, 0, static_cast<int>(internalFormat), dataWidth,
                  dataHeight, 0, format, GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-    setTextureParameters();
+    setTextureParameters(GL_TEXTURE_2D, true);
 
-    glBindTexture(GL_TEXTURE_2D, 0);
+    if (glUnbindAfterUse) {
+        GLState::current().bindTexture(GL_TEXTURE_2D, 0);
+    }
 }
 
-void Texture::loadFromFile(const std::filesystem::path& path)
+void Texture::loadFromCache(const TextureCache& cache, int firstLevel)
 {
-    filePath = path.string();
-
-    // flip texture vertically for OpenGL
-    stbi_set_flip_vertically_on_load(1);
+    const auto& levels = cache.getLevels();
+    const TextureCache::Description& description = cache.getDescription();
+    if (description.format && !isSupported(*description.format)) {
+        // decode the top level on the CPU and let GL build the mips
+        BlockFormat format = *description.format;
+        LOG("WARNING: " << blockFormatName(format)
+                        << " textures are not supported, decompressing "
+                        << filePath);
+        RgbaImage image = decompressImage(levels.front().blocks,
+                                          levels.front().width,
+                                          levels.front().height, format);
+        loadFromData(image.pixels.data(), image.width, image.height, GL_RGBA,
+                     description.srgb ? GL_SRGB_ALPHA : GL_RGBA);
+        return;
+    }
 
-    int newWidth = 0;
-    int newHeight = 0;
-    int newChannels = 0;
-    unsigned char* data =
-      stbi_load(filePath.c_str(), &newWidth, &newHeight, &newChannels, 0);
-    if (data == nullptr) {
-        throw IrrecoverableError("Failed to load texture: " + filePath + " - " +
-                                 std::string(stbi_failure_reason()));
+    if (textureId != 0) {
+        GLState::current().deleteTexture(textureId);
+        textureId = 0;
     }
 
-    // file format based on channels
-    GLenum format = GL_RGB;
-    GLenum internalFormat = GL_RGB;
+    glGenTextures(1, &textureId);
+    GLState::current().bindTexture(GL_TEXTURE_2D, textureId);
 
-    switch (newChannels) {
-        case 1: format = internalFormat = GL_RED; break;
-        case 2: format = internalFormat = GL_RG; break;
-        case 3:
-            format = GL_RGB;
-            internalFormat = GL_SRGB;
-            break;
-        case 4:
-            format = GL_RGBA;
-            internalFormat = GL_SRGB_ALPHA;
-            break;
-        default:
-            stbi_image_free(data);
-            throw IrrecoverableError("Unsupported texture format with " +
-                                     std::to_string(channels) +
-                                     " channels: " + filePath);
+    for (size_t level = firstLevel; level < levels.size(); ++level) {
+        uploadCachedLevel(description, static_cast<int>(level),
+                          levels[level].width, levels[level].height,
+                          levels[level].blocks);
     }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, firstLevel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                    static_cast<GLint>(levels.size() - 1));
+    setTextureParameters(GL_TEXTURE_2D, false);
 
-    try {
-        loadFromData(data, newWidth, newHeight, format, internalFormat);
-    } catch (...) {
-        stbi_image_free(data);
-        throw;
+    if (glUnbindAfterUse) {
+        GLState::current().bindTexture(GL_TEXTURE_2D, 0);
     }
+}
 
-    stbi_image_free(data);
+void Texture::loadFromDecoded(DecodedTexture&& decoded)
+{
+    filePath = decoded.filePath;
+    width = decoded.width;
+    height = decoded.height;
+    channels = decoded.channels;
+    topRowFirst = decoded.topRowFirst;
+
+    if (decoded.cached) {
+        const TextureCache::Description& description =
+          decoded.cached->getDescription();
+        bool streamable = decoded.streamTailSize > 0 &&
+                          (!description.format ||
+                           isSupported(*description.format));
+        if (!streamable) {
+            loadFromCache(*decoded.cached);
+            return;
+        }
+
+        // Only the tail for now, the rest is streamed in on demand
+        const auto& levels = decoded.cached->getLevels();
+        tailLevel = 0;
+        while (tailLevel + 1 < static_cast<int>(levels.size()) &&
+               std::max(levels[tailLevel].width, levels[tailLevel].height) >
+                 decoded.streamTailSize)
+        {
+            ++tailLevel;
+        }
+        residentLevel = tailLevel;
+        loadFromCache(*decoded.cached, tailLevel);
+        streamSource = std::move(decoded.cached);
+        decoded.cached.reset();
+        return;
+    }
 
-    width = newWidth;
-    height = newHeight;
-    channels = newChannels;
+    std::optional<PixelFormats> formats = pixelFormatsOf(decoded);
+    if (!formats) {
+        throw IrrecoverableError("Unsupported texture format with " +
+                                 std::to_string(decoded.channels) +
+                                 " channels: " + filePath);
+    }
+    loadFromData(decoded.data(), decoded.width, decoded.height,
+                 formats->format, formats->internalFormat);
 }
 
 void Texture::setInitUniform(Shader::BindObject& shader,
@@ -175,8 +565,7 @@ void Texture::bind(Shader::BindObject& shader, GLuint textureUnit) const
     // minimum of 16.
     // texture unit number tells openGL which sampler uniform to set when you
     // bind the texture.
-    glActiveTexture(GL_TEXTURE0 + textureUnit);
-    glBindTexture(GL_TEXTURE_2D, textureId);
+    GLState::current().bindTextureUnit(textureUnit, GL_TEXTURE_2D, textureId);
 }
 
 uint32_t Texture::getId() const
@@ -199,6 +588,11 @@ int Texture::getChannels() const
     return channels;
 }
 
+bool Texture::isTopRowFirst() const
+{
+    return topRowFirst;
+}
+
 const std::string& Texture::getFilePath() const
 {
     return filePath;
@@ -208,3 +602,256 @@ bool Texture::isValid() const
 {
     return textureId != 0;
 }
+
+bool Texture::isStreamed() const
+{
+    return streamSource.has_value();
+}
+
+int Texture::getResidentLevel() const
+{
+    return residentLevel;
+}
+
+int Texture::getTailLevel() const
+{
+    return tailLevel;
+}
+
+int Texture::getLevelCount() const
+{
+    return streamSource ? static_cast<int>(streamSource->getLevels().size())
+                        : 1;
+}
+
+size_t Texture::getLevelBytes(int level) const
+{
+    return streamSource ? streamSource->getLevels()[level].blocks.size() : 0;
+}
+
+size_t Texture::getBytesFrom(int firstLevel) const
+{
+    size_t bytes = 0;
+    for (int level = firstLevel; level < getLevelCount(); ++level) {
+        bytes += getLevelBytes(level);
+    }
+    return bytes;
+}
+
+void Texture::streamInLevel()
+{
+    if (!streamSource || residentLevel == 0) {
+        return;
+    }
+
+    int level = residentLevel - 1;
+    const TextureCache::Level& mip = streamSource->getLevels()[level];
+    GLState::current().bindTexture(GL_TEXTURE_2D, textureId);
+    uploadCachedLevel(streamSource->getDescription(), level, mip.width,
+                      mip.height, mip.blocks);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+    if (glUnbindAfterUse) {
+        GLState::current().bindTexture(GL_TEXTURE_2D, 0);
+    }
+    residentLevel = level;
+}
+
+void Texture::evictLevel()
+{
+    if (!streamSource || residentLevel >= tailLevel) {
+        return;
+    }
+
+    // Stop sampling the level before freeing it
+    GLState::current().bindTexture(GL_TEXTURE_2D, textureId);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, residentLevel + 1);
+    uploadCachedLevel(streamSource->getDescription(), residentLevel, 0, 0, {});
+    if (glUnbindAfterUse) {
+        GLState::current().bindTexture(GL_TEXTURE_2D, 0);
+    }
+    ++residentLevel;
+}
+
+std::optional<TextureArray::Layout>
+TextureArray::layoutOf(const DecodedTexture& decoded)
+{
+    Layout layout;
+    layout.width = decoded.width;
+    layout.height = decoded.height;
+    layout.channels = decoded.channels;
+    layout.bgr = decoded.bgr;
+    layout.topRowFirst = decoded.topRowFirst;
+    if (decoded.cached) {
+        const TextureCache::Description& description =
+          decoded.cached->getDescription();
+        if (description.format && !isSupported(*description.format)) {
+            return std::nullopt;
+        }
+        layout.cached = true;
+        layout.format = description.format;
+        layout.srgb = description.srgb;
+        layout.levelCount = decoded.cached->getLevels().size();
+        return layout;
+    }
+    if (!pixelFormatsOf(decoded) || decoded.data() == nullptr) {
+        return std::nullopt;
+    }
+    return layout;
+}
+
+TextureArray::TextureArray(std::span<const DecodedTexture* const> layers)
+{
+    if (layers.empty()) {
+        throw IrrecoverableError{"A texture array needs at least one layer"};
+    }
+    const DecodedTexture& first = *layers.front();
+    width = first.width;
+    height = first.height;
+    layerCount = static_cast<int>(layers.size());
+    topRowFirst = first.topRowFirst;
+
+    glGenTextures(1, &textureId);
+    GLState::current().bindTexture(GL_TEXTURE_2D_ARRAY, textureId);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (first.cached) {
+        // Every level of every layer from the mapped caches
+        const TextureCache::Description& description =
+          first.cached->getDescription();
+        const auto& levels = first.cached->getLevels();
+        for (size_t level = 0; level < levels.size(); ++level) {
+            auto levelIndex = static_cast<GLint>(level);
+            const TextureCache::Level& mip = levels[level];
+            auto levelBytes = static_cast<GLsizei>(mip.blocks.size());
+            if (description.format) {
+                GLenum internalFormat = compressedInternalFormat(
+                  *description.format, description.srgb);
+                glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, levelIndex,
+                                       internalFormat, mip.width, mip.height,
+                                       layerCount, 0, levelBytes * layerCount,
+                                       nullptr);
+                for (int layer = 0; layer < layerCount; ++layer) {
+                    glCompressedTexSubImage3D(
+                      GL_TEXTURE_2D_ARRAY, levelIndex, 0, 0, layer, mip.width,
+                      mip.height, 1, internalFormat, levelBytes,
+                      layers[layer]->cached->getLevels()[level].blocks.data());
+                }
+            } else {
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, levelIndex,
+                             description.srgb ? GL_SRGB_ALPHA : GL_RGBA,
+                             mip.width, mip.height, layerCount, 0, GL_RGBA,
+                             GL_UNSIGNED_BYTE, nullptr);
+                for (int layer = 0; layer < layerCount; ++layer) {
+                    glTexSubImage3D(
+                      GL_TEXTURE_2D_ARRAY, levelIndex, 0, 0, layer, mip.width,
+                      mip.height, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                      layers[layer]->cached->getLevels()[level].blocks.data());
+                }
+            }
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL,
+                        static_cast<GLint>(levels.size() - 1));
+        setTextureParameters(GL_TEXTURE_2D_ARRAY, false);
+    } else {
+        // The top level of every layer, GL builds the mips
+        std::optional<PixelFormats> formats = pixelFormatsOf(first);
+        if (!formats) {
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            GLState::current().bindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            throw IrrecoverableError("Unsupported texture format with " +
+                                     std::to_string(first.channels) +
+                                     " channels: " + first.filePath);
+        }
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0,
+                     static_cast<GLint>(formats->internalFormat), width, height,
+                     layerCount, 0, formats->format, GL_UNSIGNED_BYTE, nullptr);
+        for (int layer = 0; layer < layerCount; ++layer) {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height,
+                            1, formats->format, GL_UNSIGNED_BYTE,
+                            layers[layer]->data());
+        }
+        setTextureParameters(GL_TEXTURE_2D_ARRAY, true);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if (glUnbindAfterUse) {
+        GLState::current().bindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+}
+
+TextureArray::TextureArray(TextureArray&& other) noexcept
+  : textureId(other.textureId), width(other.width), height(other.height),
+    layerCount(other.layerCount), topRowFirst(other.topRowFirst)
+{
+    other.textureId = 0;
+    other.width = 0;
+    other.height = 0;
+    other.layerCount = 0;
+}
+
+TextureArray& TextureArray::operator=(TextureArray&& other) noexcept
+{
+    if (this != &other) {
+        if (textureId != 0) {
+            GLState::current().deleteTexture(textureId);
+        }
+
+        textureId = other.textureId;
+        width = other.width;
+        height = other.height;
+        layerCount = other.layerCount;
+        topRowFirst = other.topRowFirst;
+
+        other.textureId = 0;
+        other.width = 0;
+        other.height = 0;
+        other.layerCount = 0;
+    }
+    return *this;
+}
+
+TextureArray::~TextureArray()
+{
+    if (textureId != 0) {
+        GLState::current().deleteTexture(textureId);
+    }
+}
+
+void TextureArray::setInitUniform(Shader::BindObject& shader,
+                                  const std::string& textureUniformName,
+                                  GLuint textureUnit)
+{
+    shader.setUniformSampler2DArray(textureUniformName,
+                                    static_cast<int>(textureUnit));
+}
+
+void TextureArray::bind(GLuint textureUnit) const
+{
+    GLState::current().bindTextureUnit(textureUnit, GL_TEXTURE_2D_ARRAY,
+                                       textureId);
+}
+
+uint32_t TextureArray::getId() const
+{
+    return textureId;
+}
+
+int TextureArray::getWidth() const
+{
+    return width;
+}
+
+int TextureArray::getHeight() const
+{
+    return height;
+}
+
+int TextureArray::getLayerCount() const
+{
+    return layerCount;
+}
+
+bool TextureArray::isTopRowFirst() const
+{
+    return topRowFirst;
+}
@@ -0,0 +1,259 @@
+#include "frontend/textureCache.hpp"
+
+#include "util/cacheFile.hpp"
+#include "util/error.hpp"
+#include "util/logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <system_error>
+
+namespace
+{
+constexpr std::array<char, 8> cacheMagic{'T', 'E', 'X', 'C', 'A', 'C', 'H', 'E'};
+
+// no more mips than a 2^31 texel wide texture has
+constexpr uint32_t maxLevels = 32;
+
+struct FileHeader
+{
+    std::array<char, 8> magic;
+    uint32_t version;
+    // 0 for 8-bit RGBA
+    uint32_t blockFormat;
+    uint32_t mipFilter;
+    uint32_t reserved;
+
+    // the image this cache was built from
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t sourceHash;
+
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t levelCount;
+    uint32_t srgb;
+    uint32_t topRowFirst;
+};
+
+struct LevelRecord
+{
+    uint64_t offset;
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+bool validFormat(uint32_t format)
+{
+    if (format == 0) {
+        return true;
+    }
+    switch (static_cast<BlockFormat>(format)) {
+        case BlockFormat::BC1:
+        case BlockFormat::BC3:
+        case BlockFormat::BC5:
+        case BlockFormat::BC7: return true;
+    }
+    return false;
+}
+
+bool validFilter(uint32_t filter)
+{
+    switch (static_cast<MipFilter>(filter)) {
+        case MipFilter::Box:
+        case MipFilter::Kaiser: return true;
+    }
+    return false;
+}
+
+size_t levelSize(int width, int height, std::optional<BlockFormat> format)
+{
+    return format ? compressedSize(width, height, *format)
+                  : static_cast<size_t>(width) * static_cast<size_t>(height) *
+                      4;
+}
+} // namespace
+
+TextureCache::TextureCache(MappedFile mapped) : file{std::move(mapped)}
+{
+}
+
+std::filesystem::path
+TextureCache::pathFor(const std::filesystem::path& imagePath)
+{
+    std::filesystem::path cachePath = imagePath;
+    cachePath += ".texcache";
+    return cachePath;
+}
+
+std::optional<TextureCache>
+TextureCache::open(const std::filesystem::path& imagePath)
+{
+    const std::filesystem::path cachePath = pathFor(imagePath);
+
+    std::error_code ec;
+    if (!std::filesystem::exists(cachePath, ec)) {
+        return {};
+    }
+
+    auto sourceStamp = CacheFile::stampOf(imagePath);
+    if (!sourceStamp) {
+        return {};
+    }
+
+    try {
+        TextureCache cache{MappedFile{cachePath}};
+        std::span<const std::byte> bytes = cache.file.bytes();
+
+        FileHeader header{};
+        if (!CacheFile::readRecord(bytes, 0, header) ||
+            header.magic != cacheMagic ||
+            header.version != formatVersion ||
+            !validFormat(header.blockFormat) || !validFilter(header.mipFilter))
+        {
+            LOG("Ignoring texture cache " << cachePath
+                                          << ": unknown or outdated format");
+            return {};
+        }
+
+        //
+        // Is it still the same source file?
+        //
+        bool touched = false;
+        if (!CacheFile::matchesSource(imagePath, *sourceStamp,
+                                      header.sourceSize, header.sourceMtime,
+                                      header.sourceHash, touched))
+        {
+            return {};
+        }
+
+        if (header.levelCount == 0 || header.levelCount > maxLevels) {
+            LOG("Ignoring texture cache " << cachePath << ": corrupt");
+            return {};
+        }
+        Description& description = cache.description;
+        if (header.blockFormat != 0) {
+            description.format = static_cast<BlockFormat>(header.blockFormat);
+        }
+        description.mipFilter = static_cast<MipFilter>(header.mipFilter);
+        description.srgb = header.srgb != 0;
+        description.topRowFirst = header.topRowFirst != 0;
+        description.channels = static_cast<int>(header.channels);
+        description.width = static_cast<int>(header.width);
+        description.height = static_cast<int>(header.height);
+
+        //
+        // Levels: views straight into the mapping
+        //
+        cache.levels.reserve(header.levelCount);
+        for (uint32_t i = 0; i < header.levelCount; ++i) {
+            LevelRecord rec{};
+            if (!CacheFile::readRecord(bytes,
+                                       CacheFile::alignUp(sizeof(FileHeader)) +
+                                         (i * sizeof(LevelRecord)),
+                                       rec) ||
+                !CacheFile::validArray<std::byte>(bytes, rec.offset,
+                                                  rec.size) ||
+                rec.size != levelSize(static_cast<int>(rec.width),
+                                      static_cast<int>(rec.height),
+                                      description.format))
+            {
+                LOG("Ignoring texture cache " << cachePath << ": corrupt");
+                return {};
+            }
+            cache.levels.push_back(
+              Level{.width = static_cast<int>(rec.width),
+                    .height = static_cast<int>(rec.height),
+                    .blocks = bytes.subspan(rec.offset, rec.size)});
+        }
+
+        if (touched) {
+            // Source was touched but not changed: remember the new mtime so
+            // we don't re-hash it next time
+            CacheFile::refreshMtime(cachePath,
+                                    offsetof(FileHeader, sourceMtime),
+                                    sourceStamp->mtime);
+        }
+
+        return cache;
+    } catch (const std::exception& e) {
+        LOG("Ignoring texture cache " << cachePath << ": " << e.what());
+        return {};
+    }
+}
+
+void TextureCache::write(const std::filesystem::path& imagePath,
+                         const Description& description,
+                         const std::vector<std::vector<std::byte>>& levels)
+{
+    const std::filesystem::path cachePath = pathFor(imagePath);
+
+    auto sourceStamp = CacheFile::stampOf(imagePath);
+    if (!sourceStamp) {
+        throw IrrecoverableError{"Could not stat " + imagePath.string()};
+    }
+
+    FileHeader header{};
+    header.magic = cacheMagic;
+    header.version = formatVersion;
+    header.blockFormat =
+      description.format ? static_cast<uint32_t>(*description.format) : 0;
+    header.mipFilter = static_cast<uint32_t>(description.mipFilter);
+    header.sourceSize = sourceStamp->size;
+    header.sourceMtime = sourceStamp->mtime;
+    header.sourceHash = CacheFile::hashOf(imagePath);
+    header.width = static_cast<uint32_t>(description.width);
+    header.height = static_cast<uint32_t>(description.height);
+    header.channels = static_cast<uint32_t>(description.channels);
+    header.levelCount = static_cast<uint32_t>(levels.size());
+    header.srgb = description.srgb ? 1 : 0;
+    header.topRowFirst = description.topRowFirst ? 1 : 0;
+
+    //
+    // Lay out the file
+    //
+    std::vector<LevelRecord> records;
+    uint64_t offset =
+      CacheFile::alignUp(CacheFile::alignUp(sizeof(FileHeader)) +
+                         (levels.size() * sizeof(LevelRecord)));
+    int levelWidth = description.width;
+    int levelHeight = description.height;
+    for (const auto& level : levels) {
+        records.push_back(
+          LevelRecord{.offset = offset,
+                      .size = level.size(),
+                      .width = static_cast<uint32_t>(levelWidth),
+                      .height = static_cast<uint32_t>(levelHeight)});
+        offset = CacheFile::alignUp(offset + level.size());
+        levelWidth = std::max(1, levelWidth / 2);
+        levelHeight = std::max(1, levelHeight / 2);
+    }
+
+    //
+    // Write to a temporary and swap it in, so a crash mid-write never
+    // leaves a truncated cache behind.
+    //
+    CacheFile::Writer out{cachePath, "texture cache"};
+    out.write(header);
+    out.padTo(CacheFile::alignUp(sizeof(FileHeader)));
+    out.write(records.data(), records.size() * sizeof(LevelRecord));
+    for (size_t i = 0; i < levels.size(); ++i) {
+        out.padTo(records[i].offset);
+        out.write(levels[i].data(), levels[i].size());
+    }
+    out.padTo(offset);
+    out.commit();
+}
+
+const TextureCache::Description& TextureCache::getDescription() const
+{
+    return description;
+}
+
+const std::vector<TextureCache::Level>& TextureCache::getLevels() const
+{
+    return levels;
+}
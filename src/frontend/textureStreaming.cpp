@@ -0,0 +1,143 @@
+#include "frontend/textureStreaming.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void TextureStreamer::request(Texture& texture, float level)
+{
+    if (!texture.isStreamed()) {
+        return;
+    }
+
+    auto [it, inserted] = entries.try_emplace(
+      &texture, Entry{.texture = &texture,
+                      .requestedLevel = level,
+                      .lastRequestedFrame = frame});
+    Entry& entry = it->second;
+    if (entry.lastRequestedFrame != frame) {
+        entry.requestedLevel = level;
+        entry.lastRequestedFrame = frame;
+    } else {
+        entry.requestedLevel = std::min(entry.requestedLevel, level);
+    }
+}
+
+TextureStreamingStats
+TextureStreamer::update(const TextureStreamingSettings& settings)
+{
+    // Finest level `entry` should have resident; just the tail if it was not
+    // requested this frame
+    auto wantedLevel = [&](const Entry& entry) {
+        int tail = entry.texture->getTailLevel();
+        if (entry.lastRequestedFrame != frame) {
+            return tail;
+        }
+        auto level = static_cast<int>(
+          std::floor(entry.requestedLevel + settings.lodBias));
+        return std::clamp(level, 0, tail);
+    };
+    auto nextEvicted = [](const Entry& entry) {
+        return entry.texture->getLevelBytes(entry.texture->getResidentLevel());
+    };
+    auto nextStreamedIn = [](const Entry& entry) {
+        return entry.texture->getLevelBytes(entry.texture->getResidentLevel() -
+                                            1);
+    };
+
+    TextureStreamingStats stats;
+    size_t resident = 0;
+    for (const auto& [texture, entry] : entries) {
+        resident += texture->getBytesFrom(texture->getResidentLevel());
+        stats.requestedBytes += texture->getBytesFrom(wantedLevel(entry));
+    }
+
+    // Frees one level that is finer than its texture wants, of the least
+    // recently requested texture (the biggest such level on a tie). False if
+    // every texture is down to what it wants.
+    auto evictSurplus = [&] {
+        Entry* victim = nullptr;
+        for (auto& [texture, entry] : entries) {
+            if (texture->getResidentLevel() >= wantedLevel(entry)) {
+                continue;
+            }
+            if (victim == nullptr ||
+                entry.lastRequestedFrame < victim->lastRequestedFrame ||
+                (entry.lastRequestedFrame == victim->lastRequestedFrame &&
+                 nextEvicted(entry) > nextEvicted(*victim)))
+            {
+                victim = &entry;
+            }
+        }
+        if (victim == nullptr) {
+            return false;
+        }
+        resident -= nextEvicted(*victim);
+        victim->texture->evictLevel();
+        ++stats.levelsEvicted;
+        return true;
+    };
+
+    // VRAM taken by levels finer than their texture wants
+    auto surplusBytes = [&] {
+        size_t bytes = 0;
+        for (const auto& [texture, entry] : entries) {
+            int wanted = wantedLevel(entry);
+            if (texture->getResidentLevel() < wanted) {
+                bytes += texture->getBytesFrom(texture->getResidentLevel()) -
+                         texture->getBytesFrom(wanted);
+            }
+        }
+        return bytes;
+    };
+
+    // the budget may have been lowered
+    while (resident > settings.budgetBytes && evictSurplus()) {
+    }
+
+    //
+    // Stream in the smallest missing level first, so all textures sharpen
+    // together rather than one after the other
+    //
+    while (true) {
+        Entry* next = nullptr;
+        for (auto& [texture, entry] : entries) {
+            if (texture->getResidentLevel() > wantedLevel(entry) &&
+                (next == nullptr ||
+                 nextStreamedIn(entry) < nextStreamedIn(*next)))
+            {
+                next = &entry;
+            }
+        }
+        if (next == nullptr) {
+            break;
+        }
+
+        size_t bytes = nextStreamedIn(*next);
+        if (stats.uploadedBytes > 0 &&
+            stats.uploadedBytes + bytes > settings.uploadBytesPerFrame)
+        {
+            break;
+        }
+        if (resident - surplusBytes() + bytes > settings.budgetBytes) {
+            // no room even with all surplus gone; the rest has to wait
+            break;
+        }
+        while (resident + bytes > settings.budgetBytes && evictSurplus()) {
+        }
+
+        next->texture->streamInLevel();
+        resident += bytes;
+        stats.uploadedBytes += bytes;
+        ++stats.levelsUploaded;
+    }
+
+    stats.streamedTextures = entries.size();
+    stats.residentBytes = resident;
+    ++frame;
+    return stats;
+}
+
+void TextureStreamer::forget(const Texture& texture)
+{
+    entries.erase(&texture);
+}
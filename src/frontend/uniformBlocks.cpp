@@ -0,0 +1,169 @@
+#include "frontend/uniformBlocks.hpp"
+#include "frontend/glState.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+const char* uniformBlockName(UniformBlock block)
+{
+    switch (block) {
+        case UniformBlock::Camera: return "Camera";
+        case UniformBlock::Lighting: return "Lighting";
+        case UniformBlock::Object: return "Object";
+    }
+    return "?";
+}
+
+std::optional<UniformBlock> uniformBlockNamed(std::string_view name)
+{
+    for (UniformBlock block :
+         {UniformBlock::Camera, UniformBlock::Lighting, UniformBlock::Object})
+    {
+        if (name == uniformBlockName(block)) {
+            return block;
+        }
+    }
+    return std::nullopt;
+}
+
+LightingBlock SceneLighting::toBlock() const
+{
+    LightingBlock block;
+    block.lightCount = std::clamp(lightCount, 0, maxDirectionalLights);
+    for (int i = 0; i < block.lightCount; ++i) {
+        const DirectionalLight& light = lights[i];
+        // straight down if there is no direction to speak of
+        glm::vec3 direction = glm::length(light.direction) > 1e-6F
+                                ? glm::normalize(light.direction)
+                                : glm::vec3{0.0F, -1.0F, 0.0F};
+        block.lights[i].direction = glm::vec4{direction, 0.0F};
+        block.lights[i].colour = glm::vec4{light.colour * light.intensity, 0.0F};
+    }
+    block.ambient = glm::vec4{ambientColour * ambientStrength, 0.0F};
+    block.material = glm::vec4{specularStrength, shininess, 0.0F, 0.0F};
+    return block;
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    if (ubo != 0) {
+        GLState::current().deleteBuffer(ubo);
+    }
+}
+
+UniformBuffer::UniformBuffer(UniformBuffer&& other) noexcept
+  : ubo{other.ubo}, capacity{other.capacity}
+{
+    other.ubo = 0;
+    other.capacity = 0;
+}
+
+UniformBuffer& UniformBuffer::operator=(UniformBuffer&& other) noexcept
+{
+    if (this != &other) {
+        if (ubo != 0) {
+            GLState::current().deleteBuffer(ubo);
+        }
+        ubo = std::exchange(other.ubo, 0);
+        capacity = std::exchange(other.capacity, 0);
+    }
+    return *this;
+}
+
+void UniformBuffer::upload(const void* data, size_t bytes)
+{
+    if (ubo == 0) {
+        glGenBuffers(1, &ubo);
+    }
+    GLState::current().bindBuffer(GL_UNIFORM_BUFFER, ubo);
+    // Orphans the old storage (same size, so drivers can recycle it)
+    capacity = std::max(capacity, bytes);
+    glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(capacity), nullptr,
+                 GL_STREAM_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(bytes), data);
+}
+
+void UniformBuffer::bind(UniformBlock block) const
+{
+    GLState::current().bindBufferBase(GL_UNIFORM_BUFFER,
+                                      static_cast<GLuint>(block), ubo);
+}
+
+void UniformBuffer::bindRange(UniformBlock block, size_t offset,
+                              size_t bytes) const
+{
+    GLState::current().bindBufferRange(
+      GL_UNIFORM_BUFFER, static_cast<GLuint>(block), ubo,
+      static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(bytes));
+}
+
+GLuint UniformBuffer::getId() const
+{
+    return ubo;
+}
+
+void FrameUniforms::setCamera(const Camera& camera)
+{
+    CameraBlock block;
+    block.view = camera.computeViewMatrix();
+    block.projection = camera.computeProjectionMatrix();
+    block.viewProjection = block.projection * block.view;
+    block.position = glm::vec4{camera.position, 1.0F};
+    this->camera.upload(&block, sizeof(block));
+    this->camera.bind(UniformBlock::Camera);
+}
+
+void FrameUniforms::setLighting(const SceneLighting& lighting)
+{
+    LightingBlock block = lighting.toBlock();
+    this->lighting.upload(&block, sizeof(block));
+    this->lighting.bind(UniformBlock::Lighting);
+}
+
+void FrameUniforms::clearObjects()
+{
+    objectBytes.clear();
+    objectCount = 0;
+}
+
+uint32_t FrameUniforms::addObject(const glm::mat4& model)
+{
+    ObjectBlock block{.model = model,
+                      .normalMatrix = glm::transpose(glm::inverse(model))};
+    size_t offset = objectBytes.size();
+    objectBytes.resize(offset + objectStride);
+    std::memcpy(objectBytes.data() + offset, &block, sizeof(block));
+    return objectCount++;
+}
+
+void FrameUniforms::uploadObjects()
+{
+    if (objectCount == 0) {
+        return;
+    }
+
+    if (!strideAligned) {
+        // The alignment takes a GL context, so the first frame's objects
+        // were packed; spread them out, last first
+        GLint alignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        auto aligned = static_cast<size_t>(std::max(alignment, 1));
+        size_t stride = (sizeof(ObjectBlock) + aligned - 1) / aligned * aligned;
+        objectBytes.resize(static_cast<size_t>(objectCount) * stride);
+        for (size_t i = objectCount; i-- > 0;) {
+            std::memmove(objectBytes.data() + (i * stride),
+                         objectBytes.data() + (i * objectStride),
+                         sizeof(ObjectBlock));
+        }
+        objectStride = stride;
+        strideAligned = true;
+    }
+    objects.upload(objectBytes.data(), objectBytes.size());
+}
+
+void FrameUniforms::bindObject(uint32_t object) const
+{
+    objects.bindRange(UniformBlock::Object, object * objectStride,
+                      sizeof(ObjectBlock));
+}
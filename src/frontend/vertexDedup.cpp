@@ -0,0 +1,267 @@
+#include "frontend/vertexDedup.hpp"
+
+#include "util/error.hpp"
+#include "util/hash.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace
+{
+// Below this many corners per block, splitting the sort is not worth it
+constexpr size_t minItemsPerBlock = size_t{1} << 15;
+
+static_assert(sizeof(LoadedObjVertex) == 8 * sizeof(float));
+
+// The bits of a vertex's floats, with -0 made +0 so the two compare equal
+// as floats do
+using VertexKey = std::array<uint32_t, 8>;
+
+VertexKey keyOf(const LoadedObjVertex& v)
+{
+    constexpr uint32_t negativeZero = 0x80000000U;
+    VertexKey key;
+    std::memcpy(key.data(), &v, sizeof(key));
+    for (uint32_t& bits : key) {
+        bits = bits == negativeZero ? 0 : bits;
+    }
+    return key;
+}
+
+uint64_t hashVertex(const LoadedObjVertex& v)
+{
+    VertexKey key = keyOf(v);
+    return Hash::bytes(key.data(), sizeof(key));
+}
+
+bool sameKey(const LoadedObjVertex& a, const LoadedObjVertex& b)
+{
+    return keyOf(a) == keyOf(b);
+}
+
+void checkCornerCount(size_t count)
+{
+    // Vertex ids must fit an index buffer, and the flat hash reserves 0
+    if (count >= std::numeric_limits<uint32_t>::max()) {
+        throw IrrecoverableError{"Shape has too many vertices to index: " +
+                                 std::to_string(count)};
+    }
+}
+
+struct SortItem
+{
+    uint32_t key;
+    uint32_t corner;
+};
+
+// Stable LSD radix sort of `items` by `key`, 8 bits per pass. Each pass
+// histograms and scatters fixed blocks of the input in parallel; blocks get
+// consecutive slices of every bucket, which keeps the sort stable.
+void radixSortByKey(std::vector<SortItem>& items, ThreadPool& pool)
+{
+    constexpr size_t radix = 256;
+    const size_t count = items.size();
+    const size_t blocks =
+      std::clamp<size_t>(count / minItemsPerBlock, 1, pool.size() + 1);
+    const size_t blockSize = (count + blocks - 1) / blocks;
+
+    std::vector<SortItem> scratch(count);
+    std::vector<std::array<size_t, radix>> offsets(blocks);
+
+    for (uint32_t shift = 0; shift < 32; shift += 8) {
+        pool.parallelFor(blocks, [&](size_t b) {
+            auto& histogram = offsets[b];
+            histogram.fill(0);
+            size_t end = std::min(count, (b + 1) * blockSize);
+            for (size_t i = b * blockSize; i < end; ++i) {
+                ++histogram[(items[i].key >> shift) & (radix - 1)];
+            }
+        });
+
+        // Skip passes where every key has the same digit
+        bool trivial = false;
+        for (size_t d = 0; d < radix && !trivial; ++d) {
+            size_t total = 0;
+            for (size_t b = 0; b < blocks; ++b) {
+                total += offsets[b][d];
+            }
+            trivial = total == count;
+        }
+        if (trivial) {
+            continue;
+        }
+
+        size_t running = 0;
+        for (size_t d = 0; d < radix; ++d) {
+            for (size_t b = 0; b < blocks; ++b) {
+                size_t n = offsets[b][d];
+                offsets[b][d] = running;
+                running += n;
+            }
+        }
+
+        pool.parallelFor(blocks, [&](size_t b) {
+            auto& cursor = offsets[b];
+            size_t end = std::min(count, (b + 1) * blockSize);
+            for (size_t i = b * blockSize; i < end; ++i) {
+                scratch[cursor[(items[i].key >> shift) & (radix - 1)]++] =
+                  items[i];
+            }
+        });
+        items.swap(scratch);
+    }
+}
+} // anonymous namespace
+
+void dedupVertices(std::span<const LoadedObjVertex> corners,
+                   ImportedShape& shape, ThreadPool& pool)
+{
+    // Single-threaded, the sort is about half as fast as the hash table, so
+    // it only pays off with a few threads
+    if (corners.size() >= radixSortDedupThreshold && pool.size() >= 3) {
+        dedupVerticesRadixSort(corners, shape, pool);
+    } else {
+        dedupVerticesFlatHash(corners, shape);
+    }
+}
+
+void dedupVerticesFlatHash(std::span<const LoadedObjVertex> corners,
+                           ImportedShape& shape)
+{
+    checkCornerCount(corners.size());
+    auto& vertices = shape.vertices;
+    auto& indices = shape.indices;
+    vertices.clear();
+    indices.resize(corners.size());
+
+    // There are at most as many unique vertices as corners, so this keeps
+    // the load factor at or below 1/2.
+    // Each slot holds the upper half of the hash (to reject most mismatches
+    // without touching `vertices`) and the vertex id + 1 (0 marks empty).
+    const size_t capacity = std::bit_ceil(std::max<size_t>(
+      corners.size() * 2, 16));
+    const size_t mask = capacity - 1;
+    std::vector<uint64_t> slots(capacity, 0);
+
+    for (size_t i = 0; i < corners.size(); ++i) {
+        const LoadedObjVertex& vertex = corners[i];
+        uint64_t hash = hashVertex(vertex);
+        uint64_t tag = hash & 0xFFFFFFFF00000000ULL;
+
+        for (size_t pos = hash & mask;; pos = (pos + 1) & mask) {
+            uint64_t slot = slots[pos];
+            if (slot == 0) {
+                auto id = static_cast<uint32_t>(vertices.size());
+                slots[pos] = tag | (id + 1);
+                vertices.push_back(vertex);
+                indices[i] = id;
+                break;
+            }
+            if ((slot & 0xFFFFFFFF00000000ULL) == tag) {
+                auto id = static_cast<uint32_t>(slot) - 1;
+                if (sameKey(vertices[id], vertex)) {
+                    indices[i] = id;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void dedupVerticesRadixSort(std::span<const LoadedObjVertex> corners,
+                            ImportedShape& shape, ThreadPool& pool)
+{
+    checkCornerCount(corners.size());
+    const size_t count = corners.size();
+    auto& vertices = shape.vertices;
+    auto& indices = shape.indices;
+    vertices.clear();
+    indices.resize(count);
+    if (count == 0) {
+        return;
+    }
+
+    const size_t blocks =
+      std::clamp<size_t>(count / minItemsPerBlock, 1, pool.size() + 1);
+    const size_t blockSize = (count + blocks - 1) / blocks;
+
+    std::vector<SortItem> items(count);
+    pool.parallelFor(blocks, [&](size_t b) {
+        size_t end = std::min(count, (b + 1) * blockSize);
+        for (size_t i = b * blockSize; i < end; ++i) {
+            items[i] = {static_cast<uint32_t>(hashVertex(corners[i])),
+                        static_cast<uint32_t>(i)};
+        }
+    });
+
+    // Stable, so equal keys stay in corner order
+    radixSortByKey(items, pool);
+
+    // Within each run of equal keys, point every corner at the first corner
+    // with an identical key (usually the run has one distinct vertex; more
+    // only on 32-bit hash collisions). Blocks start at the next run boundary
+    // so no run is split between threads.
+    std::vector<size_t> uniqueCounts(blocks, 0);
+    pool.parallelFor(blocks, [&](size_t b) {
+        auto runStart = [&](size_t i) {
+            while (i > 0 && i < count && items[i].key == items[i - 1].key) {
+                ++i;
+            }
+            return std::min(i, count);
+        };
+        size_t begin = runStart(b * blockSize);
+        size_t end = runStart((b + 1) * blockSize);
+
+        std::vector<uint32_t> distinct;
+        size_t unique = 0;
+        for (size_t runBegin = begin; runBegin < end;) {
+            size_t runEnd = runBegin + 1;
+            while (runEnd < end && items[runEnd].key == items[runBegin].key) {
+                ++runEnd;
+            }
+
+            distinct.clear();
+            for (size_t i = runBegin; i < runEnd; ++i) {
+                uint32_t corner = items[i].corner;
+                uint32_t first = corner;
+                for (uint32_t candidate : distinct) {
+                    if (sameKey(corners[candidate], corners[corner])) {
+                        first = candidate;
+                        break;
+                    }
+                }
+                if (first == corner) {
+                    distinct.push_back(corner);
+                }
+                indices[corner] = first;
+            }
+            unique += distinct.size();
+            runBegin = runEnd;
+        }
+        uniqueCounts[b] = unique;
+    });
+
+    size_t uniqueTotal = 0;
+    for (size_t n : uniqueCounts) {
+        uniqueTotal += n;
+    }
+    vertices.reserve(uniqueTotal);
+
+    // Number unique vertices by first appearance. `indices[i]` holds the
+    // first corner equal to corner i, which is never after i, so its id is
+    // already final by the time we get here.
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t first = indices[i];
+        if (first == i) {
+            indices[i] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(corners[i]);
+        } else {
+            indices[i] = indices[first];
+        }
+    }
+}
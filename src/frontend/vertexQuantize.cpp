@@ -0,0 +1,258 @@
+#include "frontend/vertexQuantize.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+float signNotZero(float v)
+{
+    return v >= 0.0F ? 1.0F : -1.0F;
+}
+
+// Avoids dividing by zero for flat (or single vertex) shapes.
+template <typename Vec>
+Vec safeExtent(Vec extent)
+{
+    for (int i = 0; i < Vec::length(); ++i) {
+        if (extent[i] <= 0.0F) {
+            extent[i] = 1.0F;
+        }
+    }
+    return extent;
+}
+} // anonymous namespace
+
+const VertexLayout& quantizedObjVertexLayout()
+{
+    static const VertexLayout layout =
+      VertexLayout{}
+        .addAttribute(0, 4, GL_UNSIGNED_SHORT, true)  // position (+ padding)
+        .addAttribute(1, 2, GL_UNSIGNED_SHORT, true)  // octahedral normal
+        .addAttribute(2, 2, GL_UNSIGNED_SHORT, true); // texCoord
+    return layout;
+}
+
+QuantizedShape quantizeVertices(std::span<const LoadedObjVertex> vertices)
+{
+    QuantizedShape shape;
+    if (vertices.empty()) {
+        return shape;
+    }
+
+    glm::vec3 minPosition{std::numeric_limits<float>::max()};
+    glm::vec3 maxPosition{std::numeric_limits<float>::lowest()};
+    glm::vec2 minTexCoord{std::numeric_limits<float>::max()};
+    glm::vec2 maxTexCoord{std::numeric_limits<float>::lowest()};
+    for (const auto& v : vertices) {
+        minPosition = glm::min(minPosition, glm::vec3{v.position});
+        maxPosition = glm::max(maxPosition, glm::vec3{v.position});
+        minTexCoord = glm::min(minTexCoord, glm::vec2{v.texCoord});
+        maxTexCoord = glm::max(maxTexCoord, glm::vec2{v.texCoord});
+    }
+
+    QuantizationTransform& transform = shape.transform;
+    transform.positionOffset = minPosition;
+    transform.positionScale = safeExtent(maxPosition - minPosition);
+    transform.texCoordOffset = minTexCoord;
+    transform.texCoordScale = safeExtent(maxTexCoord - minTexCoord);
+
+    shape.vertices.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const LoadedObjVertex& in = vertices[i];
+        QuantizedObjVertex& out = shape.vertices[i];
+
+        glm::vec3 p = (glm::vec3{in.position} - transform.positionOffset) /
+                      transform.positionScale;
+        out.position[0] = toUnorm16(p.x);
+        out.position[1] = toUnorm16(p.y);
+        out.position[2] = toUnorm16(p.z);
+        out.position[3] = 0;
+
+        glm::vec2 n = (encodeOctahedral(in.normal) * 0.5F) + 0.5F;
+        out.normal[0] = toUnorm16(n.x);
+        out.normal[1] = toUnorm16(n.y);
+
+        glm::vec2 uv = (glm::vec2{in.texCoord} - transform.texCoordOffset) /
+                       transform.texCoordScale;
+        out.texCoord[0] = toUnorm16(uv.x);
+        out.texCoord[1] = toUnorm16(uv.y);
+    }
+    return shape;
+}
+
+LoadedObjVertex dequantizeVertex(const QuantizedObjVertex& vertex,
+                                 const QuantizationTransform& transform)
+{
+    LoadedObjVertex out;
+    out.position = transform.positionOffset +
+                   (transform.positionScale *
+                    glm::vec3{fromUnorm16(vertex.position[0]),
+                              fromUnorm16(vertex.position[1]),
+                              fromUnorm16(vertex.position[2])});
+    out.normal = decodeOctahedral(
+      (glm::vec2{fromUnorm16(vertex.normal[0]), fromUnorm16(vertex.normal[1])} *
+       2.0F) -
+      1.0F);
+    out.texCoord = transform.texCoordOffset +
+                   (transform.texCoordScale *
+                    glm::vec2{fromUnorm16(vertex.texCoord[0]),
+                              fromUnorm16(vertex.texCoord[1])});
+    return out;
+}
+
+QuantizationError
+measureQuantizationError(std::span<const LoadedObjVertex> original,
+                         const QuantizedShape& quantized)
+{
+    QuantizationError error;
+    float diagonal = glm::length(quantized.transform.positionScale);
+
+    for (size_t i = 0; i < original.size(); ++i) {
+        const LoadedObjVertex& expected = original[i];
+        LoadedObjVertex actual =
+          dequantizeVertex(quantized.vertices[i], quantized.transform);
+
+        error.position =
+          std::max(error.position, glm::length(glm::vec3{actual.position} -
+                                               glm::vec3{expected.position}));
+
+        glm::vec3 normal = expected.normal;
+        if (glm::length(normal) > 0.0F) {
+            float cosine = glm::dot(glm::normalize(normal),
+                                    glm::normalize(glm::vec3{actual.normal}));
+            error.normalDegrees =
+              std::max(error.normalDegrees,
+                       glm::degrees(std::acos(std::clamp(cosine, -1.0F, 1.0F))));
+        }
+
+        glm::vec2 uvError =
+          glm::abs(glm::vec2{actual.texCoord} - glm::vec2{expected.texCoord});
+        error.texCoord = std::max({error.texCoord, uvError.x, uvError.y});
+    }
+
+    error.positionRelative = diagonal > 0.0F ? error.position / diagonal : 0.0F;
+    return error;
+}
+
+glm::vec2 encodeOctahedral(glm::vec3 n)
+{
+    float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (l1 == 0.0F) {
+        return glm::vec2{0.0F};
+    }
+    n /= l1;
+    glm::vec2 e{n.x, n.y};
+    if (n.z < 0.0F) {
+        e = glm::vec2{(1.0F - std::abs(n.y)) * signNotZero(n.x),
+                      (1.0F - std::abs(n.x)) * signNotZero(n.y)};
+    }
+    return e;
+}
+
+glm::vec3 decodeOctahedral(glm::vec2 e)
+{
+    glm::vec3 n{e.x, e.y, 1.0F - std::abs(e.x) - std::abs(e.y)};
+    float t = std::max(-n.z, 0.0F);
+    n.x += n.x >= 0.0F ? -t : t;
+    n.y += n.y >= 0.0F ? -t : t;
+    return glm::normalize(n);
+}
+
+uint16_t toUnorm16(float v)
+{
+    return static_cast<uint16_t>(
+      std::lround(std::clamp(v, 0.0F, 1.0F) * 65535.0F));
+}
+
+float fromUnorm16(uint16_t v)
+{
+    return static_cast<float>(v) / 65535.0F;
+}
+
+uint16_t toHalf(float v)
+{
+    uint32_t bits = 0;
+    std::memcpy(&bits, &v, sizeof(bits));
+    auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000U);
+    uint32_t exponent = (bits >> 23) & 0xFFU;
+    uint32_t mantissa = bits & 0x7FFFFFU;
+
+    if (exponent == 0xFF) { // inf / nan
+        return static_cast<uint16_t>(sign | 0x7C00U |
+                                     (mantissa != 0 ? 0x200U : 0U));
+    }
+
+    int halfExponent = static_cast<int>(exponent) - 127 + 15;
+    if (halfExponent >= 31) {
+        return static_cast<uint16_t>(sign | 0x7C00U);
+    }
+
+    // Round to nearest even on the dropped bits
+    auto roundShift = [](uint32_t value, int shift) {
+        uint32_t result = value >> shift;
+        uint32_t remainder = value & ((1U << shift) - 1U);
+        uint32_t halfway = 1U << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (result & 1U))) {
+            ++result;
+        }
+        return result;
+    };
+
+    if (halfExponent <= 0) { // subnormal or zero
+        if (halfExponent < -10) {
+            return sign;
+        }
+        return static_cast<uint16_t>(
+          sign | roundShift(mantissa | 0x800000U, 14 - halfExponent));
+    }
+
+    // a carry out of the mantissa correctly bumps the exponent
+    return static_cast<uint16_t>(
+      sign |
+      roundShift((static_cast<uint32_t>(halfExponent) << 23) | mantissa, 13));
+}
+
+float fromHalf(uint16_t v)
+{
+    uint32_t sign = static_cast<uint32_t>(v & 0x8000U) << 16;
+    uint32_t exponent = (v >> 10) & 0x1FU;
+    uint32_t mantissa = v & 0x3FFU;
+
+    if (exponent == 0) {
+        float value = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign != 0 ? -value : value;
+    }
+
+    uint32_t bits = 0;
+    if (exponent == 31) {
+        bits = sign | 0x7F800000U | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+    float value = 0.0F;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+uint32_t toSnorm2101010(glm::vec3 v)
+{
+    auto component = [](float c) {
+        auto q = static_cast<int32_t>(
+          std::lround(std::clamp(c, -1.0F, 1.0F) * 511.0F));
+        return static_cast<uint32_t>(q) & 0x3FFU;
+    };
+    return component(v.x) | (component(v.y) << 10) | (component(v.z) << 20);
+}
+
+glm::vec3 fromSnorm2101010(uint32_t v)
+{
+    auto component = [v](int shift) {
+        // sign extend the 10-bit field
+        auto q = static_cast<int32_t>(v << (22 - shift)) >> 22;
+        return std::max(static_cast<float>(q) / 511.0F, -1.0F);
+    };
+    return {component(0), component(10), component(20)};
+}
@@ -150,3 +150,8 @@ float Window::getWidthOverHeight() const
 {
     return static_cast<float>(width) / static_cast<float>(height);
 }
+
+uint32_t Window::getHeight() const
+{
+    return height;
+}
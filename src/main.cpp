@@ -5,8 +5,14 @@
 #include "frontend/UI.hpp"
 #include "frontend/arcballController.hpp"
 #include "frontend/camera.hpp"
+#include "frontend/glState.hpp"
+#include "frontend/instancing.hpp"
 #include "frontend/loadedObj.hpp"
+#include "frontend/occlusion.hpp"
+#include "frontend/renderQueue.hpp"
+#include "frontend/sceneBvh.hpp"
 #include "frontend/shader.hpp"
+#include "frontend/texture.hpp"
 #include "frontend/worldPose.hpp"
 
 #include <tiny_obj_loader.h>
@@ -18,8 +24,11 @@
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <cmath>
 #include <filesystem>
+#include <optional>
 #include <string>
+#include <vector>
 
 namespace
 {
@@ -35,6 +44,23 @@ void setInitialOpenGLRenderConfig()
     glfwSwapInterval(1); // enable VSync
 }
 
+// `count` copies of `pose` on a square grid in the XZ plane, centred on it.
+void placeInstances(InstanceSet& instances, int count, const WorldPose& pose)
+{
+    constexpr float spacing = 2.0F;
+    int side = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count))));
+    float half = static_cast<float>(side - 1) * spacing * 0.5F;
+
+    instances.poses.resize(count);
+    for (int i = 0; i < count; ++i) {
+        WorldPose& instance = instances.poses[i];
+        instance = pose;
+        instance.position +=
+          glm::vec3{static_cast<float>(i % side) * spacing - half, 0.0F,
+                    static_cast<float>(i / side) * spacing - half};
+    }
+}
+
 void run()
 {
     GLFWContext glfwContext;
@@ -45,13 +71,34 @@ void run()
 
     ImGUIContext imGuiContext{mainWin};
 
-    LoadedObject mainModel =
-      LoadedObject("assets/models/shaderBall/shaderBall.obj");
+    // Shared by the shapes of every model; declared first, so it is gone last
+    GeometryArenas geometryArenas;
+
+    // Parsed and decoded in the background, uploaded a bit every frame
+    AsyncObjectLoad mainModelLoad{"assets/models/shaderBall/shaderBall.obj",
+                                  {.vertexFormat = VertexFormat::Quantized,
+                                   .textures = {.compression =
+                                                  TextureCompression::Auto,
+                                                .streamMips = true},
+                                   .textureArrays = true,
+                                   .arenas = &geometryArenas,
+                                   .raycastMeshes = true,
+                                   .occluders = true}};
+    LoadedObject& mainModel = mainModelLoad.object;
     mainModel.pose.scale = {0.01F, 0.01F, 0.01F};
     mainModel.pose.position = {0.0F, 0.0F, 0.0F};
 
     Shader mainShader{
-      std::filesystem::path{"shaders/simpleDiffuseTexturedPhong/vert.glsl"},
+      std::filesystem::path{
+        mainModel.vertexFormat == VertexFormat::Quantized
+          ? "shaders/simpleDiffuseTexturedPhong/vertQuantized.glsl"
+          : "shaders/simpleDiffuseTexturedPhong/vert.glsl"},
+      std::filesystem::path{"shaders/simpleDiffuseTexturedPhong/frag.glsl"}};
+    Shader instancedShader{
+      std::filesystem::path{
+        mainModel.vertexFormat == VertexFormat::Quantized
+          ? "shaders/simpleDiffuseTexturedPhong/vertQuantizedInstanced.glsl"
+          : "shaders/simpleDiffuseTexturedPhong/vertInstanced.glsl"},
       std::filesystem::path{"shaders/simpleDiffuseTexturedPhong/frag.glsl"}};
 
     Camera playerCamera{
@@ -65,10 +112,28 @@ void run()
                                      mainModel.pose.position +
                                        glm::vec3{0.0F, 1.0F, 0.0F});
 
+    // Declared after the model, so it is gone before the textures are
+    TextureStreamer textureStreamer;
+    RenderQueue renderQueue;
+    InstanceSet instances;
+
+    // Every object drawn, for culling them and picking the one under the
+    // cursor; a single one so far
+    SceneBvh scene;
+    scene.add(mainModel);
+    std::vector<const LoadedObject*> visibleObjects;
+    bool wasPivotDown = false;
+
+    // The visible objects' occluders, rasterised every frame to hide each
+    // other's shapes, and the debug view of them
+    OcclusionBuffer occlusionBuffer;
+    std::optional<Texture> occlusionView;
+    std::vector<unsigned char> occlusionImage;
+
     UIState uiState{playerCamera};
 
-    {
-        auto boundShader = mainShader.bind();
+    for (Shader* shader : {&mainShader, &instancedShader}) {
+        auto boundShader = shader->bind();
         mainModel.setInitUniforms(boundShader);
     }
 
@@ -118,24 +183,107 @@ void run()
               glfwGetMouseButton(mainWin.getWindow(), GLFW_MOUSE_BUTTON_LEFT) ==
               GLFW_PRESS;
             updateArcball(arcball, mouseDown, glm::vec2(mouseX, mouseY));
+
+            // Right click orbits the surface under the cursor from then on
+            bool pivotDown = glfwGetMouseButton(mainWin.getWindow(),
+                                                GLFW_MOUSE_BUTTON_RIGHT) ==
+                             GLFW_PRESS;
+            if (pivotDown && !wasPivotDown) {
+                int windowWidth = 0;
+                int windowHeight = 0;
+                glfwGetWindowSize(mainWin.getWindow(), &windowWidth,
+                                  &windowHeight);
+                Ray ray = rayThroughCursor(
+                  playerCamera, glm::vec2(mouseX, mouseY),
+                  glm::vec2(windowWidth, windowHeight));
+                if (auto hit = scene.raycast(ray)) {
+                    arcball.pivotOn(hit->position);
+                }
+            }
+            wasPivotDown = pivotDown;
             playerCamera.position = arcball.getPosition();
             playerCamera.target = arcball.target;
         }
 
-        glm::mat4 view = playerCamera.computeViewMatrix();
-        glm::mat4 projection = playerCamera.computeProjectionMatrix();
+        // Keep frame times flat while the model streams in
+        uiState.modelLoadStatus = mainModelLoad.commitUploads(2.0);
+        uiState.modelShapesUploaded = mainModelLoad.getUploadedShapeCount();
+        uiState.modelShapeCount = mainModelLoad.getShapeCount();
 
+        // Objects only submit their draws; the queue sorts them by state and
+        // binds the shader itself
+        renderQueue.begin(playerCamera, uiState.lighting);
+        uiState.drawSettings.viewportHeight =
+          static_cast<float>(mainWin.getHeight());
+        scene.update();
+        visibleObjects.clear();
+        scene.cull(Frustum{playerCamera}, visibleObjects);
+        uiState.sceneObjects = scene.size();
+        uiState.sceneObjectsVisible = visibleObjects.size();
+        const OcclusionBuffer* occlusion = nullptr;
+        if (uiState.drawSettings.occlusionCulling &&
+            uiState.instanceCount == 0)
         {
-            auto boundShader = mainShader.bind();
-            boundShader.setUniform("view", view);
-            boundShader.setUniform("projection", projection);
-            boundShader.setUniform("viewPos", playerCamera.position);
+            // 256 pixels across, fmin also catching a minimised window
+            constexpr float occlusionWidth = 256.0F;
+            occlusionBuffer.resize(
+              static_cast<int>(occlusionWidth),
+              static_cast<int>(std::fmin(
+                occlusionWidth / playerCamera.aspectRatio, occlusionWidth)));
+            occlusionBuffer.begin(playerCamera);
+            for (const LoadedObject* object : visibleObjects) {
+                object->addOccluders(occlusionBuffer);
+            }
+            occlusionBuffer.rasterise();
+            occlusion = &occlusionBuffer;
+            uiState.occlusionStats = occlusionBuffer.getStats();
+        }
+        if (uiState.instanceCount == 0) {
+            uiState.drawStats = {};
+            for (const LoadedObject* object : visibleObjects) {
+                uiState.drawStats +=
+                  object->submit(renderQueue, mainShader, playerCamera,
+                                 uiState.drawSettings, occlusion);
+            }
+        }
+        uiState.renderStats = renderQueue.execute();
+        if (uiState.instanceCount > 0) {
+            // after the queue, which has bound the Camera block
+            placeInstances(instances, uiState.instanceCount, mainModel.pose);
+            auto boundShader = instancedShader.bind();
+            uiState.drawStats = mainModel.drawInstanced(
+              boundShader, instances, playerCamera, uiState.drawSettings);
+        }
+
+        // Sharpens (or frees) textures for the next frames
+        mainModel.requestTextureLevels(playerCamera, uiState.drawSettings,
+                                       textureStreamer);
+        uiState.textureStreamingStats =
+          textureStreamer.update(uiState.textureStreamingSettings);
+
+        uiState.glStateStats = GLState::current().takeStats();
+        uiState.geometryArenaStats = geometryArenas.getStats();
 
-            // The draw call now handles binding textures and drawing the mesh
-            mainModel.draw(boundShader);
+        uiState.occlusionTexture = 0;
+        if (uiState.showOcclusionBuffer && occlusion != nullptr) {
+            occlusionBuffer.writeDebugImage(occlusionImage);
+            int width = occlusionBuffer.getWidth();
+            int height = occlusionBuffer.getHeight();
+            if (occlusionView && occlusionView->getWidth() == width &&
+                occlusionView->getHeight() == height)
+            {
+                occlusionView->update(occlusionImage.data());
+            } else {
+                occlusionView.emplace(width, height, occlusionImage.data());
+            }
+            uiState.occlusionTexture = occlusionView->getId();
+            uiState.occlusionTextureSize =
+              ImVec2(static_cast<float>(width), static_cast<float>(height));
         }
 
         drawImGuiAndUpdateState(uiState);
+        // ImGui binds behind the state cache's back
+        GLState::current().invalidate();
         mainWin.endUpdate();
         lastFrameTime = glfwGetTime();
     }
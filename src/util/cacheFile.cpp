@@ -0,0 +1,136 @@
+#include "util/cacheFile.hpp"
+
+#include "util/error.hpp"
+#include "util/hash.hpp"
+#include "util/mappedFile.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <format>
+#include <random>
+#include <system_error>
+#include <utility>
+
+namespace
+{
+// A name no other writer, in this process or another, is using: a random
+// number drawn once per process and a count of the writers it started.
+std::filesystem::path uniqueTmpPath(const std::filesystem::path& path)
+{
+    static const uint64_t processTag = [] {
+        std::random_device random;
+        return (static_cast<uint64_t>(random()) << 32) ^ random();
+    }();
+    static std::atomic<uint64_t> writers{0};
+
+    std::filesystem::path tmpPath = path;
+    tmpPath += std::format(".{:016x}.{}.tmp", processTag, writers++);
+    return tmpPath;
+}
+} // namespace
+
+std::optional<CacheFile::Stamp>
+CacheFile::stampOf(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return {};
+    }
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec) {
+        return {};
+    }
+    return Stamp{.size = static_cast<uint64_t>(size),
+                 .mtime =
+                   static_cast<int64_t>(mtime.time_since_epoch().count())};
+}
+
+uint64_t CacheFile::hashOf(const std::filesystem::path& path)
+{
+    MappedFile file{path};
+    file.adviseSequential();
+    return Hash::bytes(file.data(), file.size());
+}
+
+bool CacheFile::matchesSource(const std::filesystem::path& source,
+                              const Stamp& stamp, uint64_t size,
+                              int64_t mtime, uint64_t hash, bool& touched)
+{
+    touched = false;
+    if (size != stamp.size) {
+        return false;
+    }
+    if (mtime == stamp.mtime) {
+        return true;
+    }
+    if (hashOf(source) != hash) {
+        return false;
+    }
+    touched = true;
+    return true;
+}
+
+void CacheFile::refreshMtime(const std::filesystem::path& cachePath,
+                             uint64_t offset, int64_t mtime)
+{
+    std::fstream patch{cachePath,
+                       std::ios::binary | std::ios::in | std::ios::out};
+    if (patch.is_open()) {
+        patch.seekp(static_cast<std::streamoff>(offset));
+        patch.write(reinterpret_cast<const char*>(&mtime), sizeof(mtime));
+    }
+}
+
+CacheFile::Writer::Writer(std::filesystem::path path, std::string what)
+  : path{std::move(path)}, tmpPath{uniqueTmpPath(this->path)},
+    what{std::move(what)}, out{tmpPath, std::ios::binary | std::ios::trunc}
+{
+    if (!out.is_open()) {
+        throw IrrecoverableError{"Could not open " + this->what +
+                                 " for writing: " + tmpPath.string()};
+    }
+}
+
+CacheFile::Writer::~Writer()
+{
+    if (!committed) {
+        out.close();
+        std::error_code ec;
+        std::filesystem::remove(tmpPath, ec);
+    }
+}
+
+void CacheFile::Writer::write(const void* data, size_t size)
+{
+    out.write(static_cast<const char*>(data),
+              static_cast<std::streamsize>(size));
+    offset += size;
+}
+
+void CacheFile::Writer::padTo(uint64_t target)
+{
+    static constexpr std::array<char, sectionAlignment> zeros{};
+    while (offset < target) {
+        size_t n = std::min<uint64_t>(target - offset, zeros.size());
+        write(zeros.data(), n);
+    }
+}
+
+void CacheFile::Writer::commit()
+{
+    out.close();
+    if (!out.good()) {
+        throw IrrecoverableError{"Failed writing " + what + ": " +
+                                 tmpPath.string()};
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        throw IrrecoverableError{"Could not replace " + what + ": " +
+                                 path.string()};
+    }
+    committed = true;
+}
@@ -6,3 +6,8 @@ IrrecoverableError::IrrecoverableError(std::string msg) : msg{std::move(msg)}
     Logger::enable();
     Logger::log(std::string{">>> ERROR: "} + this->msg, true);
 }
+
+const char* IrrecoverableError::what() const noexcept
+{
+    return msg.c_str();
+}
@@ -0,0 +1,173 @@
+#include "util/mappedFile.hpp"
+#include "util/error.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+    HANDLE file =
+      CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw IrrecoverableError{"Could not open file for mapping: " +
+                                 path.string()};
+    }
+    fileHandle = file;
+
+    LARGE_INTEGER fileSize{};
+    if (GetFileSizeEx(file, &fileSize) == 0) {
+        release();
+        throw IrrecoverableError{"Could not stat file for mapping: " +
+                                 path.string()};
+    }
+    mappedSize = static_cast<size_t>(fileSize.QuadPart);
+    if (mappedSize == 0) {
+        return;
+    }
+
+    HANDLE mapping =
+      CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        release();
+        throw IrrecoverableError{"Could not map file: " + path.string()};
+    }
+    mappingHandle = mapping;
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        release();
+        throw IrrecoverableError{"Could not map file: " + path.string()};
+    }
+    mappedData = static_cast<const std::byte*>(view);
+}
+
+void MappedFile::release() noexcept
+{
+    if (mappedData != nullptr) {
+        UnmapViewOfFile(mappedData);
+    }
+    if (mappingHandle != nullptr) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != nullptr) {
+        CloseHandle(fileHandle);
+    }
+    mappedData = nullptr;
+    mappedSize = 0;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+}
+
+void MappedFile::adviseSequential() const
+{
+    // FILE_FLAG_SEQUENTIAL_SCAN at open time already covers this.
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+  : mappedData{std::exchange(other.mappedData, nullptr)},
+    mappedSize{std::exchange(other.mappedSize, 0)},
+    fileHandle{std::exchange(other.fileHandle, nullptr)},
+    mappingHandle{std::exchange(other.mappingHandle, nullptr)}
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        mappedData = std::exchange(other.mappedData, nullptr);
+        mappedSize = std::exchange(other.mappedSize, 0);
+        fileHandle = std::exchange(other.fileHandle, nullptr);
+        mappingHandle = std::exchange(other.mappingHandle, nullptr);
+    }
+    return *this;
+}
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw IrrecoverableError{"Could not open file for mapping: " +
+                                 path.string()};
+    }
+
+    struct stat info{};
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw IrrecoverableError{"Could not stat file for mapping: " +
+                                 path.string()};
+    }
+
+    mappedSize = static_cast<size_t>(info.st_size);
+    if (mappedSize == 0) {
+        close(fd);
+        return;
+    }
+
+    void* addr = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    close(fd);
+
+    if (addr == MAP_FAILED) {
+        mappedSize = 0;
+        throw IrrecoverableError{"Could not map file: " + path.string()};
+    }
+    mappedData = static_cast<const std::byte*>(addr);
+}
+
+void MappedFile::release() noexcept
+{
+    if (mappedData != nullptr) {
+        munmap(const_cast<std::byte*>(mappedData), mappedSize);
+    }
+    mappedData = nullptr;
+    mappedSize = 0;
+}
+
+void MappedFile::adviseSequential() const
+{
+    if (mappedData != nullptr) {
+        auto* addr = const_cast<std::byte*>(mappedData);
+        madvise(addr, mappedSize, MADV_SEQUENTIAL);
+        madvise(addr, mappedSize, MADV_WILLNEED);
+    }
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+  : mappedData{std::exchange(other.mappedData, nullptr)},
+    mappedSize{std::exchange(other.mappedSize, 0)}
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        mappedData = std::exchange(other.mappedData, nullptr);
+        mappedSize = std::exchange(other.mappedSize, 0);
+    }
+    return *this;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+    release();
+}
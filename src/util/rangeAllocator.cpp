@@ -0,0 +1,95 @@
+#include "util/rangeAllocator.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+RangeAllocator::RangeAllocator(size_t capacity) : capacity{capacity}
+{
+    if (capacity > 0) {
+        freeRanges.push_back({.offset = 0, .count = capacity});
+    }
+}
+
+std::optional<size_t> RangeAllocator::allocate(size_t count)
+{
+    if (count == 0) {
+        return std::nullopt;
+    }
+    auto fit = std::ranges::find_if(freeRanges, [count](const Range& range) {
+        return range.count >= count;
+    });
+    if (fit == freeRanges.end()) {
+        return std::nullopt;
+    }
+
+    size_t offset = fit->offset;
+    fit->offset += count;
+    fit->count -= count;
+    if (fit->count == 0) {
+        freeRanges.erase(fit);
+    }
+    used += count;
+    return offset;
+}
+
+void RangeAllocator::free(size_t offset, size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    used -= count;
+
+    auto next = std::ranges::lower_bound(freeRanges, offset, {}, &Range::offset);
+    bool joinsPrevious = next != freeRanges.begin() &&
+                         std::prev(next)->offset + std::prev(next)->count ==
+                           offset;
+    bool joinsNext = next != freeRanges.end() && offset + count == next->offset;
+
+    if (joinsPrevious && joinsNext) {
+        std::prev(next)->count += count + next->count;
+        freeRanges.erase(next);
+    } else if (joinsPrevious) {
+        std::prev(next)->count += count;
+    } else if (joinsNext) {
+        next->offset = offset;
+        next->count += count;
+    } else {
+        freeRanges.insert(next, {.offset = offset, .count = count});
+    }
+}
+
+void RangeAllocator::grow(size_t newCapacity)
+{
+    if (newCapacity <= capacity) {
+        return;
+    }
+    size_t added = newCapacity - capacity;
+    if (!freeRanges.empty() &&
+        freeRanges.back().offset + freeRanges.back().count == capacity)
+    {
+        freeRanges.back().count += added;
+    } else {
+        freeRanges.push_back({.offset = capacity, .count = added});
+    }
+    capacity = newCapacity;
+}
+
+void RangeAllocator::reset(size_t usedCount)
+{
+    used = usedCount;
+    freeRanges.clear();
+    if (used < capacity) {
+        freeRanges.push_back({.offset = used, .count = capacity - used});
+    }
+}
+
+size_t RangeAllocator::getFreeInHoles() const
+{
+    size_t holes = capacity - used;
+    if (!freeRanges.empty() &&
+        freeRanges.back().offset + freeRanges.back().count == capacity)
+    {
+        holes -= freeRanges.back().count;
+    }
+    return holes;
+}